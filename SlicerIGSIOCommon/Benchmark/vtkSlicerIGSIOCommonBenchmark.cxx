@@ -0,0 +1,481 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+/// Measures the throughput of the SlicerIGSIOCommon conversion functions and of the codec and Matroska IO paths
+/// on synthetic video sequences. Results are printed as JSON, so that runs can be compared by scripts.
+///
+/// Usage: vtkSlicerIGSIOCommonBenchmark [--width 640] [--height 480] [--components 3] [--frames 300]
+///   [--import-frames 1000 10000 100000] [--codecs RV24 VP90] [--threads 1] [--temp-directory .] [--output results.json]
+
+// std includes
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// Sequences includes
+#include <vtkMRMLSequenceBrowserNode.h>
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodecFactory.h>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkVP9VolumeCodec.h>
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOCommon.h"
+
+//----------------------------------------------------------------------------
+struct BenchmarkResult
+{
+  std::string Name;
+  std::string CodecFourCC;
+  bool Success;
+  int NumberOfFrames;
+  double Seconds;
+  /// Size of the uncompressed frames that were processed
+  unsigned long long NumberOfBytes;
+  /// Peak resident set size of the process at the end of the stage. Monotonic, since it is the high-water mark of the process.
+  unsigned long long PeakResidentSetSize;
+  /// Size of the written file, if the stage writes a file
+  unsigned long long FileSize;
+  BenchmarkResult()
+    : Success(false)
+    , NumberOfFrames(0)
+    , Seconds(0.0)
+    , NumberOfBytes(0)
+    , PeakResidentSetSize(0)
+    , FileSize(0)
+  {
+  }
+};
+
+//----------------------------------------------------------------------------
+// Peak physical memory used by the process (in bytes)
+unsigned long long GetPeakResidentSetSize()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS memoryCounters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+  {
+    return memoryCounters.PeakWorkingSetSize;
+  }
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024ULL;
+#endif
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Fill the image with a horizontal and vertical gradient, with the remaining components set to the frame value
+void SetBenchmarkImageDataForValue(vtkImageData* image, unsigned char value)
+{
+  int dimensions[3] = { 0,0,0 };
+  image->GetDimensions(dimensions);
+  int numberOfComponents = image->GetNumberOfScalarComponents();
+
+  unsigned char* imageDataScalars = (unsigned char*)image->GetScalarPointer();
+  for (int y = 0; y < dimensions[1]; ++y)
+  {
+    for (int x = 0; x < dimensions[0]; ++x)
+    {
+      unsigned char red = 255 * (x / (double)dimensions[0]);
+      unsigned char green = 255 * (y / (double)dimensions[1]);
+      for (int component = 0; component < numberOfComponents; ++component)
+      {
+        switch (component)
+        {
+        case 0:
+          imageDataScalars[component] = numberOfComponents == 1 ? (unsigned char)((red + green + value) / 3) : red;
+          break;
+        case 1:
+          imageDataScalars[component] = green;
+          break;
+        default:
+          imageDataScalars[component] = value;
+          break;
+        }
+      }
+      imageDataScalars += numberOfComponents;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void CreateBenchmarkImages(int width, int height, int numberOfComponents, int numberOfFrames, std::vector<vtkSmartPointer<vtkImageData> >& images)
+{
+  images.clear();
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, numberOfComponents);
+    SetBenchmarkImageDataForValue(imageData, (unsigned char)(i % 256));
+    images.push_back(imageData);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Measure how the time of importing a tracked frame list into a sequence scales with the number of frames.
+// Small frames are used, so that the per-frame overhead of creating the items dominates over copying the images.
+BenchmarkResult BenchmarkTrackedFrameListImport(vtkMRMLScene* scene, int numberOfFrames)
+{
+  const int width = 16;
+  const int height = 16;
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  CreateBenchmarkImages(width, height, 1, std::min(numberOfFrames, 256), images);
+
+  vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    igsioTrackedFrame trackedFrame;
+    trackedFrame.GetImageData()->DeepCopyFrom(images[i % images.size()]);
+    trackedFrame.SetTimestamp(i / 30.0);
+    trackedFrameList->AddTrackedFrame(&trackedFrame);
+  }
+
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode);
+
+  BenchmarkResult result;
+  result.Name = "TrackedFrameListToVolumeSequenceScaling";
+  result.NumberOfFrames = numberOfFrames;
+  result.NumberOfBytes = (unsigned long long)width * height * numberOfFrames;
+  double startTime = vtkTimerLog::GetUniversalTime();
+  result.Success = vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(trackedFrameList.GetPointer(), sequenceNode.GetPointer(), true);
+  result.Seconds = vtkTimerLog::GetUniversalTime() - startTime;
+  result.PeakResidentSetSize = GetPeakResidentSetSize();
+  scene->RemoveNode(sequenceNode);
+  return result;
+}
+
+//----------------------------------------------------------------------------
+// Sequence of streaming volume nodes that contain the uncompressed images, as they are after recording
+void CreateUncompressedVideoSequence(const std::vector<vtkSmartPointer<vtkImageData> >& images, vtkMRMLSequenceNode* sequenceNode)
+{
+  sequenceNode->SetIndexName("time");
+  sequenceNode->SetIndexUnit("s");
+  for (int i = 0; i < (int)images.size(); ++i)
+  {
+    vtkNew<vtkMRMLStreamingVolumeNode> streamingVolumeNode;
+    streamingVolumeNode->SetName("Video");
+    streamingVolumeNode->SetAndObserveImageData(images[i]);
+    std::stringstream timestampSS;
+    timestampSS << i / 30.0;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode.GetPointer(), timestampSS.str());
+  }
+}
+
+//----------------------------------------------------------------------------
+void PrintBenchmarkResults(std::ostream& os, int width, int height, int numberOfComponents, int numberOfFrames, int numberOfThreads,
+  const std::vector<BenchmarkResult>& results)
+{
+  os << "{" << std::endl;
+  os << "  \"parameters\": {"
+    << "\"width\": " << width << ", "
+    << "\"height\": " << height << ", "
+    << "\"components\": " << numberOfComponents << ", "
+    << "\"frames\": " << numberOfFrames << ", "
+    << "\"threads\": " << numberOfThreads << "}," << std::endl;
+  os << "  \"results\": [" << std::endl;
+  for (std::vector<BenchmarkResult>::const_iterator resultIt = results.begin(); resultIt != results.end(); ++resultIt)
+  {
+    double framesPerSecond = resultIt->Seconds > 0.0 ? resultIt->NumberOfFrames / resultIt->Seconds : 0.0;
+    double megabytesPerSecond = resultIt->Seconds > 0.0 ? resultIt->NumberOfBytes / (1024.0 * 1024.0) / resultIt->Seconds : 0.0;
+    os << "    {"
+      << "\"name\": \"" << resultIt->Name << "\", "
+      << "\"codec\": \"" << resultIt->CodecFourCC << "\", "
+      << "\"success\": " << (resultIt->Success ? "true" : "false") << ", "
+      << "\"frames\": " << resultIt->NumberOfFrames << ", "
+      << "\"seconds\": " << resultIt->Seconds << ", "
+      << "\"framesPerSecond\": " << framesPerSecond << ", "
+      << "\"megabytesPerSecond\": " << megabytesPerSecond << ", "
+      << "\"fileSizeBytes\": " << resultIt->FileSize << ", "
+      << "\"peakResidentSetSizeBytes\": " << resultIt->PeakResidentSetSize << "}"
+      << (resultIt + 1 != results.end() ? "," : "") << std::endl;
+  }
+  os << "  ]" << std::endl;
+  os << "}" << std::endl;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int width = 640;
+  int height = 480;
+  int numberOfComponents = 3;
+  int numberOfFrames = 300;
+  int numberOfThreads = 1;
+  std::vector<int> importFrameCounts;
+  std::vector<std::string> codecFourCCs;
+  std::string tempDirectory = ".";
+  std::string outputFileName;
+  bool printHelp = false;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--width", vtksys::CommandLineArguments::SPACE_ARGUMENT, &width, "Width of the frames (default: 640).");
+  args.AddArgument("--height", vtksys::CommandLineArguments::SPACE_ARGUMENT, &height, "Height of the frames (default: 480).");
+  args.AddArgument("--components", vtksys::CommandLineArguments::SPACE_ARGUMENT, &numberOfComponents, "Number of channels of the frames (default: 3).");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::SPACE_ARGUMENT, &numberOfFrames, "Number of frames in the sequence (default: 300).");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::SPACE_ARGUMENT, &numberOfThreads, "Number of threads used for re-encoding (default: 1).");
+  args.AddArgument("--import-frames", vtksys::CommandLineArguments::MULTI_ARGUMENT, &importFrameCounts,
+    "Numbers of (16x16) frames that the import time is measured for (default: 1000 10000 100000).");
+  args.AddArgument("--codecs", vtksys::CommandLineArguments::MULTI_ARGUMENT, &codecFourCCs, "FourCC of the codecs to benchmark (default: RV24 VP90).");
+  args.AddArgument("--temp-directory", vtksys::CommandLineArguments::SPACE_ARGUMENT, &tempDirectory, "Directory of the temporary MKV files (default: current directory).");
+  args.AddArgument("--output", vtksys::CommandLineArguments::SPACE_ARGUMENT, &outputFileName, "JSON file that the results are written to (default: standard output).");
+  if (!args.Parse() || printHelp)
+  {
+    std::cerr << "Help: " << args.GetHelp() << std::endl;
+    return printHelp ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if (width < 1 || height < 1 || numberOfComponents < 1 || numberOfFrames < 1)
+  {
+    std::cerr << "Invalid frame size or number of frames" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (importFrameCounts.empty())
+  {
+    importFrameCounts.push_back(1000);
+    importFrameCounts.push_back(10000);
+    importFrameCounts.push_back(100000);
+  }
+  if (codecFourCCs.empty())
+  {
+    codecFourCCs.push_back("RV24");
+    codecFourCCs.push_back("VP90");
+  }
+
+  vtkStreamingVolumeCodecFactory* codecFactory = vtkStreamingVolumeCodecFactory::GetInstance();
+  codecFactory->RegisterStreamingCodec(vtkSmartPointer<vtkVP9VolumeCodec>::New());
+
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  CreateBenchmarkImages(width, height, numberOfComponents, numberOfFrames, images);
+  unsigned long long numberOfBytes = (unsigned long long)width * height * numberOfComponents * numberOfFrames;
+
+  std::vector<BenchmarkResult> results;
+  vtkNew<vtkMRMLScene> scene;
+
+  // Import of uncompressed frames
+  {
+    vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      igsioTrackedFrame trackedFrame;
+      trackedFrame.GetImageData()->DeepCopyFrom(images[i]);
+      trackedFrame.SetTimestamp(i / 30.0);
+      trackedFrameList->AddTrackedFrame(&trackedFrame);
+    }
+
+    vtkNew<vtkMRMLSequenceNode> sequenceNode;
+    scene->AddNode(sequenceNode);
+
+    BenchmarkResult result;
+    result.Name = "TrackedFrameListToVolumeSequence";
+    result.NumberOfFrames = numberOfFrames;
+    result.NumberOfBytes = numberOfBytes;
+    double startTime = vtkTimerLog::GetUniversalTime();
+    result.Success = vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(trackedFrameList.GetPointer(), sequenceNode.GetPointer());
+    result.Seconds = vtkTimerLog::GetUniversalTime() - startTime;
+    result.PeakResidentSetSize = GetPeakResidentSetSize();
+    results.push_back(result);
+    scene->RemoveNode(sequenceNode);
+  }
+
+  // Import time as a function of the number of frames
+  for (std::vector<int>::iterator importFrameCountIt = importFrameCounts.begin(); importFrameCountIt != importFrameCounts.end(); ++importFrameCountIt)
+  {
+    if (*importFrameCountIt > 0)
+    {
+      results.push_back(BenchmarkTrackedFrameListImport(scene.GetPointer(), *importFrameCountIt));
+    }
+  }
+
+  // Import of uncompressed frames and a transform that are in reverse chronological order, releasing the tracked frames
+  {
+    vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+    vtkNew<vtkMatrix4x4> probeToTrackerTransform;
+    igsioTransformName probeToTrackerName("Probe", "Tracker");
+    for (int i = numberOfFrames - 1; i >= 0; --i)
+    {
+      igsioTrackedFrame trackedFrame;
+      trackedFrame.GetImageData()->DeepCopyFrom(images[i]);
+      trackedFrame.SetTimestamp(i / 30.0);
+      probeToTrackerTransform->SetElement(0, 3, i);
+      trackedFrame.SetFrameTransform(probeToTrackerName, probeToTrackerTransform.GetPointer());
+      trackedFrameList->AddTrackedFrame(&trackedFrame);
+    }
+
+    vtkNew<vtkMRMLSequenceBrowserNode> sequenceBrowserNode;
+    scene->AddNode(sequenceBrowserNode);
+
+    BenchmarkResult result;
+    result.Name = "TrackedFrameListToSequenceBrowserUnsorted";
+    result.NumberOfFrames = numberOfFrames;
+    result.NumberOfBytes = numberOfBytes;
+    double startTime = vtkTimerLog::GetUniversalTime();
+    result.Success = vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(trackedFrameList.GetPointer(), sequenceBrowserNode.GetPointer(), true);
+    result.Seconds = vtkTimerLog::GetUniversalTime() - startTime;
+    result.PeakResidentSetSize = GetPeakResidentSetSize();
+    results.push_back(result);
+
+    std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+    sequenceBrowserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+    for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+    {
+      scene->RemoveNode(*sequenceNodeIt);
+    }
+    scene->RemoveNode(sequenceBrowserNode);
+  }
+
+  for (std::vector<std::string>::iterator codecIt = codecFourCCs.begin(); codecIt != codecFourCCs.end(); ++codecIt)
+  {
+    std::string codecFourCC = *codecIt;
+    vtkNew<vtkMRMLSequenceNode> sequenceNode;
+    scene->AddNode(sequenceNode);
+    CreateUncompressedVideoSequence(images, sequenceNode.GetPointer());
+
+    BenchmarkResult encodeResult;
+    encodeResult.Name = "ReEncodeVideoSequence";
+    encodeResult.CodecFourCC = codecFourCC;
+    encodeResult.NumberOfFrames = numberOfFrames;
+    encodeResult.NumberOfBytes = numberOfBytes;
+    double startTime = vtkTimerLog::GetUniversalTime();
+    encodeResult.Success = vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC,
+      std::map<std::string, std::string>(), false, false, numberOfThreads);
+    encodeResult.Seconds = vtkTimerLog::GetUniversalTime() - startTime;
+    encodeResult.PeakResidentSetSize = GetPeakResidentSetSize();
+    results.push_back(encodeResult);
+    if (!encodeResult.Success)
+    {
+      scene->RemoveNode(sequenceNode);
+      continue;
+    }
+
+    vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+    BenchmarkResult exportResult;
+    exportResult.Name = "VolumeSequenceToTrackedFrameList";
+    exportResult.CodecFourCC = codecFourCC;
+    exportResult.NumberOfFrames = numberOfFrames;
+    exportResult.NumberOfBytes = numberOfBytes;
+    startTime = vtkTimerLog::GetUniversalTime();
+    exportResult.Success = vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(sequenceNode.GetPointer(), trackedFrameList.GetPointer());
+    exportResult.Seconds = vtkTimerLog::GetUniversalTime() - startTime;
+    exportResult.PeakResidentSetSize = GetPeakResidentSetSize();
+    results.push_back(exportResult);
+    scene->RemoveNode(sequenceNode);
+    if (!exportResult.Success)
+    {
+      continue;
+    }
+
+    std::string fileName = tempDirectory + "/vtkSlicerIGSIOCommonBenchmark_" + codecFourCC + ".mkv";
+    BenchmarkResult writeResult;
+    writeResult.Name = "MkvWrite";
+    writeResult.CodecFourCC = codecFourCC;
+    writeResult.NumberOfFrames = numberOfFrames;
+    writeResult.NumberOfBytes = numberOfBytes;
+    startTime = vtkTimerLog::GetUniversalTime();
+    writeResult.Success = vtkIGSIOSequenceIO::Write(fileName, trackedFrameList.GetPointer()) == IGSIO_SUCCESS;
+    writeResult.Seconds = vtkTimerLog::GetUniversalTime() - startTime;
+    writeResult.PeakResidentSetSize = GetPeakResidentSetSize();
+    writeResult.FileSize = vtksys::SystemTools::FileLength(fileName);
+    results.push_back(writeResult);
+    trackedFrameList->Clear();
+    if (!writeResult.Success)
+    {
+      vtksys::SystemTools::RemoveFile(fileName);
+      continue;
+    }
+
+    vtkNew<vtkIGSIOTrackedFrameList> readTrackedFrameList;
+    BenchmarkResult readResult;
+    readResult.Name = "MkvRead";
+    readResult.CodecFourCC = codecFourCC;
+    readResult.NumberOfFrames = numberOfFrames;
+    readResult.NumberOfBytes = numberOfBytes;
+    startTime = vtkTimerLog::GetUniversalTime();
+    readResult.Success = vtkIGSIOSequenceIO::Read(fileName, readTrackedFrameList.GetPointer()) == IGSIO_SUCCESS;
+    readResult.Seconds = vtkTimerLog::GetUniversalTime() - startTime;
+    readResult.PeakResidentSetSize = GetPeakResidentSetSize();
+    readResult.FileSize = writeResult.FileSize;
+    results.push_back(readResult);
+    vtksys::SystemTools::RemoveFile(fileName);
+  }
+
+  if (outputFileName.empty())
+  {
+    PrintBenchmarkResults(std::cout, width, height, numberOfComponents, numberOfFrames, numberOfThreads, results);
+  }
+  else
+  {
+    std::ofstream outputFile(outputFileName.c_str());
+    if (!outputFile)
+    {
+      std::cerr << "Could not write results to " << outputFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    PrintBenchmarkResults(outputFile, width, height, numberOfComponents, numberOfFrames, numberOfThreads, results);
+  }
+
+  for (std::vector<BenchmarkResult>::iterator resultIt = results.begin(); resultIt != results.end(); ++resultIt)
+  {
+    if (!resultIt->Success)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -22,6 +22,12 @@ Care Ontario.
 #include <igsioTrackedFrame.h>
 #include <igsioVideoFrame.h>
 #include "vtkSlicerIGSIOCommon.h"
+#include "vtkSlicerIGSIOImagePool.h"
+#include "vtkSlicerIGSIOInstrumentation.h"
+#include "vtkSlicerIGSIOLosslessVolumeCodec.h"
+#include "vtkSlicerIGSIOMkvFrameIndex.h"
+#include "vtkSlicerIGSIOMkvStreamingVolumeFrame.h"
+#include "vtkSlicerIGSIOTransformTrack.h"
 #include "vtkStreamingVolumeCodec.h"
 #include <vtkIGSIOTrackedFrameList.h>
 
@@ -37,15 +43,32 @@ Care Ontario.
 #include <vtkMRMLSelectionNode.h>
 
 // VTK includes
+#include <vtkCollection.h>
+#include <vtkImageData.h>
 #include <vtkMatrix4x4.h>
+#include <vtkNew.h>
 
 // vtkSequenceIO includes
 #include <vtkIGSIOMkvSequenceIO.h>
-
+#include <vtkIGSIOSequenceIO.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
 #include <stack>
+#include <thread>
+
+// Number of frame buffers that are cycled between the decoding and encoding stages of transcoding
+static const int TRANSCODING_NUMBER_OF_FRAME_BUFFERS = 4;
 
-std::string FRAME_STATUS_TRACKNAME = "FrameStatus";
-std::string TRACKNAME_FIELD_NAME = "TrackName";
+static const std::string FRAME_STATUS_TRACKNAME = "FrameStatus";
+static const std::string TRACKNAME_FIELD_NAME = "TrackName";
+// Frame field that marks the single-component frames of codecs that are not grayscale codecs
+// (luma-only frames, and single-component frames of the lossless codec)
+static const std::string GRAYSCALE_FIELD_NAME = "Grayscale";
 enum FrameStatus
 {
   Frame_OK,
@@ -54,13 +77,70 @@ enum FrameStatus
 };
 
 //----------------------------------------------------------------------------
-bool vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceNode* sequenceNode)
+// Flag the tracked frame as grayscale if the number of components of the encoded frame is not implied by its codec
+static void SetGrayscaleFrameField(igsioTrackedFrame& trackedFrame, vtkStreamingVolumeFrame* frame)
+{
+  if (frame && frame->GetNumberOfComponents() == 1 && !vtkSlicerIGSIOCommon::IsGrayscaleCodec(frame->GetCodecFourCC()))
+  {
+    trackedFrame.SetFrameField(GRAYSCALE_FIELD_NAME, "1");
+  }
+}
+
+//----------------------------------------------------------------------------
+static bool IsGrayscaleFrameField(const char* grayscale)
+{
+  return grayscale && vtkVariant(grayscale).ToInt() == 1;
+}
+
+//----------------------------------------------------------------------------
+static bool TrackedFrameListToVolumeSequenceInternal(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceNode* sequenceNode,
+  bool transferOwnership, bool releaseFrames);
+
+//----------------------------------------------------------------------------
+// Returns the indices of the tracked frames in the order in which they should be imported.
+// Frames are imported in chronological order, so that each frame is appended to the end of the sequence.
+// If preserveDecodingOrder is enabled and the list contains encoded frames, the list order is kept, since that is their decoding order.
+// Frames with the same timestamp keep their relative order. The tracked frame list itself is not modified.
+static void GetTrackedFrameImportOrder(vtkIGSIOTrackedFrameList* trackedFrameList, bool preserveDecodingOrder, std::vector<int>& frameOrder)
+{
+  int numberOfTrackedFrames = trackedFrameList->GetNumberOfTrackedFrames();
+  frameOrder.resize(numberOfTrackedFrames);
+  std::vector<double> timestamps(numberOfTrackedFrames);
+  bool encodedFrameFound = false;
+  for (int i = 0; i < numberOfTrackedFrames; ++i)
+  {
+    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i);
+    frameOrder[i] = i;
+    timestamps[i] = trackedFrame->GetTimestamp();
+    encodedFrameFound = encodedFrameFound || (preserveDecodingOrder && trackedFrame->GetImageData()->IsFrameEncoded());
+  }
+  if (encodedFrameFound || std::is_sorted(timestamps.begin(), timestamps.end()))
+  {
+    return;
+  }
+  std::stable_sort(frameOrder.begin(), frameOrder.end(),
+    [&timestamps](int frameA, int frameB) { return timestamps[frameA] < timestamps[frameB]; });
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceNode* sequenceNode,
+  bool transferOwnership/*=false*/)
+{
+  return TrackedFrameListToVolumeSequenceInternal(trackedFrameList, sequenceNode, transferOwnership, transferOwnership);
+}
+
+//----------------------------------------------------------------------------
+// If transferOwnership is enabled, uncompressed images are attached to the data nodes of the sequence without copying them.
+// If releaseFrames is enabled, each tracked frame is removed from the list once it has been imported.
+static bool TrackedFrameListToVolumeSequenceInternal(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceNode* sequenceNode,
+  bool transferOwnership, bool releaseFrames)
 {
   if (!trackedFrameList || !sequenceNode)
   {
     vtkErrorWithObjectMacro(trackedFrameList, "Invalid arguments");
     return false;
   }
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("CreateNodes", trackedFrameList->GetNumberOfTrackedFrames());
 
   std::string trackedFrameName = "Video";
   if (!trackedFrameList->GetCustomString(TRACKNAME_FIELD_NAME).empty())
@@ -85,27 +165,53 @@ bool vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(vtkIGSIOTrackedFrame
     }
   }
 
-  vtkSmartPointer<vtkStreamingVolumeFrame> previousFrame = NULL;
+  std::vector<int> frameOrder;
+  GetTrackedFrameImportOrder(trackedFrameList, true, frameOrder);
+  // Frames can only be released one by one if they are imported from the front of the list
+  bool releaseEachFrame = releaseFrames && std::is_sorted(frameOrder.begin(), frameOrder.end());
 
-  // How many digits are required to represent the frame numbers
-  int frameNumberMaxLength = std::floor(std::log10(trackedFrameList->GetNumberOfTrackedFrames())) + 1;
+  vtkSmartPointer<vtkStreamingVolumeFrame> previousFrame = NULL;
 
-  for (int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+  igsioTransformName imageToPhysicalTransformName;
+  imageToPhysicalTransformName.SetTransformName(trackedFrameName + "ToPhysical");
+  std::string imageToPhysicalTransformFieldName = imageToPhysicalTransformName.GetTransformName() + "Transform";
+  vtkSmartPointer<vtkMatrix4x4> ijkToRASTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  // Frames are added in a single batch, so that the sequence is only modified once all of the frames have been imported.
+  // The items are not pre-allocated: vtkMRMLSequenceNode has no API for reserving capacity. Since the frames are added
+  // in chronological order, each item is appended to the end of the sequence without moving the existing items.
+  int wasModifying = sequenceNode->StartModify();
+  vtkMRMLScene* sequenceScene = sequenceNode->GetSequenceScene();
+  if (sequenceScene)
   {
-    // Convert frame to a string with the a maximum number of digits (frameNumberMaxLength)
-    // ex. 0, 1, 2, 3 or 0000, 0001, 0002, 0003 etc.
-    std::stringstream frameNumberSS;
-    frameNumberSS << std::setw(frameNumberMaxLength) << std::setfill('0') << i;
+    sequenceScene->StartState(vtkMRMLScene::BatchProcessState);
+  }
 
-    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i);
-    std::stringstream timestampSS;
+  std::stringstream timestampSS;
+  int numberOfTrackedFrames = (int)frameOrder.size();
+  for (int i = 0; i < numberOfTrackedFrames; ++i)
+  {
+    // Imported frames are removed from the front of the list when releasing each frame
+    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(releaseEachFrame ? 0 : frameOrder[i]);
+    timestampSS.str("");
+    timestampSS.clear();
     timestampSS << trackedFrame->GetTimestamp();
 
     vtkSmartPointer<vtkMRMLVolumeNode> volumeNode;
+    vtkImageData* transferredImage = NULL;
     if (!trackedFrame->GetImageData()->IsFrameEncoded())
     {
       volumeNode = vtkSmartPointer<vtkMRMLVectorVolumeNode>::New();
-      volumeNode->SetAndObserveImageData(trackedFrame->GetImageData()->GetImage());
+      if (transferOwnership)
+      {
+        // The image is attached to the node in the sequence after it has been added,
+        // since adding the node to the sequence would create a deep copy of the image
+        transferredImage = trackedFrame->GetImageData()->GetImage();
+      }
+      else
+      {
+        volumeNode->SetAndObserveImageData(trackedFrame->GetImageData()->GetImage());
+      }
     }
     else
     {
@@ -117,15 +223,16 @@ bool vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(vtkIGSIOTrackedFrame
       {
         currentFrame->SetPreviousFrame(previousFrame);
       }
+      if (IsGrayscaleFrameField(trackedFrame->GetFrameField(GRAYSCALE_FIELD_NAME)))
+      {
+        currentFrame->SetNumberOfComponents(1);
+      }
       streamingVolumeNode->SetAndObserveFrame(currentFrame);
       volumeNode = streamingVolumeNode;
       previousFrame = currentFrame;
     }
 
-    vtkSmartPointer<vtkMatrix4x4> ijkToRASTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    igsioTransformName imageToPhysicalTransformName;
-    imageToPhysicalTransformName.SetTransformName(trackedFrameName+"ToPhysical");
-    if (trackedFrame->GetFrameField(imageToPhysicalTransformName.GetTransformName()+"Transform"))
+    if (trackedFrame->GetFrameField(imageToPhysicalTransformFieldName))
     {
       if (trackedFrame->GetFrameTransform(imageToPhysicalTransformName, ijkToRASTransformMatrix) == IGSIO_SUCCESS)
       {
@@ -141,15 +248,338 @@ bool vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(vtkIGSIOTrackedFrame
     const char* frameStatus = trackedFrame->GetFrameField(FRAME_STATUS_TRACKNAME);
     if (!frameStatus || vtkVariant(frameStatus).ToInt() != Frame_Skip)
     {
-      sequenceNode->SetDataNodeAtValue(volumeNode, timestampSS.str());
+      vtkMRMLVolumeNode* addedVolumeNode = vtkMRMLVolumeNode::SafeDownCast(sequenceNode->SetDataNodeAtValue(volumeNode, timestampSS.str()));
+      if (addedVolumeNode && transferredImage)
+      {
+        addedVolumeNode->SetAndObserveImageData(transferredImage);
+      }
+    }
+
+    if (releaseEachFrame)
+    {
+      // The image is now only referenced by the volume node in the sequence
+      trackedFrameList->RemoveTrackedFrame(0);
+    }
+  }
+  if (releaseFrames && !releaseEachFrame)
+  {
+    trackedFrameList->Clear();
+  }
+
+  if (sequenceScene)
+  {
+    sequenceScene->EndState(vtkMRMLScene::BatchProcessState);
+  }
+  sequenceNode->EndModify(wasModifying);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Returns the contents of the metadata track that apply to the frame at the specified timecode
+static const char* GetMkvFrameField(vtkSlicerIGSIOMkvFrameIndex::TrackInfo* metadataTrack, long long timecode)
+{
+  if (!metadataTrack || metadataTrack->Metadata.empty())
+  {
+    return NULL;
+  }
+
+  std::map<long long, std::string>::iterator metadataIt = metadataTrack->Metadata.upper_bound(timecode);
+  if (metadataIt == metadataTrack->Metadata.begin())
+  {
+    return NULL;
+  }
+  --metadataIt;
+  return metadataIt->second.c_str();
+}
+
+//----------------------------------------------------------------------------
+// Parse the transform matrix stored in the metadata track for the frame at the specified timecode
+static bool GetMkvFrameTransform(vtkSlicerIGSIOMkvFrameIndex::TrackInfo* transformTrack, long long timecode, vtkMatrix4x4* transformMatrix)
+{
+  const char* transformString = GetMkvFrameField(transformTrack, timecode);
+  if (!transformString)
+  {
+    return false;
+  }
+
+  std::stringstream transformSS(transformString);
+  double elements[16] = { 0.0 };
+  int numberOfElements = 0;
+  while (numberOfElements < 16 && transformSS >> elements[numberOfElements])
+  {
+    ++numberOfElements;
+  }
+  if (numberOfElements != 16)
+  {
+    return false;
+  }
+  transformMatrix->DeepCopy(elements);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::MkvFrameIndexToVolumeSequence(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkMRMLSequenceNode* sequenceNode, int trackNumber/*=-1*/)
+{
+  vtkSmartPointer<vtkStreamingVolumeFrame> previousFrame;
+  return vtkSlicerIGSIOCommon::AppendMkvFramesToVolumeSequence(frameIndex, sequenceNode, trackNumber, 0, -1, previousFrame);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::AppendMkvFramesToVolumeSequence(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkMRMLSequenceNode* sequenceNode, int trackNumber,
+  int startFrame, int endFrame, vtkSmartPointer<vtkStreamingVolumeFrame>& previousFrame)
+{
+  if (!frameIndex || !sequenceNode)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "Invalid arguments");
+    return false;
+  }
+
+  if (trackNumber < 0)
+  {
+    trackNumber = frameIndex->GetFirstVideoTrackNumber();
+  }
+
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* videoTrack = frameIndex->GetTrack(trackNumber);
+  if (!videoTrack || videoTrack->TrackType != vtkSlicerIGSIOMkvFrameIndex::VideoTrack)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "Could not find video track: " << trackNumber);
+    return false;
+  }
+
+  int numberOfFrames = (int)videoTrack->Frames.size();
+  if (endFrame < 0 || endFrame >= numberOfFrames)
+  {
+    endFrame = numberOfFrames - 1;
+  }
+  if (startFrame < 0)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "Invalid start frame: " << startFrame);
+    return false;
+  }
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("CreateNodes", std::max(0, endFrame - startFrame + 1));
+
+  std::string encodingFourCC = videoTrack->FourCC;
+  vtkSmartPointer<vtkStreamingVolumeCodec> codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+    vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(encodingFourCC));
+  if (!codec)
+  {
+    // The frames could not be decoded from the sequence
+    vtkDebugWithObjectMacro(sequenceNode, "Could not find codec: " << encodingFourCC);
+    return false;
+  }
+
+  std::string trackedFrameName = "Video";
+  if (!videoTrack->Name.empty())
+  {
+    trackedFrameName = videoTrack->Name;
+  }
+
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* imageToPhysicalTrack = frameIndex->GetTrackByName(trackedFrameName + "ToPhysicalTransform");
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* frameStatusTrack = frameIndex->GetTrackByName(FRAME_STATUS_TRACKNAME);
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* grayscaleTrack = frameIndex->GetTrackByName(GRAYSCALE_FIELD_NAME);
+
+  int numberOfComponents = 3;
+  if (vtkSlicerIGSIOCommon::IsGrayscaleCodec(encodingFourCC))
+  {
+    numberOfComponents = 1;
+  }
+
+  int wasModifying = sequenceNode->StartModify();
+  sequenceNode->SetIndexName("time");
+  sequenceNode->SetIndexUnit("s");
+
+  for (int frameNumber = startFrame; frameNumber <= endFrame; ++frameNumber)
+  {
+    const vtkSlicerIGSIOMkvFrameIndex::FrameInfo& frameInfo = videoTrack->Frames[frameNumber];
+    vtkSmartPointer<vtkSlicerIGSIOMkvStreamingVolumeFrame> currentFrame = vtkSmartPointer<vtkSlicerIGSIOMkvStreamingVolumeFrame>::New();
+    currentFrame->SetFrameLocation(frameIndex, frameInfo.Offset, frameInfo.Size);
+    currentFrame->SetDimensions(videoTrack->Width, videoTrack->Height, 1);
+    currentFrame->SetNumberOfComponents(IsGrayscaleFrameField(GetMkvFrameField(grayscaleTrack, frameInfo.Timecode)) ? 1 : numberOfComponents);
+    currentFrame->SetVTKScalarType(VTK_UNSIGNED_CHAR);
+    currentFrame->SetCodecFourCC(encodingFourCC);
+    currentFrame->SetFrameType(frameInfo.KeyFrame ? vtkStreamingVolumeFrame::IFrame : vtkStreamingVolumeFrame::PFrame);
+
+    // The previous frame is only relevant if the current frame is not a keyframe
+    if (!frameInfo.KeyFrame)
+    {
+      currentFrame->SetPreviousFrame(previousFrame);
+    }
+    previousFrame = currentFrame;
+
+    const char* frameStatus = GetMkvFrameField(frameStatusTrack, frameInfo.Timecode);
+    if (frameStatus && vtkVariant(frameStatus).ToInt() == Frame_Skip)
+    {
+      continue;
+    }
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveFrame(currentFrame);
+    streamingVolumeNode->SetName(trackedFrameName.c_str());
+
+    vtkSmartPointer<vtkMatrix4x4> ijkToRASTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (GetMkvFrameTransform(imageToPhysicalTrack, frameInfo.Timecode, ijkToRASTransformMatrix))
+    {
+      streamingVolumeNode->SetIJKToRASMatrix(ijkToRASTransformMatrix);
     }
+
+    std::stringstream timestampSS;
+    timestampSS << frameInfo.Timestamp;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, timestampSS.str());
+  }
+  sequenceNode->EndModify(wasModifying);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::AppendMkvTransforms(vtkSlicerIGSIOMkvFrameIndex* frameIndex, int videoTrackNumber, const std::string& transformName,
+  int startFrame, int endFrame, vtkMRMLSequenceNode* transformSequenceNode, vtkSlicerIGSIOTransformTrack* transformTrack)
+{
+  if (!frameIndex)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "Invalid arguments");
+    return false;
+  }
+
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* videoTrack = frameIndex->GetTrack(videoTrackNumber);
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* metadataTrack = frameIndex->GetTrackByName(transformName + "Transform");
+  if (!videoTrack || !metadataTrack)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "Could not find transform track: " << transformName);
+    return false;
+  }
+
+  int numberOfFrames = (int)videoTrack->Frames.size();
+  if (endFrame < 0 || endFrame >= numberOfFrames)
+  {
+    endFrame = numberOfFrames - 1;
+  }
+
+  int wasModifying = transformSequenceNode ? transformSequenceNode->StartModify() : 0;
+  for (int frameNumber = std::max(0, startFrame); frameNumber <= endFrame; ++frameNumber)
+  {
+    const vtkSlicerIGSIOMkvFrameIndex::FrameInfo& frameInfo = videoTrack->Frames[frameNumber];
+    vtkSmartPointer<vtkMatrix4x4> transformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (!GetMkvFrameTransform(metadataTrack, frameInfo.Timecode, transformMatrix))
+    {
+      continue;
+    }
+
+    if (transformTrack)
+    {
+      transformTrack->AddTransform(frameInfo.Timestamp, transformMatrix);
+    }
+    if (transformSequenceNode)
+    {
+      vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+      transformNode->SetMatrixTransformToParent(transformMatrix);
+
+      std::stringstream timestampSS;
+      timestampSS << frameInfo.Timestamp;
+      transformSequenceNode->SetDataNodeAtValue(transformNode, timestampSS.str());
+    }
+  }
+  if (transformSequenceNode)
+  {
+    transformSequenceNode->EndModify(wasModifying);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::MkvFrameIndexToSequenceBrowser(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkMRMLSequenceBrowserNode* sequenceBrowserNode,
+  vtkCollection* transformTracks/*=NULL*/)
+{
+  if (!frameIndex || !sequenceBrowserNode)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "Invalid argument!");
+    return false;
+  }
+
+  vtkMRMLScene* scene = sequenceBrowserNode->GetScene();
+  if (!scene)
+  {
+    vtkErrorWithObjectMacro(sequenceBrowserNode, "No scene found in sequence browser nodes!");
+    return false;
+  }
+
+  int videoTrackNumber = frameIndex->GetFirstVideoTrackNumber();
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* videoTrack = frameIndex->GetTrack(videoTrackNumber);
+  if (!videoTrack)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "No video track in file!");
+    return false;
+  }
+
+  std::string trackedFrameName = "Video";
+  if (!videoTrack->Name.empty())
+  {
+    trackedFrameName = videoTrack->Name;
+  }
+
+  vtkSmartPointer<vtkMRMLSequenceNode> videoSequenceNode = vtkSmartPointer <vtkMRMLSequenceNode>::New();
+  videoSequenceNode->SetName(scene->GetUniqueNameByString(trackedFrameName.c_str()));
+  if (!vtkSlicerIGSIOCommon::MkvFrameIndexToVolumeSequence(frameIndex, videoSequenceNode, videoTrackNumber))
+  {
+    return false;
+  }
+  scene->AddNode(videoSequenceNode);
+
+  if (videoSequenceNode->GetNumberOfDataNodes() < 1)
+  {
+    vtkErrorWithObjectMacro(frameIndex, "No frames in file!");
+    return false;
+  }
+  sequenceBrowserNode->AddSynchronizedSequenceNode(videoSequenceNode);
+
+  // Transform fields are stored in metadata tracks named <TransformName>Transform
+  const std::string transformSuffix = "Transform";
+  std::vector<int> trackNumbers = frameIndex->GetTrackNumbers();
+  for (std::vector<int>::iterator trackNumberIt = trackNumbers.begin(); trackNumberIt != trackNumbers.end(); ++trackNumberIt)
+  {
+    vtkSlicerIGSIOMkvFrameIndex::TrackInfo* metadataTrack = frameIndex->GetTrack(*trackNumberIt);
+
+    const std::string& trackName = metadataTrack->Name;
+    if (metadataTrack->TrackType == vtkSlicerIGSIOMkvFrameIndex::VideoTrack
+      || trackName.size() <= transformSuffix.size()
+      || trackName.compare(trackName.size() - transformSuffix.size(), transformSuffix.size(), transformSuffix) != 0)
+    {
+      continue;
+    }
+
+    std::string transformName = trackName.substr(0, trackName.size() - transformSuffix.size());
+    if (transformName == trackedFrameName + "ToPhysical")
+    {
+      continue;
+    }
+
+    if (transformTracks)
+    {
+      vtkSmartPointer<vtkSlicerIGSIOTransformTrack> transformTrack = vtkSmartPointer<vtkSlicerIGSIOTransformTrack>::New();
+      transformTrack->SetTransformName(transformName.c_str());
+      transformTrack->Reserve(videoTrack->Frames.size());
+      vtkSlicerIGSIOCommon::AppendMkvTransforms(frameIndex, videoTrackNumber, transformName, 0, -1, NULL, transformTrack);
+      transformTracks->AddItem(transformTrack);
+      continue;
+    }
+
+    vtkSmartPointer<vtkMRMLSequenceNode> transformSequenceNode = vtkMRMLSequenceNode::SafeDownCast(
+      scene->AddNewNodeByClass("vtkMRMLSequenceNode"));
+    transformSequenceNode->SetName(transformName.c_str());
+    transformSequenceNode->SetIndexName("time");
+    transformSequenceNode->SetIndexUnit("s");
+    transformSequenceNode->SetAttribute(vtkSlicerIGSIOCommon::GetMkvTransformNameAttributeName(), transformName.c_str());
+    sequenceBrowserNode->AddSynchronizedSequenceNode(transformSequenceNode);
+    vtkSlicerIGSIOCommon::AppendMkvTransforms(frameIndex, videoTrackNumber, transformName, 0, -1, transformSequenceNode, NULL);
   }
 
   return true;
 }
 
 //----------------------------------------------------------------------------
-bool vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceBrowserNode* sequenceBrowserNode)
+bool vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceBrowserNode* sequenceBrowserNode,
+  bool transferOwnership/*=false*/, vtkCollection* transformTracks/*=NULL*/)
 {
   if (!trackedFrameList || !sequenceBrowserNode)
   {
@@ -172,7 +602,8 @@ bool vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(vtkIGSIOTrackedFram
 
   vtkSmartPointer<vtkMRMLSequenceNode> videoSequenceNode = vtkSmartPointer <vtkMRMLSequenceNode>::New();
   videoSequenceNode->SetName(scene->GetUniqueNameByString(trackedFrameName.c_str()));
-  vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(trackedFrameList, videoSequenceNode);
+  // The tracked frames are still required for importing the transforms, so they are only released at the end
+  TrackedFrameListToVolumeSequenceInternal(trackedFrameList, videoSequenceNode, transferOwnership, false);
   scene->AddNode(videoSequenceNode);
 
   if (videoSequenceNode->GetNumberOfDataNodes() < 1)
@@ -190,44 +621,81 @@ bool vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(vtkIGSIOTrackedFram
   dimensions[1] = frameSize[1];
   dimensions[2] = frameSize[2];
 
+  // The transforms are imported in chronological order.
+  // The transform sequences are only modified once all of the frames have been imported.
   std::map<std::string, vtkSmartPointer<vtkMRMLSequenceNode>> transformSequenceNodes;
-
-  int frameNumberMaxLength = std::floor(std::log10(trackedFrameList->GetNumberOfTrackedFrames())) + 1;
-  for (int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+  std::map<std::string, int> transformSequenceWasModifying;
+  std::map<std::string, vtkSmartPointer<vtkSlicerIGSIOTransformTrack>> compactTransformTracks;
+
+  std::string imageToPhysicalTransformName = trackedFrameName + "ToPhysical";
+  vtkSmartPointer<vtkMatrix4x4> transformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+  std::vector<igsioTransformName> transformNames;
+  std::stringstream timestampSS;
+  std::vector<int> frameOrder;
+  GetTrackedFrameImportOrder(trackedFrameList, false, frameOrder);
+  for (std::vector<int>::iterator frameIt = frameOrder.begin(); frameIt != frameOrder.end(); ++frameIt)
   {
-    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i);
-    std::stringstream timestampSS;
+    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(*frameIt);
+    timestampSS.str("");
+    timestampSS.clear();
     timestampSS << trackedFrame->GetTimestamp();
 
-    std::vector<igsioTransformName> transformNames;
+    transformNames.clear();
     trackedFrame->GetFrameTransformNameList(transformNames);
     for (std::vector<igsioTransformName>::iterator transformNameIt = transformNames.begin(); transformNameIt != transformNames.end(); ++transformNameIt)
     {
-      vtkSmartPointer<vtkMatrix4x4> transformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-      trackedFrame->GetFrameTransform(*transformNameIt, transformMatrix);
-
       std::string transformName;
       transformNameIt->GetTransformName(transformName);
-      if (transformName != trackedFrameName+"ToPhysical")
+      if (transformName == imageToPhysicalTransformName)
       {
-        vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
-        transformNode->SetMatrixTransformToParent(transformMatrix);
+        continue;
+      }
 
-        std::string transformName = transformNameIt->GetTransformName();
-        if (transformSequenceNodes.find(transformName) == transformSequenceNodes.end())
+      trackedFrame->GetFrameTransform(*transformNameIt, transformMatrix);
+      if (transformTracks)
+      {
+        std::map<std::string, vtkSmartPointer<vtkSlicerIGSIOTransformTrack>>::iterator transformTrackIt = compactTransformTracks.find(transformName);
+        if (transformTrackIt == compactTransformTracks.end())
         {
-          vtkSmartPointer<vtkMRMLSequenceNode> transformSequenceNode = vtkMRMLSequenceNode::SafeDownCast(
-            scene->AddNewNodeByClass("vtkMRMLSequenceNode"));
-          transformSequenceNode->SetName(transformName.c_str());
-          transformSequenceNode->SetIndexName("time");
-          transformSequenceNode->SetIndexUnit("s");
-          sequenceBrowserNode->AddSynchronizedSequenceNode(transformSequenceNode);
-          transformSequenceNodes[transformName] = transformSequenceNode;
+          vtkSmartPointer<vtkSlicerIGSIOTransformTrack> transformTrack = vtkSmartPointer<vtkSlicerIGSIOTransformTrack>::New();
+          transformTrack->SetTransformName(transformName.c_str());
+          transformTrack->Reserve(trackedFrameList->GetNumberOfTrackedFrames());
+          transformTracks->AddItem(transformTrack);
+          transformTrackIt = compactTransformTracks.insert(std::make_pair(transformName, transformTrack)).first;
         }
-        transformSequenceNodes[transformName]->SetDataNodeAtValue(transformNode, timestampSS.str());
+        transformTrackIt->second->AddTransform(trackedFrame->GetTimestamp(), transformMatrix);
+        continue;
+      }
+
+      // The sequence stores a copy of the node, so the same transform node can be used for every frame
+      transformNode->SetMatrixTransformToParent(transformMatrix);
+
+      std::map<std::string, vtkSmartPointer<vtkMRMLSequenceNode>>::iterator transformSequenceNodeIt = transformSequenceNodes.find(transformName);
+      if (transformSequenceNodeIt == transformSequenceNodes.end())
+      {
+        vtkSmartPointer<vtkMRMLSequenceNode> transformSequenceNode = vtkMRMLSequenceNode::SafeDownCast(
+          scene->AddNewNodeByClass("vtkMRMLSequenceNode"));
+        transformSequenceNode->SetName(transformName.c_str());
+        transformSequenceNode->SetIndexName("time");
+        transformSequenceNode->SetIndexUnit("s");
+        sequenceBrowserNode->AddSynchronizedSequenceNode(transformSequenceNode);
+        transformSequenceWasModifying[transformName] = transformSequenceNode->StartModify();
+        transformSequenceNodeIt = transformSequenceNodes.insert(std::make_pair(transformName, transformSequenceNode)).first;
       }
+      transformSequenceNodeIt->second->SetDataNodeAtValue(transformNode, timestampSS.str());
     }
+  }
+
+  for (std::map<std::string, vtkSmartPointer<vtkMRMLSequenceNode>>::iterator transformSequenceNodeIt = transformSequenceNodes.begin();
+    transformSequenceNodeIt != transformSequenceNodes.end(); ++transformSequenceNodeIt)
+  {
+    transformSequenceNodeIt->second->EndModify(transformSequenceWasModifying[transformSequenceNodeIt->first]);
+  }
 
+  if (transferOwnership)
+  {
+    trackedFrameList->Clear();
   }
 
   return true;
@@ -235,6 +703,13 @@ bool vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(vtkIGSIOTrackedFram
 
 //----------------------------------------------------------------------------
 bool vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(vtkMRMLSequenceNode* sequenceNode, vtkIGSIOTrackedFrameList* trackedFrameList)
+{
+  return vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(sequenceNode, trackedFrameList, 0, -1);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(vtkMRMLSequenceNode* sequenceNode, vtkIGSIOTrackedFrameList* trackedFrameList,
+  int startIndex, int endIndex)
 {
   if (!sequenceNode || !trackedFrameList)
   {
@@ -248,41 +723,52 @@ bool vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(vtkMRMLSequenceNode*
     return false;
   }
 
-  std::string codecFourCC;
-  bool useTimestamp = sequenceNode->GetIndexName() == "time";
-  std::string trackName = sequenceNode->GetName();
-  if (sequenceNode->GetNumberOfDataNodes() > 0)
+  if (endIndex < 0 || endIndex >= sequenceNode->GetNumberOfDataNodes())
   {
-    trackName = sequenceNode->GetNthDataNode(0)->GetName();
+    endIndex = sequenceNode->GetNumberOfDataNodes() - 1;
   }
-  if (trackedFrameList->SetCustomString(TRACKNAME_FIELD_NAME, trackName) == IGSIO_FAIL)
+  if (startIndex < 0 || startIndex > endIndex)
   {
-    vtkErrorWithObjectMacro(sequenceNode, "Could not set track name!")
-      return false;
+    vtkErrorWithObjectMacro(sequenceNode, "Invalid frame range: " << startIndex << " - " << endIndex);
+    return false;
   }
 
+  bool useTimestamp = sequenceNode->GetIndexName() == "time";
+  std::string trackName = sequenceNode->GetNthDataNode(0)->GetName();
 
-  int dimensions[3] = { 0,0,0 };
-  vtkSmartPointer<vtkStreamingVolumeFrame> lastFrame = NULL;
+  vtkStreamingVolumeFrame* previousFrame = NULL;
   double timestamp = 0;
-  double lastTimestamp = 0.0;
-  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  if (startIndex > 0)
   {
-    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
-    if (!streamingVolumeNode)
+    // Frames preceding the range have already been converted, so the previous frame chain only needs to be followed
+    // back to the frame of the preceding item
+    vtkMRMLStreamingVolumeNode* previousStreamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(startIndex - 1));
+    if (previousStreamingVolumeNode)
     {
-      continue;
+      previousFrame = previousStreamingVolumeNode->GetFrame();
+    }
+    if (useTimestamp)
+    {
+      std::stringstream timestampSS;
+      timestampSS << sequenceNode->GetNthIndexValue(startIndex - 1);
+      timestampSS >> timestamp;
+    }
+    else
+    {
+      timestamp = 0.1 * startIndex;
     }
+  }
+  double previousTimestamp = timestamp;
 
-    vtkStreamingVolumeFrame* frame = streamingVolumeNode->GetFrame();
-    if (!frame)
+  std::vector<TrackedFrameSourceItem> items;
+  for (int i = startIndex; i <= endIndex; ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    if (!streamingVolumeNode || !streamingVolumeNode->GetFrame())
     {
       continue;
     }
 
-    frame->GetDimensions(dimensions);
-    codecFourCC = streamingVolumeNode->GetCodecFourCC();
-
     std::stringstream timestampSS;
     timestampSS << sequenceNode->GetNthIndexValue(i);
     if (useTimestamp)
@@ -294,12 +780,48 @@ bool vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(vtkMRMLSequenceNode*
       timestamp += 0.1;
     }
 
-    vtkSmartPointer<vtkMatrix4x4> ijkToRASTransform = vtkSmartPointer<vtkMatrix4x4>::New();
-    streamingVolumeNode->GetIJKToRASMatrix(ijkToRASTransform);
+    TrackedFrameSourceItem item;
+    item.Frame = streamingVolumeNode->GetFrame();
+    item.Timestamp = timestamp;
+    item.IJKToRASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    streamingVolumeNode->GetIJKToRASMatrix(item.IJKToRASMatrix);
+    items.push_back(item);
+  }
 
-    igsioTransformName imageToPhysicalName;
-    imageToPhysicalName.SetTransformName(trackName+"ToPhysical");
+  return vtkSlicerIGSIOCommon::SequenceItemsToTrackedFrameList(items, trackName, previousFrame, previousTimestamp, trackedFrameList);
+}
 
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::SequenceItemsToTrackedFrameList(const std::vector<TrackedFrameSourceItem>& items, const std::string& trackName,
+  vtkStreamingVolumeFrame* previousFrame, double previousTimestamp, vtkIGSIOTrackedFrameList* trackedFrameList)
+{
+  if (!trackedFrameList)
+  {
+    vtkErrorWithObjectMacro(trackedFrameList, "Invalid arguments");
+    return false;
+  }
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("ConvertToTrackedFrames", (int)items.size());
+
+  if (trackedFrameList->SetCustomString(TRACKNAME_FIELD_NAME, trackName) == IGSIO_FAIL)
+  {
+    vtkErrorWithObjectMacro(trackedFrameList, "Could not set track name!");
+    return false;
+  }
+
+  igsioTransformName imageToPhysicalName;
+  imageToPhysicalName.SetTransformName(trackName + "ToPhysical");
+
+  vtkSmartPointer<vtkStreamingVolumeFrame> lastFrame = previousFrame;
+  double lastTimestamp = previousTimestamp;
+  for (std::vector<TrackedFrameSourceItem>::const_iterator itemIt = items.begin(); itemIt != items.end(); ++itemIt)
+  {
+    vtkStreamingVolumeFrame* frame = itemIt->Frame;
+    if (!frame)
+    {
+      continue;
+    }
+
+    // Frames that are skipped in the sequence are only accessible from the previous frame chain
     std::stack<vtkSmartPointer<vtkStreamingVolumeFrame> > frameStack;
     frameStack.push(frame);
     if (!frame->IsKeyFrame())
@@ -321,23 +843,16 @@ bool vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(vtkMRMLSequenceNode*
       igsioVideoFrame videoFrame;
       videoFrame.SetEncodedFrame(currentFrame);
       trackedFrame.SetImageData(videoFrame);
-      double currentTimestamp = lastTimestamp + (timestamp-lastTimestamp)*((double)(initialStackSize - frameStack.size() + 1.0) / initialStackSize);
+      double currentTimestamp = lastTimestamp + (itemIt->Timestamp - lastTimestamp)*((double)(initialStackSize - frameStack.size() + 1.0) / initialStackSize);
       trackedFrame.SetTimestamp(currentTimestamp);
-      trackedFrame.SetFrameTransform(imageToPhysicalName, ijkToRASTransform);
+      trackedFrame.SetFrameTransform(imageToPhysicalName, itemIt->IJKToRASMatrix);
       trackedFrame.SetFrameField(FRAME_STATUS_TRACKNAME, vtkVariant(frameStack.size() == 1 ? Frame_OK : Frame_Skip).ToString());
+      SetGrayscaleFrameField(trackedFrame, currentFrame);
       trackedFrameList->AddTrackedFrame(&trackedFrame);
       frameStack.pop();
     }
-    lastTimestamp = timestamp;
-  }
-  trackedFrameList->GetEncodingFourCC(codecFourCC);
-
-  FrameSizeType frameSize = { 0,0,0 };
-  for (int i=0; i<3; ++i)
-  {
-    frameSize[i] = (unsigned int)dimensions[i];
+    lastTimestamp = itemIt->Timestamp;
   }
-
   return true;
 }
 
@@ -349,165 +864,1413 @@ bool vtkSlicerIGSIOCommon::SequenceBrowserToTrackedFrameList(vtkMRMLSequenceBrow
 }
 
 //----------------------------------------------------------------------------
-bool vtkSlicerIGSIOCommon::ReEncodeVideoSequence(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex, std::string codecFourCC, std::map<std::string, std::string> codecParameters, bool forceReEncoding, bool minimalReEncoding)
+static int GetNumberOfReEncodingThreads(int numberOfThreads)
 {
-  if (!videoStreamSequenceNode)
+  if (numberOfThreads > 0)
   {
-    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Cannot convert reference node to vtkMRMLSequenceNode");
+    return numberOfThreads;
+  }
+  return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::IsGrayscaleCodec(const std::string& codecFourCC)
+{
+  return codecFourCC == "Y800" || codecFourCC == "GREY";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::SupportsSingleComponentImages(const std::string& codecFourCC)
+{
+  return vtkSlicerIGSIOCommon::IsGrayscaleCodec(codecFourCC) || codecFourCC == vtkSlicerIGSIOLosslessVolumeCodec::GetCodecFourCC();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::IsLumaOnlyFrame(vtkStreamingVolumeFrame* frame)
+{
+  return frame && frame->GetNumberOfComponents() == 1 && !vtkSlicerIGSIOCommon::SupportsSingleComponentImages(frame->GetCodecFourCC());
+}
+
+//----------------------------------------------------------------------------
+// Copy the intensity of the single-component image to the three channels of the color image
+static void ExpandGrayscaleImage(vtkImageData* grayscaleImage, vtkImageData* colorImage)
+{
+  int dimensions[3] = { 0, 0, 0 };
+  grayscaleImage->GetDimensions(dimensions);
+  vtkSlicerIGSIOImagePool::GetInstance()->AllocateImage(colorImage, dimensions, VTK_UNSIGNED_CHAR, 3);
+
+  const unsigned char* grayscalePointer = static_cast<const unsigned char*>(grayscaleImage->GetScalarPointer());
+  unsigned char* colorPointer = static_cast<unsigned char*>(colorImage->GetScalarPointer());
+  vtkIdType numberOfPixels = (vtkIdType)dimensions[0] * dimensions[1] * dimensions[2];
+  for (vtkIdType i = 0; i < numberOfPixels; ++i)
+  {
+    colorPointer[0] = colorPointer[1] = colorPointer[2] = grayscalePointer[i];
+    colorPointer += 3;
+  }
+}
+
+//----------------------------------------------------------------------------
+// Copy the first channel of the color image to the single-component image.
+// Luma-only frames are decoded to equal color channels, so any channel holds the intensity.
+static void ExtractGrayscaleImage(vtkImageData* colorImage, vtkImageData* grayscaleImage)
+{
+  int dimensions[3] = { 0, 0, 0 };
+  colorImage->GetDimensions(dimensions);
+  vtkSlicerIGSIOImagePool::GetInstance()->AllocateImage(grayscaleImage, dimensions, VTK_UNSIGNED_CHAR, 1);
+
+  int numberOfComponents = colorImage->GetNumberOfScalarComponents();
+  const unsigned char* colorPointer = static_cast<const unsigned char*>(colorImage->GetScalarPointer());
+  unsigned char* grayscalePointer = static_cast<unsigned char*>(grayscaleImage->GetScalarPointer());
+  vtkIdType numberOfPixels = (vtkIdType)dimensions[0] * dimensions[1] * dimensions[2];
+  for (vtkIdType i = 0; i < numberOfPixels; ++i)
+  {
+    grayscalePointer[i] = colorPointer[0];
+    colorPointer += numberOfComponents;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::EncodeImageData(vtkStreamingVolumeCodec* codec, vtkImageData* image, vtkStreamingVolumeFrame* frame, bool forceKeyFrame)
+{
+  if (!codec || !image || !frame)
+  {
+    vtkErrorWithObjectMacro(codec, "EncodeImageData: Invalid arguments");
     return false;
   }
 
-  int dimensions[3] = { 0,0,0 };
-  int numberOfFrames = videoStreamSequenceNode->GetNumberOfDataNodes();
+  if (image->GetNumberOfScalarComponents() != 1 || image->GetScalarType() != VTK_UNSIGNED_CHAR
+    || vtkSlicerIGSIOCommon::SupportsSingleComponentImages(codec->GetFourCC()))
+  {
+    return codec->EncodeImageData(image, frame, forceKeyFrame);
+  }
 
-  if (endIndex < 0)
+  // The codec converts the equal color channels to a luma plane with flat chroma
+  vtkSlicerIGSIOImagePool* imagePool = vtkSlicerIGSIOImagePool::GetInstance();
+  vtkSmartPointer<vtkImageData> colorImage = vtkSmartPointer<vtkImageData>::New();
+  ExpandGrayscaleImage(image, colorImage);
+  bool success = codec->EncodeImageData(colorImage, frame, forceKeyFrame);
+  imagePool->ReleaseImage(colorImage);
+  if (!success)
   {
-    endIndex = numberOfFrames - 1;
+    return false;
   }
+  frame->SetNumberOfComponents(1);
+  return true;
+}
 
-  if (startIndex < 0 || startIndex >= numberOfFrames || startIndex > endIndex
-    || endIndex >= numberOfFrames)
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::DecodeFrame(vtkStreamingVolumeCodec* codec, vtkStreamingVolumeFrame* frame, vtkImageData* image, bool saveDecodedImage/*=true*/)
+{
+  if (!codec || !frame || !image)
   {
-    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid start and end indices!");
+    vtkErrorWithObjectMacro(codec, "DecodeFrame: Invalid arguments");
     return false;
   }
 
-  std::vector<FrameBlock> frameBlocks;
+  // Lazily loaded payloads of the frame (and the preceding frames that the codec decodes) must not be released while decoding
+  vtkSlicerIGSIOMkvStreamingVolumeFrame::ScopedFrameDataAccess frameDataAccess;
+  if (!vtkSlicerIGSIOCommon::IsLumaOnlyFrame(frame))
+  {
+    return codec->DecodeFrame(frame, image, saveDecodedImage);
+  }
 
-  if (!forceReEncoding)
+  // The image may be allocated for the single-component result, so the codec decodes into a separate color image
+  vtkSlicerIGSIOImagePool* imagePool = vtkSlicerIGSIOImagePool::GetInstance();
+  vtkSmartPointer<vtkImageData> colorImage = vtkSmartPointer<vtkImageData>::New();
+  int dimensions[3] = { 0, 0, 0 };
+  frame->GetDimensions(dimensions);
+  if (dimensions[0] * dimensions[1] * dimensions[2] > 0)
   {
-    FrameBlock currentFrameBlock;
-    currentFrameBlock.StartFrame = 0;
-    currentFrameBlock.EndFrame = 0;
-    currentFrameBlock.ReEncodingRequired = false;
-    vtkSmartPointer<vtkStreamingVolumeFrame> previousFrame = NULL;
-    for (int i = startIndex; i <= endIndex; ++i)
+    imagePool->AllocateImage(colorImage, dimensions, VTK_UNSIGNED_CHAR, 3);
+  }
+  bool success = codec->DecodeFrame(frame, colorImage, saveDecodedImage);
+  if (success && saveDecodedImage)
+  {
+    if (colorImage->GetNumberOfScalarComponents() == 1)
     {
-      // TODO: for now, only support sequences of vtkMRMLStreamingVolumeNode
-      // In the future, this could be changed to allow all types of volume nodes to be encoded
-      vtkMRMLStreamingVolumeNode* streamingNode = vtkMRMLStreamingVolumeNode::SafeDownCast(videoStreamSequenceNode->GetNthDataNode(i));
-      if (!streamingNode)
-      {
-        vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid data node at index " << i);
-        return false;
-      }
+      imagePool->CopyImage(colorImage, image);
+    }
+    else
+    {
+      ExtractGrayscaleImage(colorImage, image);
+    }
+  }
+  imagePool->ReleaseImage(colorImage);
+  return success;
+}
 
-      if (codecFourCC == "")
-      {
-        codecFourCC = streamingNode->GetCodecFourCC();
-      }
+//----------------------------------------------------------------------------
+// Decode the encoded frame into decodedImage using the decoder, continuing from lastDecodedFrame if it precedes the frame.
+// Each call to the decoder only decodes a single frame, and only the requested frame is converted to an image.
+// lastDecodedImage is the image that lastDecodedFrame was decoded into. If the same frame is requested again
+// (consecutive items that share a frame), it is copied from that image, since decodedImage may be a different frame buffer.
+static bool TranscodingDecodeFrame(vtkSmartPointer<vtkStreamingVolumeCodec>& decoder, vtkSmartPointer<vtkStreamingVolumeFrame>& lastDecodedFrame,
+  vtkImageData*& lastDecodedImage, vtkStreamingVolumeFrame* frame, vtkImageData* decodedImage)
+{
+  if (frame == lastDecodedFrame && lastDecodedImage)
+  {
+    if (decodedImage != lastDecodedImage)
+    {
+      decodedImage->DeepCopy(lastDecodedImage);
+      lastDecodedImage = decodedImage;
+    }
+    return true;
+  }
+  if (!lastDecodedImage)
+  {
+    // The decoder state is still valid, but the image of the last decoded frame is not available, so decode from the keyframe
+    lastDecodedFrame = NULL;
+  }
 
-      vtkStreamingVolumeFrame* currentFrame = streamingNode->GetFrame();
-      if (currentFrameBlock.ReEncodingRequired == false)
-      {
-        if (i == 0 && !streamingNode->IsKeyFrame())
-        {
-          currentFrameBlock.ReEncodingRequired = true;
-        }
-        else if (!currentFrame)
-        {
-          currentFrameBlock.ReEncodingRequired = true;
-        }
-        else if (codecFourCC == "")
-        {
-          currentFrameBlock.ReEncodingRequired = true;
-        }
-        else if (codecFourCC != streamingNode->GetCodecFourCC())
-        {
-          currentFrameBlock.ReEncodingRequired = true;
-        }
-        else if (!minimalReEncoding && currentFrame && !currentFrame->IsKeyFrame() && previousFrame != currentFrame->GetPreviousFrame())
-        {
-          currentFrameBlock.ReEncodingRequired = true;
-        }
-      }
+  // Frames that are skipped in the sequence are only accessible from the previous frame chain
+  std::stack<vtkStreamingVolumeFrame*> framesToDecode;
+  vtkStreamingVolumeFrame* currentFrame = frame;
+  while (currentFrame && currentFrame != lastDecodedFrame)
+  {
+    framesToDecode.push(currentFrame);
+    if (currentFrame->IsKeyFrame())
+    {
+      break;
+    }
+    currentFrame = currentFrame->GetPreviousFrame();
+  }
+  if (!currentFrame)
+  {
+    vtkErrorWithObjectMacro(frame, "Could not find a keyframe preceding the frame");
+    return false;
+  }
 
-      if (currentFrame && // Current frame exists
-        previousFrame && // Current frame is not the initial frame
-        currentFrame->IsKeyFrame() && // Current frame is a keyframe
-        !previousFrame->IsKeyFrame()) // Previous frame was not also a keyframe
-      {
-        frameBlocks.push_back(currentFrameBlock);
-        currentFrameBlock = FrameBlock();
-        currentFrameBlock.StartFrame = i;
-        currentFrameBlock.EndFrame = i;
-        currentFrameBlock.ReEncodingRequired = false;
-      }
-      currentFrameBlock.EndFrame = i;
-      previousFrame = currentFrame;
+  std::string codecFourCC = frame->GetCodecFourCC();
+  if (!decoder || decoder->GetFourCC() != codecFourCC)
+  {
+    decoder = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+      vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(codecFourCC));
+    if (!decoder)
+    {
+      vtkErrorWithObjectMacro(frame, "Could not find codec: " << codecFourCC);
+      return false;
+    }
+  }
 
-      /// TODO: If dimension changes, re-encode smaller images with padding
+  while (!framesToDecode.empty())
+  {
+    vtkStreamingVolumeFrame* frameToDecode = framesToDecode.top();
+    framesToDecode.pop();
+    if (!vtkSlicerIGSIOCommon::DecodeFrame(decoder, frameToDecode, decodedImage, framesToDecode.empty()))
+    {
+      vtkErrorWithObjectMacro(frame, "Error decoding frame!");
+      lastDecodedFrame = NULL;
+      lastDecodedImage = NULL;
+      return false;
     }
-    frameBlocks.push_back(currentFrameBlock);
+    lastDecodedFrame = frameToDecode;
   }
-  else
+  lastDecodedImage = decodedImage;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Bounded single-producer single-consumer ring buffer that connects the decoding stage to the encoding stage.
+// Items are passed without locking: the producer only advances the tail and the consumer only advances the head.
+// Push and Pop only fall back to waiting on a condition variable when the ring is full (or empty) after a short spin,
+// until there is space for the item (or an item is available), or until the queue is aborted.
+namespace
+{
+template<typename T>
+class TranscodingQueue
+{
+public:
+  TranscodingQueue(int capacity)
+    : Items(capacity)
+    , Capacity(capacity)
+    , Head(0)
+    , Tail(0)
+    , Aborted(false)
+    , ProducerWaiting(false)
+    , ConsumerWaiting(false)
   {
-    FrameBlock totalFrameBlock;
-    totalFrameBlock.StartFrame = startIndex;
-    totalFrameBlock.EndFrame = endIndex;
-    totalFrameBlock.ReEncodingRequired = true;
-    frameBlocks.push_back(totalFrameBlock);
   }
 
-  if (codecFourCC == "")
+  /// Add an item to the end of the queue, waiting until there is space for it. Must only be called from the producer thread.
+  /// \return False if the queue was aborted
+  bool Push(const T& item)
   {
-    std::vector<std::string> codecFourCCs = vtkStreamingVolumeCodecFactory::GetInstance()->GetStreamingCodecFourCCs();
-    if (codecFourCCs.empty())
+    unsigned long long tail = this->Tail.load(std::memory_order_relaxed);
+    if (!this->WaitUntil(this->ProducerWaiting, this->NotFull,
+      [this, tail]() { return tail - this->Head.load() < (unsigned long long)this->Capacity; }))
     {
-      vtkErrorWithObjectMacro(videoStreamSequenceNode, "Re-encode failed! No codecs registered!");
       return false;
     }
+    this->Items[tail % this->Capacity] = item;
+    this->Tail.store(tail + 1);
+    this->Wake(this->ConsumerWaiting, this->NotEmpty);
+    return true;
+  }
 
-    codecFourCC = codecFourCCs.front();
-    vtkDebugWithObjectMacro(videoStreamSequenceNode, "Streaming volume codec not specified! Using: " << codecFourCC);
+  /// Remove an item from the front of the queue, waiting until an item is available. Must only be called from the consumer thread.
+  /// \return False if the queue was aborted
+  bool Pop(T& item)
+  {
+    unsigned long long head = this->Head.load(std::memory_order_relaxed);
+    if (!this->WaitUntil(this->ConsumerWaiting, this->NotEmpty,
+      [this, head]() { return this->Tail.load() != head; }))
+    {
+      return false;
+    }
+    item = this->Items[head % this->Capacity];
+    this->Head.store(head + 1);
+    this->Wake(this->ProducerWaiting, this->NotFull);
+    return true;
   }
 
-  std::vector<FrameBlock>::iterator frameBlockIt;
-  for (frameBlockIt = frameBlocks.begin(); frameBlockIt != frameBlocks.end(); ++frameBlockIt)
+  /// Wake up all waiting threads, and make all subsequent calls to Push and Pop fail
+  void Abort()
+  {
+    this->Aborted = true;
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->NotFull.notify_all();
+    this->NotEmpty.notify_all();
+  }
+
+  int GetSize()
+  {
+    return (int)(this->Tail.load() - this->Head.load());
+  }
+
+private:
+  /// Number of times a thread yields before it waits on the condition variable
+  static const int SpinCount = 64;
+
+  template<typename Predicate>
+  bool WaitUntil(std::atomic<bool>& waiting, std::condition_variable& condition, Predicate ready)
+  {
+    for (int i = 0; i < SpinCount && !this->Aborted && !ready(); ++i)
+    {
+      std::this_thread::yield();
+    }
+    if (!this->Aborted && !ready())
+    {
+      // The waiting flag is set before the predicate is checked again, and the other thread checks the flag after it has
+      // updated its index, so either this thread sees the update or the other thread sees the flag and notifies.
+      std::unique_lock<std::mutex> lock(this->Mutex);
+      waiting = true;
+      condition.wait(lock, [this, &ready]() { return this->Aborted || ready(); });
+      waiting = false;
+    }
+    return !this->Aborted;
+  }
+
+  void Wake(std::atomic<bool>& waiting, std::condition_variable& condition)
+  {
+    if (waiting)
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      condition.notify_one();
+    }
+  }
+
+  std::vector<T> Items;
+  int Capacity;
+  std::atomic<unsigned long long> Head;
+  std::atomic<unsigned long long> Tail;
+  std::atomic<bool> Aborted;
+  std::atomic<bool> ProducerWaiting;
+  std::atomic<bool> ConsumerWaiting;
+  std::mutex Mutex;
+  std::condition_variable NotFull;
+  std::condition_variable NotEmpty;
+};
+}
+
+//----------------------------------------------------------------------------
+static double GetElapsedSeconds(const std::chrono::steady_clock::time_point& startTime)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+//----------------------------------------------------------------------------
+// Add the statistics of a frame block to the total statistics
+static void MergeTranscodingStatistics(vtkSlicerIGSIOCommon::TranscodingStatistics& totalStatistics,
+  const vtkSlicerIGSIOCommon::TranscodingStatistics& blockStatistics)
+{
+  int numberOfDecodedFrames = totalStatistics.NumberOfDecodedFrames + blockStatistics.NumberOfDecodedFrames;
+  if (numberOfDecodedFrames > 0)
+  {
+    totalStatistics.FreeBufferQueueAverageDepth =
+      (totalStatistics.FreeBufferQueueAverageDepth * totalStatistics.NumberOfDecodedFrames
+      + blockStatistics.FreeBufferQueueAverageDepth * blockStatistics.NumberOfDecodedFrames) / numberOfDecodedFrames;
+  }
+  int numberOfEncodedFrames = totalStatistics.NumberOfEncodedFrames + blockStatistics.NumberOfEncodedFrames;
+  if (numberOfEncodedFrames > 0)
+  {
+    totalStatistics.DecodedQueueAverageDepth =
+      (totalStatistics.DecodedQueueAverageDepth * totalStatistics.NumberOfEncodedFrames
+      + blockStatistics.DecodedQueueAverageDepth * blockStatistics.NumberOfEncodedFrames) / numberOfEncodedFrames;
+  }
+  totalStatistics.NumberOfDecodedFrames = numberOfDecodedFrames;
+  totalStatistics.NumberOfEncodedFrames = numberOfEncodedFrames;
+  totalStatistics.DecodeTime += blockStatistics.DecodeTime;
+  totalStatistics.EncodeTime += blockStatistics.EncodeTime;
+  totalStatistics.DecodeStallTime += blockStatistics.DecodeStallTime;
+  totalStatistics.EncodeStallTime += blockStatistics.EncodeStallTime;
+  totalStatistics.DecodedQueueMaximumDepth = std::max(totalStatistics.DecodedQueueMaximumDepth, blockStatistics.DecodedQueueMaximumDepth);
+  totalStatistics.FreeBufferQueueMaximumDepth = std::max(totalStatistics.FreeBufferQueueMaximumDepth, blockStatistics.FreeBufferQueueMaximumDepth);
+}
+
+//----------------------------------------------------------------------------
+// Input image of the encoding stage
+namespace
+{
+struct TranscodingFrame
+{
+  /// Frame buffer that is returned to the decoding stage once the frame has been encoded
+  vtkImageData* Buffer;
+  /// Image that is encoded. Either the frame buffer, or the image of an uncompressed volume. NULL if decoding failed.
+  vtkImageData* Image;
+};
+}
+
+//----------------------------------------------------------------------------
+// Create the encoder that is used for encoding frame blocks. Each worker thread uses its own encoder for all of its blocks.
+static vtkSmartPointer<vtkStreamingVolumeCodec> CreateTranscodingEncoder(vtkObject* logObject, const std::string& codecFourCC,
+  const std::map<std::string, std::string>& codecParameters)
+{
+  vtkSmartPointer<vtkStreamingVolumeCodec> codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+    vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(codecFourCC));
+  if (!codec)
+  {
+    vtkErrorWithObjectMacro(logObject, "Could not find codec: " << codecFourCC);
+    return NULL;
+  }
+  codec->SetParameters(codecParameters);
+  return codec;
+}
+
+//----------------------------------------------------------------------------
+// Encode all of the frames in the frame block using the codec. The first frame of the block is encoded as a keyframe,
+// so the same codec can be used for consecutive blocks.
+// Encoded frames are transcoded directly: a single decoder is used for the whole block, without going through a streaming volume node.
+// If decodeOnSeparateThread is enabled, decoding runs on a separate thread, and the decoded frames are passed to the encoder
+// (on the calling thread) through a bounded lock-free ring buffer. A fixed set of frame buffers is cycled between the two stages,
+// so no images are allocated while transcoding. Otherwise, each frame is decoded on the calling thread before it is encoded,
+// which is used when the blocks are already encoded in parallel, so that there is only one thread per block.
+// The frame buffers are taken from the shared image pool, and returned to it once the block is encoded.
+// The frame block indices refer to the source frames. Only the source frames are accessed, so the sequence can be modified while
+// the block is encoded. The resulting frames are stored in encodedFrames. logObject is only used for reporting errors.
+static bool EncodeFrameBlock(vtkObject* logObject, const std::vector<vtkSlicerIGSIOCommon::TranscodingSourceFrame>& sourceFrames,
+  const vtkSlicerIGSIOCommon::FrameBlock& frameBlock, vtkStreamingVolumeCodec* codec, bool decodeOnSeparateThread,
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> >& encodedFrames, vtkSlicerIGSIOCommon::TranscodingStatistics& statistics,
+  std::atomic<int>* numberOfProcessedFrames=NULL, const std::atomic<bool>* cancelRequested=NULL)
+{
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("ReEncodeBlock", frameBlock.EndFrame - frameBlock.StartFrame + 1);
+  if (!codec)
   {
-    if (frameBlockIt->ReEncodingRequired)
+    vtkErrorWithObjectMacro(logObject, "EncodeFrameBlock: Invalid codec");
+    return false;
+  }
+
+  int numberOfFrameBuffers = decodeOnSeparateThread ? TRANSCODING_NUMBER_OF_FRAME_BUFFERS : 1;
+  std::vector<vtkSmartPointer<vtkImageData> > frameBuffers;
+  TranscodingQueue<vtkImageData*> freeFrameBuffers(numberOfFrameBuffers);
+  TranscodingQueue<TranscodingFrame> decodedFrames(numberOfFrameBuffers);
+  vtkSlicerIGSIOImagePool* imagePool = vtkSlicerIGSIOImagePool::GetInstance();
+  vtkStreamingVolumeFrame* firstSourceFrame = sourceFrames[frameBlock.StartFrame].Frame;
+  for (int i = 0; i < numberOfFrameBuffers; ++i)
+  {
+    vtkSmartPointer<vtkImageData> frameBuffer = vtkSmartPointer<vtkImageData>::New();
+    if (firstSourceFrame)
+    {
+      imagePool->AllocateDecodedImage(firstSourceFrame, frameBuffer);
+    }
+    frameBuffers.push_back(frameBuffer);
+    freeFrameBuffers.Push(frameBuffer);
+  }
+
+  // Decode the source frame into the frame buffer. Returns the image that should be encoded, or NULL if decoding failed.
+  vtkSmartPointer<vtkStreamingVolumeCodec> decoder;
+  vtkSmartPointer<vtkStreamingVolumeFrame> lastDecodedFrame;
+  vtkImageData* lastDecodedImage = NULL;
+  auto decodeSourceFrame = [&](int i, vtkImageData* frameBuffer) -> vtkImageData*
+  {
+    std::chrono::steady_clock::time_point decodeStartTime = std::chrono::steady_clock::now();
+    vtkImageData* image = NULL;
+    const vtkSlicerIGSIOCommon::TranscodingSourceFrame& sourceFrame = sourceFrames[i];
+    if (sourceFrame.Frame)
     {
-      vtkNew<vtkMRMLStreamingVolumeNode> decodingProxyNode;
-      vtkSmartPointer<vtkStreamingVolumeCodec> codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
-        vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(codecFourCC));
-      if (!codec)
+      if (TranscodingDecodeFrame(decoder, lastDecodedFrame, lastDecodedImage, sourceFrame.Frame, frameBuffer))
       {
-        vtkErrorWithObjectMacro(videoStreamSequenceNode, "Could not find codec: " << codecFourCC);
-        return false;
+        image = frameBuffer;
       }
-      codec->SetParameters(codecParameters);
-
-      for (int i = frameBlockIt->StartFrame; i <= frameBlockIt->EndFrame; ++i)
+    }
+    else if (sourceFrame.Image)
+    {
+      // Uncompressed images are encoded directly. They must not be shared with the frame buffers, since the buffers are decoded into.
+      image = sourceFrame.Image;
+    }
+    else
+    {
+      vtkErrorWithObjectMacro(logObject, "Invalid data node at index " << i);
+    }
+    double decodeSeconds = GetElapsedSeconds(decodeStartTime);
+    statistics.DecodeTime += decodeSeconds;
+    if (vtkSlicerIGSIOInstrumentation::IsActive())
+    {
+      vtkSlicerIGSIOInstrumentation::GetInstance()->RecordStage("Decode", decodeSeconds);
+      vtkSlicerIGSIOInstrumentation::GetInstance()->RecordTraceEvent("Decode", decodeStartTime, decodeSeconds);
+    }
+    ++statistics.NumberOfDecodedFrames;
+    return image;
+  };
+
+  // Aborting the queues wakes up both stages, so neither of them can wait forever for the other one
+  long long freeBufferQueueDepthSum = 0;
+  std::thread decodingThread;
+  if (decodeOnSeparateThread)
+  {
+    decodingThread = std::thread([&]()
+    {
+      for (int i = frameBlock.StartFrame; i <= frameBlock.EndFrame; ++i)
       {
-        vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(videoStreamSequenceNode->GetNthDataNode(i));
-        if (!volumeNode)
+        if (cancelRequested && *cancelRequested)
         {
-          vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid data node at index " << i);
-          return false;
+          freeFrameBuffers.Abort();
+          decodedFrames.Abort();
+          return;
         }
 
-        vtkSmartPointer<vtkImageData> imageData = NULL;
-        vtkMRMLStreamingVolumeNode* streamingNode = vtkMRMLStreamingVolumeNode::SafeDownCast(volumeNode);
-        if (streamingNode && streamingNode->GetFrame())
+        int freeBufferQueueDepth = freeFrameBuffers.GetSize();
+        freeBufferQueueDepthSum += freeBufferQueueDepth;
+        statistics.FreeBufferQueueMaximumDepth = std::max(statistics.FreeBufferQueueMaximumDepth, freeBufferQueueDepth);
+
+        TranscodingFrame decodedFrame;
+        std::chrono::steady_clock::time_point stallStartTime = std::chrono::steady_clock::now();
+        if (!freeFrameBuffers.Pop(decodedFrame.Buffer))
         {
-          decodingProxyNode->SetAndObserveFrame(streamingNode->GetFrame());
-          decodingProxyNode->DecodeFrame();
-          imageData = decodingProxyNode->GetImageData();
+          return;
         }
-        else
+        statistics.DecodeStallTime += GetElapsedSeconds(stallStartTime);
+
+        decodedFrame.Image = decodeSourceFrame(i, decodedFrame.Buffer);
+
+        // If decoding failed, the frame is still passed to the encoding stage to stop encoding
+        stallStartTime = std::chrono::steady_clock::now();
+        if (!decodedFrames.Push(decodedFrame))
         {
-          imageData = volumeNode->GetImageData();
+          return;
         }
+        statistics.DecodeStallTime += GetElapsedSeconds(stallStartTime);
 
-        vtkSmartPointer<vtkStreamingVolumeFrame> frame = vtkSmartPointer<vtkStreamingVolumeFrame>::New();
-        if (!codec->EncodeImageData(imageData, frame))
+        if (!decodedFrame.Image)
         {
-          vtkErrorWithObjectMacro(videoStreamSequenceNode, "Error encoding frame!");
-          return false;
+          return;
         }
-        streamingNode->SetAndObserveFrame(frame);
       }
+    });
+  }
+
+  bool success = true;
+  long long decodedQueueDepthSum = 0;
+  encodedFrames.clear();
+  encodedFrames.reserve(frameBlock.EndFrame - frameBlock.StartFrame + 1);
+  for (int i = frameBlock.StartFrame; i <= frameBlock.EndFrame; ++i)
+  {
+    if (cancelRequested && *cancelRequested)
+    {
+      success = false;
+      break;
     }
+
+    TranscodingFrame decodedFrame;
+    if (decodeOnSeparateThread)
+    {
+      int decodedQueueDepth = decodedFrames.GetSize();
+      decodedQueueDepthSum += decodedQueueDepth;
+      statistics.DecodedQueueMaximumDepth = std::max(statistics.DecodedQueueMaximumDepth, decodedQueueDepth);
+
+      std::chrono::steady_clock::time_point stallStartTime = std::chrono::steady_clock::now();
+      if (!decodedFrames.Pop(decodedFrame))
+      {
+        // The decoding stage was cancelled
+        success = false;
+        break;
+      }
+      statistics.EncodeStallTime += GetElapsedSeconds(stallStartTime);
+    }
+    else
+    {
+      decodedFrame.Buffer = frameBuffers[0];
+      decodedFrame.Image = decodeSourceFrame(i, decodedFrame.Buffer);
+    }
+
+    if (!decodedFrame.Image)
+    {
+      vtkErrorWithObjectMacro(logObject, "Error decoding frame " << i << "!");
+      success = false;
+      break;
+    }
+
+    // The first frame of each block is a keyframe, so that the blocks can be decoded independently
+    std::chrono::steady_clock::time_point encodeStartTime = std::chrono::steady_clock::now();
+    vtkSmartPointer<vtkStreamingVolumeFrame> frame = vtkSmartPointer<vtkStreamingVolumeFrame>::New();
+    bool encoded = vtkSlicerIGSIOCommon::EncodeImageData(codec, decodedFrame.Image, frame, i == frameBlock.StartFrame);
+    double encodeSeconds = GetElapsedSeconds(encodeStartTime);
+    statistics.EncodeTime += encodeSeconds;
+    if (vtkSlicerIGSIOInstrumentation::IsActive())
+    {
+      vtkSlicerIGSIOInstrumentation::GetInstance()->RecordStage("Encode", encodeSeconds);
+      vtkSlicerIGSIOInstrumentation::GetInstance()->RecordTraceEvent("Encode", encodeStartTime, encodeSeconds);
+    }
+    ++statistics.NumberOfEncodedFrames;
+
+    if (decodeOnSeparateThread)
+    {
+      // The queue can hold all of the frame buffers, so returning a buffer never waits
+      freeFrameBuffers.Push(decodedFrame.Buffer);
+    }
+    if (!encoded)
+    {
+      vtkErrorWithObjectMacro(logObject, "Error encoding frame!");
+      success = false;
+      break;
+    }
+    encodedFrames.push_back(frame);
+    if (numberOfProcessedFrames)
+    {
+      ++(*numberOfProcessedFrames);
+    }
+  }
+
+  if (decodeOnSeparateThread)
+  {
+    freeFrameBuffers.Abort();
+    decodedFrames.Abort();
+    decodingThread.join();
+  }
+
+  for (std::vector<vtkSmartPointer<vtkImageData> >::iterator frameBufferIt = frameBuffers.begin(); frameBufferIt != frameBuffers.end(); ++frameBufferIt)
+  {
+    vtkSmartPointer<vtkImageData> frameBuffer = *frameBufferIt;
+    *frameBufferIt = NULL;
+    imagePool->ReleaseImage(frameBuffer);
+  }
+
+  if (decodeOnSeparateThread && statistics.NumberOfDecodedFrames > 0)
+  {
+    statistics.FreeBufferQueueAverageDepth = freeBufferQueueDepthSum / (double)statistics.NumberOfDecodedFrames;
+  }
+  if (decodeOnSeparateThread && statistics.NumberOfEncodedFrames > 0)
+  {
+    statistics.DecodedQueueAverageDepth = decodedQueueDepthSum / (double)statistics.NumberOfEncodedFrames;
+  }
+  return success;
+}
+
+//----------------------------------------------------------------------------
+// Encode the frames of the frame block (indices of the items of the sequence) without modifying the sequence
+static bool EncodeSequenceFrameBlock(vtkMRMLSequenceNode* videoStreamSequenceNode, const vtkSlicerIGSIOCommon::FrameBlock& frameBlock,
+  const std::string& codecFourCC, const std::map<std::string, std::string>& codecParameters,
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> >& encodedFrames, vtkSlicerIGSIOCommon::TranscodingStatistics& statistics)
+{
+  std::vector<vtkSlicerIGSIOCommon::TranscodingSourceFrame> sourceFrames;
+  if (!vtkSlicerIGSIOCommon::GetTranscodingSourceFrames(videoStreamSequenceNode, frameBlock.StartFrame, frameBlock.EndFrame, sourceFrames, false))
+  {
+    return false;
+  }
+  vtkSmartPointer<vtkStreamingVolumeCodec> codec = CreateTranscodingEncoder(videoStreamSequenceNode, codecFourCC, codecParameters);
+  if (!codec)
+  {
+    return false;
+  }
+  vtkSlicerIGSIOCommon::FrameBlock sourceFrameBlock = frameBlock;
+  sourceFrameBlock.StartFrame = 0;
+  sourceFrameBlock.EndFrame = (int)sourceFrames.size() - 1;
+  return EncodeFrameBlock(videoStreamSequenceNode, sourceFrames, sourceFrameBlock, codec, true, encodedFrames, statistics);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::GetTranscodingSourceFrames(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex,
+  std::vector<TranscodingSourceFrame>& sourceFrames, bool copyImages/*=true*/)
+{
+  sourceFrames.clear();
+  if (!videoStreamSequenceNode)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Cannot convert reference node to vtkMRMLSequenceNode");
+    return false;
+  }
+
+  int numberOfFrames = videoStreamSequenceNode->GetNumberOfDataNodes();
+  if (startIndex < 0 || startIndex >= numberOfFrames || startIndex > endIndex
+    || endIndex >= numberOfFrames)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid start and end indices!");
+    return false;
+  }
+
+  sourceFrames.reserve(endIndex - startIndex + 1);
+  for (int i = startIndex; i <= endIndex; ++i)
+  {
+    TranscodingSourceFrame sourceFrame;
+    vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(videoStreamSequenceNode->GetNthDataNode(i));
+    vtkMRMLStreamingVolumeNode* streamingNode = vtkMRMLStreamingVolumeNode::SafeDownCast(volumeNode);
+    if (streamingNode)
+    {
+      sourceFrame.IsStreamingVolume = true;
+      sourceFrame.IsKeyFrame = streamingNode->IsKeyFrame();
+      sourceFrame.CodecFourCC = streamingNode->GetCodecFourCC();
+      sourceFrame.Frame = streamingNode->GetFrame();
+    }
+    vtkImageData* image = volumeNode && !sourceFrame.Frame ? volumeNode->GetImageData() : NULL;
+    if (image)
+    {
+      sourceFrame.SourceImage = image;
+      sourceFrame.SourceImageMTime = image->GetMTime();
+      if (copyImages)
+      {
+        sourceFrame.Image = vtkSmartPointer<vtkImageData>::New();
+        vtkSlicerIGSIOImagePool::GetInstance()->CopyImage(image, sourceFrame.Image);
+      }
+      else
+      {
+        sourceFrame.Image = image;
+      }
+    }
+    sourceFrames.push_back(sourceFrame);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::ReEncodeSourceFrames(vtkObject* logObject, const std::vector<TranscodingSourceFrame>& sourceFrames,
+  std::string codecFourCC, std::map<std::string, std::string> codecParameters, bool forceReEncoding, bool minimalReEncoding, int numberOfThreads,
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> >& encodedFrames, TranscodingStatistics* statistics/*=NULL*/,
+  std::atomic<int>* numberOfProcessedFrames/*=NULL*/, const std::atomic<bool>* cancelRequested/*=NULL*/)
+{
+  if (statistics)
+  {
+    *statistics = TranscodingStatistics();
+  }
+
+  int numberOfFrames = (int)sourceFrames.size();
+  encodedFrames.assign(numberOfFrames, NULL);
+  if (numberOfFrames == 0)
+  {
+    vtkErrorWithObjectMacro(logObject, "Invalid start and end indices!");
+    return false;
+  }
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("ReEncode", numberOfFrames);
+
+  std::vector<FrameBlock> frameBlocks;
+
+  if (!forceReEncoding)
+  {
+    FrameBlock currentFrameBlock;
+    currentFrameBlock.StartFrame = 0;
+    currentFrameBlock.EndFrame = 0;
+    currentFrameBlock.ReEncodingRequired = false;
+    vtkSmartPointer<vtkStreamingVolumeFrame> previousFrame = NULL;
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      // TODO: for now, only support sequences of vtkMRMLStreamingVolumeNode
+      // In the future, this could be changed to allow all types of volume nodes to be encoded
+      const TranscodingSourceFrame& sourceFrame = sourceFrames[i];
+      if (!sourceFrame.IsStreamingVolume)
+      {
+        vtkErrorWithObjectMacro(logObject, "Invalid data node at index " << i);
+        return false;
+      }
+
+      if (codecFourCC == "")
+      {
+        codecFourCC = sourceFrame.CodecFourCC;
+      }
+
+      vtkStreamingVolumeFrame* currentFrame = sourceFrame.Frame;
+      if (currentFrameBlock.ReEncodingRequired == false)
+      {
+        if (i == 0 && !sourceFrame.IsKeyFrame)
+        {
+          currentFrameBlock.ReEncodingRequired = true;
+        }
+        else if (!currentFrame)
+        {
+          currentFrameBlock.ReEncodingRequired = true;
+        }
+        else if (codecFourCC == "")
+        {
+          currentFrameBlock.ReEncodingRequired = true;
+        }
+        else if (codecFourCC != sourceFrame.CodecFourCC)
+        {
+          currentFrameBlock.ReEncodingRequired = true;
+        }
+        else if (!minimalReEncoding && currentFrame && !currentFrame->IsKeyFrame() && previousFrame != currentFrame->GetPreviousFrame())
+        {
+          currentFrameBlock.ReEncodingRequired = true;
+        }
+      }
+
+      if (currentFrame && // Current frame exists
+        previousFrame && // Current frame is not the initial frame
+        currentFrame->IsKeyFrame() && // Current frame is a keyframe
+        !previousFrame->IsKeyFrame()) // Previous frame was not also a keyframe
+      {
+        frameBlocks.push_back(currentFrameBlock);
+        currentFrameBlock = FrameBlock();
+        currentFrameBlock.StartFrame = i;
+        currentFrameBlock.EndFrame = i;
+        currentFrameBlock.ReEncodingRequired = false;
+      }
+      currentFrameBlock.EndFrame = i;
+      previousFrame = currentFrame;
+
+      /// TODO: If dimension changes, re-encode smaller images with padding
+    }
+    frameBlocks.push_back(currentFrameBlock);
+  }
+  else
+  {
+    FrameBlock totalFrameBlock;
+    totalFrameBlock.StartFrame = 0;
+    totalFrameBlock.EndFrame = numberOfFrames - 1;
+    totalFrameBlock.ReEncodingRequired = true;
+    frameBlocks.push_back(totalFrameBlock);
+  }
+
+  if (codecFourCC == "")
+  {
+    std::vector<std::string> codecFourCCs = vtkStreamingVolumeCodecFactory::GetInstance()->GetStreamingCodecFourCCs();
+    if (codecFourCCs.empty())
+    {
+      vtkErrorWithObjectMacro(logObject, "Re-encode failed! No codecs registered!");
+      return false;
+    }
+
+    codecFourCC = codecFourCCs.front();
+    vtkDebugWithObjectMacro(logObject, "Streaming volume codec not specified! Using: " << codecFourCC);
+  }
+
+  // Only the blocks that require re-encoding are processed by the workers.
+  // When multiple threads are used, large blocks are split further so that all of the threads can be used.
+  // A block can only be split at frames that are either keyframes or not encoded, so that each part can be decoded independently.
+  int targetBlockSize = numberOfFrames;
+  if (numberOfThreads != 1)
+  {
+    targetBlockSize = std::max(1, (int)std::ceil(numberOfFrames / (double)GetNumberOfReEncodingThreads(numberOfThreads)));
+  }
+
+  std::vector<FrameBlock> reEncodedFrameBlocks;
+  std::vector<FrameBlock>::iterator frameBlockIt;
+  for (frameBlockIt = frameBlocks.begin(); frameBlockIt != frameBlocks.end(); ++frameBlockIt)
+  {
+    if (!frameBlockIt->ReEncodingRequired)
+    {
+      continue;
+    }
+
+    FrameBlock currentFrameBlock = *frameBlockIt;
+    for (int i = frameBlockIt->StartFrame + 1; i <= frameBlockIt->EndFrame; ++i)
+    {
+      if (i - currentFrameBlock.StartFrame < targetBlockSize)
+      {
+        continue;
+      }
+
+      vtkStreamingVolumeFrame* currentFrame = sourceFrames[i].Frame;
+      if (!currentFrame || currentFrame->IsKeyFrame())
+      {
+        currentFrameBlock.EndFrame = i - 1;
+        reEncodedFrameBlocks.push_back(currentFrameBlock);
+        currentFrameBlock.StartFrame = i;
+      }
+    }
+    currentFrameBlock.EndFrame = frameBlockIt->EndFrame;
+    reEncodedFrameBlocks.push_back(currentFrameBlock);
+  }
+
+  if (reEncodedFrameBlocks.empty())
+  {
+    return true;
+  }
+
+  std::vector<std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > > blockEncodedFrames(reEncodedFrameBlocks.size());
+  std::vector<bool> frameBlockSuccess(reEncodedFrameBlocks.size(), false);
+  std::vector<TranscodingStatistics> frameBlockStatistics(reEncodedFrameBlocks.size());
+
+  int numberOfWorkers = std::min(GetNumberOfReEncodingThreads(numberOfThreads), (int)reEncodedFrameBlocks.size());
+  if (numberOfWorkers <= 1)
+  {
+    // A single block is encoded at a time, so decoding runs on a separate thread to overlap with encoding
+    vtkSmartPointer<vtkStreamingVolumeCodec> codec = CreateTranscodingEncoder(logObject, codecFourCC, codecParameters);
+    for (int blockIndex = 0; codec && blockIndex < (int)reEncodedFrameBlocks.size(); ++blockIndex)
+    {
+      frameBlockSuccess[blockIndex] = EncodeFrameBlock(logObject, sourceFrames, reEncodedFrameBlocks[blockIndex],
+        codec, true, blockEncodedFrames[blockIndex], frameBlockStatistics[blockIndex], numberOfProcessedFrames, cancelRequested);
+      if (!frameBlockSuccess[blockIndex])
+      {
+        break;
+      }
+    }
+  }
+  else
+  {
+    // Each worker takes the next unprocessed block and encodes it with its own codec instance, which is reused for all of its blocks.
+    // The workers decode the frames themselves, so that there are no more threads than workers.
+    // Workers only read the source frames; the results are collected on this thread once all workers have finished.
+    std::atomic<int> nextBlockIndex(0);
+    std::atomic<bool> encodingFailed(false);
+    std::vector<std::thread> workers;
+    for (int workerIndex = 0; workerIndex < numberOfWorkers; ++workerIndex)
+    {
+      workers.push_back(std::thread([&]()
+      {
+        vtkSmartPointer<vtkStreamingVolumeCodec> codec = CreateTranscodingEncoder(logObject, codecFourCC, codecParameters);
+        if (!codec)
+        {
+          encodingFailed = true;
+          return;
+        }
+        int blockIndex = 0;
+        while (!encodingFailed && (blockIndex = nextBlockIndex++) < (int)reEncodedFrameBlocks.size())
+        {
+          frameBlockSuccess[blockIndex] = EncodeFrameBlock(logObject, sourceFrames, reEncodedFrameBlocks[blockIndex],
+            codec, false, blockEncodedFrames[blockIndex], frameBlockStatistics[blockIndex], numberOfProcessedFrames, cancelRequested);
+          if (!frameBlockSuccess[blockIndex])
+          {
+            encodingFailed = true;
+          }
+        }
+      }));
+    }
+    for (std::vector<std::thread>::iterator workerIt = workers.begin(); workerIt != workers.end(); ++workerIt)
+    {
+      workerIt->join();
+    }
+  }
+
+  if (statistics)
+  {
+    for (int blockIndex = 0; blockIndex < (int)reEncodedFrameBlocks.size(); ++blockIndex)
+    {
+      MergeTranscodingStatistics(*statistics, frameBlockStatistics[blockIndex]);
+    }
+  }
+
+  if (cancelRequested && *cancelRequested)
+  {
+    encodedFrames.assign(numberOfFrames, NULL);
+    return false;
+  }
+
+  for (int blockIndex = 0; blockIndex < (int)reEncodedFrameBlocks.size(); ++blockIndex)
+  {
+    if (!frameBlockSuccess[blockIndex])
+    {
+      vtkErrorWithObjectMacro(logObject, "Error encoding frames " << reEncodedFrameBlocks[blockIndex].StartFrame
+        << " to " << reEncodedFrameBlocks[blockIndex].EndFrame << "!");
+      encodedFrames.assign(numberOfFrames, NULL);
+      return false;
+    }
+  }
+
+  for (int blockIndex = 0; blockIndex < (int)reEncodedFrameBlocks.size(); ++blockIndex)
+  {
+    const FrameBlock& frameBlock = reEncodedFrameBlocks[blockIndex];
+    for (int i = frameBlock.StartFrame; i <= frameBlock.EndFrame; ++i)
+    {
+      encodedFrames[i] = blockEncodedFrames[blockIndex][i - frameBlock.StartFrame];
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::SetEncodedFrames(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex,
+  const std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> >& encodedFrames,
+  const std::vector<TranscodingSourceFrame>* sourceFrames/*=NULL*/)
+{
+  if (!videoStreamSequenceNode)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Cannot convert reference node to vtkMRMLSequenceNode");
+    return false;
+  }
+
+  int numberOfFrames = (int)encodedFrames.size();
+  if (startIndex < 0 || startIndex + numberOfFrames > videoStreamSequenceNode->GetNumberOfDataNodes()
+    || (sourceFrames && (int)sourceFrames->size() != numberOfFrames))
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Encoded frames do not match the items of the sequence!");
+    return false;
+  }
+
+  // All items are checked before any of them is modified, so that either all or none of the encoded frames are set
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingNode = vtkMRMLStreamingVolumeNode::SafeDownCast(videoStreamSequenceNode->GetNthDataNode(startIndex + i));
+    if (encodedFrames[i] && !streamingNode)
+    {
+      vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid data node at index " << startIndex + i);
+      return false;
+    }
+    if (!sourceFrames || !streamingNode)
+    {
+      continue;
+    }
+    const TranscodingSourceFrame& sourceFrame = (*sourceFrames)[i];
+    vtkImageData* sourceImage = sourceFrame.SourceImage;
+    bool itemChanged = sourceFrame.Frame ? streamingNode->GetFrame() != sourceFrame.Frame.GetPointer()
+      : (streamingNode->GetFrame() || !sourceImage || streamingNode->GetImageData() != sourceImage
+        || sourceImage->GetMTime() != sourceFrame.SourceImageMTime);
+    if (itemChanged)
+    {
+      vtkErrorWithObjectMacro(videoStreamSequenceNode, "Item " << startIndex + i << " of the sequence was modified while it was being encoded!");
+      return false;
+    }
+  }
+
+  // Splice the encoded frames back into the sequence in order
+  int wasModifying = videoStreamSequenceNode->StartModify();
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    if (!encodedFrames[i])
+    {
+      continue;
+    }
+    vtkMRMLStreamingVolumeNode* streamingNode = vtkMRMLStreamingVolumeNode::SafeDownCast(videoStreamSequenceNode->GetNthDataNode(startIndex + i));
+    streamingNode->SetAndObserveFrame(encodedFrames[i]);
+  }
+  videoStreamSequenceNode->EndModify(wasModifying);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::ReEncodeVideoSequence(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex, std::string codecFourCC, std::map<std::string, std::string> codecParameters, bool forceReEncoding, bool minimalReEncoding, int numberOfThreads,
+  TranscodingStatistics* statistics/*=NULL*/)
+{
+  if (statistics)
+  {
+    *statistics = TranscodingStatistics();
+  }
+
+  if (!videoStreamSequenceNode)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Cannot convert reference node to vtkMRMLSequenceNode");
+    return false;
+  }
+
+  if (endIndex < 0)
+  {
+    endIndex = videoStreamSequenceNode->GetNumberOfDataNodes() - 1;
+  }
+
+  // The sequence is not modified until the frames are encoded, so the images do not need to be copied
+  std::vector<TranscodingSourceFrame> sourceFrames;
+  if (!vtkSlicerIGSIOCommon::GetTranscodingSourceFrames(videoStreamSequenceNode, startIndex, endIndex, sourceFrames, false))
+  {
+    return false;
+  }
+
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > encodedFrames;
+  if (!vtkSlicerIGSIOCommon::ReEncodeSourceFrames(videoStreamSequenceNode, sourceFrames, codecFourCC, codecParameters,
+    forceReEncoding, minimalReEncoding, numberOfThreads, encodedFrames, statistics))
+  {
+    return false;
+  }
+  return vtkSlicerIGSIOCommon::SetEncodedFrames(videoStreamSequenceNode, startIndex, encodedFrames);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::ExportVideoSequence(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex,
+  std::string fileName, std::map<std::string, std::string> codecParameters)
+{
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (!vtkSlicerIGSIOCommon::VideoSequenceRangeToTrackedFrameList(videoStreamSequenceNode, startIndex, endIndex, trackedFrameList, codecParameters))
+  {
+    return false;
+  }
+
+  if (vtkIGSIOSequenceIO::Write(fileName, trackedFrameList) != IGSIO_SUCCESS)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Could not write frames " << startIndex << " to " << endIndex << " to file: " << fileName);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::VideoSequenceRangeToTrackedFrameList(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex,
+  vtkIGSIOTrackedFrameList* trackedFrameList, std::map<std::string, std::string> codecParameters, int* numberOfReEncodedFrames/*=NULL*/)
+{
+  if (numberOfReEncodedFrames)
+  {
+    *numberOfReEncodedFrames = 0;
+  }
+
+  if (!videoStreamSequenceNode || !trackedFrameList)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid arguments");
+    return false;
+  }
+
+  int numberOfFrames = videoStreamSequenceNode->GetNumberOfDataNodes();
+  if (endIndex < 0)
+  {
+    endIndex = numberOfFrames - 1;
+  }
+  if (startIndex < 0 || startIndex >= numberOfFrames || startIndex > endIndex || endIndex >= numberOfFrames)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid start and end indices!");
+    return false;
+  }
+
+  // Frames from the first keyframe in the range onwards can be copied without decoding.
+  // Only the frames preceding it (the tail of the group of pictures that started before the range) need to be re-encoded.
+  std::string codecFourCC;
+  int firstCopiedFrame = endIndex + 1;
+  for (int i = startIndex; i <= endIndex; ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingNode = vtkMRMLStreamingVolumeNode::SafeDownCast(videoStreamSequenceNode->GetNthDataNode(i));
+    if (!streamingNode)
+    {
+      vtkErrorWithObjectMacro(videoStreamSequenceNode, "Invalid data node at index " << i);
+      return false;
+    }
+
+    vtkStreamingVolumeFrame* frame = streamingNode->GetFrame();
+    if (firstCopiedFrame > endIndex)
+    {
+      if (codecFourCC.empty() && frame)
+      {
+        codecFourCC = streamingNode->GetCodecFourCC();
+      }
+      if (frame && frame->IsKeyFrame())
+      {
+        firstCopiedFrame = i;
+        codecFourCC = streamingNode->GetCodecFourCC();
+      }
+      continue;
+    }
+
+    // All of the copied frames must belong to the same stream
+    if (!frame || streamingNode->GetCodecFourCC() != codecFourCC)
+    {
+      vtkErrorWithObjectMacro(videoStreamSequenceNode, "Frame " << i << " is not encoded with " << codecFourCC
+        << ". The sequence must be re-encoded before the range can be exported.");
+      return false;
+    }
+  }
+
+  if (codecFourCC.empty())
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Frames " << startIndex << " to " << endIndex << " are not encoded!");
+    return false;
+  }
+
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > reEncodedFrames;
+  if (firstCopiedFrame > startIndex)
+  {
+    vtkSlicerIGSIOCommon::FrameBlock leadingFrameBlock;
+    leadingFrameBlock.StartFrame = startIndex;
+    leadingFrameBlock.EndFrame = firstCopiedFrame - 1;
+    leadingFrameBlock.ReEncodingRequired = true;
+    TranscodingStatistics statistics;
+    if (!EncodeSequenceFrameBlock(videoStreamSequenceNode, leadingFrameBlock, codecFourCC, codecParameters, reEncodedFrames, statistics))
+    {
+      vtkErrorWithObjectMacro(videoStreamSequenceNode, "Error re-encoding frames " << startIndex << " to " << firstCopiedFrame - 1 << "!");
+      return false;
+    }
+  }
+
+  trackedFrameList->Clear();
+
+  std::string trackName = videoStreamSequenceNode->GetNthDataNode(startIndex)->GetName();
+  if (trackedFrameList->SetCustomString(TRACKNAME_FIELD_NAME, trackName) == IGSIO_FAIL)
+  {
+    vtkErrorWithObjectMacro(videoStreamSequenceNode, "Could not set track name!");
+    return false;
+  }
+
+  // Timestamps are the same as the ones used when the whole sequence is written
+  bool useTimestamp = videoStreamSequenceNode->GetIndexName() == "time";
+  igsioTransformName imageToPhysicalName;
+  imageToPhysicalName.SetTransformName(trackName + "ToPhysical");
+  vtkSmartPointer<vtkMatrix4x4> ijkToRASTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int i = startIndex; i < firstCopiedFrame; ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingNode = vtkMRMLStreamingVolumeNode::SafeDownCast(videoStreamSequenceNode->GetNthDataNode(i));
+    streamingNode->GetIJKToRASMatrix(ijkToRASTransform);
+
+    double timestamp = 0.1 * (i + 1);
+    if (useTimestamp)
+    {
+      std::stringstream timestampSS;
+      timestampSS << videoStreamSequenceNode->GetNthIndexValue(i);
+      timestampSS >> timestamp;
+    }
+
+    igsioTrackedFrame trackedFrame;
+    igsioVideoFrame videoFrame;
+    videoFrame.SetEncodedFrame(reEncodedFrames[i - startIndex]);
+    trackedFrame.SetImageData(videoFrame);
+    trackedFrame.SetTimestamp(timestamp);
+    trackedFrame.SetFrameTransform(imageToPhysicalName, ijkToRASTransform);
+    trackedFrame.SetFrameField(FRAME_STATUS_TRACKNAME, vtkVariant(Frame_OK).ToString());
+    SetGrayscaleFrameField(trackedFrame, reEncodedFrames[i - startIndex]);
+    trackedFrameList->AddTrackedFrame(&trackedFrame);
+  }
+
+  // The remaining frames start with a keyframe, so the encoded packets can be copied as they are
+  if (firstCopiedFrame <= endIndex)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> copiedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (!vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(videoStreamSequenceNode, copiedFrameList, firstCopiedFrame, endIndex))
+    {
+      return false;
+    }
+    for (unsigned int i = 0; i < copiedFrameList->GetNumberOfTrackedFrames(); ++i)
+    {
+      trackedFrameList->AddTrackedFrame(copiedFrameList->GetTrackedFrame(i));
+    }
+  }
+
+  if (numberOfReEncodedFrames)
+  {
+    *numberOfReEncodedFrames = (int)reEncodedFrames.size();
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Numeric index value of the item of the sequence
+static double GetSequenceIndexValueAsNumber(vtkMRMLSequenceNode* sequenceNode, int itemNumber)
+{
+  double indexValue = 0.0;
+  std::stringstream indexValueSS;
+  indexValueSS << sequenceNode->GetNthIndexValue(itemNumber);
+  indexValueSS >> indexValue;
+  return indexValue;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOCommon::ConcatenateVideoSequences(vtkCollection* inputSequenceNodes, vtkMRMLSequenceNode* outputSequenceNode,
+  std::map<std::string, std::string> codecParameters, int* numberOfReEncodedFrames/*=NULL*/)
+{
+  if (numberOfReEncodedFrames)
+  {
+    *numberOfReEncodedFrames = 0;
+  }
+
+  if (!inputSequenceNodes || !outputSequenceNode)
+  {
+    vtkErrorWithObjectMacro(outputSequenceNode, "Invalid arguments");
+    return false;
+  }
+
+  // Check all of the inputs before the output is modified
+  std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+  for (int sequenceIndex = 0; sequenceIndex < inputSequenceNodes->GetNumberOfItems(); ++sequenceIndex)
+  {
+    vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(inputSequenceNodes->GetItemAsObject(sequenceIndex));
+    if (!sequenceNode || sequenceNode == outputSequenceNode)
+    {
+      vtkErrorWithObjectMacro(outputSequenceNode, "Invalid input sequence at index " << sequenceIndex);
+      return false;
+    }
+    if (sequenceNode->GetNumberOfDataNodes() < 1)
+    {
+      continue;
+    }
+    for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+    {
+      if (!vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i)))
+      {
+        vtkErrorWithObjectMacro(outputSequenceNode, "Invalid data node at index " << i << " of sequence " << sequenceNode->GetName());
+        return false;
+      }
+    }
+    sequenceNodes.push_back(sequenceNode);
+  }
+  if (sequenceNodes.empty())
+  {
+    vtkErrorWithObjectMacro(outputSequenceNode, "No frames to concatenate");
+    return false;
+  }
+
+  // The codec and the frame format of the output are defined by the first encoded frame
+  std::string codecFourCC;
+  int dimensions[3] = { 0, 0, 0 };
+  int numberOfComponents = 0;
+  for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceIt = sequenceNodes.begin(); sequenceIt != sequenceNodes.end() && codecFourCC.empty(); ++sequenceIt)
+  {
+    for (int i = 0; i < (*sequenceIt)->GetNumberOfDataNodes(); ++i)
+    {
+      vtkStreamingVolumeFrame* frame = vtkMRMLStreamingVolumeNode::SafeDownCast((*sequenceIt)->GetNthDataNode(i))->GetFrame();
+      if (frame)
+      {
+        codecFourCC = frame->GetCodecFourCC();
+        frame->GetDimensions(dimensions);
+        numberOfComponents = frame->GetNumberOfComponents();
+        break;
+      }
+    }
+  }
+  if (codecFourCC.empty())
+  {
+    vtkErrorWithObjectMacro(outputSequenceNode, "The input sequences are not encoded!");
+    return false;
+  }
+
+  // Frames are re-encoded without resampling, so all of the images must already have the frame format of the output
+  for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceIt = sequenceNodes.begin(); sequenceIt != sequenceNodes.end(); ++sequenceIt)
+  {
+    for (int i = 0; i < (*sequenceIt)->GetNumberOfDataNodes(); ++i)
+    {
+      vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast((*sequenceIt)->GetNthDataNode(i));
+      vtkStreamingVolumeFrame* frame = streamingVolumeNode->GetFrame();
+      vtkImageData* imageData = streamingVolumeNode->GetImageData();
+      int frameDimensions[3] = { 0, 0, 0 };
+      int frameNumberOfComponents = 0;
+      if (frame)
+      {
+        frame->GetDimensions(frameDimensions);
+        frameNumberOfComponents = frame->GetNumberOfComponents();
+      }
+      else if (imageData)
+      {
+        imageData->GetDimensions(frameDimensions);
+        frameNumberOfComponents = imageData->GetNumberOfScalarComponents();
+      }
+      if (frameNumberOfComponents != numberOfComponents
+        || frameDimensions[0] != dimensions[0] || frameDimensions[1] != dimensions[1] || frameDimensions[2] != dimensions[2])
+      {
+        vtkErrorWithObjectMacro(outputSequenceNode, "Frame " << i << " of sequence " << (*sequenceIt)->GetName() << " has the format "
+          << frameDimensions[0] << "x" << frameDimensions[1] << "x" << frameDimensions[2] << " (" << frameNumberOfComponents << " components)"
+          << ", which differs from the format of the output " << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2]
+          << " (" << numberOfComponents << " components). Resample the input sequences to the same frame size before concatenating them.");
+        return false;
+      }
+    }
+  }
+
+  // Encoded frames of each input are copied, except for the frames that cannot be decoded as part of the output stream:
+  // - If the frames of an input use a different codec or are not encoded, the whole input is re-encoded.
+  // - Otherwise, only the frames preceding the first keyframe of the input (the seam group of pictures) are re-encoded.
+  std::vector<FrameBlock> reEncodedFrameBlocks(sequenceNodes.size());
+  std::vector<std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > > encodedFrames(sequenceNodes.size());
+  for (int sequenceIndex = 0; sequenceIndex < (int)sequenceNodes.size(); ++sequenceIndex)
+  {
+    vtkMRMLSequenceNode* sequenceNode = sequenceNodes[sequenceIndex];
+    FrameBlock& frameBlock = reEncodedFrameBlocks[sequenceIndex];
+    int numberOfFrames = sequenceNode->GetNumberOfDataNodes();
+    int firstKeyFrameIndex = -1;
+    bool codecMismatch = false;
+    // Every frame is checked, since a codec change can occur anywhere in the input
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      vtkStreamingVolumeFrame* frame = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i))->GetFrame();
+      if (!frame || frame->GetCodecFourCC() != codecFourCC)
+      {
+        codecMismatch = true;
+        break;
+      }
+      if (firstKeyFrameIndex < 0 && frame->IsKeyFrame())
+      {
+        firstKeyFrameIndex = i;
+      }
+    }
+    frameBlock.StartFrame = 0;
+    if (codecMismatch || firstKeyFrameIndex < 0)
+    {
+      frameBlock.EndFrame = numberOfFrames - 1;
+    }
+    else
+    {
+      frameBlock.EndFrame = firstKeyFrameIndex - 1;
+    }
+    frameBlock.ReEncodingRequired = frameBlock.EndFrame >= frameBlock.StartFrame;
+
+    if (frameBlock.ReEncodingRequired)
+    {
+      TranscodingStatistics statistics;
+      if (!EncodeSequenceFrameBlock(sequenceNode, frameBlock, codecFourCC, codecParameters, encodedFrames[sequenceIndex], statistics))
+      {
+        vtkErrorWithObjectMacro(outputSequenceNode, "Error re-encoding frames " << frameBlock.StartFrame << " to " << frameBlock.EndFrame
+          << " of sequence " << sequenceNode->GetName() << "!");
+        return false;
+      }
+      if (numberOfReEncodedFrames)
+      {
+        *numberOfReEncodedFrames += (int)encodedFrames[sequenceIndex].size();
+      }
+    }
+  }
+
+  std::string frameName = sequenceNodes[0]->GetNthDataNode(0)->GetName() ? sequenceNodes[0]->GetNthDataNode(0)->GetName() : "Video";
+
+  int wasModifying = outputSequenceNode->StartModify();
+  outputSequenceNode->RemoveAllDataNodes();
+  outputSequenceNode->SetIndexName("time");
+  outputSequenceNode->SetIndexUnit("s");
+  vtkMRMLScene* sequenceScene = outputSequenceNode->GetSequenceScene();
+  if (sequenceScene)
+  {
+    sequenceScene->StartState(vtkMRMLScene::BatchProcessState);
+  }
+
+  // Each input starts one frame interval (of the preceding input) after the last frame of the preceding input
+  double timeOffset = 0.0;
+  double previousEndTime = 0.0;
+  double previousFrameInterval = 0.0;
+  std::stringstream timestampSS;
+  timestampSS << std::setprecision(15);
+  vtkSmartPointer<vtkMatrix4x4> ijkToRASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int sequenceIndex = 0; sequenceIndex < (int)sequenceNodes.size(); ++sequenceIndex)
+  {
+    vtkMRMLSequenceNode* sequenceNode = sequenceNodes[sequenceIndex];
+    int numberOfFrames = sequenceNode->GetNumberOfDataNodes();
+    double startTime = GetSequenceIndexValueAsNumber(sequenceNode, 0);
+    double endTime = GetSequenceIndexValueAsNumber(sequenceNode, numberOfFrames - 1);
+    if (sequenceIndex > 0)
+    {
+      timeOffset = previousEndTime + previousFrameInterval - startTime;
+    }
+
+    const FrameBlock& frameBlock = reEncodedFrameBlocks[sequenceIndex];
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      vtkMRMLStreamingVolumeNode* inputVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+      vtkSmartPointer<vtkStreamingVolumeFrame> frame = inputVolumeNode->GetFrame();
+      if (frameBlock.ReEncodingRequired && i >= frameBlock.StartFrame && i <= frameBlock.EndFrame)
+      {
+        frame = encodedFrames[sequenceIndex][i - frameBlock.StartFrame];
+      }
+
+      vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+      streamingVolumeNode->SetName(frameName.c_str());
+      inputVolumeNode->GetIJKToRASMatrix(ijkToRASMatrix);
+      streamingVolumeNode->SetIJKToRASMatrix(ijkToRASMatrix);
+      streamingVolumeNode->SetAndObserveFrame(frame);
+
+      timestampSS.str("");
+      timestampSS.clear();
+      timestampSS << GetSequenceIndexValueAsNumber(sequenceNode, i) + timeOffset;
+      outputSequenceNode->SetDataNodeAtValue(streamingVolumeNode, timestampSS.str());
+    }
+
+    previousEndTime = endTime + timeOffset;
+    if (numberOfFrames > 1)
+    {
+      previousFrameInterval = (endTime - startTime) / (numberOfFrames - 1);
+    }
+    else if (previousFrameInterval <= 0.0)
+    {
+      previousFrameInterval = 0.1;
+    }
+  }
+
+  if (sequenceScene)
+  {
+    sequenceScene->EndState(vtkMRMLScene::BatchProcessState);
   }
+  outputSequenceNode->EndModify(wasModifying);
   return true;
 }
@@ -37,9 +37,20 @@ class vtkMRMLSequenceNode;
 class vtkMRMLSequenceBrowserNode;
 class vtkGenericVideoReader;
 class vtkGenericVideoWriter;
+class vtkSlicerIGSIOMkvFrameIndex;
+class vtkSlicerIGSIOTransformTrack;
+class vtkCollection;
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkObject;
+class vtkStreamingVolumeCodec;
+class vtkStreamingVolumeFrame;
 
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+#include <atomic>
 #include <map>
+#include <vector>
 #include <igsioVideoFrame.h>
 
 /// \ingroup SlicerIGSIO_vtkSlicerIGSIO
@@ -52,14 +63,102 @@ public:
   // Utility functions
   //----------------------------------------------------------------------------
 
-  static bool TrackedFrameListToVolumeSequence(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceNode* sequenceNode);
+  /// Populate the sequence node with the frames of the tracked frame list.
+  /// \param transferOwnership If enabled, the uncompressed images are moved from the tracked frame list into the volume nodes
+  ///   of the sequence without copying them, and the tracked frames are removed from the list as they are imported.
+  ///   The list is empty when the function returns.
+  static bool TrackedFrameListToVolumeSequence(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceNode* sequenceNode,
+    bool transferOwnership = false);
 
-  static bool TrackedFrameListToSequenceBrowser(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceBrowserNode* sequenceBrowserNode);
+  /// Populate the sequence node with the frames of a video track from a Matroska frame index.
+  /// The frames are added to the sequence as placeholders that read the encoded payload from the file when it is first required.
+  /// \param trackNumber Number of the video track. The first video track in the file is used if negative.
+  /// \return False if the track cannot be loaded lazily (ex. no codec is available for the track), in which case the file should be read fully.
+  static bool MkvFrameIndexToVolumeSequence(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkMRMLSequenceNode* sequenceNode, int trackNumber = -1);
+
+  /// Populate the sequence browser with the video and transform tracks from a Matroska frame index.
+  /// The video frames are read lazily (see MkvFrameIndexToVolumeSequence).
+  /// \param transformTracks If specified, the transforms are stored in compact vtkSlicerIGSIOTransformTrack objects
+  ///   that are added to the collection, instead of in transform sequences.
+  static bool MkvFrameIndexToSequenceBrowser(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkMRMLSequenceBrowserNode* sequenceBrowserNode,
+    vtkCollection* transformTracks = NULL);
+
+  /// Add the frames of a video track from a Matroska frame index to the end of the sequence (see MkvFrameIndexToVolumeSequence).
+  /// Used to populate the sequence while the file is still being indexed.
+  /// \param startFrame Index of the first added frame in the track
+  /// \param endFrame Index of the last added frame in the track. The last indexed frame is used if negative.
+  /// \param previousFrame The frame preceding startFrame in the track (NULL if startFrame is 0). Returns the last frame that was added.
+  static bool AppendMkvFramesToVolumeSequence(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkMRMLSequenceNode* sequenceNode, int trackNumber,
+    int startFrame, int endFrame, vtkSmartPointer<vtkStreamingVolumeFrame>& previousFrame);
+
+  /// Add the transforms of the metadata track "<transformName>Transform" at the timestamps of the frames between startFrame and endFrame
+  /// of the video track to the transform sequence and/or the transform track (either can be NULL).
+  static bool AppendMkvTransforms(vtkSlicerIGSIOMkvFrameIndex* frameIndex, int videoTrackNumber, const std::string& transformName,
+    int startFrame, int endFrame, vtkMRMLSequenceNode* transformSequenceNode, vtkSlicerIGSIOTransformTrack* transformTrack);
+
+  /// Attribute of the transform sequences created by MkvFrameIndexToSequenceBrowser that stores the name of the transform
+  static const char* GetMkvTransformNameAttributeName() { return "VideoIO.TransformName"; }
+
+  /// Populate the sequence browser with the video and transform tracks of the tracked frame list.
+  /// \param transferOwnership If enabled, the uncompressed images are moved into the video sequence without copying them
+  ///   (see TrackedFrameListToVolumeSequence) and the list is cleared when the function returns.
+  /// \param transformTracks If specified, the transforms are stored in compact vtkSlicerIGSIOTransformTrack objects
+  ///   that are added to the collection, instead of in transform sequences.
+  static bool TrackedFrameListToSequenceBrowser(vtkIGSIOTrackedFrameList* trackedFrameList, vtkMRMLSequenceBrowserNode* sequenceBrowserNode,
+    bool transferOwnership = false, vtkCollection* transformTracks = NULL);
 
   static bool VolumeSequenceToTrackedFrameList(vtkMRMLSequenceNode* sequenceNode, vtkIGSIOTrackedFrameList* trackedFrameList);
+
+  /// Convert the frames between startIndex and endIndex (inclusive) to tracked frames.
+  /// Used for appending frames to a file that already contains the frames preceding startIndex.
+  /// \param endIndex Index of the last frame to convert. The last frame in the sequence is used if negative.
+  static bool VolumeSequenceToTrackedFrameList(vtkMRMLSequenceNode* sequenceNode, vtkIGSIOTrackedFrameList* trackedFrameList,
+    int startIndex, int endIndex);
+
+  /// Contents of a sequence item that are converted to tracked frames
+  struct TrackedFrameSourceItem
+  {
+    vtkSmartPointer<vtkStreamingVolumeFrame> Frame;
+    double Timestamp;
+    vtkSmartPointer<vtkMatrix4x4> IJKToRASMatrix;
+    TrackedFrameSourceItem()
+      : Timestamp(0.0)
+    {
+    }
+  };
+
+  /// Convert the encoded frames of sequence items to tracked frames (see VolumeSequenceToTrackedFrameList).
+  /// The sequence is not accessed, so this function can run on a background thread.
+  /// \param previousFrame Frame of the item preceding the items, which has already been converted.
+  ///   The frames of the previous frame chain between previousFrame and the frame of each item are added as skipped frames.
+  /// \param previousTimestamp Timestamp of the item preceding the items
+  static bool SequenceItemsToTrackedFrameList(const std::vector<TrackedFrameSourceItem>& items, const std::string& trackName,
+    vtkStreamingVolumeFrame* previousFrame, double previousTimestamp, vtkIGSIOTrackedFrameList* trackedFrameList);
   
   static bool SequenceBrowserToTrackedFrameList(vtkMRMLSequenceBrowserNode* sequenceBrowserNode, vtkIGSIOTrackedFrameList* trackedFrameList);
 
+  /// Returns true if the codec encodes single-component (grayscale) images natively (ex. Y800).
+  /// The other codecs encode color video, so single-component images are encoded as luma-only frames (see EncodeImageData).
+  static bool IsGrayscaleCodec(const std::string& codecFourCC);
+
+  /// Returns true if the codec encodes single-component images natively: grayscale codecs, and codecs that preserve
+  /// the number of components of the encoded images (ex. vtkSlicerIGSIOLosslessVolumeCodec).
+  static bool SupportsSingleComponentImages(const std::string& codecFourCC);
+
+  /// Returns true if the frame was encoded from a single-component image by a color codec, and must be decoded using DecodeFrame
+  /// to get back a single-component image. Luma-only frames have a single component, but a codec that does not support single-component images.
+  static bool IsLumaOnlyFrame(vtkStreamingVolumeFrame* frame);
+
+  /// Encode the image using the codec.
+  /// Single-component 8-bit images that the codec cannot encode natively are encoded as luma-only video: the intensity is copied to all
+  /// of the color channels, so that the chroma of the encoded frame is flat, and the frame is flagged as having a single component.
+  /// The flag is stored in the files that are written from the frames, so that they are read back as single-component video.
+  static bool EncodeImageData(vtkStreamingVolumeCodec* codec, vtkImageData* image, vtkStreamingVolumeFrame* frame, bool forceKeyFrame);
+
+  /// Decode the frame using the codec. Luma-only frames (see IsLumaOnlyFrame) are decoded to a single-component image.
+  /// Lazily loaded payloads are not released while the frame is decoded (see vtkSlicerIGSIOMkvStreamingVolumeFrame::ScopedFrameDataAccess).
+  static bool DecodeFrame(vtkStreamingVolumeCodec* codec, vtkStreamingVolumeFrame* frame, vtkImageData* image, bool saveDecodedImage = true);
+
   struct FrameBlock
   {
     int StartFrame;
@@ -73,17 +172,154 @@ public:
     }
   };
 
+  /// Statistics of the decode -> encode pipeline that is used to transcode the frame blocks.
+  /// Times are in seconds, and are summed over all of the frame blocks.
+  /// Stall times and queue depths are only measured when decoding runs on a separate thread (single worker thread).
+  struct TranscodingStatistics
+  {
+    int NumberOfDecodedFrames;
+    int NumberOfEncodedFrames;
+    /// Time spent decoding frames
+    double DecodeTime;
+    /// Time spent encoding frames
+    double EncodeTime;
+    /// Time that the decoding stage spent waiting for a free frame buffer (encoding is the bottleneck)
+    double DecodeStallTime;
+    /// Time that the encoding stage spent waiting for a decoded frame (decoding is the bottleneck)
+    double EncodeStallTime;
+    /// Number of decoded frames waiting to be encoded, sampled each time the encoding stage receives a frame
+    int DecodedQueueMaximumDepth;
+    double DecodedQueueAverageDepth;
+    /// Number of free frame buffers available to the decoding stage, sampled each time the decoding stage receives a buffer
+    int FreeBufferQueueMaximumDepth;
+    double FreeBufferQueueAverageDepth;
+    TranscodingStatistics()
+      : NumberOfDecodedFrames(0)
+      , NumberOfEncodedFrames(0)
+      , DecodeTime(0.0)
+      , EncodeTime(0.0)
+      , DecodeStallTime(0.0)
+      , EncodeStallTime(0.0)
+      , DecodedQueueMaximumDepth(0)
+      , DecodedQueueAverageDepth(0.0)
+      , FreeBufferQueueMaximumDepth(0)
+      , FreeBufferQueueAverageDepth(0.0)
+    {
+    }
+  };
+
   // Python wrapped function for ReEncodeVideoSequence
   static bool ReEncodeVideoSequence(vtkMRMLSequenceNode* videoStreamSequenceNode,
-    int startIndex = 0, int endIndex = -1, std::string codecFourCC = "") {
-    return vtkSlicerIGSIOCommon::ReEncodeVideoSequence(videoStreamSequenceNode, startIndex, endIndex, codecFourCC, std::map<std::string, std::string>());
+    int startIndex = 0, int endIndex = -1, std::string codecFourCC = "", int numberOfThreads = 1) {
+    return vtkSlicerIGSIOCommon::ReEncodeVideoSequence(videoStreamSequenceNode, startIndex, endIndex, codecFourCC, std::map<std::string, std::string>(),
+      false, false, numberOfThreads);
   }
 
+  /// Re-encode the frames between startIndex and endIndex using the specified codec.
+  /// The sequence is split into independent frame blocks at keyframe boundaries, and each block that requires
+  /// re-encoding is encoded starting from a keyframe, using the codec instance of the worker thread.
+  /// \param numberOfThreads Number of worker threads used to encode the frame blocks.
+  ///   1 encodes all blocks on the calling thread. 0 or less uses one thread per available core.
+  ///   The encoded frames are only written back to the sequence (on the calling thread) after all blocks have been encoded successfully.
+  ///   With a single worker, decoding and encoding run concurrently on separate threads, connected by lock-free ring buffers of reusable frame buffers.
+  ///   With multiple workers, each worker decodes its own frames, so that the number of threads does not exceed numberOfThreads.
+  /// \param statistics If specified, the statistics of the transcoding pipeline are returned, which can be used to find
+  ///   whether decoding or encoding is the bottleneck.
   static bool ReEncodeVideoSequence(vtkMRMLSequenceNode* videoStreamSequenceNode,
     int startIndex, int endIndex,
     std::string codecFourCC,
     std::map<std::string, std::string> codecParameters,
-    bool forceReEncoding = false, bool minimalReEncoding = false);
+    bool forceReEncoding = false, bool minimalReEncoding = false, int numberOfThreads = 1,
+    TranscodingStatistics* statistics = NULL);
+
+  /// Contents of a sequence item that are read while transcoding.
+  /// A snapshot of the source frames allows the frames to be encoded on a background thread, without accessing the sequence.
+  struct TranscodingSourceFrame
+  {
+    /// True if the data node of the item is a vtkMRMLStreamingVolumeNode
+    bool IsStreamingVolume;
+    bool IsKeyFrame;
+    std::string CodecFourCC;
+    /// Encoded frame of the streaming volume
+    vtkSmartPointer<vtkStreamingVolumeFrame> Frame;
+    /// Image of the volume, if it does not have an encoded frame.
+    /// For snapshots the image is copied, so that the volume can be edited while the copy is being encoded.
+    vtkSmartPointer<vtkImageData> Image;
+    /// Image of the volume that was copied, and its modification time at the time of the snapshot.
+    /// Used to find whether the image was modified while it was being encoded.
+    vtkWeakPointer<vtkImageData> SourceImage;
+    vtkMTimeType SourceImageMTime;
+    TranscodingSourceFrame()
+      : IsStreamingVolume(false)
+      , IsKeyFrame(false)
+      , SourceImageMTime(0)
+    {
+    }
+  };
+
+  /// Take a snapshot of the frames between startIndex and endIndex (inclusive) of the sequence, for ReEncodeSourceFrames.
+  /// Must be called on the main thread.
+  /// \param copyImages If true, the images of uncompressed volumes are copied, which is required if the frames are encoded
+  ///   while the sequence can be modified (on a background thread). Otherwise the images are referenced directly.
+  static bool GetTranscodingSourceFrames(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex,
+    std::vector<TranscodingSourceFrame>& sourceFrames, bool copyImages = true);
+
+  /// Re-encode a snapshot of the frames of a sequence (see ReEncodeVideoSequence). The sequence is not accessed, so this function
+  /// can run on a background thread.
+  /// \param logObject Object that is used for reporting errors
+  /// \param encodedFrames Returns the new frame of each source frame, or NULL if the frame does not need to be re-encoded
+  /// \param numberOfProcessedFrames If specified, incremented each time a frame is encoded
+  /// \param cancelRequested If specified and set to true, encoding is stopped and the function returns false
+  static bool ReEncodeSourceFrames(vtkObject* logObject, const std::vector<TranscodingSourceFrame>& sourceFrames,
+    std::string codecFourCC, std::map<std::string, std::string> codecParameters,
+    bool forceReEncoding, bool minimalReEncoding, int numberOfThreads,
+    std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> >& encodedFrames, TranscodingStatistics* statistics = NULL,
+    std::atomic<int>* numberOfProcessedFrames = NULL, const std::atomic<bool>* cancelRequested = NULL);
+
+  /// Replace the frames of the items starting at startIndex with the encoded frames, in a single modification of the sequence.
+  /// Items with a NULL encoded frame are not changed.
+  /// \param sourceFrames If specified, the frames are only replaced if none of the items (or their images) have changed since the snapshot was taken
+  static bool SetEncodedFrames(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex,
+    const std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> >& encodedFrames,
+    const std::vector<TranscodingSourceFrame>* sourceFrames = NULL);
+
+  // Python wrapped function for ExportVideoSequence
+  static bool ExportVideoSequence(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex, std::string fileName) {
+    return vtkSlicerIGSIOCommon::ExportVideoSequence(videoStreamSequenceNode, startIndex, endIndex, fileName, std::map<std::string, std::string>());
+  }
+
+  /// Write the frames between startIndex and endIndex (inclusive) of the video sequence to a new file (ex. .mkv).
+  /// The sequence is not modified. See VideoSequenceRangeToTrackedFrameList for how the frames are converted.
+  /// \param endIndex Index of the last exported frame. The last frame in the sequence is used if negative.
+  static bool ExportVideoSequence(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex,
+    std::string fileName, std::map<std::string, std::string> codecParameters);
+
+  /// Convert the frames between startIndex and endIndex (inclusive) of the video sequence to a self-contained tracked frame list.
+  /// The encoded frames starting from the first keyframe in the range are copied without decoding. If the range does not start on a keyframe,
+  /// only the frames preceding the first keyframe are re-encoded (using the codec of the sequence, and starting with a new keyframe).
+  /// The timestamps of the frames are the same as when the whole sequence is written.
+  /// \param numberOfReEncodedFrames If specified, returns the number of frames that had to be re-encoded
+  /// \return False if the range cannot be converted, for example if frames after the first keyframe are not encoded with the same codec
+  static bool VideoSequenceRangeToTrackedFrameList(vtkMRMLSequenceNode* videoStreamSequenceNode, int startIndex, int endIndex,
+    vtkIGSIOTrackedFrameList* trackedFrameList, std::map<std::string, std::string> codecParameters, int* numberOfReEncodedFrames = NULL);
+
+  // Python wrapped function for ConcatenateVideoSequences
+  static bool ConcatenateVideoSequences(vtkCollection* inputSequenceNodes, vtkMRMLSequenceNode* outputSequenceNode) {
+    return vtkSlicerIGSIOCommon::ConcatenateVideoSequences(inputSequenceNodes, outputSequenceNode, std::map<std::string, std::string>());
+  }
+
+  /// Join the video sequences in the collection into the output sequence, one after the other.
+  /// The encoded frames of the inputs are shared with the output sequence without decoding, and their time values are offset so that
+  /// each input starts one frame interval after the last frame of the preceding input. The codec and frame format of the output are those of
+  /// the first encoded frame. Only the frames that cannot be copied are re-encoded, using codecParameters:
+  /// the frames preceding the first keyframe of an input (the seam between two inputs), or all frames of an input
+  /// that uses a different codec or contains frames that are not encoded.
+  /// Frames are not resampled: if the frame size or number of components of any frame differs from the output, an error is reported
+  /// and the output sequence is not modified.
+  /// The input sequences are not modified. Existing items of the output sequence are removed.
+  /// \param numberOfReEncodedFrames If specified, returns the number of frames that had to be re-encoded
+  static bool ConcatenateVideoSequences(vtkCollection* inputSequenceNodes, vtkMRMLSequenceNode* outputSequenceNode,
+    std::map<std::string, std::string> codecParameters, int* numberOfReEncodedFrames = NULL);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,375 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOImagePool.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// STD includes
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+static const unsigned long long IMAGE_POOL_DEFAULT_MAXIMUM_SIZE = 256 * 1024 * 1024;
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOImagePool::vtkInternal
+{
+public:
+  vtkInternal()
+    : MaximumSize(IMAGE_POOL_DEFAULT_MAXIMUM_SIZE)
+    , ResidentSize(0)
+    , NumberOfBuffers(0)
+    , NumberOfHits(0)
+    , NumberOfMisses(0)
+  {
+  }
+
+  /// Buffers are bucketed by scalar type and number of values
+  typedef std::pair<int, vtkIdType> BufferKey;
+
+  /// Returns a buffer from the pool if one of the same size is available, otherwise a new buffer
+  vtkSmartPointer<vtkDataArray> NewBuffer(int scalarType, int numberOfComponents, vtkIdType numberOfTuples)
+  {
+    vtkSmartPointer<vtkDataArray> buffer;
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      std::map<BufferKey, std::vector<vtkSmartPointer<vtkDataArray> > >::iterator bucketIt =
+        this->Buffers.find(BufferKey(scalarType, numberOfTuples * numberOfComponents));
+      if (bucketIt != this->Buffers.end() && !bucketIt->second.empty())
+      {
+        buffer = bucketIt->second.back();
+        bucketIt->second.pop_back();
+        this->ResidentSize -= GetBufferSize(buffer);
+        --this->NumberOfBuffers;
+        ++this->NumberOfHits;
+      }
+      else
+      {
+        ++this->NumberOfMisses;
+      }
+    }
+
+    if (!buffer)
+    {
+      buffer = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(scalarType));
+      if (!buffer)
+      {
+        return NULL;
+      }
+    }
+    // The number of values is unchanged for pooled buffers, so the memory is not reallocated
+    buffer->SetNumberOfComponents(numberOfComponents);
+    buffer->SetNumberOfTuples(numberOfTuples);
+    return buffer;
+  }
+
+  /// Free released buffers until the pool fits in the maximum size, starting with the oldest buffer of each bucket. Must be called with Mutex locked.
+  void Shrink()
+  {
+    std::map<BufferKey, std::vector<vtkSmartPointer<vtkDataArray> > >::iterator bucketIt = this->Buffers.begin();
+    while (this->ResidentSize > this->MaximumSize && bucketIt != this->Buffers.end())
+    {
+      std::vector<vtkSmartPointer<vtkDataArray> >& bucket = bucketIt->second;
+      while (this->ResidentSize > this->MaximumSize && !bucket.empty())
+      {
+        this->ResidentSize -= GetBufferSize(bucket.front());
+        --this->NumberOfBuffers;
+        bucket.erase(bucket.begin());
+      }
+      ++bucketIt;
+    }
+  }
+
+  static unsigned long long GetBufferSize(vtkDataArray* buffer)
+  {
+    return (unsigned long long)buffer->GetNumberOfValues() * buffer->GetDataTypeSize();
+  }
+
+  std::mutex Mutex;
+  std::map<BufferKey, std::vector<vtkSmartPointer<vtkDataArray> > > Buffers;
+  unsigned long long MaximumSize;
+  unsigned long long ResidentSize;
+  int NumberOfBuffers;
+  int NumberOfHits;
+  int NumberOfMisses;
+};
+
+//----------------------------------------------------------------------------
+static vtkSlicerIGSIOImagePool* ImagePoolInstance = NULL;
+static std::mutex ImagePoolInstanceMutex;
+
+//----------------------------------------------------------------------------
+// Deletes the shared instance when the application exits
+class vtkSlicerIGSIOImagePoolCleanup
+{
+public:
+  ~vtkSlicerIGSIOImagePoolCleanup()
+  {
+    if (ImagePoolInstance)
+    {
+      ImagePoolInstance->Delete();
+      ImagePoolInstance = NULL;
+    }
+  }
+};
+static vtkSlicerIGSIOImagePoolCleanup ImagePoolCleanup;
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOImagePool* vtkSlicerIGSIOImagePool::New()
+{
+  vtkSlicerIGSIOImagePool* instance = vtkSlicerIGSIOImagePool::GetInstance();
+  instance->Register(NULL);
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOImagePool* vtkSlicerIGSIOImagePool::GetInstance()
+{
+  std::lock_guard<std::mutex> lock(ImagePoolInstanceMutex);
+  if (!ImagePoolInstance)
+  {
+    ImagePoolInstance = new vtkSlicerIGSIOImagePool();
+#ifdef VTK_HAS_INITIALIZE_OBJECT_BASE
+    ImagePoolInstance->InitializeObjectBase();
+#endif
+  }
+  return ImagePoolInstance;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOImagePool::vtkSlicerIGSIOImagePool()
+  : Internal(new vtkInternal())
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOImagePool::~vtkSlicerIGSIOImagePool()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumSize: " << this->GetMaximumSize() << std::endl;
+  os << indent << "ResidentSize: " << this->GetResidentSize() << std::endl;
+  os << indent << "NumberOfBuffers: " << this->GetNumberOfBuffers() << std::endl;
+  os << indent << "NumberOfHits: " << this->GetNumberOfHits() << std::endl;
+  os << indent << "NumberOfMisses: " << this->GetNumberOfMisses() << std::endl;
+  os << indent << "HitRate: " << this->GetHitRate() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::SetMaximumSize(unsigned long long numberOfBytes)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+    if (this->Internal->MaximumSize == numberOfBytes)
+    {
+      return;
+    }
+    this->Internal->MaximumSize = numberOfBytes;
+    this->Internal->Shrink();
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkSlicerIGSIOImagePool::GetMaximumSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->MaximumSize;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::AllocateImage(vtkImageData* image, const int dimensions[3], int scalarType, int numberOfComponents)
+{
+  if (!image || numberOfComponents < 1)
+  {
+    vtkErrorMacro("AllocateImage: Invalid arguments");
+    return;
+  }
+
+  image->SetDimensions(dimensions);
+  vtkIdType numberOfTuples = (vtkIdType)dimensions[0] * dimensions[1] * dimensions[2];
+  vtkSmartPointer<vtkDataArray> scalars = this->Internal->NewBuffer(scalarType, numberOfComponents, numberOfTuples);
+  if (!scalars)
+  {
+    image->AllocateScalars(scalarType, numberOfComponents);
+    return;
+  }
+  image->GetPointData()->SetScalars(scalars);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::AllocateDecodedImage(vtkStreamingVolumeFrame* frame, vtkImageData* image)
+{
+  if (!frame || !image)
+  {
+    vtkErrorMacro("AllocateDecodedImage: Invalid arguments");
+    return;
+  }
+
+  int dimensions[3] = { 0, 0, 0 };
+  frame->GetDimensions(dimensions);
+  int numberOfComponents = frame->GetNumberOfComponents();
+  if (dimensions[0] * dimensions[1] * dimensions[2] == 0 || numberOfComponents < 1)
+  {
+    // The size of the decoded image is not known until the frame is decoded
+    return;
+  }
+  int scalarType = frame->GetVTKScalarType();
+  if (scalarType == VTK_VOID)
+  {
+    scalarType = VTK_UNSIGNED_CHAR;
+  }
+  this->AllocateImage(image, dimensions, scalarType, numberOfComponents);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::CopyImage(vtkImageData* source, vtkImageData* target)
+{
+  if (!source || !target)
+  {
+    vtkErrorMacro("CopyImage: Invalid arguments");
+    return;
+  }
+
+  vtkDataArray* sourceScalars = source->GetPointData()->GetScalars();
+  if (!sourceScalars || source->GetPointData()->GetNumberOfArrays() != 1)
+  {
+    target->DeepCopy(source);
+    return;
+  }
+
+  target->CopyStructure(source);
+  vtkSmartPointer<vtkDataArray> targetScalars = this->Internal->NewBuffer(sourceScalars->GetDataType(),
+    sourceScalars->GetNumberOfComponents(), sourceScalars->GetNumberOfTuples());
+  if (!targetScalars)
+  {
+    target->DeepCopy(source);
+    return;
+  }
+  memcpy(targetScalars->GetVoidPointer(0), sourceScalars->GetVoidPointer(0),
+    (size_t)sourceScalars->GetNumberOfValues() * sourceScalars->GetDataTypeSize());
+  targetScalars->SetName(sourceScalars->GetName());
+  target->GetPointData()->SetScalars(targetScalars);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::ReleaseImage(vtkImageData* image)
+{
+  if (!image)
+  {
+    return;
+  }
+
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if (!scalars || image->GetReferenceCount() > 1 || scalars->GetReferenceCount() > 1)
+  {
+    // The image or its scalars are still used elsewhere
+    return;
+  }
+
+  vtkSmartPointer<vtkDataArray> buffer = scalars;
+  image->GetPointData()->SetScalars(NULL);
+  unsigned long long bufferSize = vtkInternal::GetBufferSize(buffer);
+
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  if (this->Internal->ResidentSize + bufferSize > this->Internal->MaximumSize)
+  {
+    return;
+  }
+  this->Internal->Buffers[vtkInternal::BufferKey(buffer->GetDataType(), buffer->GetNumberOfValues())].push_back(buffer);
+  this->Internal->ResidentSize += bufferSize;
+  ++this->Internal->NumberOfBuffers;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOImagePool::GetNumberOfHits()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->NumberOfHits;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOImagePool::GetNumberOfMisses()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->NumberOfMisses;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOImagePool::GetHitRate()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  int numberOfAllocations = this->Internal->NumberOfHits + this->Internal->NumberOfMisses;
+  if (numberOfAllocations == 0)
+  {
+    return 0.0;
+  }
+  return (double)this->Internal->NumberOfHits / numberOfAllocations;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::ResetStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->Internal->NumberOfHits = 0;
+  this->Internal->NumberOfMisses = 0;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkSlicerIGSIOImagePool::GetResidentSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->ResidentSize;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOImagePool::GetNumberOfBuffers()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return this->Internal->NumberOfBuffers;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOImagePool::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->Internal->Buffers.clear();
+  this->Internal->ResidentSize = 0;
+  this->Internal->NumberOfBuffers = 0;
+}
@@ -0,0 +1,95 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+#ifndef __vtkSlicerIGSIOImagePool_h
+#define __vtkSlicerIGSIOImagePool_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkImageData;
+class vtkStreamingVolumeFrame;
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Pool of image scalar buffers that are reused between recorded, decoded and re-encoded images.
+/// Released buffers are kept in buckets of the same scalar type and number of values, so that images of the same size
+/// (ex. consecutive video frames) are allocated without going through the allocator.
+/// Access the shared instance using GetInstance(). Images can be allocated and released from any thread.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOImagePool : public vtkObject
+{
+public:
+  /// Returns the shared instance (with an additional reference)
+  static vtkSlicerIGSIOImagePool* New();
+  static vtkSlicerIGSIOImagePool* GetInstance();
+  vtkTypeMacro(vtkSlicerIGSIOImagePool, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Maximum memory of the released buffers that are kept for reuse (in bytes, default: 256MB).
+  /// If 0, released buffers are freed immediately.
+  void SetMaximumSize(unsigned long long numberOfBytes);
+  unsigned long long GetMaximumSize();
+
+  /// Set the dimensions of the image and allocate its scalars, reusing a released buffer of the same size if available
+  void AllocateImage(vtkImageData* image, const int dimensions[3], int scalarType, int numberOfComponents);
+
+  /// Allocate the image that the frame is decoded into.
+  /// The codecs reuse the allocated scalars if the size and the scalar type of the decoded image match.
+  void AllocateDecodedImage(vtkStreamingVolumeFrame* frame, vtkImageData* image);
+
+  /// Copy the geometry and scalars of the source image into the target image, using a pooled buffer for the scalars.
+  /// Images that have point data arrays other than the scalars are deep copied.
+  void CopyImage(vtkImageData* source, vtkImageData* target);
+
+  /// Return the scalar buffer of the image to the pool, and remove it from the image.
+  /// The buffer is only reused if it is not referenced anywhere else, so the caller must hold the only reference to the image.
+  /// Images that are still referenced are left unchanged.
+  void ReleaseImage(vtkImageData* image);
+
+  /// Number of allocations that reused a released buffer, and that required a new buffer
+  int GetNumberOfHits();
+  int GetNumberOfMisses();
+  /// Fraction of the allocations that reused a released buffer
+  double GetHitRate();
+  void ResetStatistics();
+
+  /// Memory used by the released buffers that are waiting to be reused (in bytes)
+  unsigned long long GetResidentSize();
+  int GetNumberOfBuffers();
+
+  /// Free all released buffers
+  void Clear();
+
+protected:
+  vtkSlicerIGSIOImagePool();
+  ~vtkSlicerIGSIOImagePool();
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOImagePool(const vtkSlicerIGSIOImagePool&); // Not implemented
+  void operator=(const vtkSlicerIGSIOImagePool&);          // Not implemented
+};
+
+#endif
@@ -0,0 +1,552 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOInstrumentation.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+static const int INSTRUMENTATION_NUMBER_OF_HISTOGRAM_BINS = 21;
+static const double INSTRUMENTATION_FIRST_HISTOGRAM_BIN_UPPER_LIMIT = 1e-5;
+
+static const int INSTRUMENTATION_DEFAULT_MAXIMUM_NUMBER_OF_TRACE_EVENTS = 1000000;
+
+// Statistics and tracing are enabled independently, but a single flag word is checked on the hot path
+enum
+{
+  INSTRUMENTATION_STATISTICS = 0x1,
+  INSTRUMENTATION_TRACING = 0x2
+};
+static std::atomic<int> InstrumentationFlags(0);
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOInstrumentation::vtkInternal
+{
+public:
+  struct StageStatistics
+  {
+    int NumberOfCalls;
+    long long NumberOfItems;
+    double TotalTime;
+    double MinimumTime;
+    double MaximumTime;
+    std::vector<int> Histogram;
+    StageStatistics()
+      : NumberOfCalls(0)
+      , NumberOfItems(0)
+      , TotalTime(0.0)
+      , MinimumTime(0.0)
+      , MaximumTime(0.0)
+      , Histogram(INSTRUMENTATION_NUMBER_OF_HISTOGRAM_BINS, 0)
+    {
+    }
+  };
+
+  /// Returns a copy of the statistics of the stage, or empty statistics if the stage has not been recorded
+  StageStatistics GetStageStatistics(const std::string& stageName)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::map<std::string, StageStatistics>::iterator stageIt = this->Stages.find(stageName);
+    if (stageIt == this->Stages.end())
+    {
+      return StageStatistics();
+    }
+    return stageIt->second;
+  }
+
+  static int GetHistogramBin(double seconds)
+  {
+    double upperLimit = INSTRUMENTATION_FIRST_HISTOGRAM_BIN_UPPER_LIMIT;
+    for (int bin = 0; bin < INSTRUMENTATION_NUMBER_OF_HISTOGRAM_BINS - 1; ++bin)
+    {
+      if (seconds < upperLimit)
+      {
+        return bin;
+      }
+      upperLimit *= 2.0;
+    }
+    return INSTRUMENTATION_NUMBER_OF_HISTOGRAM_BINS - 1;
+  }
+
+  struct TraceEvent
+  {
+    std::string Name;
+    int ThreadIndex;
+    /// Start time relative to the trace start time (in microseconds)
+    double StartTime;
+    double Duration;
+  };
+
+  /// Small sequential index of the thread, which is used as the thread id in the trace file
+  int GetThreadIndex(std::thread::id threadId)
+  {
+    std::map<std::thread::id, int>::iterator threadIt = this->ThreadIndices.find(threadId);
+    if (threadIt != this->ThreadIndices.end())
+    {
+      return threadIt->second;
+    }
+    int threadIndex = (int)this->ThreadIndices.size();
+    this->ThreadIndices[threadId] = threadIndex;
+    return threadIndex;
+  }
+
+  /// Escape the string to be used as a JSON string value
+  static std::string EscapeJSONString(const std::string& value)
+  {
+    std::string escapedValue;
+    for (std::string::const_iterator characterIt = value.begin(); characterIt != value.end(); ++characterIt)
+    {
+      if (*characterIt == '"' || *characterIt == '\\')
+      {
+        escapedValue += '\\';
+      }
+      escapedValue += *characterIt;
+    }
+    return escapedValue;
+  }
+
+  std::mutex Mutex;
+  std::map<std::string, StageStatistics> Stages;
+
+  std::mutex TraceMutex;
+  std::vector<TraceEvent> TraceEvents;
+  std::map<std::thread::id, int> ThreadIndices;
+  std::chrono::steady_clock::time_point TraceStartTime;
+  int MaximumNumberOfTraceEvents;
+  int NumberOfDroppedTraceEvents;
+};
+
+//----------------------------------------------------------------------------
+static vtkSlicerIGSIOInstrumentation* InstrumentationInstance = NULL;
+static std::mutex InstrumentationInstanceMutex;
+
+//----------------------------------------------------------------------------
+// Deletes the shared instance when the application exits
+class vtkSlicerIGSIOInstrumentationCleanup
+{
+public:
+  ~vtkSlicerIGSIOInstrumentationCleanup()
+  {
+    if (InstrumentationInstance)
+    {
+      InstrumentationInstance->Delete();
+      InstrumentationInstance = NULL;
+    }
+  }
+};
+static vtkSlicerIGSIOInstrumentationCleanup InstrumentationCleanup;
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOInstrumentation* vtkSlicerIGSIOInstrumentation::New()
+{
+  vtkSlicerIGSIOInstrumentation* instance = vtkSlicerIGSIOInstrumentation::GetInstance();
+  instance->Register(NULL);
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOInstrumentation* vtkSlicerIGSIOInstrumentation::GetInstance()
+{
+  std::lock_guard<std::mutex> lock(InstrumentationInstanceMutex);
+  if (!InstrumentationInstance)
+  {
+    InstrumentationInstance = new vtkSlicerIGSIOInstrumentation();
+#ifdef VTK_HAS_INITIALIZE_OBJECT_BASE
+    InstrumentationInstance->InitializeObjectBase();
+#endif
+  }
+  return InstrumentationInstance;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOInstrumentation::vtkSlicerIGSIOInstrumentation()
+  : Internal(new vtkInternal())
+{
+  this->Internal->TraceStartTime = std::chrono::steady_clock::now();
+  this->Internal->MaximumNumberOfTraceEvents = INSTRUMENTATION_DEFAULT_MAXIMUM_NUMBER_OF_TRACE_EVENTS;
+  this->Internal->NumberOfDroppedTraceEvents = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOInstrumentation::~vtkSlicerIGSIOInstrumentation()
+{
+  delete this->Internal;
+  this->Internal = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Enabled: " << (this->GetEnabled() ? "true" : "false") << std::endl;
+  os << indent << "NumberOfStages: " << this->GetNumberOfStages() << std::endl;
+  os << indent << "TracingEnabled: " << (this->GetTracingEnabled() ? "true" : "false") << std::endl;
+  os << indent << "NumberOfTraceEvents: " << this->GetNumberOfTraceEvents() << std::endl;
+  os << indent << "NumberOfDroppedTraceEvents: " << this->GetNumberOfDroppedTraceEvents() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::SetEnabled(bool enabled)
+{
+  if (this->GetEnabled() == enabled)
+  {
+    return;
+  }
+  if (enabled)
+  {
+    InstrumentationFlags |= INSTRUMENTATION_STATISTICS;
+  }
+  else
+  {
+    InstrumentationFlags &= ~INSTRUMENTATION_STATISTICS;
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOInstrumentation::GetEnabled()
+{
+  return (InstrumentationFlags & INSTRUMENTATION_STATISTICS) != 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOInstrumentation::IsEnabled()
+{
+  return (InstrumentationFlags.load(std::memory_order_relaxed) & INSTRUMENTATION_STATISTICS) != 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::SetTracingEnabled(bool enabled)
+{
+  if (this->GetTracingEnabled() == enabled)
+  {
+    return;
+  }
+  if (enabled)
+  {
+    InstrumentationFlags |= INSTRUMENTATION_TRACING;
+  }
+  else
+  {
+    InstrumentationFlags &= ~INSTRUMENTATION_TRACING;
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOInstrumentation::GetTracingEnabled()
+{
+  return (InstrumentationFlags & INSTRUMENTATION_TRACING) != 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOInstrumentation::IsActive()
+{
+  return InstrumentationFlags.load(std::memory_order_relaxed) != 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::RecordTraceEvent(const std::string& stageName, std::chrono::steady_clock::time_point startTime, double seconds)
+{
+  if ((InstrumentationFlags.load(std::memory_order_relaxed) & INSTRUMENTATION_TRACING) == 0)
+  {
+    return;
+  }
+
+  std::thread::id threadId = std::this_thread::get_id();
+  std::lock_guard<std::mutex> lock(this->Internal->TraceMutex);
+  if ((int)this->Internal->TraceEvents.size() >= this->Internal->MaximumNumberOfTraceEvents)
+  {
+    ++this->Internal->NumberOfDroppedTraceEvents;
+    return;
+  }
+
+  vtkInternal::TraceEvent traceEvent;
+  traceEvent.Name = stageName;
+  traceEvent.ThreadIndex = this->Internal->GetThreadIndex(threadId);
+  traceEvent.StartTime = std::chrono::duration<double, std::micro>(startTime - this->Internal->TraceStartTime).count();
+  traceEvent.Duration = seconds * 1e6;
+  this->Internal->TraceEvents.push_back(traceEvent);
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOInstrumentation::GetNumberOfTraceEvents()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->TraceMutex);
+  return (int)this->Internal->TraceEvents.size();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOInstrumentation::GetNumberOfDroppedTraceEvents()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->TraceMutex);
+  return this->Internal->NumberOfDroppedTraceEvents;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::SetMaximumNumberOfTraceEvents(int maximumNumberOfTraceEvents)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->TraceMutex);
+    if (this->Internal->MaximumNumberOfTraceEvents == maximumNumberOfTraceEvents)
+    {
+      return;
+    }
+    this->Internal->MaximumNumberOfTraceEvents = std::max(0, maximumNumberOfTraceEvents);
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOInstrumentation::GetMaximumNumberOfTraceEvents()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->TraceMutex);
+  return this->Internal->MaximumNumberOfTraceEvents;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::ClearTrace()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->TraceMutex);
+  this->Internal->TraceEvents.clear();
+  this->Internal->ThreadIndices.clear();
+  this->Internal->NumberOfDroppedTraceEvents = 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOInstrumentation::WriteTrace(const std::string& fileName)
+{
+  std::vector<vtkInternal::TraceEvent> traceEvents;
+  int numberOfThreads = 0;
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->TraceMutex);
+    traceEvents = this->Internal->TraceEvents;
+    numberOfThreads = (int)this->Internal->ThreadIndices.size();
+  }
+
+  std::ofstream traceFile(fileName.c_str());
+  if (!traceFile)
+  {
+    vtkErrorMacro("WriteTrace: Could not open file: " << fileName);
+    return false;
+  }
+
+  // Thread names are metadata events ("ph": "M"). Spans are complete events ("ph": "X"), with the start time and duration in microseconds.
+  traceFile << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+  for (int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    traceFile << (threadIndex > 0 ? "," : "")
+      << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << threadIndex
+      << ", \"args\": {\"name\": \"Thread " << threadIndex << "\"}}" << std::endl;
+  }
+  traceFile << std::fixed;
+  traceFile.precision(3);
+  for (std::vector<vtkInternal::TraceEvent>::iterator traceEventIt = traceEvents.begin(); traceEventIt != traceEvents.end(); ++traceEventIt)
+  {
+    traceFile << ","
+      << "{\"name\": \"" << vtkInternal::EscapeJSONString(traceEventIt->Name) << "\", \"cat\": \"VideoIO\", \"ph\": \"X\", \"pid\": 1"
+      << ", \"tid\": " << traceEventIt->ThreadIndex
+      << ", \"ts\": " << traceEventIt->StartTime
+      << ", \"dur\": " << traceEventIt->Duration << "}" << std::endl;
+  }
+  traceFile << "]}" << std::endl;
+  return traceFile.good();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::RecordStage(const std::string& stageName, double seconds, int numberOfItems/*=1*/)
+{
+  if (!vtkSlicerIGSIOInstrumentation::IsEnabled())
+  {
+    return;
+  }
+
+  int bin = vtkInternal::GetHistogramBin(seconds);
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  vtkInternal::StageStatistics& stage = this->Internal->Stages[stageName];
+  if (stage.NumberOfCalls == 0 || seconds < stage.MinimumTime)
+  {
+    stage.MinimumTime = seconds;
+  }
+  stage.MaximumTime = std::max(stage.MaximumTime, seconds);
+  ++stage.NumberOfCalls;
+  stage.NumberOfItems += numberOfItems;
+  stage.TotalTime += seconds;
+  ++stage.Histogram[bin];
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOInstrumentation::Reset()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  this->Internal->Stages.clear();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOInstrumentation::GetNumberOfStages()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  return (int)this->Internal->Stages.size();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOInstrumentation::GetNthStageName(int n)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  if (n < 0 || n >= (int)this->Internal->Stages.size())
+  {
+    vtkErrorMacro("GetNthStageName: Invalid stage index " << n);
+    return "";
+  }
+  std::map<std::string, vtkInternal::StageStatistics>::iterator stageIt = this->Internal->Stages.begin();
+  std::advance(stageIt, n);
+  return stageIt->first;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOInstrumentation::GetStageNumberOfCalls(const std::string& stageName)
+{
+  return this->Internal->GetStageStatistics(stageName).NumberOfCalls;
+}
+
+//----------------------------------------------------------------------------
+long long vtkSlicerIGSIOInstrumentation::GetStageNumberOfItems(const std::string& stageName)
+{
+  return this->Internal->GetStageStatistics(stageName).NumberOfItems;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOInstrumentation::GetStageTotalTime(const std::string& stageName)
+{
+  return this->Internal->GetStageStatistics(stageName).TotalTime;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOInstrumentation::GetStageMinimumTime(const std::string& stageName)
+{
+  return this->Internal->GetStageStatistics(stageName).MinimumTime;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOInstrumentation::GetStageMaximumTime(const std::string& stageName)
+{
+  return this->Internal->GetStageStatistics(stageName).MaximumTime;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOInstrumentation::GetStageAverageTime(const std::string& stageName)
+{
+  vtkInternal::StageStatistics stage = this->Internal->GetStageStatistics(stageName);
+  if (stage.NumberOfCalls == 0)
+  {
+    return 0.0;
+  }
+  return stage.TotalTime / stage.NumberOfCalls;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOInstrumentation::GetNumberOfHistogramBins()
+{
+  return INSTRUMENTATION_NUMBER_OF_HISTOGRAM_BINS;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOInstrumentation::GetHistogramBinUpperLimit(int bin)
+{
+  if (bin < 0 || bin >= INSTRUMENTATION_NUMBER_OF_HISTOGRAM_BINS - 1)
+  {
+    return -1.0;
+  }
+  return INSTRUMENTATION_FIRST_HISTOGRAM_BIN_UPPER_LIMIT * (1 << bin);
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOInstrumentation::GetStageHistogramBinCount(const std::string& stageName, int bin)
+{
+  if (bin < 0 || bin >= INSTRUMENTATION_NUMBER_OF_HISTOGRAM_BINS)
+  {
+    vtkErrorMacro("GetStageHistogramBinCount: Invalid bin " << bin);
+    return 0;
+  }
+  return this->Internal->GetStageStatistics(stageName).Histogram[bin];
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOInstrumentation::GetReport()
+{
+  std::map<std::string, vtkInternal::StageStatistics> stages;
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+    stages = this->Internal->Stages;
+  }
+
+  std::stringstream report;
+  report << "Stage\tCalls\tItems\tTotal (ms)\tAverage (ms)\tMinimum (ms)\tMaximum (ms)" << std::endl;
+  for (std::map<std::string, vtkInternal::StageStatistics>::iterator stageIt = stages.begin(); stageIt != stages.end(); ++stageIt)
+  {
+    const vtkInternal::StageStatistics& stage = stageIt->second;
+    report << stageIt->first
+      << "\t" << stage.NumberOfCalls
+      << "\t" << stage.NumberOfItems
+      << "\t" << stage.TotalTime * 1000.0
+      << "\t" << (stage.NumberOfCalls > 0 ? stage.TotalTime * 1000.0 / stage.NumberOfCalls : 0.0)
+      << "\t" << stage.MinimumTime * 1000.0
+      << "\t" << stage.MaximumTime * 1000.0
+      << std::endl;
+  }
+  return report.str();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOInstrumentation::ScopedTimer::ScopedTimer(const char* stageName, int numberOfItems/*=1*/)
+  : StageName(stageName)
+  , NumberOfItems(numberOfItems)
+  , Active(vtkSlicerIGSIOInstrumentation::IsActive())
+{
+  if (this->Active)
+  {
+    this->StartTime = std::chrono::steady_clock::now();
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOInstrumentation::ScopedTimer::~ScopedTimer()
+{
+  if (!this->Active)
+  {
+    return;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->StartTime).count();
+  vtkSlicerIGSIOInstrumentation* instrumentation = vtkSlicerIGSIOInstrumentation::GetInstance();
+  instrumentation->RecordStage(this->StageName, seconds, this->NumberOfItems);
+  instrumentation->RecordTraceEvent(this->StageName, this->StartTime, seconds);
+}
@@ -0,0 +1,140 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+#ifndef __vtkSlicerIGSIOInstrumentation_h
+#define __vtkSlicerIGSIOInstrumentation_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <chrono>
+#include <string>
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Opt-in timing of the stages of video loading, decoding, encoding and saving.
+/// For each stage (ex. "Demux", "CreateNodes", "Decode", "Encode", "Write"), the number of calls, the number of processed items (frames),
+/// the total/minimum/maximum time and a histogram of the latencies are recorded.
+/// In addition, each timed stage can be recorded as a span on the timeline of its thread (tracing), and written to a file
+/// in the Chrome Trace Event format (open in chrome://tracing or https://ui.perfetto.dev) to see the overlap of the stages across threads.
+/// Instrumentation and tracing are disabled by default, in which case timing a stage costs a single atomic load.
+/// Access the shared instance using GetInstance(). Stages can be recorded from any thread.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOInstrumentation : public vtkObject
+{
+public:
+  /// Returns the shared instance (with an additional reference)
+  static vtkSlicerIGSIOInstrumentation* New();
+  static vtkSlicerIGSIOInstrumentation* GetInstance();
+  vtkTypeMacro(vtkSlicerIGSIOInstrumentation, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Enable/disable recording of the stages. Recorded statistics are kept when disabled.
+  void SetEnabled(bool enabled);
+  bool GetEnabled();
+  vtkBooleanMacro(Enabled, bool);
+
+  /// Fast check whether the stages should be recorded
+  static bool IsEnabled();
+
+  /// Enable/disable recording of the spans of the timed stages. Recorded spans are kept when disabled.
+  /// At most MaximumNumberOfTraceEvents spans are kept, later spans are dropped.
+  void SetTracingEnabled(bool enabled);
+  bool GetTracingEnabled();
+  vtkBooleanMacro(TracingEnabled, bool);
+
+  /// Fast check whether the stages should be recorded, either as statistics or as trace spans
+  static bool IsActive();
+
+  /// Add a span of the stage to the timeline of the calling thread. Ignored if tracing is disabled.
+  void RecordTraceEvent(const std::string& stageName, std::chrono::steady_clock::time_point startTime, double seconds);
+
+  int GetNumberOfTraceEvents();
+  /// Number of spans that were not recorded because the maximum number of events was reached
+  int GetNumberOfDroppedTraceEvents();
+  void SetMaximumNumberOfTraceEvents(int maximumNumberOfTraceEvents);
+  int GetMaximumNumberOfTraceEvents();
+
+  /// Remove all recorded spans
+  void ClearTrace();
+
+  /// Write the recorded spans to a file in the Chrome Trace Event (JSON) format
+  bool WriteTrace(const std::string& fileName);
+
+  /// Add a measurement of the stage. Ignored if instrumentation is disabled.
+  /// \param numberOfItems Number of items (ex. frames) that were processed in the measured time
+  void RecordStage(const std::string& stageName, double seconds, int numberOfItems = 1);
+
+  /// Remove all recorded statistics
+  void Reset();
+
+  /// Stages that have been recorded since the last reset, in alphabetical order
+  int GetNumberOfStages();
+  std::string GetNthStageName(int n);
+
+  /// Statistics of the stage. Times are in seconds.
+  int GetStageNumberOfCalls(const std::string& stageName);
+  long long GetStageNumberOfItems(const std::string& stageName);
+  double GetStageTotalTime(const std::string& stageName);
+  double GetStageMinimumTime(const std::string& stageName);
+  double GetStageMaximumTime(const std::string& stageName);
+  double GetStageAverageTime(const std::string& stageName);
+
+  /// Latency histogram. The bin limits double from 10us, and the last bin contains all longer measurements.
+  int GetNumberOfHistogramBins();
+  /// Upper limit of the bin (in seconds). Returns a negative value for the last bin, which has no upper limit.
+  double GetHistogramBinUpperLimit(int bin);
+  int GetStageHistogramBinCount(const std::string& stageName, int bin);
+
+  /// Table of the statistics of all stages (tab separated, one line per stage)
+  std::string GetReport();
+
+#ifndef __VTK_WRAP__
+  /// Records the time between construction and destruction as a measurement and a trace span of the stage,
+  /// if instrumentation or tracing is enabled. The stage name must remain valid until the timer is destroyed (ex. a string literal).
+  class ScopedTimer
+  {
+  public:
+    ScopedTimer(const char* stageName, int numberOfItems = 1);
+    ~ScopedTimer();
+    void SetNumberOfItems(int numberOfItems) { this->NumberOfItems = numberOfItems; };
+  private:
+    const char* StageName;
+    int NumberOfItems;
+    bool Active;
+    std::chrono::steady_clock::time_point StartTime;
+  };
+#endif
+
+protected:
+  vtkSlicerIGSIOInstrumentation();
+  ~vtkSlicerIGSIOInstrumentation();
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOInstrumentation(const vtkSlicerIGSIOInstrumentation&); // Not implemented
+  void operator=(const vtkSlicerIGSIOInstrumentation&);               // Not implemented
+};
+
+#endif
@@ -0,0 +1,652 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOLosslessVolumeCodec.h"
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkVariant.h>
+
+// zlib includes
+#include <zlib.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// The prediction and residual kernels use SSE2 when it is available (always the case on x86-64).
+// On other architectures the scalar loops are left to the auto-vectorizer of the compiler.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SLICERIGSIO_LOSSLESS_CODEC_USE_SSE2
+#endif
+
+static const unsigned char LOSSLESS_CODEC_FORMAT_VERSION = 1;
+static const size_t LOSSLESS_CODEC_HEADER_SIZE = 20;
+static const unsigned char LOSSLESS_CODEC_KEY_FRAME_FLAG = 0x01;
+static const int LOSSLESS_CODEC_DEFAULT_COMPRESSION_LEVEL = Z_BEST_SPEED;
+static const int LOSSLESS_CODEC_DEFAULT_KEY_FRAME_INTERVAL = 30;
+// Deflate cannot compress data by more than about 1032:1, which bounds the size of the image that a frame can contain
+static const unsigned long long LOSSLESS_CODEC_MAXIMUM_DEFLATE_RATIO = 1032;
+
+static const std::string LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER = "compressionLevel";
+static const std::string LOSSLESS_CODEC_KEY_FRAME_INTERVAL_PARAMETER = "keyFrameInterval";
+
+namespace
+{
+
+#ifdef SLICERIGSIO_LOSSLESS_CODEC_USE_SSE2
+//----------------------------------------------------------------------------
+inline __m128i SubtractVectors(__m128i a, __m128i b, vtkTypeUInt8) { return _mm_sub_epi8(a, b); }
+inline __m128i SubtractVectors(__m128i a, __m128i b, vtkTypeUInt16) { return _mm_sub_epi16(a, b); }
+inline __m128i SubtractVectors(__m128i a, __m128i b, vtkTypeUInt32) { return _mm_sub_epi32(a, b); }
+inline __m128i SubtractVectors(__m128i a, __m128i b, vtkTypeUInt64) { return _mm_sub_epi64(a, b); }
+inline __m128i AddVectors(__m128i a, __m128i b, vtkTypeUInt8) { return _mm_add_epi8(a, b); }
+inline __m128i AddVectors(__m128i a, __m128i b, vtkTypeUInt16) { return _mm_add_epi16(a, b); }
+inline __m128i AddVectors(__m128i a, __m128i b, vtkTypeUInt32) { return _mm_add_epi32(a, b); }
+inline __m128i AddVectors(__m128i a, __m128i b, vtkTypeUInt64) { return _mm_add_epi64(a, b); }
+#endif
+
+//----------------------------------------------------------------------------
+// residual = values - prediction, with wraparound
+template<typename T>
+void SubtractValues(const T* values, const T* prediction, T* residual, size_t numberOfValues)
+{
+  size_t i = 0;
+#ifdef SLICERIGSIO_LOSSLESS_CODEC_USE_SSE2
+  const size_t valuesPerVector = sizeof(__m128i) / sizeof(T);
+  for (; i + valuesPerVector <= numberOfValues; i += valuesPerVector)
+  {
+    __m128i valuesVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    __m128i predictionVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prediction + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(residual + i), SubtractVectors(valuesVector, predictionVector, T()));
+  }
+#endif
+  for (; i < numberOfValues; ++i)
+  {
+    residual[i] = static_cast<T>(values[i] - prediction[i]);
+  }
+}
+
+//----------------------------------------------------------------------------
+// values = values + prediction, with wraparound (inverse of SubtractValues, in place)
+template<typename T>
+void AddValues(T* values, const T* prediction, size_t numberOfValues)
+{
+  size_t i = 0;
+#ifdef SLICERIGSIO_LOSSLESS_CODEC_USE_SSE2
+  const size_t valuesPerVector = sizeof(__m128i) / sizeof(T);
+  for (; i + valuesPerVector <= numberOfValues; i += valuesPerVector)
+  {
+    __m128i valuesVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    __m128i predictionVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prediction + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), AddVectors(valuesVector, predictionVector, T()));
+  }
+#endif
+  for (; i < numberOfValues; ++i)
+  {
+    values[i] = static_cast<T>(values[i] + prediction[i]);
+  }
+}
+
+//----------------------------------------------------------------------------
+// The scalars are processed as unsigned integers of the size of the scalar type, so that the differences of
+// multi-byte values carry over between bytes. Floating point values are reconstructed exactly from their bit patterns.
+void SubtractScalars(const unsigned char* values, const unsigned char* prediction, unsigned char* residual, size_t numberOfBytes, int valueSize)
+{
+  switch (valueSize)
+  {
+  case 2:
+    SubtractValues(reinterpret_cast<const vtkTypeUInt16*>(values), reinterpret_cast<const vtkTypeUInt16*>(prediction),
+      reinterpret_cast<vtkTypeUInt16*>(residual), numberOfBytes / 2);
+    break;
+  case 4:
+    SubtractValues(reinterpret_cast<const vtkTypeUInt32*>(values), reinterpret_cast<const vtkTypeUInt32*>(prediction),
+      reinterpret_cast<vtkTypeUInt32*>(residual), numberOfBytes / 4);
+    break;
+  case 8:
+    SubtractValues(reinterpret_cast<const vtkTypeUInt64*>(values), reinterpret_cast<const vtkTypeUInt64*>(prediction),
+      reinterpret_cast<vtkTypeUInt64*>(residual), numberOfBytes / 8);
+    break;
+  default:
+    SubtractValues(values, prediction, residual, numberOfBytes);
+    break;
+  }
+}
+
+//----------------------------------------------------------------------------
+void AddScalars(unsigned char* values, const unsigned char* prediction, size_t numberOfBytes, int valueSize)
+{
+  switch (valueSize)
+  {
+  case 2:
+    AddValues(reinterpret_cast<vtkTypeUInt16*>(values), reinterpret_cast<const vtkTypeUInt16*>(prediction), numberOfBytes / 2);
+    break;
+  case 4:
+    AddValues(reinterpret_cast<vtkTypeUInt32*>(values), reinterpret_cast<const vtkTypeUInt32*>(prediction), numberOfBytes / 4);
+    break;
+  case 8:
+    AddValues(reinterpret_cast<vtkTypeUInt64*>(values), reinterpret_cast<const vtkTypeUInt64*>(prediction), numberOfBytes / 8);
+    break;
+  default:
+    AddValues(values, prediction, numberOfBytes);
+    break;
+  }
+}
+
+//----------------------------------------------------------------------------
+void WriteUInt32(unsigned char* data, unsigned int value)
+{
+  data[0] = (unsigned char)(value & 0xFF);
+  data[1] = (unsigned char)((value >> 8) & 0xFF);
+  data[2] = (unsigned char)((value >> 16) & 0xFF);
+  data[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+//----------------------------------------------------------------------------
+unsigned int ReadUInt32(const unsigned char* data)
+{
+  return (unsigned int)data[0] | ((unsigned int)data[1] << 8) | ((unsigned int)data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+//----------------------------------------------------------------------------
+// Format of the scalars of an encoded frame
+struct FrameFormat
+{
+  int Dimensions[3];
+  int ScalarType;
+  int NumberOfComponents;
+
+  FrameFormat()
+    : ScalarType(VTK_VOID)
+    , NumberOfComponents(0)
+  {
+    this->Dimensions[0] = this->Dimensions[1] = this->Dimensions[2] = 0;
+  }
+
+  bool operator==(const FrameFormat& other) const
+  {
+    return this->Dimensions[0] == other.Dimensions[0] && this->Dimensions[1] == other.Dimensions[1]
+      && this->Dimensions[2] == other.Dimensions[2] && this->ScalarType == other.ScalarType
+      && this->NumberOfComponents == other.NumberOfComponents;
+  }
+
+  int GetValueSize() const
+  {
+    return vtkDataArray::GetDataTypeSize(this->ScalarType);
+  }
+
+  /// Number of bytes in a row of the image
+  size_t GetRowSize() const
+  {
+    return (size_t)this->Dimensions[0] * this->NumberOfComponents * this->GetValueSize();
+  }
+
+  size_t GetNumberOfBytes() const
+  {
+    return this->GetRowSize() * this->Dimensions[1] * this->Dimensions[2];
+  }
+
+  /// Returns true if the format describes a non-empty image of a supported scalar type that has at most maximumNumberOfBytes bytes.
+  /// Used to validate the format that is read from a frame header before any memory is allocated for the frame.
+  bool IsValid(unsigned long long maximumNumberOfBytes) const
+  {
+    int valueSize = this->GetValueSize();
+    if (valueSize != 1 && valueSize != 2 && valueSize != 4 && valueSize != 8)
+    {
+      return false;
+    }
+    unsigned long long factors[4] = { (unsigned long long)this->NumberOfComponents, (unsigned long long)this->Dimensions[0],
+      (unsigned long long)this->Dimensions[1], (unsigned long long)this->Dimensions[2] };
+    unsigned long long numberOfBytes = (unsigned long long)valueSize;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (factors[i] < 1 || factors[i] > (unsigned long long)VTK_INT_MAX || factors[i] > maximumNumberOfBytes / numberOfBytes)
+      {
+        return false;
+      }
+      numberOfBytes *= factors[i];
+    }
+    return numberOfBytes <= maximumNumberOfBytes;
+  }
+};
+
+//----------------------------------------------------------------------------
+// Keyframes predict each row from the previous row. The first row is stored as it is.
+void ComputeKeyFrameResidual(const unsigned char* values, unsigned char* residual, const FrameFormat& format)
+{
+  size_t numberOfBytes = format.GetNumberOfBytes();
+  size_t rowSize = std::min(format.GetRowSize(), numberOfBytes);
+  memcpy(residual, values, rowSize);
+  SubtractScalars(values + rowSize, values, residual + rowSize, numberOfBytes - rowSize, format.GetValueSize());
+}
+
+//----------------------------------------------------------------------------
+// Inverse of ComputeKeyFrameResidual, in place. Each row depends on the reconstructed previous row.
+void ReconstructKeyFrame(unsigned char* values, const FrameFormat& format)
+{
+  size_t numberOfBytes = format.GetNumberOfBytes();
+  size_t rowSize = format.GetRowSize();
+  int valueSize = format.GetValueSize();
+  for (size_t rowStart = rowSize; rowStart + rowSize <= numberOfBytes; rowStart += rowSize)
+  {
+    AddScalars(values + rowStart, values + rowStart - rowSize, rowSize, valueSize);
+  }
+}
+
+}
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOLosslessVolumeCodec::vtkInternal
+{
+public:
+  vtkInternal()
+    : CompressionLevel(LOSSLESS_CODEC_DEFAULT_COMPRESSION_LEVEL)
+    , KeyFrameInterval(LOSSLESS_CODEC_DEFAULT_KEY_FRAME_INTERVAL)
+    , NumberOfFramesSinceKeyFrame(0)
+    , DeflateInitialized(false)
+    , DeflateLevel(0)
+    , InflateInitialized(false)
+  {
+    memset(&this->DeflateStream, 0, sizeof(this->DeflateStream));
+    memset(&this->InflateStream, 0, sizeof(this->InflateStream));
+  }
+
+  ~vtkInternal()
+  {
+    if (this->DeflateInitialized)
+    {
+      deflateEnd(&this->DeflateStream);
+    }
+    if (this->InflateInitialized)
+    {
+      inflateEnd(&this->InflateStream);
+    }
+  }
+
+  /// Compress the input into the output buffer. The compression state is reused between frames.
+  bool Deflate(const unsigned char* input, size_t inputSize, std::vector<unsigned char>& output);
+
+  /// Decompress the input into the output, which must be exactly outputSize bytes long when decompressed.
+  bool Inflate(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize);
+
+  int CompressionLevel;
+  int KeyFrameInterval;
+
+  // Encoder state: the previous input image, which predicts the next frame
+  FrameFormat EncoderFormat;
+  std::vector<unsigned char> EncoderReference;
+  int NumberOfFramesSinceKeyFrame;
+  std::vector<unsigned char> CompressedBuffer;
+
+  // Decoder state: the last decoded image, which is the prediction of the next frame
+  FrameFormat DecoderFormat;
+  std::vector<unsigned char> DecoderReference;
+
+  std::vector<unsigned char> Residual;
+
+  z_stream DeflateStream;
+  bool DeflateInitialized;
+  int DeflateLevel;
+  z_stream InflateStream;
+  bool InflateInitialized;
+};
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOLosslessVolumeCodec::vtkInternal::Deflate(const unsigned char* input, size_t inputSize, std::vector<unsigned char>& output)
+{
+  if (this->DeflateInitialized && this->DeflateLevel != this->CompressionLevel)
+  {
+    deflateEnd(&this->DeflateStream);
+    this->DeflateInitialized = false;
+  }
+  if (!this->DeflateInitialized)
+  {
+    memset(&this->DeflateStream, 0, sizeof(this->DeflateStream));
+    if (deflateInit(&this->DeflateStream, this->CompressionLevel) != Z_OK)
+    {
+      return false;
+    }
+    this->DeflateInitialized = true;
+    this->DeflateLevel = this->CompressionLevel;
+  }
+  else if (deflateReset(&this->DeflateStream) != Z_OK)
+  {
+    return false;
+  }
+
+  output.resize(deflateBound(&this->DeflateStream, (uLong)inputSize));
+  this->DeflateStream.next_in = const_cast<Bytef*>(input);
+  this->DeflateStream.avail_in = (uInt)inputSize;
+  this->DeflateStream.next_out = output.data();
+  this->DeflateStream.avail_out = (uInt)output.size();
+  if (deflate(&this->DeflateStream, Z_FINISH) != Z_STREAM_END)
+  {
+    return false;
+  }
+  output.resize(this->DeflateStream.total_out);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOLosslessVolumeCodec::vtkInternal::Inflate(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize)
+{
+  if (!this->InflateInitialized)
+  {
+    memset(&this->InflateStream, 0, sizeof(this->InflateStream));
+    if (inflateInit(&this->InflateStream) != Z_OK)
+    {
+      return false;
+    }
+    this->InflateInitialized = true;
+  }
+  else if (inflateReset(&this->InflateStream) != Z_OK)
+  {
+    return false;
+  }
+
+  this->InflateStream.next_in = const_cast<Bytef*>(input);
+  this->InflateStream.avail_in = (uInt)inputSize;
+  this->InflateStream.next_out = output;
+  this->InflateStream.avail_out = (uInt)outputSize;
+  return inflate(&this->InflateStream, Z_FINISH) == Z_STREAM_END && this->InflateStream.total_out == outputSize;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOLosslessVolumeCodec);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOLosslessVolumeCodec::vtkSlicerIGSIOLosslessVolumeCodec()
+  : Internal(new vtkInternal())
+{
+  this->AvailiableParameterNames.push_back(LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER);
+  this->AvailiableParameterNames.push_back(LOSSLESS_CODEC_KEY_FRAME_INTERVAL_PARAMETER);
+  this->Parameters[LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER] = vtkVariant(LOSSLESS_CODEC_DEFAULT_COMPRESSION_LEVEL).ToString();
+  this->Parameters[LOSSLESS_CODEC_KEY_FRAME_INTERVAL_PARAMETER] = vtkVariant(LOSSLESS_CODEC_DEFAULT_KEY_FRAME_INTERVAL).ToString();
+
+  ParameterPreset fastPreset;
+  fastPreset.Value = "fast";
+  fastPreset.Name = "Fast (real-time)";
+  this->ParameterPresets.push_back(fastPreset);
+  ParameterPreset balancedPreset;
+  balancedPreset.Value = "balanced";
+  balancedPreset.Name = "Balanced";
+  this->ParameterPresets.push_back(balancedPreset);
+  ParameterPreset smallPreset;
+  smallPreset.Value = "small";
+  smallPreset.Name = "Smallest file";
+  this->ParameterPresets.push_back(smallPreset);
+  this->DefaultParameterPresetValue = "fast";
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOLosslessVolumeCodec::~vtkSlicerIGSIOLosslessVolumeCodec()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+vtkStreamingVolumeCodec* vtkSlicerIGSIOLosslessVolumeCodec::CreateCodecInstance()
+{
+  return vtkSlicerIGSIOLosslessVolumeCodec::New();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOLosslessVolumeCodec::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "CompressionLevel: " << this->Internal->CompressionLevel << std::endl;
+  os << indent << "KeyFrameInterval: " << this->Internal->KeyFrameInterval << std::endl;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOLosslessVolumeCodec::SetParameter(std::string parameterName, std::string parameterValue)
+{
+  if (!this->UpdateParameterInternal(parameterValue, parameterName))
+  {
+    return false;
+  }
+  this->Parameters[parameterName] = parameterValue;
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOLosslessVolumeCodec::UpdateParameterInternal(std::string parameterValue, std::string parameterName)
+{
+  bool valid = false;
+  int value = vtkVariant(parameterValue).ToInt(&valid);
+  if (parameterName == LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER)
+  {
+    if (!valid || value < Z_BEST_SPEED || value > Z_BEST_COMPRESSION)
+    {
+      vtkErrorMacro("Invalid compression level: " << parameterValue);
+      return false;
+    }
+    this->Internal->CompressionLevel = value;
+    return true;
+  }
+  else if (parameterName == LOSSLESS_CODEC_KEY_FRAME_INTERVAL_PARAMETER)
+  {
+    if (!valid || value < 1)
+    {
+      vtkErrorMacro("Invalid keyframe interval: " << parameterValue);
+      return false;
+    }
+    this->Internal->KeyFrameInterval = value;
+    return true;
+  }
+  vtkErrorMacro("Unknown parameter: " << parameterName);
+  return false;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOLosslessVolumeCodec::GetParameterDescription(std::string parameterName)
+{
+  if (parameterName == LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER)
+  {
+    return "Deflate compression level, between 1 (fastest) and 9 (smallest).";
+  }
+  else if (parameterName == LOSSLESS_CODEC_KEY_FRAME_INTERVAL_PARAMETER)
+  {
+    return "Number of frames between keyframes. Decoding a frame starts from the preceding keyframe.";
+  }
+  return "";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOLosslessVolumeCodec::SetParametersFromPresetValue(const std::string& presetValue)
+{
+  if (presetValue == "fast")
+  {
+    this->SetParameter(LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER, vtkVariant(Z_BEST_SPEED).ToString());
+  }
+  else if (presetValue == "balanced")
+  {
+    this->SetParameter(LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER, "6");
+  }
+  else if (presetValue == "small")
+  {
+    this->SetParameter(LOSSLESS_CODEC_COMPRESSION_LEVEL_PARAMETER, vtkVariant(Z_BEST_COMPRESSION).ToString());
+  }
+  else
+  {
+    vtkErrorMacro("Unknown preset: " << presetValue);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOLosslessVolumeCodec::EncodeImageDataInternal(vtkImageData* inputImageData, vtkStreamingVolumeFrame* outputFrame, bool forceKeyFrame)
+{
+  if (!inputImageData || !outputFrame || !inputImageData->GetScalarPointer())
+  {
+    vtkErrorMacro("EncodeImageDataInternal: Invalid arguments");
+    return false;
+  }
+
+  FrameFormat format;
+  inputImageData->GetDimensions(format.Dimensions);
+  format.ScalarType = inputImageData->GetScalarType();
+  format.NumberOfComponents = inputImageData->GetNumberOfScalarComponents();
+  size_t numberOfBytes = format.GetNumberOfBytes();
+  if (numberOfBytes == 0)
+  {
+    vtkErrorMacro("EncodeImageDataInternal: Empty image");
+    return false;
+  }
+  const unsigned char* values = static_cast<const unsigned char*>(inputImageData->GetScalarPointer());
+
+  // A change of format also requires a keyframe, since the previous image cannot predict the frame
+  bool keyFrame = forceKeyFrame || !(format == this->Internal->EncoderFormat)
+    || this->Internal->NumberOfFramesSinceKeyFrame + 1 >= this->Internal->KeyFrameInterval;
+  this->Internal->Residual.resize(numberOfBytes);
+  if (keyFrame)
+  {
+    ComputeKeyFrameResidual(values, this->Internal->Residual.data(), format);
+  }
+  else
+  {
+    SubtractScalars(values, this->Internal->EncoderReference.data(), this->Internal->Residual.data(), numberOfBytes, format.GetValueSize());
+  }
+
+  if (!this->Internal->Deflate(this->Internal->Residual.data(), numberOfBytes, this->Internal->CompressedBuffer))
+  {
+    vtkErrorMacro("EncodeImageDataInternal: Could not compress frame");
+    return false;
+  }
+
+  vtkSmartPointer<vtkUnsignedCharArray> frameData = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  frameData->SetNumberOfComponents(1);
+  frameData->SetNumberOfTuples(LOSSLESS_CODEC_HEADER_SIZE + this->Internal->CompressedBuffer.size());
+  unsigned char* frameDataPointer = frameData->GetPointer(0);
+  frameDataPointer[0] = LOSSLESS_CODEC_FORMAT_VERSION;
+  frameDataPointer[1] = keyFrame ? LOSSLESS_CODEC_KEY_FRAME_FLAG : 0;
+  frameDataPointer[2] = (unsigned char)format.ScalarType;
+  frameDataPointer[3] = 0;
+  WriteUInt32(frameDataPointer + 4, (unsigned int)format.NumberOfComponents);
+  for (int i = 0; i < 3; ++i)
+  {
+    WriteUInt32(frameDataPointer + 8 + 4 * i, (unsigned int)format.Dimensions[i]);
+  }
+  memcpy(frameDataPointer + LOSSLESS_CODEC_HEADER_SIZE, this->Internal->CompressedBuffer.data(), this->Internal->CompressedBuffer.size());
+
+  outputFrame->SetFrameData(frameData);
+  outputFrame->SetFrameType(keyFrame ? vtkStreamingVolumeFrame::IFrame : vtkStreamingVolumeFrame::PFrame);
+  outputFrame->SetDimensions(format.Dimensions);
+  outputFrame->SetNumberOfComponents(format.NumberOfComponents);
+  outputFrame->SetVTKScalarType(format.ScalarType);
+  outputFrame->SetCodecFourCC(this->GetFourCC());
+
+  this->Internal->EncoderFormat = format;
+  this->Internal->EncoderReference.assign(values, values + numberOfBytes);
+  this->Internal->NumberOfFramesSinceKeyFrame = keyFrame ? 0 : this->Internal->NumberOfFramesSinceKeyFrame + 1;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOLosslessVolumeCodec::DecodeFrameInternal(vtkStreamingVolumeFrame* inputFrame, vtkImageData* outputImageData, bool saveDecodedImage/*=true*/)
+{
+  vtkUnsignedCharArray* frameData = inputFrame ? inputFrame->GetFrameData() : NULL;
+  if (!frameData || frameData->GetNumberOfValues() < (vtkIdType)LOSSLESS_CODEC_HEADER_SIZE)
+  {
+    vtkErrorMacro("DecodeFrameInternal: Invalid frame");
+    return false;
+  }
+
+  const unsigned char* frameDataPointer = frameData->GetPointer(0);
+  if (frameDataPointer[0] != LOSSLESS_CODEC_FORMAT_VERSION)
+  {
+    vtkErrorMacro("DecodeFrameInternal: Unsupported frame format version: " << (int)frameDataPointer[0]);
+    return false;
+  }
+  bool keyFrame = (frameDataPointer[1] & LOSSLESS_CODEC_KEY_FRAME_FLAG) != 0;
+  size_t payloadSize = (size_t)frameData->GetNumberOfValues() - LOSSLESS_CODEC_HEADER_SIZE;
+
+  // The header is validated before the image is allocated, so that a corrupted frame cannot request an arbitrarily large allocation
+  unsigned int headerValues[4] = { 0, 0, 0, 0 };
+  for (int i = 0; i < 4; ++i)
+  {
+    headerValues[i] = ReadUInt32(frameDataPointer + 4 + 4 * i);
+    if (headerValues[i] > (unsigned int)VTK_INT_MAX)
+    {
+      vtkErrorMacro("DecodeFrameInternal: Invalid frame format");
+      return false;
+    }
+  }
+  FrameFormat format;
+  format.ScalarType = frameDataPointer[2];
+  format.NumberOfComponents = (int)headerValues[0];
+  for (int i = 0; i < 3; ++i)
+  {
+    format.Dimensions[i] = (int)headerValues[i + 1];
+  }
+  // Frames are inflated in a single call, so the image must also fit in the output size that zlib accepts
+  unsigned long long maximumNumberOfBytes = std::min((unsigned long long)payloadSize * LOSSLESS_CODEC_MAXIMUM_DEFLATE_RATIO,
+    (unsigned long long)std::numeric_limits<uInt>::max());
+  if (!format.IsValid(maximumNumberOfBytes))
+  {
+    vtkErrorMacro("DecodeFrameInternal: Invalid frame format");
+    return false;
+  }
+  size_t numberOfBytes = format.GetNumberOfBytes();
+
+  if (!keyFrame && (!(format == this->Internal->DecoderFormat) || this->Internal->DecoderReference.size() != numberOfBytes))
+  {
+    vtkErrorMacro("DecodeFrameInternal: The frame preceding the predicted frame has not been decoded");
+    return false;
+  }
+
+  // Keyframes are decompressed directly into the reference image, and reconstructed in place
+  std::vector<unsigned char>& residual = keyFrame ? this->Internal->DecoderReference : this->Internal->Residual;
+  residual.resize(numberOfBytes);
+  if (!this->Internal->Inflate(frameDataPointer + LOSSLESS_CODEC_HEADER_SIZE, payloadSize, residual.data(), numberOfBytes))
+  {
+    vtkErrorMacro("DecodeFrameInternal: Could not decompress frame");
+    this->Internal->DecoderReference.clear();
+    return false;
+  }
+  if (keyFrame)
+  {
+    ReconstructKeyFrame(this->Internal->DecoderReference.data(), format);
+  }
+  else
+  {
+    AddScalars(this->Internal->DecoderReference.data(), residual.data(), numberOfBytes, format.GetValueSize());
+  }
+  this->Internal->DecoderFormat = format;
+
+  if (saveDecodedImage && outputImageData)
+  {
+    outputImageData->SetDimensions(format.Dimensions);
+    outputImageData->AllocateScalars(format.ScalarType, format.NumberOfComponents);
+    memcpy(outputImageData->GetScalarPointer(), this->Internal->DecoderReference.data(), numberOfBytes);
+  }
+  return true;
+}
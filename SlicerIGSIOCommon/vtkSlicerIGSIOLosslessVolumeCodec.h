@@ -0,0 +1,77 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIGSIOLosslessVolumeCodec_h
+#define __vtkSlicerIGSIOLosslessVolumeCodec_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodec.h>
+
+// STD includes
+#include <string>
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Lossless codec for video and volume sequences, using inter-frame delta prediction and deflate (zlib) compression.
+/// Predicted frames store the difference from the previous frame, and keyframes store the difference of each row from the previous row.
+/// The differences are computed on the raw scalar values (with wraparound), so images of any scalar type and number of components
+/// are reconstructed exactly. Keyframes are inserted periodically (see keyFrameInterval), so that the video can be decoded from
+/// any keyframe.
+/// Each encoded frame starts with a 20 byte header: the format version, the keyframe flag and the VTK scalar type (1 byte each, and 1 reserved byte),
+/// the number of components and the dimensions (4 x 4 bytes, little-endian). The header is followed by the deflate stream of the residual.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOLosslessVolumeCodec : public vtkStreamingVolumeCodec
+{
+public:
+  static vtkSlicerIGSIOLosslessVolumeCodec* New();
+  vtkStreamingVolumeCodec* CreateCodecInstance() VTK_OVERRIDE;
+  vtkTypeMacro(vtkSlicerIGSIOLosslessVolumeCodec, vtkStreamingVolumeCodec);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// FourCC of the codec
+  static std::string GetCodecFourCC() { return "ZDLT"; }
+  std::string GetFourCC() VTK_OVERRIDE { return vtkSlicerIGSIOLosslessVolumeCodec::GetCodecFourCC(); }
+
+  /// Parameters:
+  /// - compressionLevel: deflate compression level, between 1 (fastest, default) and 9 (smallest)
+  /// - keyFrameInterval: number of frames between keyframes (default: 30). If 1, all frames are keyframes.
+  bool SetParameter(std::string parameterName, std::string parameterValue) VTK_OVERRIDE;
+  std::string GetParameterDescription(std::string parameterName) VTK_OVERRIDE;
+
+  /// Presets: "fast" (real-time, default), "balanced" and "small"
+  void SetParametersFromPresetValue(const std::string& presetValue) VTK_OVERRIDE;
+
+protected:
+  vtkSlicerIGSIOLosslessVolumeCodec();
+  ~vtkSlicerIGSIOLosslessVolumeCodec();
+
+  bool DecodeFrameInternal(vtkStreamingVolumeFrame* inputFrame, vtkImageData* outputImageData, bool saveDecodedImage = true) VTK_OVERRIDE;
+  bool EncodeImageDataInternal(vtkImageData* inputImageData, vtkStreamingVolumeFrame* outputFrame, bool forceKeyFrame) VTK_OVERRIDE;
+  bool UpdateParameterInternal(std::string parameterValue, std::string parameterName) VTK_OVERRIDE;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOLosslessVolumeCodec(const vtkSlicerIGSIOLosslessVolumeCodec&); // Not implemented
+  void operator=(const vtkSlicerIGSIOLosslessVolumeCodec&);                    // Not implemented
+};
+
+#endif
@@ -0,0 +1,1010 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOMkvFrameIndex.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkUnsignedCharArray.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+namespace
+{
+  // Matroska element IDs
+  const unsigned int EBML_HEADER_ID = 0x1A45DFA3;
+  const unsigned int SEGMENT_ID = 0x18538067;
+  const unsigned int SEEK_HEAD_ID = 0x114D9B74;
+  const unsigned int SEEK_ID = 0x4DBB;
+  const unsigned int SEEK_ID_ID = 0x53AB;
+  const unsigned int SEEK_POSITION_ID = 0x53AC;
+  const unsigned int INFO_ID = 0x1549A966;
+  const unsigned int TIMECODE_SCALE_ID = 0x2AD7B1;
+  const unsigned int DURATION_ID = 0x4489;
+  const unsigned int TRACKS_ID = 0x1654AE6B;
+  const unsigned int TRACK_ENTRY_ID = 0xAE;
+  const unsigned int TRACK_NUMBER_ID = 0xD7;
+  const unsigned int TRACK_TYPE_ID = 0x83;
+  const unsigned int CODEC_ID_ID = 0x86;
+  const unsigned int CODEC_PRIVATE_ID = 0x63A2;
+  const unsigned int NAME_ID = 0x536E;
+  const unsigned int VIDEO_ID = 0xE0;
+  const unsigned int PIXEL_WIDTH_ID = 0xB0;
+  const unsigned int PIXEL_HEIGHT_ID = 0xBA;
+  const unsigned int COLOUR_SPACE_ID = 0x2EB524;
+  const unsigned int CLUSTER_ID = 0x1F43B675;
+  const unsigned int CLUSTER_TIMECODE_ID = 0xE7;
+  const unsigned int SIMPLE_BLOCK_ID = 0xA3;
+  const unsigned int BLOCK_GROUP_ID = 0xA0;
+  const unsigned int BLOCK_ID = 0xA1;
+  const unsigned int REFERENCE_BLOCK_ID = 0xFB;
+  const unsigned int CUES_ID = 0x1C53BB6B;
+  const unsigned int CUE_POINT_ID = 0xBB;
+  const unsigned int CUE_TIME_ID = 0xB3;
+  const unsigned int CUE_TRACK_POSITIONS_ID = 0xB7;
+  const unsigned int CUE_TRACK_ID = 0xF7;
+  const unsigned int CUE_CLUSTER_POSITION_ID = 0xF1;
+  const unsigned int TAGS_ID = 0x1254C367;
+  const unsigned int ATTACHMENTS_ID = 0x1941A469;
+  const unsigned int CHAPTERS_ID = 0x1043A770;
+
+  const long long UNKNOWN_SIZE = -1;
+  const long long DEFAULT_TIMECODE_SCALE = 1000000;
+
+  // Metadata payloads larger than this are not stored in the index
+  const unsigned int MAXIMUM_METADATA_SIZE = 65536;
+
+  //----------------------------------------------------------------------------
+  bool IsSegmentChildID(unsigned int id)
+  {
+    return id == SEEK_HEAD_ID || id == INFO_ID || id == TRACKS_ID || id == CLUSTER_ID || id == CUES_ID
+      || id == TAGS_ID || id == ATTACHMENTS_ID || id == CHAPTERS_ID;
+  }
+}
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOMkvFrameIndex::vtkInternal
+{
+public:
+  vtkInternal()
+    : TimecodeScale(DEFAULT_TIMECODE_SCALE)
+    , Duration(0.0)
+    , SegmentDataOffset(0)
+    , SegmentEnd(UNKNOWN_SIZE)
+    , CuesOffset(UNKNOWN_SIZE)
+    , NextElementOffset(UNKNOWN_SIZE)
+    , ScanComplete(false)
+  {
+  }
+
+  /// Read an EBML variable size integer.
+  /// If keepMarker is true, the length marker bit is kept in the value (used for element IDs).
+  bool ReadVint(std::istream& stream, unsigned long long& value, int& length, bool keepMarker)
+  {
+    int firstByte = stream.get();
+    if (firstByte == EOF)
+    {
+      return false;
+    }
+
+    length = 1;
+    int mask = 0x80;
+    while (length <= 8 && !(firstByte & mask))
+    {
+      ++length;
+      mask >>= 1;
+    }
+    if (length > 8)
+    {
+      return false;
+    }
+
+    value = keepMarker ? firstByte : (firstByte & (mask - 1));
+    bool allOnes = (firstByte & (mask - 1)) == (mask - 1);
+    for (int i = 1; i < length; ++i)
+    {
+      int nextByte = stream.get();
+      if (nextByte == EOF)
+      {
+        return false;
+      }
+      allOnes = allOnes && nextByte == 0xFF;
+      value = (value << 8) | (unsigned long long)nextByte;
+    }
+
+    if (!keepMarker && allOnes)
+    {
+      value = (unsigned long long)UNKNOWN_SIZE;
+    }
+    return true;
+  }
+
+  /// Read the ID and size of the element starting at offset
+  bool ReadElementHeader(std::istream& stream, long long offset, unsigned int& id, long long& size, long long& dataOffset)
+  {
+    stream.clear();
+    stream.seekg(offset);
+
+    unsigned long long value = 0;
+    int idLength = 0;
+    if (!this->ReadVint(stream, value, idLength, true) || idLength > 4)
+    {
+      return false;
+    }
+    id = (unsigned int)value;
+
+    int sizeLength = 0;
+    if (!this->ReadVint(stream, value, sizeLength, false))
+    {
+      return false;
+    }
+    size = (long long)value;
+    dataOffset = offset + idLength + sizeLength;
+    return true;
+  }
+
+  unsigned long long ReadUnsignedInteger(std::istream& stream, long long size)
+  {
+    unsigned long long value = 0;
+    for (long long i = 0; i < size && i < 8; ++i)
+    {
+      value = (value << 8) | (unsigned long long)(stream.get() & 0xFF);
+    }
+    return value;
+  }
+
+  double ReadFloat(std::istream& stream, long long size)
+  {
+    unsigned long long bits = this->ReadUnsignedInteger(stream, size);
+    if (size == 4)
+    {
+      unsigned int floatBits = (unsigned int)bits;
+      float value = 0.0f;
+      memcpy(&value, &floatBits, sizeof(float));
+      return value;
+    }
+    else if (size == 8)
+    {
+      double value = 0.0;
+      memcpy(&value, &bits, sizeof(double));
+      return value;
+    }
+    return 0.0;
+  }
+
+  std::string ReadString(std::istream& stream, long long size)
+  {
+    std::string value((size_t)size, '\0');
+    if (size > 0)
+    {
+      stream.read(&value[0], size);
+    }
+    // Strings may be zero padded
+    size_t end = value.find('\0');
+    if (end != std::string::npos)
+    {
+      value.resize(end);
+    }
+    return value;
+  }
+
+  bool ParseSeekHead(long long dataOffset, long long dataEnd);
+  bool ParseCues(long long dataOffset, long long dataEnd);
+  bool ParseInfo(long long dataOffset, long long dataEnd);
+  bool ParseTracks(long long dataOffset, long long dataEnd);
+  bool ParseTrackEntry(long long dataOffset, long long dataEnd);
+  bool ParseVideo(long long dataOffset, long long dataEnd, TrackInfo& track);
+  bool ParseCluster(long long dataOffset, long long dataEnd, long long& clusterEnd);
+  bool ParseBlock(long long dataOffset, long long size, long long clusterTimecode, bool simpleBlock, bool keyFrame);
+
+  static std::string GetFourCCFromCodecID(const TrackInfo& track, const std::string& codecPrivate, const std::string& colourSpace);
+
+  std::string FileName;
+  std::ifstream ScanStream;
+
+  std::ifstream PayloadStream;
+  std::mutex PayloadMutex;
+
+  long long TimecodeScale;
+  double Duration;
+  long long SegmentDataOffset;
+  long long SegmentEnd;
+  /// Offset of the cues element from the start of the file, found in the seek head
+  long long CuesOffset;
+  long long NextElementOffset;
+  bool ScanComplete;
+
+  std::map<int, TrackInfo> Tracks;
+  std::vector<CuePointInfo> CuePoints;
+};
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOMkvFrameIndex::vtkInternal::GetFourCCFromCodecID(const TrackInfo& track, const std::string& codecPrivate, const std::string& colourSpace)
+{
+  if (track.CodecID == "V_VP9")
+  {
+    return "VP90";
+  }
+  else if (track.CodecID == "V_VP8")
+  {
+    return "VP80";
+  }
+  else if (track.CodecID == "V_MS/VFW/FOURCC" && codecPrivate.size() >= 20)
+  {
+    // BITMAPINFOHEADER, biCompression contains the FourCC
+    return codecPrivate.substr(16, 4);
+  }
+  else if (track.CodecID == "V_UNCOMPRESSED" && colourSpace.size() >= 4)
+  {
+    return colourSpace.substr(0, 4);
+  }
+  return "";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseSeekHead(long long offset, long long end)
+{
+  while (offset < end)
+  {
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->ReadElementHeader(this->ScanStream, offset, id, size, dataOffset) || size < 0)
+    {
+      return false;
+    }
+
+    if (id == SEEK_ID)
+    {
+      unsigned int seekId = 0;
+      long long seekPosition = UNKNOWN_SIZE;
+      long long seekOffset = dataOffset;
+      while (seekOffset < dataOffset + size)
+      {
+        unsigned int seekChildId = 0;
+        long long seekChildSize = 0;
+        long long seekChildDataOffset = 0;
+        if (!this->ReadElementHeader(this->ScanStream, seekOffset, seekChildId, seekChildSize, seekChildDataOffset) || seekChildSize < 0)
+        {
+          return false;
+        }
+        if (seekChildId == SEEK_ID_ID)
+        {
+          // The seek ID is stored as binary, including the length marker of the element ID
+          seekId = (unsigned int)this->ReadUnsignedInteger(this->ScanStream, seekChildSize);
+        }
+        else if (seekChildId == SEEK_POSITION_ID)
+        {
+          seekPosition = (long long)this->ReadUnsignedInteger(this->ScanStream, seekChildSize);
+        }
+        seekOffset = seekChildDataOffset + seekChildSize;
+      }
+      if (seekId == CUES_ID && seekPosition != UNKNOWN_SIZE)
+      {
+        // Seek positions are relative to the start of the segment data
+        this->CuesOffset = this->SegmentDataOffset + seekPosition;
+      }
+    }
+    offset = dataOffset + size;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseCues(long long offset, long long end)
+{
+  this->CuePoints.clear();
+  while (offset < end)
+  {
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->ReadElementHeader(this->ScanStream, offset, id, size, dataOffset) || size < 0)
+    {
+      return false;
+    }
+
+    if (id == CUE_POINT_ID)
+    {
+      CuePointInfo cuePoint;
+      std::vector<CuePointInfo> trackCuePoints;
+      long long cuePointOffset = dataOffset;
+      while (cuePointOffset < dataOffset + size)
+      {
+        unsigned int cuePointChildId = 0;
+        long long cuePointChildSize = 0;
+        long long cuePointChildDataOffset = 0;
+        if (!this->ReadElementHeader(this->ScanStream, cuePointOffset, cuePointChildId, cuePointChildSize, cuePointChildDataOffset) || cuePointChildSize < 0)
+        {
+          return false;
+        }
+        if (cuePointChildId == CUE_TIME_ID)
+        {
+          cuePoint.Timecode = (long long)this->ReadUnsignedInteger(this->ScanStream, cuePointChildSize);
+        }
+        else if (cuePointChildId == CUE_TRACK_POSITIONS_ID)
+        {
+          // A cue point contains the position of the cued frame for each of the cued tracks
+          CuePointInfo trackCuePoint;
+          long long positionOffset = cuePointChildDataOffset;
+          while (positionOffset < cuePointChildDataOffset + cuePointChildSize)
+          {
+            unsigned int positionChildId = 0;
+            long long positionChildSize = 0;
+            long long positionChildDataOffset = 0;
+            if (!this->ReadElementHeader(this->ScanStream, positionOffset, positionChildId, positionChildSize, positionChildDataOffset) || positionChildSize < 0)
+            {
+              return false;
+            }
+            if (positionChildId == CUE_TRACK_ID)
+            {
+              trackCuePoint.TrackNumber = (int)this->ReadUnsignedInteger(this->ScanStream, positionChildSize);
+            }
+            else if (positionChildId == CUE_CLUSTER_POSITION_ID)
+            {
+              trackCuePoint.ClusterOffset = this->SegmentDataOffset + (long long)this->ReadUnsignedInteger(this->ScanStream, positionChildSize);
+            }
+            positionOffset = positionChildDataOffset + positionChildSize;
+          }
+          trackCuePoints.push_back(trackCuePoint);
+        }
+        cuePointOffset = cuePointChildDataOffset + cuePointChildSize;
+      }
+      for (std::vector<CuePointInfo>::iterator trackCuePointIt = trackCuePoints.begin(); trackCuePointIt != trackCuePoints.end(); ++trackCuePointIt)
+      {
+        trackCuePointIt->Timecode = cuePoint.Timecode;
+        trackCuePointIt->Timestamp = cuePoint.Timecode * this->TimecodeScale * 1e-9;
+        this->CuePoints.push_back(*trackCuePointIt);
+      }
+    }
+    offset = dataOffset + size;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseInfo(long long offset, long long end)
+{
+  while (offset < end)
+  {
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->ReadElementHeader(this->ScanStream, offset, id, size, dataOffset) || size < 0)
+    {
+      return false;
+    }
+
+    if (id == TIMECODE_SCALE_ID)
+    {
+      this->TimecodeScale = (long long)this->ReadUnsignedInteger(this->ScanStream, size);
+    }
+    else if (id == DURATION_ID)
+    {
+      this->Duration = this->ReadFloat(this->ScanStream, size);
+    }
+    offset = dataOffset + size;
+  }
+
+  // Duration is specified in units of TimecodeScale
+  this->Duration = this->Duration * this->TimecodeScale * 1e-9;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseTracks(long long offset, long long end)
+{
+  while (offset < end)
+  {
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->ReadElementHeader(this->ScanStream, offset, id, size, dataOffset) || size < 0)
+    {
+      return false;
+    }
+
+    if (id == TRACK_ENTRY_ID && !this->ParseTrackEntry(dataOffset, dataOffset + size))
+    {
+      return false;
+    }
+    offset = dataOffset + size;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseTrackEntry(long long offset, long long end)
+{
+  TrackInfo track;
+  std::string codecPrivate;
+  std::string colourSpace;
+  while (offset < end)
+  {
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->ReadElementHeader(this->ScanStream, offset, id, size, dataOffset) || size < 0)
+    {
+      return false;
+    }
+
+    switch (id)
+    {
+    case TRACK_NUMBER_ID:
+      track.TrackNumber = (int)this->ReadUnsignedInteger(this->ScanStream, size);
+      break;
+    case TRACK_TYPE_ID:
+      track.TrackType = (int)this->ReadUnsignedInteger(this->ScanStream, size);
+      break;
+    case CODEC_ID_ID:
+      track.CodecID = this->ReadString(this->ScanStream, size);
+      break;
+    case CODEC_PRIVATE_ID:
+      codecPrivate = this->ReadString(this->ScanStream, std::min<long long>(size, 64));
+      break;
+    case NAME_ID:
+      track.Name = this->ReadString(this->ScanStream, size);
+      break;
+    case VIDEO_ID:
+      if (!this->ParseVideo(dataOffset, dataOffset + size, track))
+      {
+        return false;
+      }
+      break;
+    default:
+      break;
+    }
+    if (id == VIDEO_ID)
+    {
+      // Colour space is stored in the video element
+      colourSpace = track.FourCC;
+    }
+    offset = dataOffset + size;
+  }
+
+  if (track.TrackNumber < 0)
+  {
+    return false;
+  }
+  track.FourCC = GetFourCCFromCodecID(track, codecPrivate, colourSpace);
+  this->Tracks[track.TrackNumber] = track;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseVideo(long long offset, long long end, TrackInfo& track)
+{
+  while (offset < end)
+  {
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->ReadElementHeader(this->ScanStream, offset, id, size, dataOffset) || size < 0)
+    {
+      return false;
+    }
+
+    if (id == PIXEL_WIDTH_ID)
+    {
+      track.Width = (int)this->ReadUnsignedInteger(this->ScanStream, size);
+    }
+    else if (id == PIXEL_HEIGHT_ID)
+    {
+      track.Height = (int)this->ReadUnsignedInteger(this->ScanStream, size);
+    }
+    else if (id == COLOUR_SPACE_ID)
+    {
+      // Temporarily stored in the FourCC, until the codec ID has been read
+      track.FourCC = this->ReadString(this->ScanStream, size);
+    }
+    offset = dataOffset + size;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseCluster(long long offset, long long end, long long& clusterEnd)
+{
+  long long clusterTimecode = 0;
+  while (end == UNKNOWN_SIZE || offset < end)
+  {
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->ReadElementHeader(this->ScanStream, offset, id, size, dataOffset))
+    {
+      if (end == UNKNOWN_SIZE)
+      {
+        // Cluster of unknown size ends at the end of the file
+        break;
+      }
+      return false;
+    }
+
+    if (end == UNKNOWN_SIZE && IsSegmentChildID(id))
+    {
+      // Cluster of unknown size ends at the start of the next top level element
+      break;
+    }
+
+    if (size < 0)
+    {
+      return false;
+    }
+
+    if (id == CLUSTER_TIMECODE_ID)
+    {
+      clusterTimecode = (long long)this->ReadUnsignedInteger(this->ScanStream, size);
+    }
+    else if (id == SIMPLE_BLOCK_ID)
+    {
+      if (!this->ParseBlock(dataOffset, size, clusterTimecode, true, false))
+      {
+        return false;
+      }
+    }
+    else if (id == BLOCK_GROUP_ID)
+    {
+      // Blocks in block groups are keyframes if they don't reference another block
+      long long blockOffset = -1;
+      long long blockSize = 0;
+      bool keyFrame = true;
+      long long groupOffset = dataOffset;
+      while (groupOffset < dataOffset + size)
+      {
+        unsigned int groupChildId = 0;
+        long long groupChildSize = 0;
+        long long groupChildDataOffset = 0;
+        if (!this->ReadElementHeader(this->ScanStream, groupOffset, groupChildId, groupChildSize, groupChildDataOffset) || groupChildSize < 0)
+        {
+          return false;
+        }
+        if (groupChildId == BLOCK_ID)
+        {
+          blockOffset = groupChildDataOffset;
+          blockSize = groupChildSize;
+        }
+        else if (groupChildId == REFERENCE_BLOCK_ID)
+        {
+          keyFrame = false;
+        }
+        groupOffset = groupChildDataOffset + groupChildSize;
+      }
+      if (blockOffset >= 0 && !this->ParseBlock(blockOffset, blockSize, clusterTimecode, false, keyFrame))
+      {
+        return false;
+      }
+    }
+    offset = dataOffset + size;
+  }
+  clusterEnd = (end == UNKNOWN_SIZE) ? offset : end;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::vtkInternal::ParseBlock(long long offset, long long size, long long clusterTimecode, bool simpleBlock, bool keyFrame)
+{
+  this->ScanStream.clear();
+  this->ScanStream.seekg(offset);
+
+  unsigned long long trackNumber = 0;
+  int trackNumberLength = 0;
+  if (!this->ReadVint(this->ScanStream, trackNumber, trackNumberLength, false))
+  {
+    return false;
+  }
+
+  int timecodeHigh = this->ScanStream.get();
+  int timecodeLow = this->ScanStream.get();
+  int flags = this->ScanStream.get();
+  if (flags == EOF)
+  {
+    return false;
+  }
+  short relativeTimecode = (short)(((timecodeHigh & 0xFF) << 8) | (timecodeLow & 0xFF));
+
+  if (flags & 0x06)
+  {
+    // Laced blocks contain multiple frames. They are not written by the IGSIO sequence writer.
+    vtkGenericWarningMacro("vtkSlicerIGSIOMkvFrameIndex: laced blocks are not supported");
+    return false;
+  }
+
+  std::map<int, TrackInfo>::iterator trackIt = this->Tracks.find((int)trackNumber);
+  if (trackIt == this->Tracks.end())
+  {
+    // Block from an unknown track, ignore
+    return true;
+  }
+
+  long long headerSize = trackNumberLength + 3;
+  FrameInfo frame;
+  frame.Timecode = clusterTimecode + relativeTimecode;
+  frame.Timestamp = frame.Timecode * this->TimecodeScale * 1e-9;
+  frame.Offset = offset + headerSize;
+  frame.Size = (unsigned int)(size - headerSize);
+  frame.KeyFrame = simpleBlock ? ((flags & 0x80) != 0) : keyFrame;
+
+  TrackInfo& track = trackIt->second;
+  if (track.TrackType == VideoTrack)
+  {
+    track.Frames.push_back(frame);
+  }
+  else if (frame.Size <= MAXIMUM_METADATA_SIZE)
+  {
+    track.Metadata[frame.Timecode] = this->ReadString(this->ScanStream, frame.Size);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOMkvFrameIndex);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvFrameIndex::vtkSlicerIGSIOMkvFrameIndex()
+  : Internal(new vtkInternal())
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvFrameIndex::~vtkSlicerIGSIOMkvFrameIndex()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::ReadFile(const std::string& fileName)
+{
+  if (!this->ReadHeader(fileName))
+  {
+    return false;
+  }
+  return this->ScanClusters() >= 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::ReadHeader(const std::string& fileName)
+{
+  this->Internal->Tracks.clear();
+  this->Internal->TimecodeScale = DEFAULT_TIMECODE_SCALE;
+  this->Internal->Duration = 0.0;
+  this->Internal->ScanComplete = false;
+  this->Internal->CuesOffset = UNKNOWN_SIZE;
+  this->Internal->CuePoints.clear();
+  this->Internal->FileName = fileName;
+
+  if (this->Internal->ScanStream.is_open())
+  {
+    this->Internal->ScanStream.close();
+  }
+  this->Internal->ScanStream.open(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!this->Internal->ScanStream.is_open())
+  {
+    vtkErrorMacro("ReadHeader: Could not open file: " << fileName);
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->PayloadMutex);
+    if (this->Internal->PayloadStream.is_open())
+    {
+      this->Internal->PayloadStream.close();
+    }
+  }
+
+  unsigned int id = 0;
+  long long size = 0;
+  long long dataOffset = 0;
+  if (!this->Internal->ReadElementHeader(this->Internal->ScanStream, 0, id, size, dataOffset) || id != EBML_HEADER_ID || size < 0)
+  {
+    vtkErrorMacro("ReadHeader: File is not an EBML file: " << fileName);
+    return false;
+  }
+
+  if (!this->Internal->ReadElementHeader(this->Internal->ScanStream, dataOffset + size, id, size, dataOffset) || id != SEGMENT_ID)
+  {
+    vtkErrorMacro("ReadHeader: Could not find segment in file: " << fileName);
+    return false;
+  }
+  this->Internal->SegmentDataOffset = dataOffset;
+  this->Internal->SegmentEnd = (size == UNKNOWN_SIZE) ? UNKNOWN_SIZE : dataOffset + size;
+
+  // Read the top level elements until the first cluster is found
+  long long offset = dataOffset;
+  while (this->Internal->SegmentEnd == UNKNOWN_SIZE || offset < this->Internal->SegmentEnd)
+  {
+    if (!this->Internal->ReadElementHeader(this->Internal->ScanStream, offset, id, size, dataOffset))
+    {
+      // End of file
+      this->Internal->ScanComplete = true;
+      break;
+    }
+
+    if (id == CLUSTER_ID)
+    {
+      break;
+    }
+
+    if (size < 0)
+    {
+      vtkErrorMacro("ReadHeader: Top level element of unknown size in file: " << fileName);
+      return false;
+    }
+
+    if (id == SEEK_HEAD_ID && !this->Internal->ParseSeekHead(dataOffset, dataOffset + size))
+    {
+      vtkErrorMacro("ReadHeader: Could not parse seek head in file: " << fileName);
+      return false;
+    }
+    else if (id == CUES_ID)
+    {
+      this->Internal->CuesOffset = offset;
+    }
+    else if (id == INFO_ID && !this->Internal->ParseInfo(dataOffset, dataOffset + size))
+    {
+      vtkErrorMacro("ReadHeader: Could not parse segment information in file: " << fileName);
+      return false;
+    }
+    else if (id == TRACKS_ID && !this->Internal->ParseTracks(dataOffset, dataOffset + size))
+    {
+      vtkErrorMacro("ReadHeader: Could not parse tracks in file: " << fileName);
+      return false;
+    }
+    offset = dataOffset + size;
+  }
+  this->Internal->NextElementOffset = offset;
+
+  if (this->Internal->Tracks.empty())
+  {
+    vtkErrorMacro("ReadHeader: No tracks found in file: " << fileName);
+    return false;
+  }
+
+  // Cues are usually written after the clusters. They are optional, so the file can still be indexed if they cannot be read.
+  if (this->Internal->CuesOffset != UNKNOWN_SIZE)
+  {
+    if (!this->Internal->ReadElementHeader(this->Internal->ScanStream, this->Internal->CuesOffset, id, size, dataOffset)
+      || id != CUES_ID || size < 0 || !this->Internal->ParseCues(dataOffset, dataOffset + size))
+    {
+      vtkWarningMacro("ReadHeader: Could not parse cues in file: " << fileName);
+      this->Internal->CuePoints.clear();
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvFrameIndex::ScanClusters(int maximumNumberOfClusters/*=-1*/)
+{
+  if (!this->Internal->ScanStream.is_open())
+  {
+    vtkErrorMacro("ScanClusters: File header has not been read");
+    return -1;
+  }
+
+  int numberOfClusters = 0;
+  long long offset = this->Internal->NextElementOffset;
+  while (!this->Internal->ScanComplete && (maximumNumberOfClusters < 0 || numberOfClusters < maximumNumberOfClusters))
+  {
+    if (this->Internal->SegmentEnd != UNKNOWN_SIZE && offset >= this->Internal->SegmentEnd)
+    {
+      this->Internal->ScanComplete = true;
+      break;
+    }
+
+    unsigned int id = 0;
+    long long size = 0;
+    long long dataOffset = 0;
+    if (!this->Internal->ReadElementHeader(this->Internal->ScanStream, offset, id, size, dataOffset))
+    {
+      // End of file
+      this->Internal->ScanComplete = true;
+      break;
+    }
+
+    if (id == CLUSTER_ID)
+    {
+      long long clusterEnd = 0;
+      if (!this->Internal->ParseCluster(dataOffset, size == UNKNOWN_SIZE ? UNKNOWN_SIZE : dataOffset + size, clusterEnd))
+      {
+        vtkErrorMacro("ScanClusters: Could not parse cluster at offset " << offset << " in file: " << this->Internal->FileName);
+        return -1;
+      }
+      offset = clusterEnd;
+      ++numberOfClusters;
+    }
+    else if (size < 0)
+    {
+      vtkErrorMacro("ScanClusters: Top level element of unknown size in file: " << this->Internal->FileName);
+      return -1;
+    }
+    else
+    {
+      offset = dataOffset + size;
+    }
+  }
+  this->Internal->NextElementOffset = offset;
+  return numberOfClusters;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::IsScanComplete()
+{
+  return this->Internal->ScanComplete;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::ReadFrameData(long long offset, unsigned int size, vtkUnsignedCharArray* frameData)
+{
+  if (!frameData)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(this->Internal->PayloadMutex);
+  if (!this->Internal->PayloadStream.is_open())
+  {
+    this->Internal->PayloadStream.open(this->Internal->FileName.c_str(), std::ios::in | std::ios::binary);
+    if (!this->Internal->PayloadStream.is_open())
+    {
+      vtkErrorMacro("ReadFrameData: Could not open file: " << this->Internal->FileName);
+      return false;
+    }
+  }
+
+  frameData->SetNumberOfComponents(1);
+  frameData->SetNumberOfTuples(size);
+  this->Internal->PayloadStream.clear();
+  this->Internal->PayloadStream.seekg(offset);
+  this->Internal->PayloadStream.read((char*)frameData->GetPointer(0), size);
+  if (this->Internal->PayloadStream.gcount() != (std::streamsize)size)
+  {
+    vtkErrorMacro("ReadFrameData: Could not read " << size << " bytes at offset " << offset << " from file: " << this->Internal->FileName);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOMkvFrameIndex::GetFileName()
+{
+  return this->Internal->FileName;
+}
+
+//----------------------------------------------------------------------------
+long long vtkSlicerIGSIOMkvFrameIndex::GetTimecodeScale()
+{
+  return this->Internal->TimecodeScale;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOMkvFrameIndex::GetDuration()
+{
+  return this->Internal->Duration;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvFrameIndex::HasCues()
+{
+  return !this->Internal->CuePoints.empty();
+}
+
+//----------------------------------------------------------------------------
+const std::vector<vtkSlicerIGSIOMkvFrameIndex::CuePointInfo>& vtkSlicerIGSIOMkvFrameIndex::GetCuePoints()
+{
+  return this->Internal->CuePoints;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvFrameIndex::GetNumberOfTracks()
+{
+  return (int)this->Internal->Tracks.size();
+}
+
+//----------------------------------------------------------------------------
+std::vector<int> vtkSlicerIGSIOMkvFrameIndex::GetTrackNumbers()
+{
+  std::vector<int> trackNumbers;
+  for (std::map<int, TrackInfo>::iterator trackIt = this->Internal->Tracks.begin(); trackIt != this->Internal->Tracks.end(); ++trackIt)
+  {
+    trackNumbers.push_back(trackIt->first);
+  }
+  return trackNumbers;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvFrameIndex::GetFirstVideoTrackNumber()
+{
+  for (std::map<int, TrackInfo>::iterator trackIt = this->Internal->Tracks.begin(); trackIt != this->Internal->Tracks.end(); ++trackIt)
+  {
+    if (trackIt->second.TrackType == VideoTrack)
+    {
+      return trackIt->first;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvFrameIndex::TrackInfo* vtkSlicerIGSIOMkvFrameIndex::GetTrack(int trackNumber)
+{
+  std::map<int, TrackInfo>::iterator trackIt = this->Internal->Tracks.find(trackNumber);
+  if (trackIt == this->Internal->Tracks.end())
+  {
+    return NULL;
+  }
+  return &trackIt->second;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvFrameIndex::TrackInfo* vtkSlicerIGSIOMkvFrameIndex::GetTrackByName(const std::string& name)
+{
+  for (std::map<int, TrackInfo>::iterator trackIt = this->Internal->Tracks.begin(); trackIt != this->Internal->Tracks.end(); ++trackIt)
+  {
+    if (trackIt->second.Name == name)
+    {
+      return &trackIt->second;
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOMkvFrameIndex::GetTrackName(int trackNumber)
+{
+  TrackInfo* track = this->GetTrack(trackNumber);
+  return track ? track->Name : "";
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOMkvFrameIndex::GetTrackFourCC(int trackNumber)
+{
+  TrackInfo* track = this->GetTrack(trackNumber);
+  return track ? track->FourCC : "";
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvFrameIndex::GetNumberOfFrames(int trackNumber)
+{
+  TrackInfo* track = this->GetTrack(trackNumber);
+  return track ? (int)track->Frames.size() : 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvFrameIndex::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << this->Internal->FileName << "\n";
+  os << indent << "TimecodeScale: " << this->Internal->TimecodeScale << "\n";
+  os << indent << "Duration: " << this->Internal->Duration << "\n";
+  os << indent << "ScanComplete: " << (this->Internal->ScanComplete ? "true" : "false") << "\n";
+  os << indent << "NumberOfCuePoints: " << this->Internal->CuePoints.size() << "\n";
+  for (std::map<int, TrackInfo>::iterator trackIt = this->Internal->Tracks.begin(); trackIt != this->Internal->Tracks.end(); ++trackIt)
+  {
+    os << indent << "Track " << trackIt->first << ": " << trackIt->second.Name
+       << " (" << trackIt->second.CodecID << ", " << trackIt->second.Frames.size() << " frames)\n";
+  }
+}
@@ -0,0 +1,176 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIGSIOMkvFrameIndex_h
+#define __vtkSlicerIGSIOMkvFrameIndex_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkUnsignedCharArray;
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Index of the frames contained in a Matroska (.mkv/.webm) file.
+/// The index is built by parsing the segment information, tracks and cluster/block headers of the file.
+/// The encoded payloads of the video frames are not read while indexing, and can be read later on demand using ReadFrameData().
+/// The contents of the (small) metadata tracks are read while indexing.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOMkvFrameIndex : public vtkObject
+{
+public:
+  static vtkSlicerIGSIOMkvFrameIndex* New();
+  vtkTypeMacro(vtkSlicerIGSIOMkvFrameIndex, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum TrackType
+  {
+    VideoTrack = 0x01,
+    SubtitleTrack = 0x11,
+  };
+
+  /// Location of a single encoded frame in the file
+  struct FrameInfo
+  {
+    /// Timecode of the frame in units of TimecodeScale
+    long long Timecode;
+    /// Timestamp of the frame in seconds
+    double Timestamp;
+    /// Offset of the frame payload from the start of the file
+    long long Offset;
+    /// Size of the frame payload in bytes
+    unsigned int Size;
+    bool KeyFrame;
+    FrameInfo()
+      : Timecode(0)
+      , Timestamp(0.0)
+      , Offset(0)
+      , Size(0)
+      , KeyFrame(false)
+    {
+    }
+  };
+
+  struct TrackInfo
+  {
+    int TrackNumber;
+    int TrackType;
+    std::string CodecID;
+    std::string FourCC;
+    std::string Name;
+    int Width;
+    int Height;
+    /// Encoded frames of video tracks
+    std::vector<FrameInfo> Frames;
+    /// Contents of metadata tracks, indexed by timecode
+    std::map<long long, std::string> Metadata;
+    TrackInfo()
+      : TrackNumber(-1)
+      , TrackType(0)
+      , Width(0)
+      , Height(0)
+    {
+    }
+  };
+
+  /// Entry of the cues (seek index) of the file
+  struct CuePointInfo
+  {
+    /// Timecode of the cue point in units of TimecodeScale
+    long long Timecode;
+    /// Timestamp of the cue point in seconds
+    double Timestamp;
+    int TrackNumber;
+    /// Offset of the cluster that contains the cued frame from the start of the file
+    long long ClusterOffset;
+    CuePointInfo()
+      : Timecode(0)
+      , Timestamp(0.0)
+      , TrackNumber(-1)
+      , ClusterOffset(0)
+    {
+    }
+  };
+
+  /// Read the header and index all of the frames in the file
+  bool ReadFile(const std::string& fileName);
+
+  /// Open the file and read the segment information, the track entries and the cues.
+  /// The cues are found using the seek head if they are stored after the clusters. No clusters are parsed.
+  bool ReadHeader(const std::string& fileName);
+
+  /// Parse the next clusters of the file and add the contained frames to the index.
+  /// \param maximumNumberOfClusters Maximum number of clusters to parse. All remaining clusters are parsed if negative.
+  /// \return The number of clusters that were parsed, or -1 in case of an error.
+  int ScanClusters(int maximumNumberOfClusters = -1);
+
+  /// Returns true if all of the clusters in the file have been indexed
+  bool IsScanComplete();
+
+  /// Read the encoded payload of a frame from the file.
+  /// This method can be called from any thread.
+  bool ReadFrameData(long long offset, unsigned int size, vtkUnsignedCharArray* frameData);
+
+  /// Name of the indexed file
+  std::string GetFileName();
+
+  /// Scale of the timecodes in nanoseconds
+  long long GetTimecodeScale();
+
+  /// Segment duration in seconds (0.0 if not specified in the file)
+  double GetDuration();
+
+  /// Returns true if the file contains cues
+  bool HasCues();
+  /// Cue points of the file, in the order they are stored in the file
+  const std::vector<CuePointInfo>& GetCuePoints();
+
+  int GetNumberOfTracks();
+  std::vector<int> GetTrackNumbers();
+  /// Track number of the first video track, or -1 if the file contains no video tracks
+  int GetFirstVideoTrackNumber();
+  /// Returns NULL if there is no track with the specified track number
+  TrackInfo* GetTrack(int trackNumber);
+  /// Returns NULL if there is no track with the specified name
+  TrackInfo* GetTrackByName(const std::string& name);
+
+  std::string GetTrackName(int trackNumber);
+  std::string GetTrackFourCC(int trackNumber);
+  int GetNumberOfFrames(int trackNumber);
+
+protected:
+  vtkSlicerIGSIOMkvFrameIndex();
+  ~vtkSlicerIGSIOMkvFrameIndex();
+
+private:
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOMkvFrameIndex(const vtkSlicerIGSIOMkvFrameIndex&); // Not implemented
+  void operator=(const vtkSlicerIGSIOMkvFrameIndex&);              // Not implemented
+};
+
+#endif
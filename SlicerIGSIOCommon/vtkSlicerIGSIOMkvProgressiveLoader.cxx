@@ -0,0 +1,485 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOMkvFrameIndex.h"
+#include "vtkSlicerIGSIOMkvProgressiveLoader.h"
+#include "vtkSlicerIGSIOTransformTrack.h"
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSequenceBrowserNode.h>
+#include <vtkMRMLSequenceNode.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOMkvProgressiveLoader::vtkInternal
+{
+public:
+  vtkInternal()
+    : Status(StatusIdle)
+    , VideoTrackNumber(-1)
+    , NumberOfLoadedFrames(0)
+    , LastTimestamp(0.0)
+    , CancelRequested(false)
+    , ScanFinished(false)
+    , ScanFailed(false)
+  {
+  }
+
+  std::string FileName;
+  vtkWeakPointer<vtkMRMLSequenceBrowserNode> SequenceBrowserNode;
+  vtkSmartPointer<vtkCollection> TransformTracks;
+
+  int Status;
+
+  /// Index of the file. The frames and metadata of the tracks are modified by the background thread, so they must only be
+  /// accessed with IndexMutex locked.
+  vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex> FrameIndex;
+  std::mutex IndexMutex;
+
+  int VideoTrackNumber;
+  vtkWeakPointer<vtkMRMLSequenceNode> VideoSequenceNode;
+  std::map<std::string, vtkWeakPointer<vtkMRMLSequenceNode> > TransformSequenceNodes;
+  std::map<std::string, vtkSmartPointer<vtkSlicerIGSIOTransformTrack> > TransformTracksByName;
+
+  /// Number of frames of the video track that have been added to the sequences
+  int NumberOfLoadedFrames;
+  /// Last frame that was added to the video sequence, which is the previous frame of the next added frame
+  vtkSmartPointer<vtkStreamingVolumeFrame> PreviousFrame;
+  double LastTimestamp;
+
+  std::thread Thread;
+  std::atomic<bool> CancelRequested;
+  /// Set by the background thread once the whole file has been indexed, or indexing has stopped
+  std::atomic<bool> ScanFinished;
+  bool ScanFailed;
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOMkvProgressiveLoader);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvProgressiveLoader::vtkSlicerIGSIOMkvProgressiveLoader()
+  : NumberOfClustersPerScan(16)
+  , MaximumNumberOfFramesPerUpdate(500)
+  , Internal(new vtkInternal())
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvProgressiveLoader::~vtkSlicerIGSIOMkvProgressiveLoader()
+{
+  // The background thread accesses the frame index, so it must finish before the loader is deleted
+  this->Internal->CancelRequested = true;
+  if (this->Internal->Thread.joinable())
+  {
+    this->Internal->Thread.join();
+  }
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << this->Internal->FileName << std::endl;
+  os << indent << "SequenceBrowserNode: " << this->Internal->SequenceBrowserNode.GetPointer() << std::endl;
+  os << indent << "NumberOfClustersPerScan: " << this->NumberOfClustersPerScan << std::endl;
+  os << indent << "MaximumNumberOfFramesPerUpdate: " << this->MaximumNumberOfFramesPerUpdate << std::endl;
+  os << indent << "Status: " << GetStatusAsString(this->Internal->Status) << std::endl;
+  os << indent << "NumberOfLoadedFrames: " << this->Internal->NumberOfLoadedFrames << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::SetFileName(const std::string& fileName)
+{
+  if (this->Internal->FileName == fileName)
+  {
+    return;
+  }
+  this->Internal->FileName = fileName;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOMkvProgressiveLoader::GetFileName()
+{
+  return this->Internal->FileName;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::SetSequenceBrowserNode(vtkMRMLSequenceBrowserNode* sequenceBrowserNode)
+{
+  if (this->Internal->SequenceBrowserNode == sequenceBrowserNode)
+  {
+    return;
+  }
+  this->Internal->SequenceBrowserNode = sequenceBrowserNode;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSequenceBrowserNode* vtkSlicerIGSIOMkvProgressiveLoader::GetSequenceBrowserNode()
+{
+  return this->Internal->SequenceBrowserNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::SetTransformTracks(vtkCollection* transformTracks)
+{
+  if (this->Internal->TransformTracks == transformTracks)
+  {
+    return;
+  }
+  this->Internal->TransformTracks = transformTracks;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkCollection* vtkSlicerIGSIOMkvProgressiveLoader::GetTransformTracks()
+{
+  return this->Internal->TransformTracks;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvProgressiveLoader::Start()
+{
+  if (this->IsRunning())
+  {
+    vtkErrorMacro("Start: Loading is already running");
+    return false;
+  }
+
+  vtkMRMLSequenceBrowserNode* sequenceBrowserNode = this->Internal->SequenceBrowserNode;
+  if (!sequenceBrowserNode || !sequenceBrowserNode->GetScene())
+  {
+    vtkErrorMacro("Start: Sequence browser node must be added to the scene");
+    return false;
+  }
+
+  this->Internal->FrameIndex = vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex>::New();
+  this->Internal->VideoSequenceNode = NULL;
+  this->Internal->TransformSequenceNodes.clear();
+  this->Internal->TransformTracksByName.clear();
+  this->Internal->NumberOfLoadedFrames = 0;
+  this->Internal->PreviousFrame = NULL;
+  this->Internal->LastTimestamp = 0.0;
+  this->Internal->CancelRequested = false;
+  this->Internal->ScanFinished = false;
+  this->Internal->ScanFailed = false;
+
+  // Only the clusters up to the first video frame are indexed before the browser is populated
+  vtkSlicerIGSIOMkvFrameIndex* frameIndex = this->Internal->FrameIndex;
+  if (!frameIndex->ReadHeader(this->Internal->FileName))
+  {
+    this->SetStatus(StatusFailed);
+    return false;
+  }
+  int videoTrackNumber = frameIndex->GetFirstVideoTrackNumber();
+  if (videoTrackNumber < 0)
+  {
+    vtkErrorMacro("Start: No video track in file: " << this->Internal->FileName);
+    this->SetStatus(StatusFailed);
+    return false;
+  }
+  while (frameIndex->GetNumberOfFrames(videoTrackNumber) < 1 && !frameIndex->IsScanComplete())
+  {
+    if (frameIndex->ScanClusters(1) < 0)
+    {
+      this->SetStatus(StatusFailed);
+      return false;
+    }
+  }
+
+  if (!vtkSlicerIGSIOCommon::MkvFrameIndexToSequenceBrowser(frameIndex, sequenceBrowserNode, this->Internal->TransformTracks))
+  {
+    this->SetStatus(StatusFailed);
+    return false;
+  }
+  this->Internal->VideoTrackNumber = videoTrackNumber;
+  this->Internal->VideoSequenceNode = sequenceBrowserNode->GetMasterSequenceNode();
+  this->Internal->NumberOfLoadedFrames = frameIndex->GetNumberOfFrames(videoTrackNumber);
+  this->Internal->LastTimestamp = frameIndex->GetTrack(videoTrackNumber)->Frames.back().Timestamp;
+
+  // Frames that are skipped in the file are not added to the sequence, so if the last indexed frame was skipped,
+  // the next frame is decoded starting from the last frame in the sequence
+  vtkMRMLSequenceNode* videoSequenceNode = this->Internal->VideoSequenceNode;
+  int numberOfDataNodes = videoSequenceNode ? videoSequenceNode->GetNumberOfDataNodes() : 0;
+  vtkMRMLStreamingVolumeNode* lastStreamingVolumeNode = numberOfDataNodes > 0 ?
+    vtkMRMLStreamingVolumeNode::SafeDownCast(videoSequenceNode->GetNthDataNode(numberOfDataNodes - 1)) : NULL;
+  this->Internal->PreviousFrame = lastStreamingVolumeNode ? lastStreamingVolumeNode->GetFrame() : NULL;
+
+  std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+  sequenceBrowserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+  for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+  {
+    const char* transformName = *sequenceNodeIt ? (*sequenceNodeIt)->GetAttribute(vtkSlicerIGSIOCommon::GetMkvTransformNameAttributeName()) : NULL;
+    if (transformName)
+    {
+      this->Internal->TransformSequenceNodes[transformName] = *sequenceNodeIt;
+    }
+  }
+  for (int i = 0; this->Internal->TransformTracks && i < this->Internal->TransformTracks->GetNumberOfItems(); ++i)
+  {
+    vtkSlicerIGSIOTransformTrack* transformTrack = vtkSlicerIGSIOTransformTrack::SafeDownCast(this->Internal->TransformTracks->GetItemAsObject(i));
+    if (transformTrack && transformTrack->GetTransformName())
+    {
+      this->Internal->TransformTracksByName[transformTrack->GetTransformName()] = transformTrack;
+    }
+  }
+
+  if (frameIndex->IsScanComplete())
+  {
+    this->SetStatus(StatusCompleted);
+    return true;
+  }
+
+  int numberOfClustersPerScan = std::max(1, this->NumberOfClustersPerScan);
+  this->Internal->Thread = std::thread([=]()
+  {
+    vtkInternal* internal = this->Internal;
+    while (!internal->CancelRequested)
+    {
+      int numberOfClusters = 0;
+      bool scanComplete = false;
+      {
+        std::lock_guard<std::mutex> lock(internal->IndexMutex);
+        numberOfClusters = internal->FrameIndex->ScanClusters(numberOfClustersPerScan);
+        scanComplete = internal->FrameIndex->IsScanComplete();
+      }
+      if (numberOfClusters < 0)
+      {
+        internal->ScanFailed = true;
+        break;
+      }
+      if (scanComplete)
+      {
+        break;
+      }
+      // Let the main thread add the indexed frames
+      std::this_thread::yield();
+    }
+    internal->ScanFinished = true;
+  });
+
+  this->SetStatus(StatusRunning);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::Cancel()
+{
+  if (!this->IsRunning())
+  {
+    return;
+  }
+  this->Internal->CancelRequested = true;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvProgressiveLoader::Update()
+{
+  if (!this->IsRunning())
+  {
+    return this->Internal->Status;
+  }
+
+  if (!this->Internal->VideoSequenceNode)
+  {
+    // The sequence was deleted (ex. the scene was closed)
+    this->Internal->CancelRequested = true;
+  }
+
+  bool loadingComplete = false;
+  {
+    std::unique_lock<std::mutex> lock(this->Internal->IndexMutex, std::try_to_lock);
+    if (lock.owns_lock() && !this->Internal->CancelRequested)
+    {
+      this->AppendIndexedFrames();
+      loadingComplete = this->Internal->ScanFinished
+        && this->Internal->NumberOfLoadedFrames >= this->Internal->FrameIndex->GetNumberOfFrames(this->Internal->VideoTrackNumber);
+    }
+  }
+
+  if (loadingComplete || this->Internal->CancelRequested)
+  {
+    this->Finish();
+  }
+  return this->Internal->Status;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::AppendIndexedFrames()
+{
+  vtkSlicerIGSIOMkvFrameIndex* frameIndex = this->Internal->FrameIndex;
+  int startFrame = this->Internal->NumberOfLoadedFrames;
+  int endFrame = std::min(frameIndex->GetNumberOfFrames(this->Internal->VideoTrackNumber),
+    startFrame + std::max(1, this->MaximumNumberOfFramesPerUpdate)) - 1;
+  if (endFrame < startFrame)
+  {
+    return;
+  }
+
+  if (!vtkSlicerIGSIOCommon::AppendMkvFramesToVolumeSequence(frameIndex, this->Internal->VideoSequenceNode, this->Internal->VideoTrackNumber,
+    startFrame, endFrame, this->Internal->PreviousFrame))
+  {
+    this->Internal->ScanFailed = true;
+    this->Internal->CancelRequested = true;
+    return;
+  }
+
+  std::map<std::string, vtkWeakPointer<vtkMRMLSequenceNode> >::iterator transformSequenceIt;
+  for (transformSequenceIt = this->Internal->TransformSequenceNodes.begin();
+    transformSequenceIt != this->Internal->TransformSequenceNodes.end(); ++transformSequenceIt)
+  {
+    if (transformSequenceIt->second)
+    {
+      vtkSlicerIGSIOCommon::AppendMkvTransforms(frameIndex, this->Internal->VideoTrackNumber, transformSequenceIt->first,
+        startFrame, endFrame, transformSequenceIt->second, NULL);
+    }
+  }
+  std::map<std::string, vtkSmartPointer<vtkSlicerIGSIOTransformTrack> >::iterator transformTrackIt;
+  for (transformTrackIt = this->Internal->TransformTracksByName.begin();
+    transformTrackIt != this->Internal->TransformTracksByName.end(); ++transformTrackIt)
+  {
+    vtkSlicerIGSIOCommon::AppendMkvTransforms(frameIndex, this->Internal->VideoTrackNumber, transformTrackIt->first,
+      startFrame, endFrame, NULL, transformTrackIt->second);
+  }
+
+  this->Internal->NumberOfLoadedFrames = endFrame + 1;
+  this->Internal->LastTimestamp = frameIndex->GetTrack(this->Internal->VideoTrackNumber)->Frames[endFrame].Timestamp;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::Finish()
+{
+  if (this->Internal->Thread.joinable())
+  {
+    this->Internal->Thread.join();
+  }
+
+  int status = StatusCompleted;
+  if (this->Internal->ScanFailed)
+  {
+    status = StatusFailed;
+  }
+  else if (this->Internal->CancelRequested)
+  {
+    status = StatusCancelled;
+  }
+  this->SetStatus(status);
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvProgressiveLoader::Wait()
+{
+  while (this->IsRunning())
+  {
+    if (this->Update() == StatusRunning && !this->Internal->ScanFinished)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  return this->Internal->Status;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvProgressiveLoader::SetStatus(int status)
+{
+  if (this->Internal->Status == status)
+  {
+    return;
+  }
+  this->Internal->Status = status;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvProgressiveLoader::GetStatus()
+{
+  return this->Internal->Status;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkSlicerIGSIOMkvProgressiveLoader::GetStatusAsString(int status)
+{
+  switch (status)
+  {
+  case StatusIdle: return "Idle";
+  case StatusRunning: return "Running";
+  case StatusCompleted: return "Completed";
+  case StatusFailed: return "Failed";
+  case StatusCancelled: return "Cancelled";
+  default: return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvProgressiveLoader::IsRunning()
+{
+  return this->Internal->Status == StatusRunning;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSequenceNode* vtkSlicerIGSIOMkvProgressiveLoader::GetVideoSequenceNode()
+{
+  return this->Internal->VideoSequenceNode;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOMkvProgressiveLoader::GetNumberOfLoadedFrames()
+{
+  return this->Internal->NumberOfLoadedFrames;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOMkvProgressiveLoader::GetProgress()
+{
+  if (this->Internal->Status == StatusCompleted)
+  {
+    return 1.0;
+  }
+  double duration = this->Internal->FrameIndex ? this->Internal->FrameIndex->GetDuration() : 0.0;
+  if (duration <= 0.0)
+  {
+    return 0.0;
+  }
+  return std::max(0.0, std::min(1.0, this->Internal->LastTimestamp / duration));
+}
@@ -0,0 +1,138 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+#ifndef __vtkSlicerIGSIOMkvProgressiveLoader_h
+#define __vtkSlicerIGSIOMkvProgressiveLoader_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <string>
+
+class vtkCollection;
+class vtkMRMLSequenceBrowserNode;
+class vtkMRMLSequenceNode;
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Progressive loading of a Matroska (.mkv/.webm) file into a sequence browser.
+/// Start() only indexes the clusters of the file up to the first video frame, and populates the sequence browser with the frames that
+/// have been found, so the first frame can be shown immediately. The remaining clusters are indexed on a background thread.
+/// Update() must be called periodically from the main thread (ex. from a timer): each call adds a batch of the newly indexed frames
+/// (and transforms) to the end of the sequences, so the frame range of the browser grows while the file is being read.
+/// The video frames are read lazily from the file (see vtkSlicerIGSIOCommon::MkvFrameIndexToVolumeSequence).
+/// ModifiedEvent is invoked when the status of the loader changes.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOMkvProgressiveLoader : public vtkObject
+{
+public:
+  static vtkSlicerIGSIOMkvProgressiveLoader* New();
+  vtkTypeMacro(vtkSlicerIGSIOMkvProgressiveLoader, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum Status
+  {
+    StatusIdle,
+    StatusRunning,
+    StatusCompleted,
+    StatusFailed,
+    StatusCancelled,
+  };
+
+  /// File that is loaded
+  void SetFileName(const std::string& fileName);
+  std::string GetFileName();
+
+  /// Sequence browser that is populated. Must be added to the scene before calling Start().
+  void SetSequenceBrowserNode(vtkMRMLSequenceBrowserNode* sequenceBrowserNode);
+  vtkMRMLSequenceBrowserNode* GetSequenceBrowserNode();
+
+  /// If specified, the transforms are stored in compact vtkSlicerIGSIOTransformTrack objects that are added to the collection,
+  /// instead of in transform sequences (see vtkSlicerIGSIOCommon::MkvFrameIndexToSequenceBrowser)
+  void SetTransformTracks(vtkCollection* transformTracks);
+  vtkCollection* GetTransformTracks();
+
+  /// Number of clusters that the background thread indexes at a time. Default: 16.
+  vtkSetMacro(NumberOfClustersPerScan, int);
+  vtkGetMacro(NumberOfClustersPerScan, int);
+
+  /// Maximum number of frames that are added to the sequences by each call to Update(), which limits the time
+  /// that the main thread is blocked. Default: 500.
+  vtkSetMacro(MaximumNumberOfFramesPerUpdate, int);
+  vtkGetMacro(MaximumNumberOfFramesPerUpdate, int);
+
+  /// Read the header and the first video frame of the file, populate the sequence browser, and start indexing the rest of the file
+  /// on a background thread. Must be called on the main thread.
+  /// \return False if the file cannot be loaded progressively (ex. no codec is available for the video track),
+  ///   in which case the file should be read fully.
+  bool Start();
+
+  /// Stop indexing the file. The frames that have already been added to the sequences are kept.
+  /// The status changes to StatusCancelled on the next call to Update().
+  void Cancel();
+
+  /// Add the frames that have been indexed since the last update to the sequences. Must be called on the main thread.
+  /// Does not wait for the background thread: if it is currently indexing, the frames are added on the next call.
+  /// \return The status of the loader
+  int Update();
+
+  /// Block until the whole file has been indexed and all frames have been added to the sequences
+  int Wait();
+
+  int GetStatus();
+  static const char* GetStatusAsString(int status);
+  bool IsRunning();
+
+  /// Sequence that contains the video frames
+  vtkMRMLSequenceNode* GetVideoSequenceNode();
+
+  /// Number of video frames that have been added to the video sequence (including frames that are skipped in the file)
+  int GetNumberOfLoadedFrames();
+
+  /// Fraction of the duration of the file that has been loaded (between 0 and 1). 0 if the file does not specify its duration.
+  double GetProgress();
+
+protected:
+  vtkSlicerIGSIOMkvProgressiveLoader();
+  ~vtkSlicerIGSIOMkvProgressiveLoader();
+
+  void SetStatus(int status);
+
+  /// Add the next batch of indexed frames to the sequences. Must be called with the index locked.
+  void AppendIndexedFrames();
+
+  /// Join the background thread and set the final status
+  void Finish();
+
+  int NumberOfClustersPerScan;
+  int MaximumNumberOfFramesPerUpdate;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOMkvProgressiveLoader(const vtkSlicerIGSIOMkvProgressiveLoader&); // Not implemented
+  void operator=(const vtkSlicerIGSIOMkvProgressiveLoader&);                     // Not implemented
+};
+
+#endif
@@ -0,0 +1,183 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOInstrumentation.h"
+#include "vtkSlicerIGSIOMkvFrameIndex.h"
+#include "vtkSlicerIGSIOMkvStreamingVolumeFrame.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+// Number of ScopedFrameDataAccess instances, across all threads
+static int NumberOfFrameDataAccesses = 0;
+static std::mutex FrameDataAccessMutex;
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvStreamingVolumeFrame::ScopedFrameDataAccess::ScopedFrameDataAccess()
+{
+  std::lock_guard<std::mutex> lock(FrameDataAccessMutex);
+  ++NumberOfFrameDataAccesses;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvStreamingVolumeFrame::ScopedFrameDataAccess::~ScopedFrameDataAccess()
+{
+  std::lock_guard<std::mutex> lock(FrameDataAccessMutex);
+  --NumberOfFrameDataAccesses;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOMkvStreamingVolumeFrame);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvStreamingVolumeFrame::vtkSlicerIGSIOMkvStreamingVolumeFrame()
+  : FrameIndex(NULL)
+  , PayloadOffset(-1)
+  , PayloadSize(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOMkvStreamingVolumeFrame::~vtkSlicerIGSIOMkvStreamingVolumeFrame()
+{
+  if (this->FrameIndex)
+  {
+    this->FrameIndex->UnRegister(this);
+    this->FrameIndex = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvStreamingVolumeFrame::SetFrameLocation(vtkSlicerIGSIOMkvFrameIndex* frameIndex, long long offset, unsigned int size)
+{
+  std::lock_guard<std::mutex> lock(this->LoadMutex);
+  if (this->FrameIndex != frameIndex)
+  {
+    if (frameIndex)
+    {
+      frameIndex->Register(this);
+    }
+    if (this->FrameIndex)
+    {
+      this->FrameIndex->UnRegister(this);
+    }
+    this->FrameIndex = frameIndex;
+  }
+  this->PayloadOffset = offset;
+  this->PayloadSize = size;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkUnsignedCharArray* vtkSlicerIGSIOMkvStreamingVolumeFrame::GetFrameData()
+{
+  std::lock_guard<std::mutex> lock(this->LoadMutex);
+  if (!this->FrameData && this->FrameIndex)
+  {
+    vtkSlicerIGSIOInstrumentation::ScopedTimer timer("ReadFrameData");
+    vtkSmartPointer<vtkUnsignedCharArray> frameData = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    if (!this->FrameIndex->ReadFrameData(this->PayloadOffset, this->PayloadSize, frameData))
+    {
+      vtkErrorMacro("GetFrameData: Could not read frame data from file: " << this->FrameIndex->GetFileName());
+      return NULL;
+    }
+    // Loading the payload does not change the content of the frame, so Modified() is not invoked
+    this->FrameData = frameData;
+    this->FrameData->Register(this);
+  }
+  return this->FrameData;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvStreamingVolumeFrame::IsFrameDataLoaded()
+{
+  std::lock_guard<std::mutex> lock(this->LoadMutex);
+  return this->FrameData != NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvStreamingVolumeFrame::ReleaseFrameData()
+{
+  std::lock_guard<std::mutex> lock(this->LoadMutex);
+  if (!this->FrameIndex || !this->FrameData)
+  {
+    // Frame data cannot be read again
+    return;
+  }
+  this->FrameData->UnRegister(this);
+  this->FrameData = NULL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvStreamingVolumeFrame::ReleaseFrameData(const std::vector<vtkSlicerIGSIOMkvStreamingVolumeFrame*>& frames)
+{
+  // The access mutex is held while the payloads are released, so that no decoding can start in the meantime
+  std::lock_guard<std::mutex> lock(FrameDataAccessMutex);
+  if (NumberOfFrameDataAccesses > 0)
+  {
+    return false;
+  }
+  for (std::vector<vtkSlicerIGSIOMkvStreamingVolumeFrame*>::const_iterator frameIt = frames.begin(); frameIt != frames.end(); ++frameIt)
+  {
+    if (*frameIt)
+    {
+      (*frameIt)->ReleaseFrameData();
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOMkvStreamingVolumeFrame::LoadFrameData()
+{
+  if (!this->GetFrameData())
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(this->LoadMutex);
+  if (this->FrameIndex)
+  {
+    this->FrameIndex->UnRegister(this);
+    this->FrameIndex = NULL;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOMkvStreamingVolumeFrame::GetFileName()
+{
+  std::lock_guard<std::mutex> lock(this->LoadMutex);
+  return this->FrameIndex ? this->FrameIndex->GetFileName() : "";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOMkvStreamingVolumeFrame::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << (this->FrameIndex ? this->FrameIndex->GetFileName() : "") << "\n";
+  os << indent << "PayloadOffset: " << this->PayloadOffset << "\n";
+  os << indent << "PayloadSize: " << this->PayloadSize << "\n";
+  os << indent << "FrameDataLoaded: " << (this->FrameData ? "true" : "false") << "\n";
+}
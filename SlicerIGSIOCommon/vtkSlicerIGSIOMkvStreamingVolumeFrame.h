@@ -0,0 +1,104 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+#ifndef __vtkSlicerIGSIOMkvStreamingVolumeFrame_h
+#define __vtkSlicerIGSIOMkvStreamingVolumeFrame_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// STD includes
+#include <mutex>
+#include <string>
+#include <vector>
+
+class vtkSlicerIGSIOMkvFrameIndex;
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Encoded frame whose payload is stored in a Matroska file.
+/// Only the location of the payload is stored in the frame until the frame data is requested using GetFrameData(),
+/// at which point the payload is read from the file using the frame index.
+/// Payloads that are no longer needed can be released using ReleaseFrameData(frames), and are read again when the frame is decoded.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOMkvStreamingVolumeFrame : public vtkStreamingVolumeFrame
+{
+public:
+  static vtkSlicerIGSIOMkvStreamingVolumeFrame* New();
+  vtkTypeMacro(vtkSlicerIGSIOMkvStreamingVolumeFrame, vtkStreamingVolumeFrame);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Set the location of the frame payload within the indexed file
+  void SetFrameLocation(vtkSlicerIGSIOMkvFrameIndex* frameIndex, long long offset, unsigned int size);
+
+  /// Returns the encoded frame data. The payload is read from the file if it has not been loaded yet.
+  vtkUnsignedCharArray* GetFrameData() VTK_OVERRIDE;
+
+  /// Returns true if the payload has been read from the file
+  bool IsFrameDataLoaded();
+
+  /// Remove the loaded payload from memory.
+  /// The payload will be read from the file again the next time GetFrameData() is called.
+  /// The frame data returned by GetFrameData() is deleted, so this must not be called while the frame may be decoded on another thread
+  /// (use ReleaseFrameData(frames) instead).
+  void ReleaseFrameData();
+
+  /// Remove the loaded payloads of the frames from memory, if no frames are being decoded (see ScopedFrameDataAccess).
+  /// \return False if frames are being decoded, in which case no payloads are released
+  static bool ReleaseFrameData(const std::vector<vtkSlicerIGSIOMkvStreamingVolumeFrame*>& frames);
+
+  /// Prevents payloads from being released by ReleaseFrameData(frames) while the frame data is accessed, for example while frames are decoded.
+  /// Can be used from any thread.
+  class VTK_SLICERIGSIOCOMMON_EXPORT ScopedFrameDataAccess
+  {
+  public:
+    ScopedFrameDataAccess();
+    ~ScopedFrameDataAccess();
+  private:
+    ScopedFrameDataAccess(const ScopedFrameDataAccess&); // Not implemented
+    void operator=(const ScopedFrameDataAccess&);        // Not implemented
+  };
+
+  /// Read the payload from the file and detach the frame from the file.
+  /// Should be called before the file containing the payload is overwritten.
+  bool LoadFrameData();
+
+  /// Name of the file containing the payload, or an empty string if the frame is not attached to a file
+  std::string GetFileName();
+
+  vtkGetMacro(PayloadOffset, long long);
+  vtkGetMacro(PayloadSize, unsigned int);
+
+protected:
+  vtkSlicerIGSIOMkvStreamingVolumeFrame();
+  ~vtkSlicerIGSIOMkvStreamingVolumeFrame();
+
+  vtkSlicerIGSIOMkvFrameIndex* FrameIndex;
+  long long PayloadOffset;
+  unsigned int PayloadSize;
+  std::mutex LoadMutex;
+
+private:
+  vtkSlicerIGSIOMkvStreamingVolumeFrame(const vtkSlicerIGSIOMkvStreamingVolumeFrame&); // Not implemented
+  void operator=(const vtkSlicerIGSIOMkvStreamingVolumeFrame&);                        // Not implemented
+};
+
+#endif
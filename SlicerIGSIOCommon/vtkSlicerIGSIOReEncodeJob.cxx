@@ -0,0 +1,403 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOReEncodeJob.h"
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// MRML includes
+#include <vtkMRMLSequenceNode.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOReEncodeJob::vtkInternal
+{
+public:
+  vtkInternal()
+    : Status(StatusIdle)
+    , StartIndex(0)
+    , NumberOfFrames(0)
+    , NumberOfProcessedFrames(0)
+    , CancelRequested(false)
+    , Finished(false)
+    , Success(false)
+    , ElapsedTime(0.0)
+  {
+  }
+
+  double GetElapsedSeconds()
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->StartTime).count();
+  }
+
+  vtkWeakPointer<vtkMRMLSequenceNode> SequenceNode;
+  std::string CodecFourCC;
+  std::map<std::string, std::string> CodecParameters;
+
+  int Status;
+
+  /// Item number of the first frame of the snapshot
+  int StartIndex;
+  int NumberOfFrames;
+  std::vector<vtkSlicerIGSIOCommon::TranscodingSourceFrame> SourceFrames;
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > EncodedFrames;
+  vtkSlicerIGSIOCommon::TranscodingStatistics Statistics;
+
+  std::thread Thread;
+  std::atomic<int> NumberOfProcessedFrames;
+  std::atomic<bool> CancelRequested;
+  /// Set by the worker thread once EncodedFrames, Statistics and Success are final
+  std::atomic<bool> Finished;
+  bool Success;
+
+  std::chrono::steady_clock::time_point StartTime;
+  /// Total duration of the job, once it has finished
+  double ElapsedTime;
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOReEncodeJob);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOReEncodeJob::vtkSlicerIGSIOReEncodeJob()
+  : StartIndex(0)
+  , EndIndex(-1)
+  , ForceReEncoding(false)
+  , MinimalReEncoding(false)
+  , NumberOfThreads(0)
+  , Internal(new vtkInternal())
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOReEncodeJob::~vtkSlicerIGSIOReEncodeJob()
+{
+  // The worker thread accesses the job, so it must finish before the job is deleted
+  this->Internal->CancelRequested = true;
+  if (this->Internal->Thread.joinable())
+  {
+    this->Internal->Thread.join();
+  }
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SequenceNode: " << this->Internal->SequenceNode.GetPointer() << std::endl;
+  os << indent << "StartIndex: " << this->StartIndex << std::endl;
+  os << indent << "EndIndex: " << this->EndIndex << std::endl;
+  os << indent << "CodecFourCC: " << this->Internal->CodecFourCC << std::endl;
+  os << indent << "ForceReEncoding: " << (this->ForceReEncoding ? "true" : "false") << std::endl;
+  os << indent << "MinimalReEncoding: " << (this->MinimalReEncoding ? "true" : "false") << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+  os << indent << "Status: " << GetStatusAsString(this->Internal->Status) << std::endl;
+  os << indent << "NumberOfFrames: " << this->GetNumberOfFrames() << std::endl;
+  os << indent << "NumberOfProcessedFrames: " << this->GetNumberOfProcessedFrames() << std::endl;
+  os << indent << "ElapsedTime: " << this->GetElapsedTime() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::SetSequenceNode(vtkMRMLSequenceNode* sequenceNode)
+{
+  if (this->Internal->SequenceNode == sequenceNode)
+  {
+    return;
+  }
+  this->Internal->SequenceNode = sequenceNode;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSequenceNode* vtkSlicerIGSIOReEncodeJob::GetSequenceNode()
+{
+  return this->Internal->SequenceNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::SetCodecFourCC(const std::string& codecFourCC)
+{
+  if (this->Internal->CodecFourCC == codecFourCC)
+  {
+    return;
+  }
+  this->Internal->CodecFourCC = codecFourCC;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOReEncodeJob::GetCodecFourCC()
+{
+  return this->Internal->CodecFourCC;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::SetCodecParameter(const std::string& name, const std::string& value)
+{
+  this->Internal->CodecParameters[name] = value;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::SetCodecParameters(const std::map<std::string, std::string>& parameters)
+{
+  this->Internal->CodecParameters = parameters;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::RemoveAllCodecParameters()
+{
+  this->Internal->CodecParameters.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOReEncodeJob::Start()
+{
+  if (this->IsRunning())
+  {
+    vtkErrorMacro("Start: Re-encoding is already running");
+    return false;
+  }
+
+  vtkMRMLSequenceNode* sequenceNode = this->Internal->SequenceNode;
+  if (!sequenceNode)
+  {
+    vtkErrorMacro("Start: Invalid sequence node");
+    return false;
+  }
+
+  int endIndex = this->EndIndex;
+  if (endIndex < 0)
+  {
+    endIndex = sequenceNode->GetNumberOfDataNodes() - 1;
+  }
+
+  this->Internal->StartIndex = this->StartIndex;
+  this->Internal->EncodedFrames.clear();
+  this->Internal->Statistics = vtkSlicerIGSIOCommon::TranscodingStatistics();
+  this->Internal->NumberOfProcessedFrames = 0;
+  this->Internal->CancelRequested = false;
+  this->Internal->Finished = false;
+  this->Internal->Success = false;
+  this->Internal->ElapsedTime = 0.0;
+  this->Internal->StartTime = std::chrono::steady_clock::now();
+  if (!vtkSlicerIGSIOCommon::GetTranscodingSourceFrames(sequenceNode, this->StartIndex, endIndex, this->Internal->SourceFrames))
+  {
+    this->Internal->NumberOfFrames = 0;
+    this->SetStatus(StatusFailed);
+    return false;
+  }
+  this->Internal->NumberOfFrames = (int)this->Internal->SourceFrames.size();
+
+  // The parameters are copied, so that they can be changed while the job is running
+  std::string codecFourCC = this->Internal->CodecFourCC;
+  std::map<std::string, std::string> codecParameters = this->Internal->CodecParameters;
+  bool forceReEncoding = this->ForceReEncoding;
+  bool minimalReEncoding = this->MinimalReEncoding;
+  int numberOfThreads = this->NumberOfThreads;
+  this->Internal->Thread = std::thread([=]()
+  {
+    vtkInternal* internal = this->Internal;
+    internal->Success = vtkSlicerIGSIOCommon::ReEncodeSourceFrames(this, internal->SourceFrames, codecFourCC, codecParameters,
+      forceReEncoding, minimalReEncoding, numberOfThreads, internal->EncodedFrames, &internal->Statistics,
+      &internal->NumberOfProcessedFrames, &internal->CancelRequested);
+    internal->Finished = true;
+  });
+
+  this->SetStatus(StatusRunning);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::Cancel()
+{
+  if (!this->IsRunning())
+  {
+    return;
+  }
+  this->Internal->CancelRequested = true;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOReEncodeJob::Update()
+{
+  if (!this->IsRunning() || !this->Internal->Finished)
+  {
+    return this->Internal->Status;
+  }
+
+  this->Internal->Thread.join();
+  this->Internal->ElapsedTime = this->Internal->GetElapsedSeconds();
+
+  int status = StatusFailed;
+  if (this->Internal->CancelRequested)
+  {
+    status = StatusCancelled;
+  }
+  else if (this->Internal->Success)
+  {
+    vtkMRMLSequenceNode* sequenceNode = this->Internal->SequenceNode;
+    if (!sequenceNode)
+    {
+      vtkErrorMacro("Update: Sequence node was deleted while it was being encoded");
+    }
+    else if (vtkSlicerIGSIOCommon::SetEncodedFrames(sequenceNode, this->Internal->StartIndex,
+      this->Internal->EncodedFrames, &this->Internal->SourceFrames))
+    {
+      status = StatusCompleted;
+    }
+  }
+
+  // The snapshot keeps the original frames alive, so it is released as soon as the job has finished
+  this->Internal->SourceFrames.clear();
+  this->Internal->EncodedFrames.clear();
+  this->SetStatus(status);
+  return status;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOReEncodeJob::Wait()
+{
+  if (this->IsRunning())
+  {
+    while (!this->Internal->Finished)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  return this->Update();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOReEncodeJob::SetStatus(int status)
+{
+  if (this->Internal->Status == status)
+  {
+    return;
+  }
+  this->Internal->Status = status;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOReEncodeJob::GetStatus()
+{
+  return this->Internal->Status;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkSlicerIGSIOReEncodeJob::GetStatusAsString(int status)
+{
+  switch (status)
+  {
+  case StatusIdle: return "Idle";
+  case StatusRunning: return "Running";
+  case StatusCompleted: return "Completed";
+  case StatusFailed: return "Failed";
+  case StatusCancelled: return "Cancelled";
+  default: return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOReEncodeJob::IsRunning()
+{
+  return this->Internal->Status == StatusRunning;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOReEncodeJob::GetNumberOfFrames()
+{
+  return this->Internal->NumberOfFrames;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOReEncodeJob::GetNumberOfProcessedFrames()
+{
+  return this->Internal->NumberOfProcessedFrames;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOReEncodeJob::GetProgress()
+{
+  if (this->Internal->Status == StatusCompleted)
+  {
+    return 1.0;
+  }
+  int numberOfFrames = this->GetNumberOfFrames();
+  if (numberOfFrames == 0)
+  {
+    return 0.0;
+  }
+  return std::min(1.0, this->GetNumberOfProcessedFrames() / (double)numberOfFrames);
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOReEncodeJob::GetElapsedTime()
+{
+  if (this->Internal->Status == StatusIdle)
+  {
+    return 0.0;
+  }
+  if (this->IsRunning())
+  {
+    return this->Internal->GetElapsedSeconds();
+  }
+  return this->Internal->ElapsedTime;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOReEncodeJob::GetFramesPerSecond()
+{
+  double elapsedTime = this->GetElapsedTime();
+  if (elapsedTime <= 0.0)
+  {
+    return 0.0;
+  }
+  return this->GetNumberOfProcessedFrames() / elapsedTime;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOCommon::TranscodingStatistics vtkSlicerIGSIOReEncodeJob::GetStatistics()
+{
+  if (this->IsRunning())
+  {
+    return vtkSlicerIGSIOCommon::TranscodingStatistics();
+  }
+  return this->Internal->Statistics;
+}
@@ -0,0 +1,149 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+#ifndef __vtkSlicerIGSIOReEncodeJob_h
+#define __vtkSlicerIGSIOReEncodeJob_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <map>
+#include <string>
+
+class vtkMRMLSequenceNode;
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Re-encoding of a video sequence on a background thread.
+/// Start() takes a snapshot of the frames of the sequence, and encodes the snapshot on a worker thread (see vtkSlicerIGSIOCommon::ReEncodeSourceFrames),
+/// so the scene remains responsive while the frames are encoded. The sequence is not modified until the job is complete:
+/// Update() must be called periodically from the main thread (ex. from a timer), and once encoding has finished, the encoded frames are
+/// swapped into the streaming volume nodes of the sequence in a single modification.
+/// If any of the encoded items of the sequence were changed in the meantime, the encoded frames are discarded and the job fails.
+/// ModifiedEvent is invoked when the status of the job changes.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOReEncodeJob : public vtkObject
+{
+public:
+  static vtkSlicerIGSIOReEncodeJob* New();
+  vtkTypeMacro(vtkSlicerIGSIOReEncodeJob, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum Status
+  {
+    StatusIdle,
+    StatusRunning,
+    StatusCompleted,
+    StatusFailed,
+    StatusCancelled,
+  };
+
+  /// Sequence of vtkMRMLStreamingVolumeNode that is re-encoded. The sequence is not kept alive by the job.
+  void SetSequenceNode(vtkMRMLSequenceNode* sequenceNode);
+  vtkMRMLSequenceNode* GetSequenceNode();
+
+  /// Range of items that are re-encoded. If EndIndex is negative (default), the last item of the sequence is used.
+  vtkSetMacro(StartIndex, int);
+  vtkGetMacro(StartIndex, int);
+  vtkSetMacro(EndIndex, int);
+  vtkGetMacro(EndIndex, int);
+
+  /// FourCC of the codec. If empty (default), the codec of the sequence is used.
+  void SetCodecFourCC(const std::string& codecFourCC);
+  std::string GetCodecFourCC();
+
+  /// Parameters of the codec
+  void SetCodecParameter(const std::string& name, const std::string& value);
+  void SetCodecParameters(const std::map<std::string, std::string>& parameters);
+  void RemoveAllCodecParameters();
+
+  /// See vtkSlicerIGSIOCommon::ReEncodeVideoSequence
+  vtkSetMacro(ForceReEncoding, bool);
+  vtkGetMacro(ForceReEncoding, bool);
+  vtkBooleanMacro(ForceReEncoding, bool);
+  vtkSetMacro(MinimalReEncoding, bool);
+  vtkGetMacro(MinimalReEncoding, bool);
+  vtkBooleanMacro(MinimalReEncoding, bool);
+
+  /// Number of threads used to encode the frame blocks. 0 or less (default) uses one thread per available core.
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Take a snapshot of the frames of the sequence and start encoding it on a background thread. Must be called on the main thread.
+  /// \return False if the job is already running or the frames cannot be read
+  bool Start();
+
+  /// Request the job to stop. The sequence is not modified. The status changes to StatusCancelled on the next call to Update().
+  void Cancel();
+
+  /// Check if the background encoding has finished, and if it has, set the encoded frames in the sequence.
+  /// Must be called on the main thread.
+  /// \return The status of the job
+  int Update();
+
+  /// Block until the background encoding has finished and call Update()
+  int Wait();
+
+  int GetStatus();
+  static const char* GetStatusAsString(int status);
+  bool IsRunning();
+
+  /// Number of frames in the snapshot
+  int GetNumberOfFrames();
+
+  /// Number of frames that have been encoded so far. Frames that do not need to be re-encoded are not counted.
+  int GetNumberOfProcessedFrames();
+
+  /// Fraction of the frames that have been encoded (between 0 and 1)
+  double GetProgress();
+
+  /// Time since the job was started, or the total duration of the job if it has finished (in seconds)
+  double GetElapsedTime();
+
+  /// Average number of frames encoded per second
+  double GetFramesPerSecond();
+
+  /// Statistics of the transcoding pipeline, once the job has finished
+  vtkSlicerIGSIOCommon::TranscodingStatistics GetStatistics();
+
+protected:
+  vtkSlicerIGSIOReEncodeJob();
+  ~vtkSlicerIGSIOReEncodeJob();
+
+  void SetStatus(int status);
+
+  int StartIndex;
+  int EndIndex;
+  bool ForceReEncoding;
+  bool MinimalReEncoding;
+  int NumberOfThreads;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOReEncodeJob(const vtkSlicerIGSIOReEncodeJob&); // Not implemented
+  void operator=(const vtkSlicerIGSIOReEncodeJob&);            // Not implemented
+};
+
+#endif
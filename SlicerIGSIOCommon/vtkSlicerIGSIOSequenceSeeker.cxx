@@ -0,0 +1,411 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOCommon.h"
+#include "vtkSlicerIGSIOSequenceSeeker.h"
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodec.h>
+#include <vtkStreamingVolumeCodecFactory.h>
+#include <vtkStreamingVolumeFrame.h>
+
+// MRML includes
+#include <vtkMRMLSequenceNode.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <map>
+#include <stack>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOSequenceSeeker::vtkInternal
+{
+public:
+  vtkInternal()
+    : IndexMTime(0)
+    , LastDecodedFrameMTime(0)
+    , LastDecodedItemNumber(-1)
+    , LastSeekNumberOfDecodedFrames(0)
+    , TotalNumberOfDecodedFrames(0)
+  {
+  }
+
+  void ResetDecoder()
+  {
+    this->Codec = NULL;
+    this->LastDecodedFrame = NULL;
+    this->LastDecodedFrameMTime = 0;
+    this->LastDecodedItemNumber = -1;
+  }
+
+  /// Returns true if the item still contains the data node and the encoded frame that were indexed, and the frame has
+  /// not been modified since
+  bool IsItemUpToDate(int itemNumber)
+  {
+    const IndexedItem& item = this->Items[itemNumber];
+    vtkMRMLNode* dataNode = this->SequenceNode->GetNthDataNode(itemNumber);
+    if (dataNode != item.DataNode.GetPointer())
+    {
+      return false;
+    }
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(dataNode);
+    vtkStreamingVolumeFrame* frame = streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL;
+    return frame == item.Frame && (!frame || frame->GetMTime() == item.FrameMTime);
+  }
+
+  struct IndexedItem
+  {
+    vtkWeakPointer<vtkMRMLNode> DataNode;
+    /// Encoded frame of the item (NULL if the item does not contain an encoded frame)
+    vtkSmartPointer<vtkStreamingVolumeFrame> Frame;
+    vtkMTimeType FrameMTime;
+  };
+
+  vtkWeakPointer<vtkMRMLSequenceNode> SequenceNode;
+  vtkMTimeType IndexMTime;
+
+  /// Indexed data node and encoded frame of each item in the sequence
+  std::vector<IndexedItem> Items;
+  /// Item number of each encoded frame in the sequence
+  std::map<vtkStreamingVolumeFrame*, int> FrameItemNumbers;
+  /// Sorted item numbers of the items that contain a keyframe
+  std::vector<int> KeyFrameItemNumbers;
+
+  vtkSmartPointer<vtkStreamingVolumeCodec> Codec;
+  vtkSmartPointer<vtkImageData> ImageData;
+  vtkSmartPointer<vtkStreamingVolumeFrame> LastDecodedFrame;
+  vtkMTimeType LastDecodedFrameMTime;
+  int LastDecodedItemNumber;
+
+  int LastSeekNumberOfDecodedFrames;
+  int TotalNumberOfDecodedFrames;
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOSequenceSeeker);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOSequenceSeeker::vtkSlicerIGSIOSequenceSeeker()
+  : Internal(new vtkInternal())
+{
+  this->Internal->ImageData = vtkSmartPointer<vtkImageData>::New();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOSequenceSeeker::~vtkSlicerIGSIOSequenceSeeker()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOSequenceSeeker::SetSequenceNode(vtkMRMLSequenceNode* sequenceNode)
+{
+  if (this->Internal->SequenceNode == sequenceNode)
+  {
+    return;
+  }
+  this->Internal->SequenceNode = sequenceNode;
+  this->UpdateKeyFrameIndex();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSequenceNode* vtkSlicerIGSIOSequenceSeeker::GetSequenceNode()
+{
+  return this->Internal->SequenceNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOSequenceSeeker::UpdateKeyFrameIndex()
+{
+  this->Internal->Items.clear();
+  this->Internal->FrameItemNumbers.clear();
+  this->Internal->KeyFrameItemNumbers.clear();
+
+  vtkMRMLSequenceNode* sequenceNode = this->Internal->SequenceNode;
+  if (!sequenceNode)
+  {
+    this->Internal->IndexMTime = 0;
+    this->Internal->ResetDecoder();
+    return;
+  }
+
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkInternal::IndexedItem item;
+    item.DataNode = sequenceNode->GetNthDataNode(i);
+    item.FrameMTime = 0;
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(item.DataNode);
+    if (streamingVolumeNode)
+    {
+      item.Frame = streamingVolumeNode->GetFrame();
+    }
+    if (item.Frame)
+    {
+      item.FrameMTime = item.Frame->GetMTime();
+      this->Internal->FrameItemNumbers[item.Frame] = i;
+      if (item.Frame->IsKeyFrame())
+      {
+        this->Internal->KeyFrameItemNumbers.push_back(i);
+      }
+    }
+    this->Internal->Items.push_back(item);
+  }
+  this->Internal->IndexMTime = sequenceNode->GetMTime();
+
+  // Decoding can only continue from the last decoded frame if it is still in the same item and has not been modified
+  int lastDecodedItemNumber = this->Internal->LastDecodedItemNumber;
+  if (lastDecodedItemNumber < 0 || lastDecodedItemNumber >= (int)this->Internal->Items.size()
+    || this->Internal->Items[lastDecodedItemNumber].Frame != this->Internal->LastDecodedFrame
+    || this->Internal->Items[lastDecodedItemNumber].FrameMTime != this->Internal->LastDecodedFrameMTime)
+  {
+    this->Internal->ResetDecoder();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOSequenceSeeker::UpdateKeyFrameIndexIfModified()
+{
+  vtkMRMLSequenceNode* sequenceNode = this->Internal->SequenceNode;
+  if (!sequenceNode)
+  {
+    if (!this->Internal->Items.empty())
+    {
+      // The sequence has been deleted
+      this->UpdateKeyFrameIndex();
+    }
+    return;
+  }
+  if (sequenceNode->GetMTime() > this->Internal->IndexMTime || sequenceNode->GetNumberOfDataNodes() != (int)this->Internal->Items.size())
+  {
+    this->UpdateKeyFrameIndex();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOSequenceSeeker::UpdateKeyFrameIndexIfItemsModified(int firstItemNumber, int lastItemNumber)
+{
+  this->UpdateKeyFrameIndexIfModified();
+  firstItemNumber = std::max(firstItemNumber, 0);
+  lastItemNumber = std::min(lastItemNumber, (int)this->Internal->Items.size() - 1);
+  for (int itemNumber = firstItemNumber; itemNumber <= lastItemNumber; ++itemNumber)
+  {
+    if (!this->Internal->IsItemUpToDate(itemNumber))
+    {
+      this->UpdateKeyFrameIndex();
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOSequenceSeeker::GetNumberOfKeyFrames()
+{
+  this->UpdateKeyFrameIndexIfModified();
+  return (int)this->Internal->KeyFrameItemNumbers.size();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOSequenceSeeker::GetNearestKeyFrameItemNumber(int itemNumber)
+{
+  this->UpdateKeyFrameIndexIfModified();
+  std::vector<int>::iterator keyFrameIt = std::upper_bound(
+    this->Internal->KeyFrameItemNumbers.begin(), this->Internal->KeyFrameItemNumbers.end(), itemNumber);
+  if (keyFrameIt == this->Internal->KeyFrameItemNumbers.begin())
+  {
+    return -1;
+  }
+  --keyFrameIt;
+  return *keyFrameIt;
+}
+
+//----------------------------------------------------------------------------
+vtkStreamingVolumeFrame* vtkSlicerIGSIOSequenceSeeker::GetFrame(int itemNumber)
+{
+  this->UpdateKeyFrameIndexIfItemsModified(itemNumber, itemNumber);
+  if (itemNumber < 0 || itemNumber >= (int)this->Internal->Items.size())
+  {
+    return NULL;
+  }
+  return this->Internal->Items[itemNumber].Frame;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOSequenceSeeker::GetItemNumberOfFrame(vtkStreamingVolumeFrame* frame)
+{
+  if (!frame)
+  {
+    return -1;
+  }
+  this->UpdateKeyFrameIndexIfModified();
+  std::map<vtkStreamingVolumeFrame*, int>::iterator itemNumberIt = this->Internal->FrameItemNumbers.find(frame);
+  if (itemNumberIt == this->Internal->FrameItemNumbers.end())
+  {
+    // The frame may have been set in an item since the keyframe table was built, without modifying the sequence
+    this->UpdateKeyFrameIndex();
+  }
+  else if (!this->UpdateKeyFrameIndexIfItemsModified(itemNumberIt->second, itemNumberIt->second))
+  {
+    return itemNumberIt->second;
+  }
+  itemNumberIt = this->Internal->FrameItemNumbers.find(frame);
+  return itemNumberIt != this->Internal->FrameItemNumbers.end() ? itemNumberIt->second : -1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOSequenceSeeker::Seek(int itemNumber)
+{
+  this->Internal->LastSeekNumberOfDecodedFrames = 0;
+  this->UpdateKeyFrameIndexIfModified();
+
+  if (itemNumber < 0 || itemNumber >= (int)this->Internal->Items.size())
+  {
+    vtkErrorMacro("Seek: Invalid item number: " << itemNumber);
+    return false;
+  }
+
+  // The frames from the nearest keyframe to the requested item are checked, as the data nodes and frames of the items
+  // can be replaced or modified without modifying the sequence
+  this->UpdateKeyFrameIndexIfItemsModified(this->GetNearestKeyFrameItemNumber(itemNumber), itemNumber);
+
+  vtkStreamingVolumeFrame* targetFrame = this->Internal->Items[itemNumber].Frame;
+  if (!targetFrame)
+  {
+    vtkErrorMacro("Seek: No encoded frame at item number: " << itemNumber);
+    return false;
+  }
+
+  if (targetFrame == this->Internal->LastDecodedFrame)
+  {
+    // Already decoded
+    this->Internal->LastDecodedItemNumber = itemNumber;
+    return true;
+  }
+
+  // Decoder state can only be reused if the last decoded frame is between the nearest keyframe and the target frame
+  int keyFrameItemNumber = this->GetNearestKeyFrameItemNumber(itemNumber);
+  bool continueFromLastDecodedFrame = this->Internal->LastDecodedFrame
+    && this->Internal->LastDecodedItemNumber >= keyFrameItemNumber
+    && this->Internal->LastDecodedItemNumber < itemNumber;
+
+  // Frames that are skipped in the sequence are only accessible from the previous frame chain
+  std::stack<vtkStreamingVolumeFrame*> framesToDecode;
+  vtkStreamingVolumeFrame* currentFrame = targetFrame;
+  while (currentFrame)
+  {
+    if (continueFromLastDecodedFrame && currentFrame == this->Internal->LastDecodedFrame)
+    {
+      break;
+    }
+    framesToDecode.push(currentFrame);
+    if (currentFrame->IsKeyFrame())
+    {
+      break;
+    }
+    currentFrame = currentFrame->GetPreviousFrame();
+  }
+
+  if (!currentFrame)
+  {
+    vtkErrorMacro("Seek: Could not find a keyframe preceding item number: " << itemNumber);
+    this->Internal->ResetDecoder();
+    return false;
+  }
+
+  std::string codecFourCC = targetFrame->GetCodecFourCC();
+  if (!this->Internal->Codec || this->Internal->Codec->GetFourCC() != codecFourCC)
+  {
+    this->Internal->Codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+      vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(codecFourCC));
+    if (!this->Internal->Codec)
+    {
+      vtkErrorMacro("Seek: Could not find codec: " << codecFourCC);
+      this->Internal->ResetDecoder();
+      return false;
+    }
+  }
+
+  // Decode the frames one at a time so that each call only decodes a single frame
+  while (!framesToDecode.empty())
+  {
+    vtkStreamingVolumeFrame* frame = framesToDecode.top();
+    framesToDecode.pop();
+    bool saveDecodedImage = framesToDecode.empty();
+    if (!vtkSlicerIGSIOCommon::DecodeFrame(this->Internal->Codec, frame, this->Internal->ImageData, saveDecodedImage))
+    {
+      vtkErrorMacro("Seek: Could not decode frame for item number: " << itemNumber);
+      this->Internal->ResetDecoder();
+      return false;
+    }
+    this->Internal->LastDecodedFrame = frame;
+    this->Internal->LastDecodedFrameMTime = frame->GetMTime();
+    ++this->Internal->LastSeekNumberOfDecodedFrames;
+    ++this->Internal->TotalNumberOfDecodedFrames;
+  }
+
+  this->Internal->LastDecodedItemNumber = itemNumber;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerIGSIOSequenceSeeker::GetImageData()
+{
+  return this->Internal->ImageData;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOSequenceSeeker::GetLastDecodedItemNumber()
+{
+  return this->Internal->LastDecodedItemNumber;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOSequenceSeeker::GetLastSeekNumberOfDecodedFrames()
+{
+  return this->Internal->LastSeekNumberOfDecodedFrames;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOSequenceSeeker::GetTotalNumberOfDecodedFrames()
+{
+  return this->Internal->TotalNumberOfDecodedFrames;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOSequenceSeeker::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SequenceNode: " << (this->Internal->SequenceNode ? this->Internal->SequenceNode->GetID() : "(none)") << "\n";
+  os << indent << "NumberOfKeyFrames: " << this->Internal->KeyFrameItemNumbers.size() << "\n";
+  os << indent << "LastDecodedItemNumber: " << this->Internal->LastDecodedItemNumber << "\n";
+  os << indent << "LastSeekNumberOfDecodedFrames: " << this->Internal->LastSeekNumberOfDecodedFrames << "\n";
+  os << indent << "TotalNumberOfDecodedFrames: " << this->Internal->TotalNumberOfDecodedFrames << "\n";
+}
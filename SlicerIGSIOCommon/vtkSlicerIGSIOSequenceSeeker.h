@@ -0,0 +1,104 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+#ifndef __vtkSlicerIGSIOSequenceSeeker_h
+#define __vtkSlicerIGSIOSequenceSeeker_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkImageData;
+class vtkMRMLSequenceNode;
+class vtkStreamingVolumeFrame;
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Random access decoding of the frames in a streaming volume sequence.
+/// A keyframe table is built for the sequence, which is used to determine the frames that need to be decoded to reach
+/// the requested item. If the requested item is ahead of the last decoded item within the same group of pictures,
+/// decoding continues from the last decoded frame instead of from the preceding keyframe.
+/// The keyframe table is rebuilt automatically if the sequence is modified, or if the data node or the encoded frame of
+/// an item that is accessed has been replaced or modified since the table was built.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOSequenceSeeker : public vtkObject
+{
+public:
+  static vtkSlicerIGSIOSequenceSeeker* New();
+  vtkTypeMacro(vtkSlicerIGSIOSequenceSeeker, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Sequence of vtkMRMLStreamingVolumeNode that is decoded by the seeker. The seeker does not keep the sequence alive.
+  void SetSequenceNode(vtkMRMLSequenceNode* sequenceNode);
+  vtkMRMLSequenceNode* GetSequenceNode();
+
+  /// Rebuild the keyframe table of the sequence
+  void UpdateKeyFrameIndex();
+
+  /// Number of items in the sequence that contain a keyframe
+  int GetNumberOfKeyFrames();
+
+  /// Returns the item number of the nearest keyframe at or before the specified item, or -1 if there is none
+  int GetNearestKeyFrameItemNumber(int itemNumber);
+
+  /// Encoded frame of the item, or NULL if the item does not contain an encoded frame
+  vtkStreamingVolumeFrame* GetFrame(int itemNumber);
+
+  /// Item number of the item that contains the encoded frame, or -1 if the frame is not in the sequence
+  int GetItemNumberOfFrame(vtkStreamingVolumeFrame* frame);
+
+  /// Decode the frame at the specified item number into the output image.
+  /// \return True if the frame was decoded successfully
+  bool Seek(int itemNumber);
+
+  /// Decoded image of the last item that was seeked to
+  vtkImageData* GetImageData();
+
+  /// Item number of the last decoded frame, or -1 if no frame has been decoded
+  int GetLastDecodedItemNumber();
+
+  /// Number of frames that were decoded by the last call to Seek()
+  int GetLastSeekNumberOfDecodedFrames();
+
+  /// Total number of frames decoded by the seeker
+  int GetTotalNumberOfDecodedFrames();
+
+protected:
+  vtkSlicerIGSIOSequenceSeeker();
+  ~vtkSlicerIGSIOSequenceSeeker();
+
+  /// Update the keyframe table if the sequence has been modified since it was built
+  void UpdateKeyFrameIndexIfModified();
+
+  /// Update the keyframe table if the data node or the encoded frame of any of the items in the range has been
+  /// replaced or modified since the table was built. Items can be changed without modifying the sequence.
+  /// \return True if the keyframe table was rebuilt
+  bool UpdateKeyFrameIndexIfItemsModified(int firstItemNumber, int lastItemNumber);
+
+private:
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOSequenceSeeker(const vtkSlicerIGSIOSequenceSeeker&); // Not implemented
+  void operator=(const vtkSlicerIGSIOSequenceSeeker&);               // Not implemented
+};
+
+#endif
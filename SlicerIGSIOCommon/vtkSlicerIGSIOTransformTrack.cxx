@@ -0,0 +1,192 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOTransformTrack.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+static const int TRANSFORM_NUMBER_OF_ELEMENTS = 16;
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOTransformTrack);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOTransformTrack::vtkSlicerIGSIOTransformTrack()
+  : TransformName(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOTransformTrack::~vtkSlicerIGSIOTransformTrack()
+{
+  this->SetTransformName(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOTransformTrack::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "TransformName: " << (this->TransformName ? this->TransformName : "(none)") << std::endl;
+  os << indent << "NumberOfTransforms: " << this->GetNumberOfTransforms() << std::endl;
+  os << indent << "MemorySize: " << this->GetMemorySize() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOTransformTrack::Reserve(int numberOfTransforms)
+{
+  if (numberOfTransforms < 0)
+  {
+    return;
+  }
+  this->Timestamps.reserve(numberOfTransforms);
+  this->Matrices.reserve(numberOfTransforms * TRANSFORM_NUMBER_OF_ELEMENTS);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOTransformTrack::AddTransform(double timestamp, vtkMatrix4x4* matrix)
+{
+  if (!matrix)
+  {
+    vtkErrorMacro("AddTransform: Invalid matrix");
+    return;
+  }
+
+  // Transforms are usually added in chronological order, in which case they are appended to the end of the arrays
+  std::vector<double>::iterator timestampIt = this->Timestamps.end();
+  if (!this->Timestamps.empty() && timestamp <= this->Timestamps.back())
+  {
+    timestampIt = std::lower_bound(this->Timestamps.begin(), this->Timestamps.end(), timestamp);
+  }
+
+  int index = timestampIt - this->Timestamps.begin();
+  std::vector<float>::iterator matrixIt = this->Matrices.begin() + index * TRANSFORM_NUMBER_OF_ELEMENTS;
+  if (timestampIt == this->Timestamps.end() || *timestampIt != timestamp)
+  {
+    this->Timestamps.insert(timestampIt, timestamp);
+    matrixIt = this->Matrices.insert(matrixIt, TRANSFORM_NUMBER_OF_ELEMENTS, 0.0f);
+  }
+
+  for (int i = 0; i < 4; ++i)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      *matrixIt = static_cast<float>(matrix->GetElement(i, j));
+      ++matrixIt;
+    }
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOTransformTrack::RemoveAllTransforms()
+{
+  this->Timestamps.clear();
+  this->Matrices.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOTransformTrack::GetNumberOfTransforms()
+{
+  return static_cast<int>(this->Timestamps.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOTransformTrack::GetNthTimestamp(int n)
+{
+  if (n < 0 || n >= this->GetNumberOfTransforms())
+  {
+    vtkErrorMacro("GetNthTimestamp: Index out of range: " << n);
+    return 0.0;
+  }
+  return this->Timestamps[n];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOTransformTrack::GetNthTransform(int n, vtkMatrix4x4* matrix)
+{
+  if (!matrix || n < 0 || n >= this->GetNumberOfTransforms())
+  {
+    vtkErrorMacro("GetNthTransform: Invalid arguments");
+    return false;
+  }
+
+  const float* elements = &this->Matrices[n * TRANSFORM_NUMBER_OF_ELEMENTS];
+  for (int i = 0; i < 4; ++i)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      matrix->SetElement(i, j, elements[4 * i + j]);
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOTransformTrack::GetClosestTransformIndex(double timestamp)
+{
+  if (this->Timestamps.empty())
+  {
+    return -1;
+  }
+
+  std::vector<double>::iterator timestampIt = std::lower_bound(this->Timestamps.begin(), this->Timestamps.end(), timestamp);
+  if (timestampIt == this->Timestamps.begin())
+  {
+    return 0;
+  }
+  if (timestampIt == this->Timestamps.end())
+  {
+    return this->GetNumberOfTransforms() - 1;
+  }
+
+  int index = timestampIt - this->Timestamps.begin();
+  if (std::fabs(this->Timestamps[index - 1] - timestamp) <= std::fabs(this->Timestamps[index] - timestamp))
+  {
+    return index - 1;
+  }
+  return index;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOTransformTrack::GetTransformAtTimestamp(double timestamp, vtkMatrix4x4* matrix)
+{
+  int index = this->GetClosestTransformIndex(timestamp);
+  if (index < 0)
+  {
+    return false;
+  }
+  return this->GetNthTransform(index, matrix);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkSlicerIGSIOTransformTrack::GetMemorySize()
+{
+  return this->Timestamps.capacity() * sizeof(double) + this->Matrices.capacity() * sizeof(float);
+}
@@ -0,0 +1,93 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+#ifndef __vtkSlicerIGSIOTransformTrack_h
+#define __vtkSlicerIGSIOTransformTrack_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+class vtkMatrix4x4;
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Compact storage of the transforms of a single tracked tool.
+/// The timestamps and the 4x4 matrices (in single precision, row-major order) are stored in contiguous arrays,
+/// instead of creating a transform node for every sample. The samples are kept sorted by timestamp.
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOTransformTrack : public vtkObject
+{
+public:
+  static vtkSlicerIGSIOTransformTrack* New();
+  vtkTypeMacro(vtkSlicerIGSIOTransformTrack, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Name of the transform (ex. ProbeToTracker)
+  vtkGetStringMacro(TransformName);
+  vtkSetStringMacro(TransformName);
+
+  /// Allocate memory for the specified number of transforms
+  void Reserve(int numberOfTransforms);
+
+  /// Add a transform at the specified timestamp.
+  /// If there is already a transform with the same timestamp, it is replaced.
+  void AddTransform(double timestamp, vtkMatrix4x4* matrix);
+
+  /// Remove all transforms from the track
+  void RemoveAllTransforms();
+
+  int GetNumberOfTransforms();
+  double GetNthTimestamp(int n);
+
+  /// Copy the nth transform into the matrix.
+  /// \return False if n is out of range
+  bool GetNthTransform(int n, vtkMatrix4x4* matrix);
+
+  /// Returns the index of the transform with the timestamp closest to the specified timestamp, or -1 if the track is empty
+  int GetClosestTransformIndex(double timestamp);
+
+  /// Copy the transform with the timestamp closest to the specified timestamp into the matrix.
+  /// \return False if the track is empty
+  bool GetTransformAtTimestamp(double timestamp, vtkMatrix4x4* matrix);
+
+  /// Memory used to store the transforms (in bytes)
+  unsigned long long GetMemorySize();
+
+protected:
+  vtkSlicerIGSIOTransformTrack();
+  ~vtkSlicerIGSIOTransformTrack();
+
+  char* TransformName;
+
+  std::vector<double> Timestamps;
+  /// 16 elements per transform
+  std::vector<float> Matrices;
+
+private:
+  vtkSlicerIGSIOTransformTrack(const vtkSlicerIGSIOTransformTrack&); // Not implemented
+  void operator=(const vtkSlicerIGSIOTransformTrack&);               // Not implemented
+};
+
+#endif
@@ -0,0 +1,352 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+// SlicerIGSIOCommon includes
+#include "vtkSlicerIGSIOCommon.h"
+#include "vtkSlicerIGSIOInstrumentation.h"
+#include "vtkSlicerIGSIOLosslessVolumeCodec.h"
+#include "vtkSlicerIGSIOMkvFrameIndex.h"
+#include "vtkSlicerIGSIOVideoProbe.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Number of clusters that are scanned by default to measure the frame interval
+static const int DEFAULT_MAXIMUM_NUMBER_OF_SCANNED_CLUSTERS = 8;
+
+//----------------------------------------------------------------------------
+class vtkSlicerIGSIOVideoProbe::vtkInternal
+{
+public:
+  vtkInternal()
+  {
+    this->Clear();
+  }
+
+  void Clear()
+  {
+    this->FileName.clear();
+    this->Duration = 0.0;
+    this->NumberOfFrames = 0;
+    this->NumberOfFramesExact = false;
+    this->VideoTrackName.clear();
+    this->CodecFourCC.clear();
+    this->Width = 0;
+    this->Height = 0;
+    this->NumberOfComponents = 0;
+    this->TrackNames.clear();
+    this->TransformNames.clear();
+  }
+
+  static int GetNumberOfComponents(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkSlicerIGSIOMkvFrameIndex::TrackInfo* videoTrack);
+
+  std::string FileName;
+  double Duration;
+  int NumberOfFrames;
+  bool NumberOfFramesExact;
+  std::string VideoTrackName;
+  std::string CodecFourCC;
+  int Width;
+  int Height;
+  int NumberOfComponents;
+  std::vector<std::string> TrackNames;
+  std::vector<std::string> TransformNames;
+};
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOVideoProbe::vtkInternal::GetNumberOfComponents(vtkSlicerIGSIOMkvFrameIndex* frameIndex, vtkSlicerIGSIOMkvFrameIndex::TrackInfo* videoTrack)
+{
+  const std::string& codecFourCC = videoTrack->FourCC;
+  if (vtkSlicerIGSIOCommon::IsGrayscaleCodec(codecFourCC))
+  {
+    return 1;
+  }
+
+  if (codecFourCC == vtkSlicerIGSIOLosslessVolumeCodec::GetCodecFourCC())
+  {
+    // The number of components is stored in the header of each frame (see vtkSlicerIGSIOLosslessVolumeCodec),
+    // only the first bytes of the first frame are read
+    const unsigned int numberOfComponentsEnd = 8;
+    if (videoTrack->Frames.empty() || videoTrack->Frames[0].Size < numberOfComponentsEnd)
+    {
+      return 0;
+    }
+    vtkSmartPointer<vtkUnsignedCharArray> frameHeader = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    if (!frameIndex->ReadFrameData(videoTrack->Frames[0].Offset, numberOfComponentsEnd, frameHeader))
+    {
+      return 0;
+    }
+    const unsigned char* frameHeaderPointer = frameHeader->GetPointer(0);
+    unsigned int numberOfComponents = (unsigned int)frameHeaderPointer[4] | ((unsigned int)frameHeaderPointer[5] << 8)
+      | ((unsigned int)frameHeaderPointer[6] << 16) | ((unsigned int)frameHeaderPointer[7] << 24);
+    return (numberOfComponents > (unsigned int)VTK_INT_MAX) ? 0 : (int)numberOfComponents;
+  }
+
+  // Single-component video of color codecs is flagged by a metadata track (see vtkSlicerIGSIOCommon::EncodeImageData)
+  if (frameIndex->GetTrackByName("Grayscale") != NULL)
+  {
+    return 1;
+  }
+
+  // Uncompressed RGB and YUV video is decoded to RGB
+  if (codecFourCC == "RV24" || codecFourCC == "I420" || codecFourCC == "VP80" || codecFourCC == "VP90")
+  {
+    return 3;
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIGSIOVideoProbe);
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOVideoProbe::vtkSlicerIGSIOVideoProbe()
+  : MaximumNumberOfScannedClusters(DEFAULT_MAXIMUM_NUMBER_OF_SCANNED_CLUSTERS)
+  , Internal(new vtkInternal())
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIGSIOVideoProbe::~vtkSlicerIGSIOVideoProbe()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIGSIOVideoProbe::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfScannedClusters: " << this->MaximumNumberOfScannedClusters << std::endl;
+  os << indent << "FileName: " << this->Internal->FileName << std::endl;
+  os << indent << "Duration: " << this->Internal->Duration << std::endl;
+  os << indent << "NumberOfFrames: " << this->Internal->NumberOfFrames << (this->Internal->NumberOfFramesExact ? "" : " (estimated)") << std::endl;
+  os << indent << "VideoTrackName: " << this->Internal->VideoTrackName << std::endl;
+  os << indent << "CodecFourCC: " << this->Internal->CodecFourCC << std::endl;
+  os << indent << "Dimensions: " << this->Internal->Width << " x " << this->Internal->Height
+    << " x " << this->Internal->NumberOfComponents << std::endl;
+  os << indent << "Transforms:";
+  for (std::vector<std::string>::iterator transformNameIt = this->Internal->TransformNames.begin();
+    transformNameIt != this->Internal->TransformNames.end(); ++transformNameIt)
+  {
+    os << " " << *transformNameIt;
+  }
+  os << std::endl;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOVideoProbe::Probe(const std::string& fileName)
+{
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("Probe");
+  this->Internal->Clear();
+  this->Internal->FileName = fileName;
+  this->Modified();
+
+  vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex> frameIndex = vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex>::New();
+  if (!frameIndex->ReadHeader(fileName))
+  {
+    return false;
+  }
+
+  int videoTrackNumber = frameIndex->GetFirstVideoTrackNumber();
+  vtkSlicerIGSIOMkvFrameIndex::TrackInfo* videoTrack = frameIndex->GetTrack(videoTrackNumber);
+  if (!videoTrack)
+  {
+    vtkErrorMacro("Probe: No video track in file: " << fileName);
+    return false;
+  }
+
+  this->Internal->VideoTrackName = videoTrack->Name.empty() ? "Video" : videoTrack->Name;
+  this->Internal->CodecFourCC = videoTrack->FourCC;
+  this->Internal->Width = videoTrack->Width;
+  this->Internal->Height = videoTrack->Height;
+
+  // Transforms are stored in metadata tracks named <TransformName>Transform (see vtkSlicerIGSIOCommon::MkvFrameIndexToSequenceBrowser)
+  const std::string transformSuffix = "Transform";
+  std::vector<int> trackNumbers = frameIndex->GetTrackNumbers();
+  for (std::vector<int>::iterator trackNumberIt = trackNumbers.begin(); trackNumberIt != trackNumbers.end(); ++trackNumberIt)
+  {
+    vtkSlicerIGSIOMkvFrameIndex::TrackInfo* track = frameIndex->GetTrack(*trackNumberIt);
+    const std::string& trackName = track->Name;
+    this->Internal->TrackNames.push_back(trackName);
+    if (track->TrackType == vtkSlicerIGSIOMkvFrameIndex::VideoTrack
+      || trackName.size() <= transformSuffix.size()
+      || trackName.compare(trackName.size() - transformSuffix.size(), transformSuffix.size(), transformSuffix) != 0)
+    {
+      continue;
+    }
+    std::string transformName = trackName.substr(0, trackName.size() - transformSuffix.size());
+    if (transformName != this->Internal->VideoTrackName + "ToPhysical")
+    {
+      this->Internal->TransformNames.push_back(transformName);
+    }
+  }
+
+  // Only the block headers are read while scanning, the frame payloads are skipped
+  if (this->MaximumNumberOfScannedClusters != 0 && frameIndex->ScanClusters(this->MaximumNumberOfScannedClusters) < 0)
+  {
+    return false;
+  }
+
+  this->Internal->NumberOfComponents = vtkInternal::GetNumberOfComponents(frameIndex, videoTrack);
+
+  const std::vector<vtkSlicerIGSIOMkvFrameIndex::FrameInfo>& frames = videoTrack->Frames;
+  int numberOfScannedFrames = (int)frames.size();
+  this->Internal->Duration = frameIndex->GetDuration();
+  this->Internal->NumberOfFrames = numberOfScannedFrames;
+  this->Internal->NumberOfFramesExact = frameIndex->IsScanComplete();
+  if (this->Internal->NumberOfFramesExact)
+  {
+    if (this->Internal->Duration <= 0.0 && numberOfScannedFrames > 1)
+    {
+      this->Internal->Duration = frames.back().Timestamp - frames.front().Timestamp;
+    }
+    return true;
+  }
+
+  // Each cue point of the video track refers to a different keyframe, and the last one bounds the duration of the video
+  int numberOfCuedFrames = 0;
+  double firstCueTimestamp = 0.0;
+  double lastCueTimestamp = 0.0;
+  const std::vector<vtkSlicerIGSIOMkvFrameIndex::CuePointInfo>& cuePoints = frameIndex->GetCuePoints();
+  for (std::vector<vtkSlicerIGSIOMkvFrameIndex::CuePointInfo>::const_iterator cuePointIt = cuePoints.begin(); cuePointIt != cuePoints.end(); ++cuePointIt)
+  {
+    if (cuePointIt->TrackNumber != videoTrackNumber)
+    {
+      continue;
+    }
+    firstCueTimestamp = (numberOfCuedFrames == 0) ? cuePointIt->Timestamp : std::min(firstCueTimestamp, cuePointIt->Timestamp);
+    lastCueTimestamp = (numberOfCuedFrames == 0) ? cuePointIt->Timestamp : std::max(lastCueTimestamp, cuePointIt->Timestamp);
+    ++numberOfCuedFrames;
+  }
+  this->Internal->NumberOfFrames = std::max(numberOfScannedFrames, numberOfCuedFrames);
+  if (this->Internal->Duration <= 0.0 && numberOfCuedFrames > 0)
+  {
+    double firstTimestamp = frames.empty() ? firstCueTimestamp : std::min(frames.front().Timestamp, firstCueTimestamp);
+    this->Internal->Duration = lastCueTimestamp - firstTimestamp;
+  }
+
+  if (this->Internal->Duration > 0.0 && numberOfScannedFrames > 1)
+  {
+    double frameInterval = (frames.back().Timestamp - frames.front().Timestamp) / (numberOfScannedFrames - 1);
+    if (frameInterval > 0.0)
+    {
+      int estimatedNumberOfFrames = (int)std::floor(this->Internal->Duration / frameInterval + 0.5) + 1;
+      this->Internal->NumberOfFrames = std::max(this->Internal->NumberOfFrames, estimatedNumberOfFrames);
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOVideoProbe::GetFileName()
+{
+  return this->Internal->FileName;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIGSIOVideoProbe::GetDuration()
+{
+  return this->Internal->Duration;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOVideoProbe::GetNumberOfFrames()
+{
+  return this->Internal->NumberOfFrames;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIGSIOVideoProbe::IsNumberOfFramesExact()
+{
+  return this->Internal->NumberOfFramesExact;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOVideoProbe::GetVideoTrackName()
+{
+  return this->Internal->VideoTrackName;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOVideoProbe::GetCodecFourCC()
+{
+  return this->Internal->CodecFourCC;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOVideoProbe::GetWidth()
+{
+  return this->Internal->Width;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOVideoProbe::GetHeight()
+{
+  return this->Internal->Height;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOVideoProbe::GetNumberOfComponents()
+{
+  return this->Internal->NumberOfComponents;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOVideoProbe::GetNumberOfTracks()
+{
+  return (int)this->Internal->TrackNames.size();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOVideoProbe::GetNthTrackName(int n)
+{
+  if (n < 0 || n >= (int)this->Internal->TrackNames.size())
+  {
+    vtkErrorMacro("GetNthTrackName: Invalid track index: " << n);
+    return "";
+  }
+  return this->Internal->TrackNames[n];
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIGSIOVideoProbe::GetNumberOfTransforms()
+{
+  return (int)this->Internal->TransformNames.size();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIGSIOVideoProbe::GetNthTransformName(int n)
+{
+  if (n < 0 || n >= (int)this->Internal->TransformNames.size())
+  {
+    vtkErrorMacro("GetNthTransformName: Invalid transform index: " << n);
+    return "";
+  }
+  return this->Internal->TransformNames[n];
+}
@@ -0,0 +1,100 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+
+
+#ifndef __vtkSlicerIGSIOVideoProbe_h
+#define __vtkSlicerIGSIOVideoProbe_h
+
+#include "vtkSlicerIGSIOCommon.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <string>
+
+/// \ingroup SlicerIGSIO_vtkSlicerIGSIO
+/// Summary of the contents of a Matroska (.mkv/.webm) video file, without loading the video.
+/// Only the segment information, the track entries, the cues and the block headers of the first clusters are read
+/// (see vtkSlicerIGSIOMkvFrameIndex); the encoded frame payloads are skipped.
+/// Example (Python): probe = slicer.vtkSlicerIGSIOVideoProbe(); probe.Probe(fileName); print(probe.GetNumberOfFrames(), probe.GetDuration())
+class VTK_SLICERIGSIOCOMMON_EXPORT vtkSlicerIGSIOVideoProbe : public vtkObject
+{
+public:
+  static vtkSlicerIGSIOVideoProbe* New();
+  vtkTypeMacro(vtkSlicerIGSIOVideoProbe, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Maximum number of clusters that are scanned to count the frames (default: 8). If negative, all clusters are scanned
+  /// and the number of frames is exact. Otherwise, if the file contains more clusters, the number of frames is estimated from
+  /// the frame interval of the scanned clusters and the duration of the file, and the cues of the file are used
+  /// to bound the duration and the number of frames. If 0, only the header and the cues are read.
+  vtkSetMacro(MaximumNumberOfScannedClusters, int);
+  vtkGetMacro(MaximumNumberOfScannedClusters, int);
+
+  /// Read the summary of the file. The previous summary is cleared.
+  /// \return False if the file cannot be read or contains no video track
+  bool Probe(const std::string& fileName);
+
+  std::string GetFileName();
+
+  /// Duration of the video in seconds. If the file does not specify its duration, it is computed from the timestamps of the scanned frames.
+  double GetDuration();
+
+  /// Number of frames in the first video track
+  int GetNumberOfFrames();
+
+  /// Returns true if all frames were counted, false if the number of frames is an estimate
+  bool IsNumberOfFramesExact();
+
+  /// Properties of the first video track
+  std::string GetVideoTrackName();
+  std::string GetCodecFourCC();
+  int GetWidth();
+  int GetHeight();
+  /// Number of components of the decoded frames, derived from the codec: 1 for grayscale video (including luma-only video
+  /// of color codecs), 3 for color video. For the lossless codec, it is read from the header of the first scanned frame.
+  /// 0 if it cannot be determined.
+  int GetNumberOfComponents();
+
+  /// Names of all tracks in the file (video and metadata)
+  int GetNumberOfTracks();
+  std::string GetNthTrackName(int n);
+
+  /// Names of the transforms stored in the file (ex. ProbeToTracker)
+  int GetNumberOfTransforms();
+  std::string GetNthTransformName(int n);
+
+protected:
+  vtkSlicerIGSIOVideoProbe();
+  ~vtkSlicerIGSIOVideoProbe();
+
+  int MaximumNumberOfScannedClusters;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkSlicerIGSIOVideoProbe(const vtkSlicerIGSIOVideoProbe&); // Not implemented
+  void operator=(const vtkSlicerIGSIOVideoProbe&);           // Not implemented
+};
+
+#endif
@@ -43,8 +43,47 @@ Care Ontario.
 // vtkVideoIOMRML includes
 #include "vtkMRMLStreamingVolumeSequenceStorageNode.h"
 
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOImagePool.h>
+#include <vtkSlicerIGSIOInstrumentation.h>
+#include <vtkSlicerIGSIOMkvStreamingVolumeFrame.h>
+#include <vtkSlicerIGSIOSequenceSeeker.h>
+#include <vtkSlicerIGSIOTransformTrack.h>
+
 // VTK includes
+#include <vtkCollection.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
 #include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkVariant.h>
+#include <vtkWeakPointer.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodec.h>
+#include <vtkStreamingVolumeFrame.h>
+
+// STD includes
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Number of recorded frames that are appended to incrementally written files at once
+static const int INCREMENTAL_WRITE_NUMBER_OF_FRAMES = 30;
+
+// Default maximum number of recorded images that are waiting to be encoded
+static const int ENCODE_ON_RECORD_DEFAULT_QUEUE_SIZE = 30;
 
 //---------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerVideoIOLogic);
@@ -57,14 +96,184 @@ public:
   vtkInternal(vtkSlicerVideoIOLogic* external);
   ~vtkInternal();
 
+  /// Remove least recently used frames until the cache fits in the budget. Must be called with CacheMutex locked.
+  void EvictDecodedFrames();
+
+  /// Add the decoded image to the cache without copying it
+  void InsertDecodedFrame(vtkStreamingVolumeFrame* frame, vtkImageData* decodedImage);
+
+  /// Queue the frames following the selected item of the browser for decoding on the read-ahead thread
+  void UpdateReadAhead(vtkMRMLSequenceBrowserNode* browserNode);
+
+  /// Release the payloads of the lazily loaded frames (see vtkSlicerIGSIOMkvStreamingVolumeFrame) that are no longer in the decode window
+  /// of the browser: the selected item, the read-ahead items during playback, and the frames from their nearest keyframes.
+  void ReleaseFramePayloads(vtkMRMLSequenceBrowserNode* browserNode);
+
+  /// Seeker of the sequence, created on demand
+  vtkSlicerIGSIOSequenceSeeker* GetSequenceSeeker(vtkMRMLSequenceNode* sequenceNode);
+
+  /// Queue the recorded frames for the writer threads of the sequences that are being written incrementally.
+  /// When recording stops, the files are finalized.
+  void UpdateIncrementalWrite(vtkMRMLSequenceBrowserNode* browserNode);
+
+  /// Write the remaining frames of an incrementally written file, and finalize it
+  void FinalizeIncrementalWrite(vtkMRMLStreamingVolumeSequenceStorageNode* storageNode);
+
+  void StartReadAheadThread();
+  void StopReadAheadThread();
+  /// Decode the queued frames and add them to the cache
+  void ReadAheadThreadMain();
+
+  void StartEncodeOnRecordThread();
+  /// Stop the encoder thread. Images that are still queued are left uncompressed in the sequences.
+  void StopEncodeOnRecordThread();
+  /// Encode the queued images, in recording order
+  void EncodeOnRecordThreadMain();
+
   vtkSlicerVideoIOLogic* External;
+
+  struct DecodedFrame
+  {
+    /// Key of the frame in DecodedFrameLookup
+    vtkStreamingVolumeFrame* FrameKey;
+    /// Used to detect if the encoded frame has been deleted, in which case the address could be reused by a different frame
+    vtkWeakPointer<vtkStreamingVolumeFrame> Frame;
+    vtkMTimeType FrameMTime;
+    vtkSmartPointer<vtkImageData> Image;
+    unsigned long long NumberOfBytes;
+  };
+  typedef std::list<DecodedFrame> DecodedFrameList;
+
+  /// Remove the frame from the list of decoded frames, and return its image to the image pool. Must be called with CacheMutex locked.
+  void ReleaseDecodedFrame(DecodedFrameList::iterator decodedFrameIt);
+
+  std::mutex CacheMutex;
+  unsigned long long DecodedFrameCacheSize;
+  unsigned long long DecodedFrameCacheMemoryUsage;
+  /// Most recently used frames are at the front of the list
+  DecodedFrameList DecodedFrames;
+  std::map<vtkStreamingVolumeFrame*, DecodedFrameList::iterator> DecodedFrameLookup;
+  int DecodedFrameCacheHits;
+  int DecodedFrameCacheMisses;
+
+  /// Playback and recording state of the observed sequence browsers
+  typedef std::map<vtkSlicerIGSIOMkvStreamingVolumeFrame*, vtkWeakPointer<vtkSlicerIGSIOMkvStreamingVolumeFrame> > PayloadFrameMap;
+  struct BrowserPlaybackState
+  {
+    int LastSelectedItemNumber;
+    int Step;
+    bool RecordingActive;
+    /// Selected item of the current decode window
+    int PayloadWindowItemNumber;
+    /// Lazily loaded frames in the decode window
+    PayloadFrameMap PayloadWindowFrames;
+    /// Frames that left the decode window, and whose payloads have not been released yet
+    PayloadFrameMap PayloadFramesToRelease;
+    BrowserPlaybackState()
+      : LastSelectedItemNumber(-1)
+      , Step(1)
+      , RecordingActive(false)
+      , PayloadWindowItemNumber(-1)
+    {
+    }
+  };
+  std::map<vtkMRMLSequenceBrowserNode*, BrowserPlaybackState> BrowserPlaybackStates;
+
+  int ReadAheadNumberOfFrames;
+  std::thread ReadAheadThread;
+  std::mutex ReadAheadMutex;
+  std::condition_variable ReadAheadCondition;
+  bool ReadAheadThreadRunning;
+  struct ReadAheadItem
+  {
+    /// Identifies the sequence that the frame is read from. Only used as a key, never dereferenced by the read-ahead thread.
+    vtkMRMLSequenceNode* SequenceKey;
+    vtkSmartPointer<vtkStreamingVolumeFrame> Frame;
+  };
+  /// Frames waiting to be decoded, in decoding order. Replaced every time the selected item changes.
+  std::deque<ReadAheadItem> ReadAheadQueue;
+
+  /// Keyframe tables and decoders of the browsed sequences. Only used from the main thread.
+  std::map<vtkMRMLSequenceNode*, vtkSmartPointer<vtkSlicerIGSIOSequenceSeeker> > SequenceSeekers;
+  /// Sequence of each internal sequence scene, used to find the sequence that contains a data node
+  std::map<vtkMRMLScene*, vtkWeakPointer<vtkMRMLSequenceNode> > SequenceNodesBySequenceScene;
+
+  struct TransformTrackProxy
+  {
+    vtkSmartPointer<vtkSlicerIGSIOTransformTrack> Track;
+    vtkWeakPointer<vtkMRMLLinearTransformNode> ProxyNode;
+    /// Index of the transform in the track that was last copied to the proxy node
+    int TransformIndex;
+    vtkMTimeType TrackMTime;
+  };
+  std::map<vtkMRMLSequenceBrowserNode*, std::vector<TransformTrackProxy> > TransformTrackProxies;
+
+  struct EncodeOnRecordItem
+  {
+    /// Identifies the recorded node. Images of the same node are encoded by the same codec instance, so that inter-frame compression can be used.
+    std::string StreamKey;
+    std::string CodecFourCC;
+    std::string CodecPreset;
+    bool ForceKeyFrame;
+    /// Sequence item that the encoded frame is stored in
+    vtkWeakPointer<vtkMRMLStreamingVolumeNode> TargetNode;
+    /// Copy of the recorded image, also referenced by the target node until it is replaced by the encoded frame
+    vtkSmartPointer<vtkImageData> Image;
+    vtkSmartPointer<vtkStreamingVolumeFrame> Frame;
+  };
+
+  std::string EncodeOnRecordCodecFourCC;
+  std::string EncodeOnRecordCodecPreset;
+  int EncodeOnRecordQueueSize;
+  int EncodeOnRecordOverflowPolicy;
+  std::thread EncodeOnRecordThread;
+  std::mutex EncodeOnRecordMutex;
+  /// Notified when an image is queued or the thread is stopped
+  std::condition_variable EncodeOnRecordCondition;
+  /// Notified when an image is encoded
+  std::condition_variable EncodeOnRecordDoneCondition;
+  bool EncodeOnRecordThreadRunning;
+  std::deque<EncodeOnRecordItem> EncodeOnRecordQueue;
+  /// Number of images that have been taken from the queue and are being encoded
+  int NumberOfImagesBeingEncodedOnRecord;
+  /// Encoded items that have not been stored in the sequences yet
+  std::deque<EncodeOnRecordItem> EncodedOnRecordItems;
+  /// Recorded nodes that had an image stored uncompressed. The next encoded frame of the node is a key frame.
+  std::map<std::string, bool> EncodeOnRecordStreamGaps;
+  int NumberOfFramesEncodedOnRecord;
+  int NumberOfFramesStoredUncompressedOnRecord;
+
+  /// Recorded items that share the current image of a recorded node
+  struct SharedRecordedImage
+  {
+    /// Recorded node. Used to detect entries of deleted nodes, whose address may be reused by a new node.
+    vtkWeakPointer<vtkMRMLStreamingVolumeNode> SourceNode;
+    vtkWeakPointer<vtkDataArray> Scalars;
+    /// Used to detect if the image was modified in place without invoking ImageDataAboutToBeModifiedEvent
+    vtkMTimeType ImageMTime;
+    vtkMTimeType ScalarsMTime;
+    std::vector<vtkWeakPointer<vtkMRMLStreamingVolumeNode> > TargetNodes;
+    /// Set if the node modified a shared image in place without notification, in which case its images are deep copied
+    bool CopyOnWriteDisabled;
+    SharedRecordedImage()
+      : ImageMTime(0)
+      , ScalarsMTime(0)
+      , CopyOnWriteDisabled(false)
+    {
+    }
+  };
+  int RecordingCopyMode;
+  std::map<vtkMRMLStreamingVolumeNode*, SharedRecordedImage> SharedRecordedImages;
+  int NumberOfSharedRecordedImages;
+  int NumberOfMaterializedRecordedImages;
 };
 
 //----------------------------------------------------------------------------
 class StreamingVolumeNodeSequencer : public vtkMRMLNodeSequencer::NodeSequencer
 {
 public:
-  StreamingVolumeNodeSequencer()
+  StreamingVolumeNodeSequencer(vtkSlicerVideoIOLogic* logic)
+    : Logic(logic)
   {
     this->SupportedNodeClassName = "vtkMRMLStreamingVolumeNode";
     this->RecordingEvents->InsertNextValue(vtkMRMLVolumeNode::ImageDataModifiedEvent);
@@ -80,15 +289,44 @@ public:
 
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy /* =false */)
   {
+    vtkSlicerIGSIOInstrumentation::ScopedTimer timer("CopyNode");
     int oldModified = target->StartModify();
     vtkSmartPointer<vtkMRMLStreamingVolumeNode> targetStreamNode = vtkMRMLStreamingVolumeNode::SafeDownCast(target);
     vtkSmartPointer<vtkMRMLStreamingVolumeNode> sourceStreamNode = vtkMRMLStreamingVolumeNode::SafeDownCast(source);
     if (targetStreamNode && sourceStreamNode)
     {
       vtkStreamingVolumeFrame* frame = sourceStreamNode->GetFrame();
-      if (frame)
+      if (frame && this->Logic && this->Logic->GetDecodedFrameCacheSize() > 0)
+      {
+        vtkSmartPointer<vtkImageData> cachedImage = vtkSmartPointer<vtkImageData>::New();
+        if (this->Logic->GetDecodedFrameFromCache(frame, cachedImage))
+        {
+          this->SetFrameWithDecodedImage(frame, cachedImage, targetStreamNode);
+        }
+        else
+        {
+          if (!this->SetDecodedLumaOnlyFrame(frame, targetStreamNode) && !this->SetSeekedFrame(sourceStreamNode, frame, targetStreamNode))
+          {
+            targetStreamNode->SetAndObserveFrame(frame);
+          }
+          vtkImageData* decodedImage = targetStreamNode->GetImageData();
+          if (decodedImage)
+          {
+            this->Logic->AddDecodedFrameToCache(frame, decodedImage);
+          }
+        }
+      }
+      else if (frame)
+      {
+        if (!this->SetDecodedLumaOnlyFrame(frame, targetStreamNode) && !this->SetSeekedFrame(sourceStreamNode, frame, targetStreamNode))
+        {
+          targetStreamNode->SetAndObserveFrame(sourceStreamNode->GetFrame());
+        }
+      }
+      else if (this->Logic && !this->Logic->GetEncodeOnRecordCodecFourCC().empty() && this->IsRecording(sourceStreamNode, targetStreamNode))
       {
-        targetStreamNode->SetAndObserveFrame(sourceStreamNode->GetFrame());
+        // The image is copied to the target, and is replaced by the encoded frame once it is encoded
+        this->Logic->EncodeOnRecord(sourceStreamNode, targetStreamNode);
       }
       else
       {
@@ -96,10 +334,18 @@ public:
         {
           targetStreamNode->SetAndObserveImageData(sourceStreamNode->GetImageData());
         }
+        else if (this->Logic && this->Logic->GetRecordingCopyMode() == vtkSlicerVideoIOLogic::RecordingCopyOnWrite
+          && this->IsRecording(sourceStreamNode, targetStreamNode) && this->Logic->ShareRecordedImage(sourceStreamNode, targetStreamNode))
+        {
+          // The image is copied when the source node is about to modify it
+        }
         else
         {
           vtkSmartPointer<vtkImageData> newImage = vtkSmartPointer<vtkImageData>::New();
-          newImage->DeepCopy(sourceStreamNode->GetImageData());
+          if (sourceStreamNode->GetImageData())
+          {
+            vtkSlicerIGSIOImagePool::GetInstance()->CopyImage(sourceStreamNode->GetImageData(), newImage);
+          }
           targetStreamNode->SetAndObserveImageData(newImage);
         }
       }
@@ -162,6 +408,87 @@ public:
       streamingNode->CreateDefaultDisplayNodes();
     }
   }
+
+protected:
+  /// Set the frame of the target together with its already decoded image, so that the frame is not decoded again.
+  /// The frame is kept on the target, so that the proxy node still refers to the encoded frame of the item.
+  void SetFrameWithDecodedImage(vtkStreamingVolumeFrame* frame, vtkImageData* decodedImage, vtkMRMLStreamingVolumeNode* targetStreamNode)
+  {
+    // The image is set after the frame, so that it is the decoded image of the frame
+    targetStreamNode->SetAndObserveFrame(frame);
+    targetStreamNode->SetAndObserveImageData(decodedImage);
+    if (targetStreamNode->GetFrame() != frame)
+    {
+      // The node discarded the frame when the image was set, so the frame is set again and decoded by the node
+      targetStreamNode->SetAndObserveFrame(frame);
+    }
+  }
+
+  /// Decode the frame of the source node using the seeker of its sequence, which decodes from the nearest keyframe, or continues from
+  /// the last frame decoded in the sequence. Returns false if the source node is not in a sequence, or the frame could not be decoded.
+  bool SetSeekedFrame(vtkMRMLStreamingVolumeNode* sourceStreamNode, vtkStreamingVolumeFrame* frame, vtkMRMLStreamingVolumeNode* targetStreamNode)
+  {
+    vtkSlicerIGSIOSequenceSeeker* seeker = this->Logic ? this->Logic->GetSequenceSeeker(sourceStreamNode) : NULL;
+    if (!seeker)
+    {
+      return false;
+    }
+    int itemNumber = seeker->GetItemNumberOfFrame(frame);
+    if (itemNumber < 0 || !seeker->Seek(itemNumber))
+    {
+      return false;
+    }
+    // The image of the seeker is overwritten by the next seek
+    vtkSmartPointer<vtkImageData> decodedImage = vtkSmartPointer<vtkImageData>::New();
+    vtkSlicerIGSIOImagePool::GetInstance()->CopyImage(seeker->GetImageData(), decodedImage);
+    this->SetFrameWithDecodedImage(frame, decodedImage, targetStreamNode);
+    return true;
+  }
+
+  /// Returns true if a node of the scene is being copied into a sequence.
+  /// Proxy nodes are in the scene of the logic, while the data nodes of the sequences are in the internal scenes of the sequences.
+  bool IsRecording(vtkMRMLNode* source, vtkMRMLNode* target)
+  {
+    vtkMRMLScene* scene = this->Logic->GetMRMLScene();
+    return scene && source->GetScene() == scene && target->GetScene() != scene;
+  }
+
+  // The streaming volume node would decode luma-only frames to a color image, so they are decoded here to a single-component image
+  // that replaces the frame of the target. Returns false if the frame is not a luma-only frame, or could not be decoded.
+  bool SetDecodedLumaOnlyFrame(vtkStreamingVolumeFrame* frame, vtkMRMLStreamingVolumeNode* targetStreamNode)
+  {
+    if (!vtkSlicerIGSIOCommon::IsLumaOnlyFrame(frame))
+    {
+      return false;
+    }
+
+    // One decoder per codec, so that consecutive frames are decoded without decoding from the keyframe
+    std::string codecFourCC = frame->GetCodecFourCC();
+    vtkSmartPointer<vtkStreamingVolumeCodec> codec = this->LumaOnlyDecoders[codecFourCC];
+    if (!codec)
+    {
+      codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+        vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(codecFourCC));
+      if (!codec)
+      {
+        return false;
+      }
+      this->LumaOnlyDecoders[codecFourCC] = codec;
+    }
+
+    vtkSmartPointer<vtkImageData> decodedImage = vtkSmartPointer<vtkImageData>::New();
+    vtkSlicerIGSIOImagePool::GetInstance()->AllocateDecodedImage(frame, decodedImage);
+    if (!vtkSlicerIGSIOCommon::DecodeFrame(codec, frame, decodedImage))
+    {
+      return false;
+    }
+    targetStreamNode->SetAndObserveFrame(NULL);
+    targetStreamNode->SetAndObserveImageData(decodedImage);
+    return true;
+  }
+
+  vtkWeakPointer<vtkSlicerVideoIOLogic> Logic;
+  std::map<std::string, vtkSmartPointer<vtkStreamingVolumeCodec> > LumaOnlyDecoders;
 };
 
 
@@ -171,39 +498,1422 @@ public:
 //---------------------------------------------------------------------------
 vtkSlicerVideoIOLogic::vtkInternal::vtkInternal(vtkSlicerVideoIOLogic* external)
   : External(external)
+  , DecodedFrameCacheSize(0)
+  , DecodedFrameCacheMemoryUsage(0)
+  , DecodedFrameCacheHits(0)
+  , DecodedFrameCacheMisses(0)
+  , ReadAheadNumberOfFrames(0)
+  , ReadAheadThreadRunning(false)
+  , EncodeOnRecordQueueSize(ENCODE_ON_RECORD_DEFAULT_QUEUE_SIZE)
+  , EncodeOnRecordOverflowPolicy(vtkSlicerVideoIOLogic::EncodeOnRecordStoreUncompressed)
+  , EncodeOnRecordThreadRunning(false)
+  , NumberOfImagesBeingEncodedOnRecord(0)
+  , NumberOfFramesEncodedOnRecord(0)
+  , NumberOfFramesStoredUncompressedOnRecord(0)
+  , RecordingCopyMode(vtkSlicerVideoIOLogic::RecordingDeepCopy)
+  , NumberOfSharedRecordedImages(0)
+  , NumberOfMaterializedRecordedImages(0)
 {
 }
 
 //---------------------------------------------------------------------------
 vtkSlicerVideoIOLogic::vtkInternal::~vtkInternal()
 {
+  this->StopReadAheadThread();
+  this->StopEncodeOnRecordThread();
 }
 
-//----------------------------------------------------------------------------
-// vtkSlicerVideoIOLogic methods
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::EvictDecodedFrames()
+{
+  while (!this->DecodedFrames.empty() && this->DecodedFrameCacheMemoryUsage > this->DecodedFrameCacheSize)
+  {
+    DecodedFrame& leastRecentlyUsedFrame = this->DecodedFrames.back();
+    this->DecodedFrameCacheMemoryUsage -= leastRecentlyUsedFrame.NumberOfBytes;
+    this->DecodedFrameLookup.erase(leastRecentlyUsedFrame.FrameKey);
+    this->ReleaseDecodedFrame(--this->DecodedFrames.end());
+  }
+}
 
 //---------------------------------------------------------------------------
-vtkSlicerVideoIOLogic::vtkSlicerVideoIOLogic()
+void vtkSlicerVideoIOLogic::vtkInternal::ReleaseDecodedFrame(DecodedFrameList::iterator decodedFrameIt)
 {
-  this->Internal = new vtkInternal(this);
+  // Images in the cache are not shared (they are copied in and out), so the buffer can be reused
+  vtkSmartPointer<vtkImageData> image = decodedFrameIt->Image;
+  this->DecodedFrames.erase(decodedFrameIt);
+  vtkSlicerIGSIOImagePool::GetInstance()->ReleaseImage(image);
 }
 
 //---------------------------------------------------------------------------
-vtkSlicerVideoIOLogic::~vtkSlicerVideoIOLogic()
+void vtkSlicerVideoIOLogic::vtkInternal::InsertDecodedFrame(vtkStreamingVolumeFrame* frame, vtkImageData* decodedImage)
 {
+  unsigned long long numberOfBytes = (unsigned long long)decodedImage->GetNumberOfPoints()
+    * decodedImage->GetNumberOfScalarComponents() * decodedImage->GetScalarSize();
+
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  if (numberOfBytes > this->DecodedFrameCacheSize)
+  {
+    // Frame does not fit in the cache
+    return;
+  }
+
+  std::map<vtkStreamingVolumeFrame*, DecodedFrameList::iterator>::iterator lookupIt = this->DecodedFrameLookup.find(frame);
+  if (lookupIt != this->DecodedFrameLookup.end())
+  {
+    this->DecodedFrameCacheMemoryUsage -= lookupIt->second->NumberOfBytes;
+    this->ReleaseDecodedFrame(lookupIt->second);
+    this->DecodedFrameLookup.erase(lookupIt);
+  }
+
+  DecodedFrame decodedFrame;
+  decodedFrame.FrameKey = frame;
+  decodedFrame.Frame = frame;
+  decodedFrame.FrameMTime = frame->GetMTime();
+  decodedFrame.Image = decodedImage;
+  decodedFrame.NumberOfBytes = numberOfBytes;
+
+  this->DecodedFrames.push_front(decodedFrame);
+  this->DecodedFrameLookup[frame] = this->DecodedFrames.begin();
+  this->DecodedFrameCacheMemoryUsage += numberOfBytes;
+  this->EvictDecodedFrames();
 }
 
-//-----------------------------------------------------------------------------
-void vtkSlicerVideoIOLogic::RegisterNodes()
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::UpdateReadAhead(vtkMRMLSequenceBrowserNode* browserNode)
 {
-  if (this->GetMRMLScene() == NULL)
+  BrowserPlaybackState& state = this->BrowserPlaybackStates[browserNode];
+  int selectedItemNumber = browserNode->GetSelectedItemNumber();
+  if (selectedItemNumber == state.LastSelectedItemNumber)
   {
-    vtkErrorMacro("Scene is invalid");
     return;
   }
 
-  this->GetMRMLScene()->RegisterNodeClass(vtkSmartPointer<vtkMRMLStreamingVolumeSequenceStorageNode>::New());
-  vtkMRMLNodeSequencer::GetInstance()->RegisterNodeSequencer(new StreamingVolumeNodeSequencer());
+  vtkMRMLSequenceNode* masterSequenceNode = browserNode->GetMasterSequenceNode();
+  int numberOfItems = masterSequenceNode ? masterSequenceNode->GetNumberOfDataNodes() : 0;
+  if (numberOfItems < 1 || selectedItemNumber < 0)
+  {
+    state.LastSelectedItemNumber = selectedItemNumber;
+    return;
+  }
+
+  // The playback direction and rate (number of items skipped between updates) are determined from the selected item
+  // numbers. A jump of more than half of the sequence is considered to be a wrap around during looped playback.
+  if (state.LastSelectedItemNumber >= 0)
+  {
+    int step = selectedItemNumber - state.LastSelectedItemNumber;
+    if (std::abs(step) <= numberOfItems / 2)
+    {
+      state.Step = step;
+    }
+  }
+  state.LastSelectedItemNumber = selectedItemNumber;
+
+  if (!browserNode->GetPlaybackActive() || this->ReadAheadNumberOfFrames < 1 || this->External->GetDecodedFrameCacheSize() == 0)
+  {
+    return;
+  }
+
+  std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+  browserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+
+  std::deque<ReadAheadItem> readAheadQueue;
+  for (int i = 1; i <= this->ReadAheadNumberOfFrames; ++i)
+  {
+    int itemNumber = selectedItemNumber + i * state.Step;
+    if (itemNumber < 0 || itemNumber >= numberOfItems)
+    {
+      if (!browserNode->GetPlaybackLooped())
+      {
+        break;
+      }
+      itemNumber = ((itemNumber % numberOfItems) + numberOfItems) % numberOfItems;
+    }
+
+    std::string indexValue = masterSequenceNode->GetNthIndexValue(itemNumber);
+    for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+    {
+      // The frames are taken from the keyframe table of the sequence, which is updated if the items have been replaced or modified
+      int sequenceItemNumber = (*sequenceNodeIt == masterSequenceNode) ? itemNumber : (*sequenceNodeIt)->GetItemNumberFromIndexValue(indexValue, false);
+      vtkStreamingVolumeFrame* frame = this->GetSequenceSeeker(*sequenceNodeIt)->GetFrame(sequenceItemNumber);
+      if (!frame)
+      {
+        continue;
+      }
+      if (!this->External->IsDecodedFrameInCache(frame))
+      {
+        ReadAheadItem item;
+        item.SequenceKey = *sequenceNodeIt;
+        item.Frame = frame;
+        readAheadQueue.push_back(item);
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->ReadAheadMutex);
+    this->ReadAheadQueue.swap(readAheadQueue);
+  }
+  this->ReadAheadCondition.notify_one();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::ReleaseFramePayloads(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  BrowserPlaybackState& state = this->BrowserPlaybackStates[browserNode];
+  int selectedItemNumber = browserNode->GetSelectedItemNumber();
+  if (selectedItemNumber != state.PayloadWindowItemNumber)
+  {
+    state.PayloadWindowItemNumber = selectedItemNumber;
+
+    PayloadFrameMap windowFrames;
+    vtkMRMLSequenceNode* masterSequenceNode = browserNode->GetMasterSequenceNode();
+    int numberOfItems = masterSequenceNode ? masterSequenceNode->GetNumberOfDataNodes() : 0;
+    if (numberOfItems > 0 && selectedItemNumber >= 0)
+    {
+      std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+      browserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+      int numberOfWindowItems = 1 + (browserNode->GetPlaybackActive() ? std::max(0, this->ReadAheadNumberOfFrames) : 0);
+      for (int i = 0; i < numberOfWindowItems; ++i)
+      {
+        int itemNumber = selectedItemNumber + i * state.Step;
+        if (itemNumber < 0 || itemNumber >= numberOfItems)
+        {
+          if (!browserNode->GetPlaybackLooped())
+          {
+            break;
+          }
+          itemNumber = ((itemNumber % numberOfItems) + numberOfItems) % numberOfItems;
+        }
+
+        std::string indexValue = masterSequenceNode->GetNthIndexValue(itemNumber);
+        for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+        {
+          int sequenceItemNumber = (*sequenceNodeIt == masterSequenceNode) ? itemNumber : (*sequenceNodeIt)->GetItemNumberFromIndexValue(indexValue, false);
+          if (sequenceItemNumber < 0)
+          {
+            continue;
+          }
+          // Decoding a frame may require decoding all of the frames since the preceding keyframe
+          vtkSlicerIGSIOSequenceSeeker* seeker = this->GetSequenceSeeker(*sequenceNodeIt);
+          int keyFrameItemNumber = seeker->GetNearestKeyFrameItemNumber(sequenceItemNumber);
+          if (keyFrameItemNumber < 0)
+          {
+            keyFrameItemNumber = sequenceItemNumber;
+          }
+          for (int windowItemNumber = keyFrameItemNumber; windowItemNumber <= sequenceItemNumber; ++windowItemNumber)
+          {
+            vtkSlicerIGSIOMkvStreamingVolumeFrame* frame = vtkSlicerIGSIOMkvStreamingVolumeFrame::SafeDownCast(seeker->GetFrame(windowItemNumber));
+            if (frame)
+            {
+              windowFrames[frame] = frame;
+            }
+          }
+        }
+      }
+    }
+
+    for (PayloadFrameMap::iterator frameIt = state.PayloadWindowFrames.begin(); frameIt != state.PayloadWindowFrames.end(); ++frameIt)
+    {
+      if (frameIt->second && windowFrames.find(frameIt->first) == windowFrames.end())
+      {
+        state.PayloadFramesToRelease[frameIt->first] = frameIt->second;
+      }
+    }
+    for (PayloadFrameMap::iterator frameIt = windowFrames.begin(); frameIt != windowFrames.end(); ++frameIt)
+    {
+      state.PayloadFramesToRelease.erase(frameIt->first);
+    }
+    state.PayloadWindowFrames.swap(windowFrames);
+  }
+
+  if (state.PayloadFramesToRelease.empty())
+  {
+    return;
+  }
+  std::vector<vtkSmartPointer<vtkSlicerIGSIOMkvStreamingVolumeFrame> > framesToRelease;
+  std::vector<vtkSlicerIGSIOMkvStreamingVolumeFrame*> framePointersToRelease;
+  for (PayloadFrameMap::iterator frameIt = state.PayloadFramesToRelease.begin(); frameIt != state.PayloadFramesToRelease.end(); ++frameIt)
+  {
+    // Frames that have been deleted are skipped, their address may have been reused
+    vtkSmartPointer<vtkSlicerIGSIOMkvStreamingVolumeFrame> frame = frameIt->second.GetPointer();
+    if (frame)
+    {
+      framesToRelease.push_back(frame);
+      framePointersToRelease.push_back(frame);
+    }
+  }
+  // If frames are being decoded (ex. by the read-ahead thread), the payloads are released at the next update
+  if (vtkSlicerIGSIOMkvStreamingVolumeFrame::ReleaseFrameData(framePointersToRelease))
+  {
+    state.PayloadFramesToRelease.clear();
+  }
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerIGSIOSequenceSeeker* vtkSlicerVideoIOLogic::vtkInternal::GetSequenceSeeker(vtkMRMLSequenceNode* sequenceNode)
+{
+  if (!sequenceNode)
+  {
+    return NULL;
+  }
+  vtkSmartPointer<vtkSlicerIGSIOSequenceSeeker>& seeker = this->SequenceSeekers[sequenceNode];
+  if (!seeker || seeker->GetSequenceNode() != sequenceNode)
+  {
+    // The address of a deleted sequence may be reused by a new sequence
+    seeker = vtkSmartPointer<vtkSlicerIGSIOSequenceSeeker>::New();
+    seeker->SetSequenceNode(sequenceNode);
+  }
+  return seeker;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::UpdateIncrementalWrite(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  BrowserPlaybackState& state = this->BrowserPlaybackStates[browserNode];
+  bool recordingActive = browserNode->GetRecordingActive();
+  bool recordingStopped = state.RecordingActive && !recordingActive;
+  state.RecordingActive = recordingActive;
+  if (!recordingActive && !recordingStopped)
+  {
+    return;
+  }
+  if (recordingStopped)
+  {
+    // Images that are still being encoded on record are stored in the sequences before the remaining frames are written
+    this->External->FlushEncodeOnRecord();
+  }
+
+  std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+  browserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+  for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+  {
+    vtkMRMLStreamingVolumeSequenceStorageNode* storageNode = vtkMRMLStreamingVolumeSequenceStorageNode::SafeDownCast((*sequenceNodeIt)->GetStorageNode());
+    if (!storageNode || !storageNode->GetIncrementalWriteActive())
+    {
+      continue;
+    }
+    if (recordingStopped)
+    {
+      this->FinalizeIncrementalWrite(storageNode);
+    }
+    else
+    {
+      // Frames are queued in blocks to limit the overhead of encoding and writing
+      storageNode->WriteIncrementalFrames(INCREMENTAL_WRITE_NUMBER_OF_FRAMES);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::FinalizeIncrementalWrite(vtkMRMLStreamingVolumeSequenceStorageNode* storageNode)
+{
+  if (!storageNode || !storageNode->GetIncrementalWriteActive())
+  {
+    return;
+  }
+  if (!storageNode->StopIncrementalWrite())
+  {
+    vtkErrorWithObjectMacro(this->External, "FinalizeIncrementalWrite: Could not finalize file: " << storageNode->GetFileName());
+    return;
+  }
+  // All of the frames are in the file, so they are not re-encoded when the sequence is saved
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(storageNode->GetStorableNode());
+  if (sequenceNode)
+  {
+    storageNode->ResetModifiedFrames(sequenceNode);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::StartReadAheadThread()
+{
+  if (this->ReadAheadThread.joinable())
+  {
+    return;
+  }
+  this->ReadAheadThreadRunning = true;
+  this->ReadAheadThread = std::thread(&vtkSlicerVideoIOLogic::vtkInternal::ReadAheadThreadMain, this);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::StopReadAheadThread()
+{
+  if (!this->ReadAheadThread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->ReadAheadMutex);
+    this->ReadAheadThreadRunning = false;
+    this->ReadAheadQueue.clear();
+  }
+  this->ReadAheadCondition.notify_one();
+  this->ReadAheadThread.join();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::ReadAheadThreadMain()
+{
+  // One decoder per sequence, so that consecutive frames of a sequence can be decoded without decoding from the keyframe.
+  // Frames of the synchronized sequences are interleaved in the queue, which would reset the continuity of a shared decoder.
+  std::map<vtkMRMLSequenceNode*, vtkSmartPointer<vtkStreamingVolumeCodec> > codecs;
+  while (true)
+  {
+    ReadAheadItem item;
+    {
+      std::unique_lock<std::mutex> lock(this->ReadAheadMutex);
+      this->ReadAheadCondition.wait(lock, [this] { return !this->ReadAheadThreadRunning || !this->ReadAheadQueue.empty(); });
+      if (!this->ReadAheadThreadRunning)
+      {
+        break;
+      }
+      item = this->ReadAheadQueue.front();
+      this->ReadAheadQueue.pop_front();
+    }
+
+    vtkStreamingVolumeFrame* frame = item.Frame;
+    if (this->External->IsDecodedFrameInCache(frame))
+    {
+      continue;
+    }
+
+    // The decoder is replaced if the codec of the sequence changed
+    std::string codecFourCC = frame->GetCodecFourCC();
+    vtkSmartPointer<vtkStreamingVolumeCodec> codec = codecs[item.SequenceKey];
+    if (!codec || codec->GetFourCC() != codecFourCC)
+    {
+      codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+        vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(codecFourCC));
+      if (!codec)
+      {
+        codecs.erase(item.SequenceKey);
+        continue;
+      }
+      codecs[item.SequenceKey] = codec;
+    }
+
+    vtkSmartPointer<vtkImageData> decodedImage = vtkSmartPointer<vtkImageData>::New();
+    vtkSlicerIGSIOImagePool::GetInstance()->AllocateDecodedImage(frame, decodedImage);
+    vtkSlicerIGSIOInstrumentation::ScopedTimer timer("ReadAheadDecode");
+    if (vtkSlicerIGSIOCommon::DecodeFrame(codec, frame, decodedImage))
+    {
+      this->InsertDecodedFrame(frame, decodedImage);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::StartEncodeOnRecordThread()
+{
+  if (this->EncodeOnRecordThread.joinable())
+  {
+    return;
+  }
+  this->EncodeOnRecordThreadRunning = true;
+  this->EncodeOnRecordThread = std::thread(&vtkSlicerVideoIOLogic::vtkInternal::EncodeOnRecordThreadMain, this);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::StopEncodeOnRecordThread()
+{
+  if (!this->EncodeOnRecordThread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->EncodeOnRecordMutex);
+    this->EncodeOnRecordThreadRunning = false;
+    this->EncodeOnRecordQueue.clear();
+  }
+  this->EncodeOnRecordCondition.notify_one();
+  this->EncodeOnRecordDoneCondition.notify_all();
+  this->EncodeOnRecordThread.join();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::vtkInternal::EncodeOnRecordThreadMain()
+{
+  // One encoder per recorded node, so that consecutive images of the node can be encoded as inter frames
+  std::map<std::string, vtkSmartPointer<vtkStreamingVolumeCodec> > codecs;
+  while (true)
+  {
+    EncodeOnRecordItem item;
+    {
+      std::unique_lock<std::mutex> lock(this->EncodeOnRecordMutex);
+      this->EncodeOnRecordCondition.wait(lock, [this] { return !this->EncodeOnRecordThreadRunning || !this->EncodeOnRecordQueue.empty(); });
+      if (!this->EncodeOnRecordThreadRunning)
+      {
+        break;
+      }
+      item = this->EncodeOnRecordQueue.front();
+      this->EncodeOnRecordQueue.pop_front();
+      ++this->NumberOfImagesBeingEncodedOnRecord;
+    }
+
+    vtkSmartPointer<vtkStreamingVolumeCodec> codec = codecs[item.StreamKey];
+    if (!codec || codec->GetFourCC() != item.CodecFourCC)
+    {
+      codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+        vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(item.CodecFourCC));
+      if (codec && !item.CodecPreset.empty())
+      {
+        codec->SetParametersFromPresetValue(item.CodecPreset);
+      }
+      codecs[item.StreamKey] = codec;
+    }
+
+    if (codec)
+    {
+      vtkSlicerIGSIOInstrumentation::ScopedTimer timer("EncodeOnRecord");
+      vtkSmartPointer<vtkStreamingVolumeFrame> frame = vtkSmartPointer<vtkStreamingVolumeFrame>::New();
+      if (vtkSlicerIGSIOCommon::EncodeImageData(codec, item.Image, frame, item.ForceKeyFrame))
+      {
+        item.Frame = frame;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->EncodeOnRecordMutex);
+      --this->NumberOfImagesBeingEncodedOnRecord;
+      this->EncodedOnRecordItems.push_back(item);
+    }
+    this->EncodeOnRecordDoneCondition.notify_all();
+  }
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerVideoIOLogic methods
+
+//---------------------------------------------------------------------------
+vtkSlicerVideoIOLogic::vtkSlicerVideoIOLogic()
+{
+  this->Internal = new vtkInternal(this);
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerVideoIOLogic::~vtkSlicerVideoIOLogic()
+{
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::RegisterNodes()
+{
+  if (this->GetMRMLScene() == NULL)
+  {
+    vtkErrorMacro("Scene is invalid");
+    return;
+  }
+
+  this->GetMRMLScene()->RegisterNodeClass(vtkSmartPointer<vtkMRMLStreamingVolumeSequenceStorageNode>::New());
+  vtkMRMLNodeSequencer::GetInstance()->RegisterNodeSequencer(new StreamingVolumeNodeSequencer(this));
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetMRMLSceneInternal(vtkMRMLScene* newScene)
+{
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
+  events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
+  events->InsertNextValue(vtkMRMLScene::StartCloseEvent);
+  events->InsertNextValue(vtkMRMLScene::EndCloseEvent);
+  this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
+{
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(node);
+  if (browserNode)
+  {
+    vtkObserveMRMLNodeMacro(browserNode);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(node);
+  if (browserNode)
+  {
+    vtkUnObserveMRMLNodeMacro(browserNode);
+    this->Internal->BrowserPlaybackStates.erase(browserNode);
+    this->Internal->TransformTrackProxies.erase(browserNode);
+  }
+
+  vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(node);
+  if (streamingVolumeNode && this->Internal->SharedRecordedImages.find(streamingVolumeNode) != this->Internal->SharedRecordedImages.end())
+  {
+    // The recorded items keep sharing the image, which is no longer modified by the node
+    vtkUnObserveMRMLNodeMacro(streamingVolumeNode);
+    this->Internal->SharedRecordedImages.erase(streamingVolumeNode);
+  }
+
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(node);
+  if (sequenceNode)
+  {
+    this->Internal->SequenceSeekers.erase(sequenceNode);
+    this->Internal->SequenceNodesBySequenceScene.erase(sequenceNode->GetSequenceScene());
+  }
+
+  // The frames that have been queued are still written
+  this->Internal->FinalizeIncrementalWrite(vtkMRMLStreamingVolumeSequenceStorageNode::SafeDownCast(node));
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::OnMRMLSceneStartClose()
+{
+  // Incrementally written files are finalized while the sequences are still in the scene
+  this->FlushEncodeOnRecord();
+  std::vector<vtkMRMLNode*> storageNodes;
+  this->GetMRMLScene()->GetNodesByClass("vtkMRMLStreamingVolumeSequenceStorageNode", storageNodes);
+  for (std::vector<vtkMRMLNode*>::iterator storageNodeIt = storageNodes.begin(); storageNodeIt != storageNodes.end(); ++storageNodeIt)
+  {
+    this->Internal->FinalizeIncrementalWrite(vtkMRMLStreamingVolumeSequenceStorageNode::SafeDownCast(*storageNodeIt));
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::OnMRMLSceneEndClose()
+{
+  this->FlushEncodeOnRecord();
+  this->Internal->EncodeOnRecordStreamGaps.clear();
+  this->Internal->SharedRecordedImages.clear();
+  this->Internal->BrowserPlaybackStates.clear();
+  this->Internal->TransformTrackProxies.clear();
+  this->Internal->SequenceSeekers.clear();
+  this->Internal->SequenceNodesBySequenceScene.clear();
+  this->ClearDecodedFrameCache();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(caller);
+  if (streamingVolumeNode && event == ImageDataAboutToBeModifiedEvent)
+  {
+    this->MaterializeRecordedImages(streamingVolumeNode);
+  }
+
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(caller);
+  if (browserNode && event == vtkCommand::ModifiedEvent)
+  {
+    this->Internal->UpdateReadAhead(browserNode);
+    this->Internal->ReleaseFramePayloads(browserNode);
+    this->UpdateTransformTrackProxyNodes(browserNode);
+    this->UpdateEncodeOnRecordFrames();
+    this->Internal->UpdateIncrementalWrite(browserNode);
+  }
+  this->Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetReadAheadNumberOfFrames(int numberOfFrames)
+{
+  if (this->Internal->ReadAheadNumberOfFrames == numberOfFrames)
+  {
+    return;
+  }
+  this->Internal->ReadAheadNumberOfFrames = numberOfFrames;
+  if (numberOfFrames > 0)
+  {
+    this->Internal->StartReadAheadThread();
+  }
+  else
+  {
+    this->Internal->StopReadAheadThread();
+  }
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetReadAheadNumberOfFrames()
+{
+  return this->Internal->ReadAheadNumberOfFrames;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerIGSIOSequenceSeeker* vtkSlicerVideoIOLogic::GetSequenceSeeker(vtkMRMLNode* dataNode)
+{
+  // Data nodes of the sequences are in the internal scenes of the sequences
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  vtkMRMLScene* sequenceScene = dataNode ? dataNode->GetScene() : NULL;
+  if (!scene || !sequenceScene || sequenceScene == scene)
+  {
+    return NULL;
+  }
+
+  vtkMRMLSequenceNode* sequenceNode = this->Internal->SequenceNodesBySequenceScene[sequenceScene];
+  if (!sequenceNode || sequenceNode->GetSequenceScene() != sequenceScene)
+  {
+    sequenceNode = NULL;
+    std::vector<vtkMRMLNode*> sequenceNodes;
+    scene->GetNodesByClass("vtkMRMLSequenceNode", sequenceNodes);
+    for (std::vector<vtkMRMLNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+    {
+      vtkMRMLSequenceNode* candidateSequenceNode = vtkMRMLSequenceNode::SafeDownCast(*sequenceNodeIt);
+      if (candidateSequenceNode && candidateSequenceNode->GetSequenceScene() == sequenceScene)
+      {
+        sequenceNode = candidateSequenceNode;
+        break;
+      }
+    }
+    if (!sequenceNode)
+    {
+      this->Internal->SequenceNodesBySequenceScene.erase(sequenceScene);
+      return NULL;
+    }
+    this->Internal->SequenceNodesBySequenceScene[sequenceScene] = sequenceNode;
+  }
+  return this->Internal->GetSequenceSeeker(sequenceNode);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetRecordingCopyMode(int mode)
+{
+  if (mode < 0 || mode >= RecordingCopyMode_Last)
+  {
+    vtkErrorMacro("SetRecordingCopyMode: Invalid mode: " << mode);
+    return;
+  }
+  if (this->Internal->RecordingCopyMode == mode)
+  {
+    return;
+  }
+  this->Internal->RecordingCopyMode = mode;
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetRecordingCopyMode()
+{
+  return this->Internal->RecordingCopyMode;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::ShareRecordedImage(vtkMRMLStreamingVolumeNode* sourceNode, vtkMRMLStreamingVolumeNode* targetNode)
+{
+  if (!sourceNode || !targetNode)
+  {
+    vtkErrorMacro("ShareRecordedImage: Invalid arguments");
+    return false;
+  }
+
+  vtkImageData* sourceImage = sourceNode->GetImageData();
+  vtkDataArray* sourceScalars = sourceImage ? sourceImage->GetPointData()->GetScalars() : NULL;
+  if (!sourceScalars)
+  {
+    return false;
+  }
+
+  std::map<vtkMRMLStreamingVolumeNode*, vtkInternal::SharedRecordedImage>::iterator sharedImageIt =
+    this->Internal->SharedRecordedImages.find(sourceNode);
+  if (sharedImageIt != this->Internal->SharedRecordedImages.end() && sharedImageIt->second.SourceNode.GetPointer() != sourceNode)
+  {
+    // The address of a deleted node was reused by the new node
+    this->Internal->SharedRecordedImages.erase(sharedImageIt);
+    sharedImageIt = this->Internal->SharedRecordedImages.end();
+  }
+  if (sharedImageIt == this->Internal->SharedRecordedImages.end())
+  {
+    // Nodes that were deleted without being removed from the scene no longer need their entries
+    for (sharedImageIt = this->Internal->SharedRecordedImages.begin(); sharedImageIt != this->Internal->SharedRecordedImages.end();)
+    {
+      if (!sharedImageIt->second.SourceNode)
+      {
+        this->Internal->SharedRecordedImages.erase(sharedImageIt++);
+      }
+      else
+      {
+        ++sharedImageIt;
+      }
+    }
+    vtkNew<vtkIntArray> events;
+    events->InsertNextValue(ImageDataAboutToBeModifiedEvent);
+    vtkObserveMRMLNodeEventsMacro(sourceNode, events.GetPointer());
+    sharedImageIt = this->Internal->SharedRecordedImages.insert(
+      std::make_pair(sourceNode, vtkInternal::SharedRecordedImage())).first;
+    sharedImageIt->second.SourceNode = sourceNode;
+  }
+
+  vtkInternal::SharedRecordedImage& sharedImage = sharedImageIt->second;
+  if (sharedImage.CopyOnWriteDisabled)
+  {
+    return false;
+  }
+  if (sharedImage.Scalars.GetPointer() == sourceScalars)
+  {
+    if (sourceImage->GetMTime() != sharedImage.ImageMTime || sourceScalars->GetMTime() != sharedImage.ScalarsMTime)
+    {
+      vtkWarningMacro("ShareRecordedImage: " << (sourceNode->GetName() ? sourceNode->GetName() : "")
+        << " modified its image in place without invoking ImageDataAboutToBeModifiedEvent. The previously recorded image may have been"
+        << " overwritten. Recorded images of the node are deep copied from now on.");
+      sharedImage.CopyOnWriteDisabled = true;
+      sharedImage.TargetNodes.clear();
+      return false;
+    }
+  }
+  else
+  {
+    // The node has a new image, the items that shared the previous image are no longer affected by the node
+    sharedImage.Scalars = sourceScalars;
+    sharedImage.ImageMTime = sourceImage->GetMTime();
+    sharedImage.ScalarsMTime = sourceScalars->GetMTime();
+    sharedImage.TargetNodes.clear();
+  }
+
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->ShallowCopy(sourceImage);
+  targetNode->SetAndObserveImageData(image);
+  // Items that were removed from their sequences no longer need to be materialized
+  sharedImage.TargetNodes.erase(std::remove(sharedImage.TargetNodes.begin(), sharedImage.TargetNodes.end(),
+    vtkWeakPointer<vtkMRMLStreamingVolumeNode>()), sharedImage.TargetNodes.end());
+  sharedImage.TargetNodes.push_back(targetNode);
+  ++this->Internal->NumberOfSharedRecordedImages;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::MaterializeRecordedImages(vtkMRMLStreamingVolumeNode* sourceNode)
+{
+  std::map<vtkMRMLStreamingVolumeNode*, vtkInternal::SharedRecordedImage>::iterator sharedImageIt =
+    this->Internal->SharedRecordedImages.find(sourceNode);
+  if (sharedImageIt == this->Internal->SharedRecordedImages.end())
+  {
+    return;
+  }
+
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("MaterializeRecordedImages");
+  vtkInternal::SharedRecordedImage& sharedImage = sharedImageIt->second;
+  for (std::vector<vtkWeakPointer<vtkMRMLStreamingVolumeNode> >::iterator targetNodeIt = sharedImage.TargetNodes.begin();
+    targetNodeIt != sharedImage.TargetNodes.end(); ++targetNodeIt)
+  {
+    vtkMRMLStreamingVolumeNode* targetNode = *targetNodeIt;
+    if (!targetNode || targetNode->GetFrame())
+    {
+      continue;
+    }
+    vtkImageData* targetImage = targetNode->GetImageData();
+    if (!targetImage || !sharedImage.Scalars || targetImage->GetPointData()->GetScalars() != sharedImage.Scalars.GetPointer())
+    {
+      // The item no longer shares the image of the node
+      continue;
+    }
+    vtkSmartPointer<vtkImageData> imageCopy = vtkSmartPointer<vtkImageData>::New();
+    vtkSlicerIGSIOImagePool::GetInstance()->CopyImage(targetImage, imageCopy);
+    targetNode->SetAndObserveImageData(imageCopy);
+    ++this->Internal->NumberOfMaterializedRecordedImages;
+  }
+
+  // The next recorded image of the node is shared again
+  sharedImage.Scalars = NULL;
+  sharedImage.TargetNodes.clear();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetNumberOfSharedRecordedImages()
+{
+  return this->Internal->NumberOfSharedRecordedImages;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetNumberOfMaterializedRecordedImages()
+{
+  return this->Internal->NumberOfMaterializedRecordedImages;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::SetEncodeOnRecordCodecFourCC(const std::string& codecFourCC)
+{
+  if (codecFourCC == this->GetEncodeOnRecordCodecFourCC())
+  {
+    return true;
+  }
+
+  if (!codecFourCC.empty())
+  {
+    vtkSmartPointer<vtkStreamingVolumeCodec> codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+      vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(codecFourCC));
+    if (!codec)
+    {
+      vtkErrorMacro("SetEncodeOnRecordCodecFourCC: Could not find codec: " << codecFourCC);
+      return false;
+    }
+  }
+
+  // Images that were queued with the previous codec are encoded before the codec is changed
+  this->FlushEncodeOnRecord();
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+    this->Internal->EncodeOnRecordCodecFourCC = codecFourCC;
+  }
+  if (codecFourCC.empty())
+  {
+    this->Internal->StopEncodeOnRecordThread();
+  }
+  else
+  {
+    this->Internal->StartEncodeOnRecordThread();
+  }
+  this->Modified();
+  return true;
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerVideoIOLogic::GetEncodeOnRecordCodecFourCC()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+  return this->Internal->EncodeOnRecordCodecFourCC;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetEncodeOnRecordCodecPreset(const std::string& presetValue)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+    if (this->Internal->EncodeOnRecordCodecPreset == presetValue)
+    {
+      return;
+    }
+    this->Internal->EncodeOnRecordCodecPreset = presetValue;
+  }
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerVideoIOLogic::GetEncodeOnRecordCodecPreset()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+  return this->Internal->EncodeOnRecordCodecPreset;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetEncodeOnRecordQueueSize(int queueSize)
+{
+  if (queueSize < 1)
+  {
+    vtkErrorMacro("SetEncodeOnRecordQueueSize: Invalid queue size: " << queueSize);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+    if (this->Internal->EncodeOnRecordQueueSize == queueSize)
+    {
+      return;
+    }
+    this->Internal->EncodeOnRecordQueueSize = queueSize;
+  }
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetEncodeOnRecordQueueSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+  return this->Internal->EncodeOnRecordQueueSize;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetEncodeOnRecordOverflowPolicy(int policy)
+{
+  if (policy < 0 || policy >= EncodeOnRecordOverflowPolicy_Last)
+  {
+    vtkErrorMacro("SetEncodeOnRecordOverflowPolicy: Invalid policy: " << policy);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+    if (this->Internal->EncodeOnRecordOverflowPolicy == policy)
+    {
+      return;
+    }
+    this->Internal->EncodeOnRecordOverflowPolicy = policy;
+  }
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetEncodeOnRecordOverflowPolicy()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+  return this->Internal->EncodeOnRecordOverflowPolicy;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::EncodeOnRecord(vtkMRMLStreamingVolumeNode* sourceNode, vtkMRMLStreamingVolumeNode* targetNode)
+{
+  if (!sourceNode || !targetNode)
+  {
+    vtkErrorMacro("EncodeOnRecord: Invalid arguments");
+    return false;
+  }
+
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("EncodeOnRecordQueue");
+
+  // Store the images that have been encoded since the last recorded image, so that they can be released
+  this->UpdateEncodeOnRecordFrames();
+
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  if (sourceNode->GetImageData())
+  {
+    vtkSlicerIGSIOImagePool::GetInstance()->CopyImage(sourceNode->GetImageData(), image);
+  }
+  targetNode->SetAndObserveImageData(image);
+
+  std::string streamKey;
+  if (sourceNode->GetID())
+  {
+    streamKey = sourceNode->GetID();
+  }
+  else
+  {
+    std::stringstream streamKeyStream;
+    streamKeyStream << sourceNode;
+    streamKey = streamKeyStream.str();
+  }
+
+  int* dimensions = image->GetDimensions();
+  if (dimensions[0] * dimensions[1] * dimensions[2] == 0)
+  {
+    return false;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+    if (this->Internal->EncodeOnRecordCodecFourCC.empty() || !this->Internal->EncodeOnRecordThreadRunning)
+    {
+      return false;
+    }
+
+    if (this->Internal->EncodeOnRecordOverflowPolicy == EncodeOnRecordWait)
+    {
+      this->Internal->EncodeOnRecordDoneCondition.wait(lock, [this] {
+        return !this->Internal->EncodeOnRecordThreadRunning
+          || (int)this->Internal->EncodeOnRecordQueue.size() + this->Internal->NumberOfImagesBeingEncodedOnRecord < this->Internal->EncodeOnRecordQueueSize; });
+    }
+    if (!this->Internal->EncodeOnRecordThreadRunning
+      || (int)this->Internal->EncodeOnRecordQueue.size() + this->Internal->NumberOfImagesBeingEncodedOnRecord >= this->Internal->EncodeOnRecordQueueSize)
+    {
+      // The encoder has fallen behind, the image stays uncompressed in the sequence
+      this->Internal->EncodeOnRecordStreamGaps[streamKey] = true;
+      ++this->Internal->NumberOfFramesStoredUncompressedOnRecord;
+      return false;
+    }
+
+    vtkInternal::EncodeOnRecordItem item;
+    item.StreamKey = streamKey;
+    item.CodecFourCC = this->Internal->EncodeOnRecordCodecFourCC;
+    item.CodecPreset = this->Internal->EncodeOnRecordCodecPreset;
+    // A key frame is forced after a gap, so that the encoded frames do not reference a frame that is not in the sequence
+    item.ForceKeyFrame = this->Internal->EncodeOnRecordStreamGaps[streamKey];
+    this->Internal->EncodeOnRecordStreamGaps[streamKey] = false;
+    item.TargetNode = targetNode;
+    item.Image = image;
+    this->Internal->EncodeOnRecordQueue.push_back(item);
+  }
+  this->Internal->EncodeOnRecordCondition.notify_one();
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::UpdateEncodeOnRecordFrames()
+{
+  std::deque<vtkInternal::EncodeOnRecordItem> encodedItems;
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+    encodedItems.swap(this->Internal->EncodedOnRecordItems);
+  }
+
+  vtkSlicerIGSIOImagePool* imagePool = vtkSlicerIGSIOImagePool::GetInstance();
+  for (std::deque<vtkInternal::EncodeOnRecordItem>::iterator itemIt = encodedItems.begin(); itemIt != encodedItems.end(); ++itemIt)
+  {
+    vtkMRMLStreamingVolumeNode* targetNode = itemIt->TargetNode;
+    if (!itemIt->Frame)
+    {
+      vtkErrorMacro("UpdateEncodeOnRecordFrames: Could not encode recorded image with codec: " << itemIt->CodecFourCC);
+      continue;
+    }
+    if (!targetNode || targetNode->GetFrame() || targetNode->GetImageData() != itemIt->Image.GetPointer())
+    {
+      // The sequence item was removed or modified since it was recorded
+      continue;
+    }
+
+    // The uncompressed image is released, the frame is decoded when the item is displayed
+    int wasModifying = targetNode->StartModify();
+    targetNode->SetAndObserveImageData(NULL);
+    targetNode->SetAndObserveFrame(itemIt->Frame);
+    targetNode->EndModify(wasModifying);
+    ++this->Internal->NumberOfFramesEncodedOnRecord;
+
+    // The buffer of the image is reused for the next recorded images
+    vtkSmartPointer<vtkImageData> image = itemIt->Image;
+    itemIt->Image = NULL;
+    imagePool->ReleaseImage(image);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::FlushEncodeOnRecord()
+{
+  {
+    std::unique_lock<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+    this->Internal->EncodeOnRecordDoneCondition.wait(lock, [this] {
+      return !this->Internal->EncodeOnRecordThreadRunning
+        || (this->Internal->EncodeOnRecordQueue.empty() && this->Internal->NumberOfImagesBeingEncodedOnRecord == 0); });
+  }
+  this->UpdateEncodeOnRecordFrames();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetEncodeOnRecordQueueLength()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+  return (int)this->Internal->EncodeOnRecordQueue.size() + this->Internal->NumberOfImagesBeingEncodedOnRecord;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetNumberOfFramesEncodedOnRecord()
+{
+  return this->Internal->NumberOfFramesEncodedOnRecord;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetNumberOfFramesStoredUncompressedOnRecord()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+  return this->Internal->NumberOfFramesStoredUncompressedOnRecord;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::ResetEncodeOnRecordStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->EncodeOnRecordMutex);
+  this->Internal->NumberOfFramesEncodedOnRecord = 0;
+  this->Internal->NumberOfFramesStoredUncompressedOnRecord = 0;
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkSlicerVideoIOLogic::AddTransformTrack(vtkMRMLSequenceBrowserNode* browserNode, vtkSlicerIGSIOTransformTrack* transformTrack)
+{
+  if (!browserNode || !transformTrack)
+  {
+    vtkErrorMacro("AddTransformTrack: Invalid arguments");
+    return NULL;
+  }
+
+  vtkMRMLScene* scene = browserNode->GetScene();
+  if (!scene)
+  {
+    vtkErrorMacro("AddTransformTrack: Sequence browser node is not in a scene");
+    return NULL;
+  }
+
+  const char* transformName = transformTrack->GetTransformName() ? transformTrack->GetTransformName() : "Transform";
+  vtkMRMLLinearTransformNode* proxyNode = vtkMRMLLinearTransformNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLLinearTransformNode", transformName));
+  if (!proxyNode)
+  {
+    vtkErrorMacro("AddTransformTrack: Could not create proxy node");
+    return NULL;
+  }
+
+  vtkInternal::TransformTrackProxy transformTrackProxy;
+  transformTrackProxy.Track = transformTrack;
+  transformTrackProxy.ProxyNode = proxyNode;
+  transformTrackProxy.TransformIndex = -1;
+  transformTrackProxy.TrackMTime = 0;
+  this->Internal->TransformTrackProxies[browserNode].push_back(transformTrackProxy);
+
+  this->UpdateTransformTrackProxyNodes(browserNode);
+  return proxyNode;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::AddTransformTracks(vtkMRMLSequenceBrowserNode* browserNode, vtkCollection* transformTracks)
+{
+  if (!transformTracks)
+  {
+    return;
+  }
+  for (int i = 0; i < transformTracks->GetNumberOfItems(); ++i)
+  {
+    vtkSlicerIGSIOTransformTrack* transformTrack = vtkSlicerIGSIOTransformTrack::SafeDownCast(transformTracks->GetItemAsObject(i));
+    if (transformTrack)
+    {
+      this->AddTransformTrack(browserNode, transformTrack);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetNumberOfTransformTracks(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  std::map<vtkMRMLSequenceBrowserNode*, std::vector<vtkInternal::TransformTrackProxy> >::iterator transformTrackProxiesIt =
+    this->Internal->TransformTrackProxies.find(browserNode);
+  if (transformTrackProxiesIt == this->Internal->TransformTrackProxies.end())
+  {
+    return 0;
+  }
+  return transformTrackProxiesIt->second.size();
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerIGSIOTransformTrack* vtkSlicerVideoIOLogic::GetNthTransformTrack(vtkMRMLSequenceBrowserNode* browserNode, int n)
+{
+  if (n < 0 || n >= this->GetNumberOfTransformTracks(browserNode))
+  {
+    return NULL;
+  }
+  return this->Internal->TransformTrackProxies[browserNode][n].Track;
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkSlicerVideoIOLogic::GetNthTransformTrackProxyNode(vtkMRMLSequenceBrowserNode* browserNode, int n)
+{
+  if (n < 0 || n >= this->GetNumberOfTransformTracks(browserNode))
+  {
+    return NULL;
+  }
+  return this->Internal->TransformTrackProxies[browserNode][n].ProxyNode;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::RemoveTransformTracks(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  this->Internal->TransformTrackProxies.erase(browserNode);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::UpdateTransformTrackProxyNodes(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  std::map<vtkMRMLSequenceBrowserNode*, std::vector<vtkInternal::TransformTrackProxy> >::iterator transformTrackProxiesIt =
+    this->Internal->TransformTrackProxies.find(browserNode);
+  if (transformTrackProxiesIt == this->Internal->TransformTrackProxies.end())
+  {
+    return;
+  }
+
+  vtkMRMLSequenceNode* masterSequenceNode = browserNode->GetMasterSequenceNode();
+  int selectedItemNumber = browserNode->GetSelectedItemNumber();
+  if (!masterSequenceNode || selectedItemNumber < 0 || selectedItemNumber >= masterSequenceNode->GetNumberOfDataNodes())
+  {
+    return;
+  }
+  double timestamp = vtkVariant(masterSequenceNode->GetNthIndexValue(selectedItemNumber)).ToDouble();
+
+  vtkNew<vtkMatrix4x4> transformMatrix;
+  std::vector<vtkInternal::TransformTrackProxy>& transformTrackProxies = transformTrackProxiesIt->second;
+  for (std::vector<vtkInternal::TransformTrackProxy>::iterator transformTrackProxyIt = transformTrackProxies.begin();
+    transformTrackProxyIt != transformTrackProxies.end(); ++transformTrackProxyIt)
+  {
+    vtkMRMLLinearTransformNode* proxyNode = transformTrackProxyIt->ProxyNode;
+    if (!proxyNode)
+    {
+      continue;
+    }
+
+    // The proxy node is only modified if a different transform is selected
+    int transformIndex = transformTrackProxyIt->Track->GetClosestTransformIndex(timestamp);
+    if (transformIndex < 0 || (transformIndex == transformTrackProxyIt->TransformIndex
+      && transformTrackProxyIt->Track->GetMTime() == transformTrackProxyIt->TrackMTime))
+    {
+      continue;
+    }
+    transformTrackProxyIt->TransformIndex = transformIndex;
+    transformTrackProxyIt->TrackMTime = transformTrackProxyIt->Track->GetMTime();
+
+    transformTrackProxyIt->Track->GetNthTransform(transformIndex, transformMatrix.GetPointer());
+    proxyNode->SetMatrixTransformToParent(transformMatrix.GetPointer());
+  }
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerIGSIOImagePool* vtkSlicerVideoIOLogic::GetImagePool()
+{
+  return vtkSlicerIGSIOImagePool::GetInstance();
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerIGSIOInstrumentation* vtkSlicerVideoIOLogic::GetInstrumentation()
+{
+  return vtkSlicerIGSIOInstrumentation::GetInstance();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetInstrumentationEnabled(bool enabled)
+{
+  vtkSlicerIGSIOInstrumentation::GetInstance()->SetEnabled(enabled);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::GetInstrumentationEnabled()
+{
+  return vtkSlicerIGSIOInstrumentation::GetInstance()->GetEnabled();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::ResetInstrumentation()
+{
+  vtkSlicerIGSIOInstrumentation::GetInstance()->Reset();
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerVideoIOLogic::GetInstrumentationReport()
+{
+  return vtkSlicerIGSIOInstrumentation::GetInstance()->GetReport();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetTracingEnabled(bool enabled)
+{
+  vtkSlicerIGSIOInstrumentation::GetInstance()->SetTracingEnabled(enabled);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::GetTracingEnabled()
+{
+  return vtkSlicerIGSIOInstrumentation::GetInstance()->GetTracingEnabled();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::WriteTrace(const std::string& fileName)
+{
+  return vtkSlicerIGSIOInstrumentation::GetInstance()->WriteTrace(fileName);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::ClearTrace()
+{
+  vtkSlicerIGSIOInstrumentation::GetInstance()->ClearTrace();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::SetDecodedFrameCacheSize(unsigned long long numberOfBytes)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+    if (this->Internal->DecodedFrameCacheSize == numberOfBytes)
+    {
+      return;
+    }
+    this->Internal->DecodedFrameCacheSize = numberOfBytes;
+    this->Internal->EvictDecodedFrames();
+  }
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+unsigned long long vtkSlicerVideoIOLogic::GetDecodedFrameCacheSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  return this->Internal->DecodedFrameCacheSize;
+}
+
+//---------------------------------------------------------------------------
+unsigned long long vtkSlicerVideoIOLogic::GetDecodedFrameCacheMemoryUsage()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  return this->Internal->DecodedFrameCacheMemoryUsage;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetNumberOfDecodedFramesInCache()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  return (int)this->Internal->DecodedFrames.size();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::GetDecodedFrameFromCache(vtkStreamingVolumeFrame* frame, vtkImageData* outputImage)
+{
+  if (!frame || !outputImage)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  std::map<vtkStreamingVolumeFrame*, vtkInternal::DecodedFrameList::iterator>::iterator lookupIt =
+    this->Internal->DecodedFrameLookup.find(frame);
+  if (lookupIt == this->Internal->DecodedFrameLookup.end())
+  {
+    ++this->Internal->DecodedFrameCacheMisses;
+    return false;
+  }
+
+  vtkInternal::DecodedFrameList::iterator decodedFrameIt = lookupIt->second;
+  if (decodedFrameIt->Frame.GetPointer() != frame || decodedFrameIt->FrameMTime != frame->GetMTime())
+  {
+    // The cached image is out of date
+    this->Internal->DecodedFrameCacheMemoryUsage -= decodedFrameIt->NumberOfBytes;
+    this->Internal->ReleaseDecodedFrame(decodedFrameIt);
+    this->Internal->DecodedFrameLookup.erase(lookupIt);
+    ++this->Internal->DecodedFrameCacheMisses;
+    return false;
+  }
+
+  // Move to the front of the list to mark as most recently used
+  this->Internal->DecodedFrames.splice(this->Internal->DecodedFrames.begin(), this->Internal->DecodedFrames, decodedFrameIt);
+  vtkSlicerIGSIOImagePool::GetInstance()->CopyImage(decodedFrameIt->Image, outputImage);
+  ++this->Internal->DecodedFrameCacheHits;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::AddDecodedFrameToCache(vtkStreamingVolumeFrame* frame, vtkImageData* decodedImage)
+{
+  if (!frame || !decodedImage)
+  {
+    return;
+  }
+
+  vtkSmartPointer<vtkImageData> imageCopy = vtkSmartPointer<vtkImageData>::New();
+  vtkSlicerIGSIOImagePool::GetInstance()->CopyImage(decodedImage, imageCopy);
+  this->Internal->InsertDecodedFrame(frame, imageCopy);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerVideoIOLogic::IsDecodedFrameInCache(vtkStreamingVolumeFrame* frame)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  std::map<vtkStreamingVolumeFrame*, vtkInternal::DecodedFrameList::iterator>::iterator lookupIt =
+    this->Internal->DecodedFrameLookup.find(frame);
+  return lookupIt != this->Internal->DecodedFrameLookup.end()
+    && lookupIt->second->Frame.GetPointer() == frame
+    && lookupIt->second->FrameMTime == frame->GetMTime();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::ClearDecodedFrameCache()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  while (!this->Internal->DecodedFrames.empty())
+  {
+    this->Internal->ReleaseDecodedFrame(this->Internal->DecodedFrames.begin());
+  }
+  this->Internal->DecodedFrameLookup.clear();
+  this->Internal->DecodedFrameCacheMemoryUsage = 0;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetDecodedFrameCacheHits()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  return this->Internal->DecodedFrameCacheHits;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerVideoIOLogic::GetDecodedFrameCacheMisses()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  return this->Internal->DecodedFrameCacheMisses;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerVideoIOLogic::ResetDecodedFrameCacheStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CacheMutex);
+  this->Internal->DecodedFrameCacheHits = 0;
+  this->Internal->DecodedFrameCacheMisses = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -211,4 +1921,18 @@ void vtkSlicerVideoIOLogic::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->vtkObject::PrintSelf(os, indent);
   os << indent << "vtkSlicerVideoIOLogic:             " << this->GetClassName() << "\n";
+  os << indent << "DecodedFrameCacheSize:             " << this->GetDecodedFrameCacheSize() << "\n";
+  os << indent << "DecodedFrameCacheMemoryUsage:      " << this->GetDecodedFrameCacheMemoryUsage() << "\n";
+  os << indent << "DecodedFrameCacheHits:             " << this->GetDecodedFrameCacheHits() << "\n";
+  os << indent << "DecodedFrameCacheMisses:           " << this->GetDecodedFrameCacheMisses() << "\n";
+  os << indent << "ReadAheadNumberOfFrames:           " << this->GetReadAheadNumberOfFrames() << "\n";
+  os << indent << "RecordingCopyMode:                 " << this->GetRecordingCopyMode() << "\n";
+  os << indent << "EncodeOnRecordCodecFourCC:         " << this->GetEncodeOnRecordCodecFourCC() << "\n";
+  os << indent << "EncodeOnRecordCodecPreset:         " << this->GetEncodeOnRecordCodecPreset() << "\n";
+  os << indent << "EncodeOnRecordQueueSize:           " << this->GetEncodeOnRecordQueueSize() << "\n";
+  os << indent << "EncodeOnRecordOverflowPolicy:      " << this->GetEncodeOnRecordOverflowPolicy() << "\n";
+  os << indent << "ImagePoolHitRate:                  " << this->GetImagePool()->GetHitRate() << "\n";
+  os << indent << "ImagePoolResidentSize:             " << this->GetImagePool()->GetResidentSize() << "\n";
+  os << indent << "InstrumentationEnabled:            " << (this->GetInstrumentationEnabled() ? "true" : "false") << "\n";
+  os << indent << "TracingEnabled:                    " << (this->GetTracingEnabled() ? "true" : "false") << "\n";
 }
@@ -37,12 +37,50 @@ Care Ontario.
 // Sequences MRML includes
 #include <vtkMRMLSequenceBrowserNode.h>
 
+class vtkCollection;
 class vtkMRMLIGTLConnectorNode;
+class vtkMRMLLinearTransformNode;
+class vtkMRMLStreamingVolumeNode;
+class vtkImageData;
+class vtkSlicerIGSIOImagePool;
+class vtkSlicerIGSIOInstrumentation;
+class vtkSlicerIGSIOSequenceSeeker;
+class vtkSlicerIGSIOTransformTrack;
+class vtkStreamingVolumeFrame;
 
 /// \ingroup Slicer_QtModules_VideoIO
 class VTK_SLICER_VIDEOIO_MODULE_LOGIC_EXPORT vtkSlicerVideoIOLogic : public vtkSlicerModuleLogic
 {
  public:
+  enum Events
+  {
+    /// Invoke this event on a streaming volume node before writing into its image data in place, so that the sequence
+    /// items that share the image (see RecordingCopyOnWrite) are copied before they are overwritten.
+    /// Example (Python): volumeNode.InvokeEvent(slicer.vtkSlicerVideoIOLogic.ImageDataAboutToBeModifiedEvent)
+    ImageDataAboutToBeModifiedEvent = vtkCommand::UserEvent + 1850
+  };
+
+  enum RecordingCopyMode
+  {
+    /// Recorded images are deep copied into the sequence (default)
+    RecordingDeepCopy,
+    /// Recorded images share the scalars of the image of the recorded node, and are only copied when the node invokes
+    /// ImageDataAboutToBeModifiedEvent. This avoids copying images of nodes that receive a new image for every frame.
+    RecordingCopyOnWrite,
+    RecordingCopyMode_Last
+  };
+
+  enum EncodeOnRecordOverflowPolicy
+  {
+    /// Images that do not fit in the encoding queue are stored in the sequence without compression (default).
+    /// Recording is never slowed down, and the uncompressed items are encoded when the sequence is saved.
+    EncodeOnRecordStoreUncompressed,
+    /// Recording waits until there is space in the encoding queue. No image is stored uncompressed, but the recording rate
+    /// is limited to the encoding rate.
+    EncodeOnRecordWait,
+    EncodeOnRecordOverflowPolicy_Last
+  };
+
   static vtkSlicerVideoIOLogic *New();
   vtkTypeMacro(vtkSlicerVideoIOLogic, vtkSlicerModuleLogic);
   void PrintSelf(ostream&, vtkIndent) VTK_OVERRIDE;
@@ -61,6 +99,190 @@ class VTK_SLICER_VIDEOIO_MODULE_LOGIC_EXPORT vtkSlicerVideoIOLogic : public vtkS
   // MRML Management
   //----------------------------------------------------------------
 
+  //----------------------------------------------------------------
+  // Decoded frame cache
+  //----------------------------------------------------------------
+
+  /// Maximum memory used by the decoded frames that are stored in the cache (in bytes).
+  /// If the size is 0 (default), the cache is disabled. Least recently used frames are removed when the budget is exceeded.
+  void SetDecodedFrameCacheSize(unsigned long long numberOfBytes);
+  unsigned long long GetDecodedFrameCacheSize();
+
+  /// Memory used by the decoded frames that are currently stored in the cache (in bytes)
+  unsigned long long GetDecodedFrameCacheMemoryUsage();
+  int GetNumberOfDecodedFramesInCache();
+
+  /// Copy the decoded image of the encoded frame from the cache into outputImage.
+  /// \return False if the frame is not in the cache
+  bool GetDecodedFrameFromCache(vtkStreamingVolumeFrame* frame, vtkImageData* outputImage);
+
+  /// Store a copy of the decoded image of the encoded frame in the cache
+  void AddDecodedFrameToCache(vtkStreamingVolumeFrame* frame, vtkImageData* decodedImage);
+
+  /// Returns true if an up-to-date decoded image of the frame is in the cache. Does not affect the cache statistics.
+  bool IsDecodedFrameInCache(vtkStreamingVolumeFrame* frame);
+
+  /// Remove all frames from the cache
+  void ClearDecodedFrameCache();
+
+  /// Number of cache lookups that found/did not find the requested frame
+  int GetDecodedFrameCacheHits();
+  int GetDecodedFrameCacheMisses();
+  void ResetDecodedFrameCacheStatistics();
+
+  //----------------------------------------------------------------
+  // Read-ahead decoding
+  //----------------------------------------------------------------
+
+  /// Number of frames that are decoded ahead of the selected item of sequence browsers during playback.
+  /// Frames are decoded on a background thread in the playback direction, skipping items at the playback rate, and
+  /// stored in the decoded frame cache. Has no effect if the decoded frame cache is disabled.
+  /// If 0 (default), read-ahead decoding is disabled and the background thread is stopped.
+  /// The payloads of lazily loaded frames (see vtkSlicerIGSIOMkvStreamingVolumeFrame) are released when the frames leave the
+  /// decode window of the browser (the selected item and the read-ahead items, from their nearest keyframes).
+  void SetReadAheadNumberOfFrames(int numberOfFrames);
+  int GetReadAheadNumberOfFrames();
+
+  //----------------------------------------------------------------
+  // Random access decoding
+  //----------------------------------------------------------------
+
+  /// Seeker of the sequence that contains the data node, or NULL if the node is not an item of a sequence in the scene.
+  /// Seekers are created on demand, and are used by the streaming volume node sequencer to decode the frames of the proxy
+  /// nodes from the nearest keyframe, or from the last frame decoded in the sequence if it precedes the frame.
+  vtkSlicerIGSIOSequenceSeeker* GetSequenceSeeker(vtkMRMLNode* dataNode);
+
+  //----------------------------------------------------------------
+  // Copy-on-write recording
+  //----------------------------------------------------------------
+
+  /// How the images of streaming volume nodes without an encoded frame are copied into sequences while they are recorded
+  /// (see RecordingCopyMode). Images that are encoded on record are always copied.
+  void SetRecordingCopyMode(int mode);
+  int GetRecordingCopyMode();
+
+  /// Store the image of the source node in the target node, sharing the scalars of the source image.
+  /// Called by the streaming volume node sequencer when a node of the scene is recorded in a sequence.
+  /// If the source node has modified its image in place since the previous recorded image without invoking
+  /// ImageDataAboutToBeModifiedEvent, copy-on-write is disabled for the node, and subsequent images are deep copied.
+  /// \return False if the image could not be shared, in which case the target node is not modified
+  bool ShareRecordedImage(vtkMRMLStreamingVolumeNode* sourceNode, vtkMRMLStreamingVolumeNode* targetNode);
+
+  /// Copy the image of the recorded items that share the image of the source node, so that the source image can be modified.
+  /// Called when the source node invokes ImageDataAboutToBeModifiedEvent.
+  void MaterializeRecordedImages(vtkMRMLStreamingVolumeNode* sourceNode);
+
+  /// Number of recorded images that shared the image of the source node, and that had to be copied
+  int GetNumberOfSharedRecordedImages();
+  int GetNumberOfMaterializedRecordedImages();
+
+  //----------------------------------------------------------------
+  // Encode on record
+  //----------------------------------------------------------------
+
+  /// Codec that is used to encode the images of streaming volume nodes while they are recorded in a sequence.
+  /// Each recorded image is copied into the sequence and queued for encoding on a background thread. Once encoded, the image of the
+  /// sequence item is replaced by the encoded frame, so that only the queued images are kept in memory uncompressed.
+  /// If empty (default), recorded images are stored uncompressed.
+  /// \return False if the codec is not available
+  bool SetEncodeOnRecordCodecFourCC(const std::string& codecFourCC);
+  std::string GetEncodeOnRecordCodecFourCC();
+
+  /// Parameter preset of the encode on record codec (see vtkStreamingVolumeCodec::GetParameterPresets).
+  /// If empty (default), the default parameters of the codec are used.
+  void SetEncodeOnRecordCodecPreset(const std::string& presetValue);
+  std::string GetEncodeOnRecordCodecPreset();
+
+  /// Maximum number of recorded images that are waiting to be encoded (default: 30)
+  void SetEncodeOnRecordQueueSize(int queueSize);
+  int GetEncodeOnRecordQueueSize();
+
+  /// What happens to recorded images when the encoding queue is full (see EncodeOnRecordOverflowPolicy)
+  void SetEncodeOnRecordOverflowPolicy(int policy);
+  int GetEncodeOnRecordOverflowPolicy();
+
+  /// Copy the image of the source node to the target node and queue it for encoding.
+  /// Called by the streaming volume node sequencer when a node of the scene is recorded in a sequence.
+  /// \return False if encoding on record is disabled or the image was stored uncompressed because the queue is full
+  bool EncodeOnRecord(vtkMRMLStreamingVolumeNode* sourceNode, vtkMRMLStreamingVolumeNode* targetNode);
+
+  /// Replace the images of the sequence items that have been encoded since the last update by the encoded frames.
+  /// Called whenever a sequence browser is modified.
+  void UpdateEncodeOnRecordFrames();
+
+  /// Wait until all of the queued images are encoded and replace them by the encoded frames. Should be called before saving a recording.
+  void FlushEncodeOnRecord();
+
+  /// Number of recorded images that are waiting to be encoded
+  int GetEncodeOnRecordQueueLength();
+
+  /// Number of recorded images that were replaced by encoded frames, and that were stored uncompressed because the queue was full
+  int GetNumberOfFramesEncodedOnRecord();
+  int GetNumberOfFramesStoredUncompressedOnRecord();
+  void ResetEncodeOnRecordStatistics();
+
+  //----------------------------------------------------------------
+  // Compact transform tracks
+  //----------------------------------------------------------------
+
+  /// Browse the transform track with the sequence browser.
+  /// A linear transform node is added to the scene as the proxy node of the track. Whenever the selected item of the browser changes,
+  /// the transform of the track that is closest to the index value of the selected item is copied to the proxy node.
+  /// \return The proxy transform node of the track
+  vtkMRMLLinearTransformNode* AddTransformTrack(vtkMRMLSequenceBrowserNode* browserNode, vtkSlicerIGSIOTransformTrack* transformTrack);
+
+  /// Add all of the vtkSlicerIGSIOTransformTrack in the collection to the browser (see AddTransformTrack)
+  void AddTransformTracks(vtkMRMLSequenceBrowserNode* browserNode, vtkCollection* transformTracks);
+
+  int GetNumberOfTransformTracks(vtkMRMLSequenceBrowserNode* browserNode);
+  vtkSlicerIGSIOTransformTrack* GetNthTransformTrack(vtkMRMLSequenceBrowserNode* browserNode, int n);
+  vtkMRMLLinearTransformNode* GetNthTransformTrackProxyNode(vtkMRMLSequenceBrowserNode* browserNode, int n);
+
+  /// Stop updating the proxy nodes of the transform tracks of the browser. The proxy nodes are not removed from the scene.
+  void RemoveTransformTracks(vtkMRMLSequenceBrowserNode* browserNode);
+
+  /// Update the proxy nodes of the transform tracks to the selected item of the browser
+  void UpdateTransformTrackProxyNodes(vtkMRMLSequenceBrowserNode* browserNode);
+
+  //----------------------------------------------------------------
+  // Image buffer pool
+  //----------------------------------------------------------------
+
+  /// Pool of the image buffers that are reused by recorded images, decoded frames and re-encoding.
+  /// The pool is shared by all VideoIO logic instances.
+  /// Example (Python): pool = logic.GetImagePool(); print(pool.GetHitRate(), pool.GetResidentSize())
+  vtkSlicerIGSIOImagePool* GetImagePool();
+
+  //----------------------------------------------------------------
+  // Instrumentation
+  //----------------------------------------------------------------
+
+  /// Timing statistics of the stages of loading, decoding, encoding and saving videos (ex. "Demux", "CreateNodes", "Decode", "Encode",
+  /// "CopyNode", "Write"). The statistics are shared by all VideoIO logic instances.
+  /// Example (Python): logic.SetInstrumentationEnabled(True); ...; print(logic.GetInstrumentationReport())
+  vtkSlicerIGSIOInstrumentation* GetInstrumentation();
+
+  /// Recording of the stages is disabled by default
+  void SetInstrumentationEnabled(bool enabled);
+  bool GetInstrumentationEnabled();
+
+  /// Remove all recorded statistics
+  void ResetInstrumentation();
+
+  /// Table of the statistics of all recorded stages
+  std::string GetInstrumentationReport();
+
+  /// Record the timed stages as spans on the timeline of each thread (ex. file read, decoding of each frame, CopyNode, re-encoded blocks, write).
+  /// Disabled by default. Example (Python): logic.SetTracingEnabled(True); ...; logic.WriteTrace("trace.json")
+  void SetTracingEnabled(bool enabled);
+  bool GetTracingEnabled();
+
+  /// Write the recorded spans to a Chrome Trace Event format file, that can be opened in chrome://tracing or https://ui.perfetto.dev
+  bool WriteTrace(const std::string& fileName);
+
+  /// Remove all recorded spans
+  void ClearTrace();
+
  protected:
 
   //----------------------------------------------------------------
@@ -70,6 +292,13 @@ class VTK_SLICER_VIDEOIO_MODULE_LOGIC_EXPORT vtkSlicerVideoIOLogic : public vtkS
   vtkSlicerVideoIOLogic();
   virtual ~vtkSlicerVideoIOLogic();
 
+  virtual void SetMRMLSceneInternal(vtkMRMLScene* newScene) VTK_OVERRIDE;
+  virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node) VTK_OVERRIDE;
+  virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node) VTK_OVERRIDE;
+  virtual void OnMRMLSceneStartClose() VTK_OVERRIDE;
+  virtual void OnMRMLSceneEndClose() VTK_OVERRIDE;
+  virtual void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData) VTK_OVERRIDE;
+
  private:
   
 private:
@@ -19,8 +19,17 @@ Care Ontario.
 ==============================================================================*/
 
 // VTK includes
+#include <vtkMatrix4x4.h>
 #include <vtkStringArray.h>
 
+// STD includes
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
 //MRML includes
 #include <vtkMRMLStreamingVolumeNode.h>
 #include <vtkStreamingVolumeCodecFactory.h>
@@ -30,28 +39,259 @@ Care Ontario.
 
 // SlicerIGSIOCommon includes
 #include "vtkSlicerIGSIOCommon.h"
+#include "vtkSlicerIGSIOInstrumentation.h"
+#include "vtkSlicerIGSIOMkvFrameIndex.h"
+#include "vtkSlicerIGSIOMkvStreamingVolumeFrame.h"
 
 // IGSIOCommon includes
 #include <vtkIGSIOTrackedFrameList.h>
 
 // IGSIO vtkSequenceIO includes
+#include <vtkIGSIOMkvSequenceIO.h>
 #include <vtkIGSIOSequenceIO.h>
 
+// vtksys includes
+#include <vtksys/SystemTools.hxx>
+
 // VideoIO MRML includes
 #include "vtkMRMLStreamingVolumeSequenceStorageNode.h"
 
+// Maximum number of frame blocks that are waiting to be written by the incremental writer thread
+static const int INCREMENTAL_WRITE_MAXIMUM_NUMBER_OF_QUEUED_BLOCKS = 4;
+
+//----------------------------------------------------------------------------
+class vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal
+{
+public:
+  vtkInternal(vtkMRMLStreamingVolumeSequenceStorageNode* external)
+    : External(external)
+    , LastWrittenTimestamp(0.0)
+    , WriterThreadRunning(false)
+    , WriteFailed(false)
+    , NumberOfBlocksBeingWritten(0)
+    , NumberOfQueuedFrames(0)
+  {
+  }
+
+  /// Frames of the sequence that are encoded and appended to the file together
+  struct FrameBlock
+  {
+    int StartIndex;
+    std::string CodecFourCC;
+    std::map<std::string, std::string> CodecParameters;
+    std::string TrackName;
+    /// Snapshot of the items, taken on the main thread
+    std::vector<vtkSlicerIGSIOCommon::TranscodingSourceFrame> SourceFrames;
+    /// Timestamp and transform of each item. The frames are set by the writer thread.
+    std::vector<vtkSlicerIGSIOCommon::TrackedFrameSourceItem> Items;
+    /// Frames that were encoded by the writer thread (NULL if the frame of the item did not need to be re-encoded)
+    std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > EncodedFrames;
+    bool Success;
+    FrameBlock()
+      : StartIndex(0)
+      , Success(false)
+    {
+    }
+  };
+
+  void StartWriterThread();
+  /// Write the queued blocks, and stop the thread once they have all been written
+  void StopWriterThread();
+  /// Discard the queued blocks and stop the thread
+  void CancelWriterThread();
+  /// Wait until all of the queued blocks have been written
+  void WaitForWriterThread();
+  void WriterThreadMain();
+  /// Encode the frames of the block and append them to the file. Called on the writer thread.
+  bool WriteFrameBlock(FrameBlock& block);
+
+  vtkMRMLStreamingVolumeSequenceStorageNode* External;
+
+  /// Only accessed by the writer thread while it is running
+  vtkSmartPointer<vtkIGSIOMkvSequenceIO> Writer;
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> TrackedFrameList;
+  std::string FileName;
+  /// Last frame and timestamp that were appended to the file, which the frames of the next block follow
+  vtkSmartPointer<vtkStreamingVolumeFrame> LastWrittenFrame;
+  double LastWrittenTimestamp;
+
+  std::thread WriterThread;
+  std::mutex WriterMutex;
+  /// Notified when a block is queued or the thread is stopped
+  std::condition_variable WriterCondition;
+  /// Notified when a block is written
+  std::condition_variable WriterDoneCondition;
+  bool WriterThreadRunning;
+  bool WriteFailed;
+  std::deque<FrameBlock> QueuedBlocks;
+  int NumberOfBlocksBeingWritten;
+  /// Written blocks whose encoded frames have not been set in the sequence yet
+  std::deque<FrameBlock> WrittenBlocks;
+
+  /// Number of items of the sequence that have been queued for writing. Only accessed from the main thread.
+  int NumberOfQueuedFrames;
+};
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal::StartWriterThread()
+{
+  if (this->WriterThread.joinable())
+  {
+    return;
+  }
+  this->WriterThreadRunning = true;
+  this->WriteFailed = false;
+  this->WriterThread = std::thread(&vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal::WriterThreadMain, this);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal::StopWriterThread()
+{
+  if (!this->WriterThread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->WriterMutex);
+    this->WriterThreadRunning = false;
+  }
+  this->WriterCondition.notify_one();
+  this->WriterThread.join();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal::CancelWriterThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->WriterMutex);
+    this->QueuedBlocks.clear();
+  }
+  this->StopWriterThread();
+  this->WrittenBlocks.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal::WaitForWriterThread()
+{
+  std::unique_lock<std::mutex> lock(this->WriterMutex);
+  this->WriterDoneCondition.wait(lock, [this] { return this->QueuedBlocks.empty() && this->NumberOfBlocksBeingWritten == 0; });
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal::WriterThreadMain()
+{
+  while (true)
+  {
+    FrameBlock block;
+    bool writeFailed = false;
+    {
+      std::unique_lock<std::mutex> lock(this->WriterMutex);
+      this->WriterCondition.wait(lock, [this] { return !this->WriterThreadRunning || !this->QueuedBlocks.empty(); });
+      if (this->QueuedBlocks.empty())
+      {
+        // Stopped, and all of the queued blocks have been written
+        break;
+      }
+      block = this->QueuedBlocks.front();
+      this->QueuedBlocks.pop_front();
+      ++this->NumberOfBlocksBeingWritten;
+      writeFailed = this->WriteFailed;
+    }
+
+    // Frames following a block that could not be written cannot be appended to the file
+    block.Success = !writeFailed && this->WriteFrameBlock(block);
+
+    {
+      std::lock_guard<std::mutex> lock(this->WriterMutex);
+      --this->NumberOfBlocksBeingWritten;
+      if (!block.Success)
+      {
+        this->WriteFailed = true;
+      }
+      this->WrittenBlocks.push_back(block);
+    }
+    this->WriterDoneCondition.notify_all();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::vtkInternal::WriteFrameBlock(FrameBlock& block)
+{
+  int endIndex = block.StartIndex + (int)block.SourceFrames.size() - 1;
+  if (!vtkSlicerIGSIOCommon::ReEncodeSourceFrames(this->External, block.SourceFrames, block.CodecFourCC, block.CodecParameters,
+    false, true, 0, block.EncodedFrames))
+  {
+    vtkErrorWithObjectMacro(this->External, "WriteFrameBlock: Could not encode frames " << block.StartIndex << " - " << endIndex);
+    return false;
+  }
+
+  for (int i = 0; i < (int)block.SourceFrames.size(); ++i)
+  {
+    block.Items[i].Frame = block.EncodedFrames[i] ? block.EncodedFrames[i] : block.SourceFrames[i].Frame;
+  }
+
+  this->TrackedFrameList->Clear();
+  if (!vtkSlicerIGSIOCommon::SequenceItemsToTrackedFrameList(block.Items, block.TrackName, this->LastWrittenFrame, this->LastWrittenTimestamp,
+    this->TrackedFrameList))
+  {
+    vtkErrorWithObjectMacro(this->External, "WriteFrameBlock: Could not convert frames " << block.StartIndex << " - " << endIndex);
+    return false;
+  }
+
+  if (!this->Writer)
+  {
+    // The header is created based on the first frames that are written
+    this->Writer = vtkSmartPointer<vtkIGSIOMkvSequenceIO>::New();
+    this->Writer->SetTrackedFrameList(this->TrackedFrameList);
+    if (this->Writer->SetFileName(this->FileName) != IGSIO_SUCCESS
+      || this->Writer->PrepareHeader() != IGSIO_SUCCESS)
+    {
+      vtkErrorWithObjectMacro(this->External, "WriteFrameBlock: Could not open file for writing: " << this->FileName);
+      this->Writer = NULL;
+      return false;
+    }
+  }
+
+  if (this->Writer->AppendImagesToHeader() != IGSIO_SUCCESS
+    || this->Writer->AppendImages() != IGSIO_SUCCESS)
+  {
+    vtkErrorWithObjectMacro(this->External, "WriteFrameBlock: Could not append frames to file: " << this->FileName);
+    return false;
+  }
+
+  // Written frames are no longer needed in the tracked frame list
+  this->TrackedFrameList->Clear();
+  for (std::vector<vtkSlicerIGSIOCommon::TrackedFrameSourceItem>::iterator itemIt = block.Items.begin(); itemIt != block.Items.end(); ++itemIt)
+  {
+    if (itemIt->Frame)
+    {
+      this->LastWrittenFrame = itemIt->Frame;
+      this->LastWrittenTimestamp = itemIt->Timestamp;
+    }
+  }
+  return true;
+}
+
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLStreamingVolumeSequenceStorageNode);
 
 //----------------------------------------------------------------------------
 vtkMRMLStreamingVolumeSequenceStorageNode::vtkMRMLStreamingVolumeSequenceStorageNode()
   : CodecFourCC("")
+  , LazyRead(false)
+  , IncrementalWriteActive(false)
+  , NumberOfIncrementallyWrittenFrames(0)
+  , Internal(new vtkInternal(this))
 {
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLStreamingVolumeSequenceStorageNode::~vtkMRMLStreamingVolumeSequenceStorageNode()
 {
+  // The file is finalized by the owner of the incremental write (the logic finalizes it when recording stops or the
+  // scene is closed). Only the writer thread is stopped here, since the sequence may already be deleted.
+  this->CancelIncrementalWrite();
+  delete this->Internal;
 }
 
 //----------------------------------------------------------------------------
@@ -63,12 +303,16 @@ bool vtkMRMLStreamingVolumeSequenceStorageNode::CanReadInReferenceNode(vtkMRMLNo
 //---------------------------------------------------------------------------
 bool vtkMRMLStreamingVolumeSequenceStorageNode::ReadVideo(std::string fileName, vtkIGSIOTrackedFrameList* trackedFrameList)
 {
-  return vtkIGSIOSequenceIO::Read(fileName, trackedFrameList) == IGSIO_SUCCESS;
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("Demux");
+  bool success = vtkIGSIOSequenceIO::Read(fileName, trackedFrameList) == IGSIO_SUCCESS;
+  timer.SetNumberOfItems(trackedFrameList->GetNumberOfTrackedFrames());
+  return success;
 }
 
 //---------------------------------------------------------------------------
 bool vtkMRMLStreamingVolumeSequenceStorageNode::WriteVideo(std::string fileName, vtkIGSIOTrackedFrameList* trackedFrameList)
 {
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("Write", trackedFrameList->GetNumberOfTrackedFrames());
   return vtkIGSIOSequenceIO::Write(fileName, trackedFrameList) == IGSIO_SUCCESS;
 }
 
@@ -82,14 +326,75 @@ int vtkMRMLStreamingVolumeSequenceStorageNode::ReadDataInternal(vtkMRMLNode* ref
     return 0;
   }
 
+  if (this->LazyRead)
+  {
+    if (this->ReadDataLazy(sequenceNode))
+    {
+      this->ResetModifiedFrames(sequenceNode);
+      return 1;
+    }
+    vtkWarningMacro("ReadDataInternal: Could not read " << this->FileName << " lazily. Reading all frames into memory.");
+    sequenceNode->RemoveAllDataNodes();
+  }
+
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
   this->ReadVideo(this->FileName, trackedFrameList);
-  vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(trackedFrameList, sequenceNode);
   trackedFrameList->GetEncodingFourCC(this->CodecFourCC);
+  // The tracked frame list is discarded after reading, so the images can be moved into the sequence without a copy
+  vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(trackedFrameList, sequenceNode, true);
+  this->ResetModifiedFrames(sequenceNode);
 
   return 1;
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::ReadDataLazy(vtkMRMLSequenceNode* sequenceNode)
+{
+  vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex> frameIndex = vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex>::New();
+  {
+    vtkSlicerIGSIOInstrumentation::ScopedTimer timer("ReadIndex");
+    if (!frameIndex->ReadFile(this->FileName))
+    {
+      return false;
+    }
+  }
+
+  int trackNumber = frameIndex->GetFirstVideoTrackNumber();
+  if (!vtkSlicerIGSIOCommon::MkvFrameIndexToVolumeSequence(frameIndex, sequenceNode, trackNumber))
+  {
+    return false;
+  }
+  this->CodecFourCC = frameIndex->GetTrackFourCC(trackNumber);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::LoadFrameDataFromFile(vtkMRMLSequenceNode* sequenceNode, std::string fileName)
+{
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    if (!streamingVolumeNode)
+    {
+      continue;
+    }
+
+    // Frames that are skipped in the sequence are only referenced as previous frames
+    vtkStreamingVolumeFrame* frame = streamingVolumeNode->GetFrame();
+    while (frame)
+    {
+      vtkSlicerIGSIOMkvStreamingVolumeFrame* mkvFrame = vtkSlicerIGSIOMkvStreamingVolumeFrame::SafeDownCast(frame);
+      if (!mkvFrame || mkvFrame->GetFileName() != fileName)
+      {
+        // The rest of the chain has already been loaded
+        break;
+      }
+      mkvFrame->LoadFrameData();
+      frame = frame->GetPreviousFrame();
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 bool vtkMRMLStreamingVolumeSequenceStorageNode::CanWriteFromReferenceNode(vtkMRMLNode *refNode)
 {
@@ -115,6 +420,191 @@ int vtkMRMLStreamingVolumeSequenceStorageNode::WriteDataInternal(vtkMRMLNode *re
     return 0;
   }
 
+  if (this->IncrementalWriteActive && this->IncrementalWriteFileName == this->GetFileName())
+  {
+    // Only the frames that have not been written yet need to be encoded
+    if (!this->StopIncrementalWrite())
+    {
+      vtkErrorMacro("WriteData: Could not finalize incrementally written file: " << this->GetFileName());
+      return 0;
+    }
+    this->ResetModifiedFrames(videoStreamSequenceNode);
+    return 1;
+  }
+
+  std::map<std::string, std::string> parameters = this->GetCodecParameters();
+
+  // Only the groups of pictures that contain modified frames can require re-encoding.
+  // The encoded frames of the other groups of pictures are written to the file as they are.
+  std::vector<std::pair<int, int> > modifiedFrameRanges;
+  this->GetModifiedFrameRanges(videoStreamSequenceNode, modifiedFrameRanges);
+  this->ExpandFrameRangesToKeyFrames(videoStreamSequenceNode, modifiedFrameRanges);
+  for (std::vector<std::pair<int, int> >::iterator frameRangeIt = modifiedFrameRanges.begin(); frameRangeIt != modifiedFrameRanges.end(); ++frameRangeIt)
+  {
+    // Use all available cores to encode the frame blocks that require re-encoding
+    if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(videoStreamSequenceNode, frameRangeIt->first, frameRangeIt->second,
+      this->CodecFourCC, parameters, false, true, 0))
+    {
+      vtkErrorMacro("WriteData: Could not encode frames " << frameRangeIt->first << " - " << frameRangeIt->second
+                    << " of node " << refNode->GetID());
+      return 0;
+    }
+  }
+
+  // Frames that were read lazily from the file must be loaded before it is overwritten
+  this->LoadFrameDataFromFile(videoStreamSequenceNode, this->GetFileName());
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer <vtkIGSIOTrackedFrameList>::New();
+  if (!vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(videoStreamSequenceNode, trackedFrameList))
+  {
+    vtkErrorMacro("WriteData: Could not convert node " << refNode->GetID() << " to a tracked frame list");
+    return 0;
+  }
+  if (!this->WriteVideo(this->GetFileName(), trackedFrameList))
+  {
+    vtkErrorMacro("WriteData: Could not write file: " << this->GetFileName());
+    return 0;
+  }
+
+  this->ResetModifiedFrames(videoStreamSequenceNode);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::ResetModifiedFrames(vtkMRMLSequenceNode* sequenceNode)
+{
+  this->FrameSnapshots.clear();
+  this->FrameSnapshotSequenceNode = sequenceNode;
+  this->FrameSnapshotCodecFourCC = this->CodecFourCC;
+  if (!sequenceNode)
+  {
+    return;
+  }
+
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    vtkStreamingVolumeFrame* frame = streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL;
+    if (!frame)
+    {
+      continue;
+    }
+
+    FrameSnapshot snapshot;
+    snapshot.Frame = frame;
+    snapshot.FrameMTime = frame->GetMTime();
+    this->FrameSnapshots[sequenceNode->GetNthIndexValue(i)] = snapshot;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::GetModifiedFrameRanges(vtkMRMLSequenceNode* sequenceNode,
+  std::vector<std::pair<int, int> >& modifiedFrameRanges)
+{
+  modifiedFrameRanges.clear();
+  if (!sequenceNode || sequenceNode->GetNumberOfDataNodes() < 1)
+  {
+    return true;
+  }
+
+  // All of the frames must be re-encoded if the codec has changed
+  if (sequenceNode != this->FrameSnapshotSequenceNode || this->CodecFourCC != this->FrameSnapshotCodecFourCC)
+  {
+    modifiedFrameRanges.push_back(std::make_pair(0, sequenceNode->GetNumberOfDataNodes() - 1));
+    return false;
+  }
+
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    vtkStreamingVolumeFrame* frame = streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL;
+
+    bool modified = true;
+    std::map<std::string, FrameSnapshot>::iterator snapshotIt = this->FrameSnapshots.find(sequenceNode->GetNthIndexValue(i));
+    if (frame && snapshotIt != this->FrameSnapshots.end())
+    {
+      modified = snapshotIt->second.Frame != frame || snapshotIt->second.FrameMTime != frame->GetMTime();
+    }
+    if (!modified)
+    {
+      continue;
+    }
+
+    if (!modifiedFrameRanges.empty() && modifiedFrameRanges.back().second == i - 1)
+    {
+      modifiedFrameRanges.back().second = i;
+    }
+    else
+    {
+      modifiedFrameRanges.push_back(std::make_pair(i, i));
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLStreamingVolumeSequenceStorageNode::GetNumberOfModifiedFrames(vtkMRMLSequenceNode* sequenceNode)
+{
+  std::vector<std::pair<int, int> > modifiedFrameRanges;
+  this->GetModifiedFrameRanges(sequenceNode, modifiedFrameRanges);
+
+  int numberOfModifiedFrames = 0;
+  for (std::vector<std::pair<int, int> >::iterator frameRangeIt = modifiedFrameRanges.begin(); frameRangeIt != modifiedFrameRanges.end(); ++frameRangeIt)
+  {
+    numberOfModifiedFrames += frameRangeIt->second - frameRangeIt->first + 1;
+  }
+  return numberOfModifiedFrames;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::ExpandFrameRangesToKeyFrames(vtkMRMLSequenceNode* sequenceNode,
+  std::vector<std::pair<int, int> >& frameRanges)
+{
+  int numberOfFrames = sequenceNode->GetNumberOfDataNodes();
+
+  std::vector<std::pair<int, int> > expandedFrameRanges;
+  for (std::vector<std::pair<int, int> >::iterator frameRangeIt = frameRanges.begin(); frameRangeIt != frameRanges.end(); ++frameRangeIt)
+  {
+    int startFrame = frameRangeIt->first;
+    while (startFrame > 0)
+    {
+      vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(startFrame));
+      vtkStreamingVolumeFrame* frame = streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL;
+      if (frame && frame->IsKeyFrame())
+      {
+        break;
+      }
+      --startFrame;
+    }
+
+    // Frames following the range up to the next keyframe depend on the frames in the range
+    int endFrame = frameRangeIt->second;
+    while (endFrame < numberOfFrames - 1)
+    {
+      vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(endFrame + 1));
+      vtkStreamingVolumeFrame* frame = streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL;
+      if (frame && frame->IsKeyFrame())
+      {
+        break;
+      }
+      ++endFrame;
+    }
+
+    if (!expandedFrameRanges.empty() && expandedFrameRanges.back().second >= startFrame - 1)
+    {
+      expandedFrameRanges.back().second = std::max(expandedFrameRanges.back().second, endFrame);
+    }
+    else
+    {
+      expandedFrameRanges.push_back(std::make_pair(startFrame, endFrame));
+    }
+  }
+  frameRanges.swap(expandedFrameRanges);
+}
+
+//----------------------------------------------------------------------------
+std::map<std::string, std::string> vtkMRMLStreamingVolumeSequenceStorageNode::GetCodecParameters()
+{
   vtkSmartPointer<vtkStreamingVolumeCodec> codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
     vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(this->CodecFourCC));
 
@@ -124,7 +614,6 @@ int vtkMRMLStreamingVolumeSequenceStorageNode::WriteDataInternal(vtkMRMLNode *re
     codec->SetParametersFromPresetValue(this->CompressionParameter);
     parameterNames = codec->GetAvailiableParameterNames();
   }
-  
 
   std::map<std::string, std::string> parameters;
   std::vector<std::string>::iterator parameterNameIt;
@@ -140,14 +629,245 @@ int vtkMRMLStreamingVolumeSequenceStorageNode::WriteDataInternal(vtkMRMLNode *re
       parameters[*parameterNameIt] = parameterValue;
     }
   }
+  return parameters;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::StartIncrementalWrite()
+{
+  if (this->IncrementalWriteActive)
+  {
+    vtkErrorMacro("StartIncrementalWrite: Incremental writing is already active");
+    return false;
+  }
 
-  vtkSlicerIGSIOCommon::ReEncodeVideoSequence(videoStreamSequenceNode, 0, -1, this->CodecFourCC, parameters, false, true);
+  if (!this->GetFileName())
+  {
+    vtkErrorMacro("StartIncrementalWrite: File name is not specified");
+    return false;
+  }
 
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer <vtkIGSIOTrackedFrameList>::New();
-  vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(videoStreamSequenceNode, trackedFrameList);
-  this->WriteVideo(this->GetFileName(), trackedFrameList);
+  std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(this->GetFileName()));
+  if (extension != ".mkv" && extension != ".webm")
+  {
+    vtkErrorMacro("StartIncrementalWrite: Incremental writing is only supported for Matroska files: " << this->GetFileName());
+    return false;
+  }
 
-  return 1;
+  this->IncrementalWriteActive = true;
+  this->IncrementalWriteFileName = this->GetFileName();
+  this->NumberOfIncrementallyWrittenFrames = 0;
+  this->Internal->NumberOfQueuedFrames = 0;
+  this->Internal->FileName = this->IncrementalWriteFileName;
+  this->Internal->Writer = NULL;
+  this->Internal->TrackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  this->Internal->LastWrittenFrame = NULL;
+  this->Internal->LastWrittenTimestamp = 0.0;
+  this->Internal->StartWriterThread();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::WriteIncrementalFrames(int minimumNumberOfFrames/*=1*/)
+{
+  if (!this->IncrementalWriteActive)
+  {
+    vtkErrorMacro("WriteIncrementalFrames: Incremental writing is not active");
+    return false;
+  }
+
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(this->GetStorableNode());
+  if (!sequenceNode)
+  {
+    vtkErrorMacro("WriteIncrementalFrames: Cannot convert storable node to vtkMRMLSequenceNode");
+    return false;
+  }
+
+  bool success = this->UpdateIncrementallyWrittenFrames(sequenceNode);
+  int numberOfPendingFrames = sequenceNode->GetNumberOfDataNodes() - this->Internal->NumberOfQueuedFrames;
+  if (numberOfPendingFrames < std::max(1, minimumNumberOfFrames))
+  {
+    return success;
+  }
+  return this->QueueIncrementalFrames(sequenceNode, sequenceNode->GetNumberOfDataNodes() - 1, false) && success;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::FlushIncrementalWrite()
+{
+  if (!this->IncrementalWriteActive)
+  {
+    vtkErrorMacro("FlushIncrementalWrite: Incremental writing is not active");
+    return false;
+  }
+
+  bool success = true;
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(this->GetStorableNode());
+  if (sequenceNode)
+  {
+    success = this->QueueIncrementalFrames(sequenceNode, sequenceNode->GetNumberOfDataNodes() - 1, true);
+  }
+  this->Internal->WaitForWriterThread();
+  return this->UpdateIncrementallyWrittenFrames(sequenceNode) && success;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::QueueIncrementalFrames(vtkMRMLSequenceNode* sequenceNode, int endIndex, bool waitForQueue)
+{
+  int startIndex = this->Internal->NumberOfQueuedFrames;
+  if (endIndex < startIndex)
+  {
+    return true;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(this->Internal->WriterMutex);
+    if (waitForQueue)
+    {
+      this->Internal->WriterDoneCondition.wait(lock, [this] {
+        return (int)this->Internal->QueuedBlocks.size() < INCREMENTAL_WRITE_MAXIMUM_NUMBER_OF_QUEUED_BLOCKS; });
+    }
+    else if ((int)this->Internal->QueuedBlocks.size() >= INCREMENTAL_WRITE_MAXIMUM_NUMBER_OF_QUEUED_BLOCKS)
+    {
+      // The frames stay in the sequence until the writer catches up
+      return true;
+    }
+  }
+
+  // Frames that were read lazily from the file must be loaded before the writer thread overwrites it
+  if (startIndex == 0)
+  {
+    this->LoadFrameDataFromFile(sequenceNode, this->IncrementalWriteFileName);
+  }
+
+  vtkInternal::FrameBlock block;
+  block.StartIndex = startIndex;
+  this->UpdateCompressionPresets();
+  block.CodecFourCC = this->CodecFourCC;
+  block.CodecParameters = this->GetCodecParameters();
+  block.TrackName = sequenceNode->GetNthDataNode(0)->GetName() ? sequenceNode->GetNthDataNode(0)->GetName() : "Video";
+  if (!vtkSlicerIGSIOCommon::GetTranscodingSourceFrames(sequenceNode, startIndex, endIndex, block.SourceFrames))
+  {
+    vtkErrorMacro("QueueIncrementalFrames: Could not read frames " << startIndex << " - " << endIndex);
+    return false;
+  }
+
+  // Timestamps are the same as the ones used when the whole sequence is written
+  bool useTimestamp = sequenceNode->GetIndexName() == "time";
+  for (int i = startIndex; i <= endIndex; ++i)
+  {
+    vtkSlicerIGSIOCommon::TrackedFrameSourceItem item;
+    item.Timestamp = 0.1 * (i + 1);
+    if (useTimestamp)
+    {
+      std::stringstream timestampSS;
+      timestampSS << sequenceNode->GetNthIndexValue(i);
+      timestampSS >> item.Timestamp;
+    }
+    item.IJKToRASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    if (streamingVolumeNode)
+    {
+      streamingVolumeNode->GetIJKToRASMatrix(item.IJKToRASMatrix);
+    }
+    block.Items.push_back(item);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->WriterMutex);
+    this->Internal->QueuedBlocks.push_back(block);
+  }
+  this->Internal->WriterCondition.notify_one();
+  this->Internal->NumberOfQueuedFrames = endIndex + 1;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::UpdateIncrementallyWrittenFrames(vtkMRMLSequenceNode* sequenceNode)
+{
+  std::deque<vtkInternal::FrameBlock> writtenBlocks;
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->WriterMutex);
+    writtenBlocks.swap(this->Internal->WrittenBlocks);
+  }
+
+  bool success = true;
+  for (std::deque<vtkInternal::FrameBlock>::iterator blockIt = writtenBlocks.begin(); blockIt != writtenBlocks.end(); ++blockIt)
+  {
+    if (!blockIt->Success)
+    {
+      success = false;
+      continue;
+    }
+    // The items are only replaced if they have not been changed since they were queued.
+    // The frames are in the file in either case.
+    if (sequenceNode)
+    {
+      vtkSlicerIGSIOCommon::SetEncodedFrames(sequenceNode, blockIt->StartIndex, blockIt->EncodedFrames, &blockIt->SourceFrames);
+    }
+    this->NumberOfIncrementallyWrittenFrames = blockIt->StartIndex + (int)blockIt->SourceFrames.size();
+  }
+  return success;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::StopIncrementalWrite()
+{
+  if (!this->IncrementalWriteActive)
+  {
+    return true;
+  }
+
+  bool success = this->FlushIncrementalWrite();
+  this->Internal->StopWriterThread();
+
+  if (this->Internal->Writer)
+  {
+    if (this->Internal->Writer->FinalizeHeader() != IGSIO_SUCCESS || this->Internal->Writer->Close() != IGSIO_SUCCESS)
+    {
+      vtkErrorMacro("StopIncrementalWrite: Could not finalize file: " << this->IncrementalWriteFileName);
+      success = false;
+    }
+  }
+
+  this->IncrementalWriteActive = false;
+  this->Internal->Writer = NULL;
+  this->Internal->TrackedFrameList = NULL;
+  this->Internal->LastWrittenFrame = NULL;
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStreamingVolumeSequenceStorageNode::CancelIncrementalWrite()
+{
+  if (!this->IncrementalWriteActive)
+  {
+    return;
+  }
+
+  this->Internal->CancelWriterThread();
+  if (this->Internal->Writer)
+  {
+    this->Internal->Writer->Discard();
+  }
+  this->IncrementalWriteActive = false;
+  this->Internal->Writer = NULL;
+  this->Internal->TrackedFrameList = NULL;
+  this->Internal->LastWrittenFrame = NULL;
+  this->Internal->NumberOfQueuedFrames = 0;
+  this->NumberOfIncrementallyWrittenFrames = 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLStreamingVolumeSequenceStorageNode::GetIncrementalWriteActive()
+{
+  return this->IncrementalWriteActive;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLStreamingVolumeSequenceStorageNode::GetNumberOfIncrementallyWrittenFrames()
+{
+  return this->NumberOfIncrementallyWrittenFrames;
 }
 
 //----------------------------------------------------------------------------
@@ -246,6 +966,7 @@ void vtkMRMLStreamingVolumeSequenceStorageNode::ReadXMLAttributes(const char** a
   Superclass::ReadXMLAttributes(atts);
   vtkMRMLReadXMLBeginMacro(atts);
   vtkMRMLReadXMLStdStringMacro(codecFourCC, CodecFourCC);
+  vtkMRMLReadXMLBooleanMacro(lazyRead, LazyRead);
   vtkMRMLReadXMLEndMacro();
 }
 
@@ -255,6 +976,7 @@ void vtkMRMLStreamingVolumeSequenceStorageNode::WriteXML(ostream& of, int indent
   Superclass::WriteXML(of, indent);
   vtkMRMLWriteXMLBeginMacro(of);
   vtkMRMLWriteXMLStdStringMacro(codecFourCC, CodecFourCC);
+  vtkMRMLWriteXMLBooleanMacro(lazyRead, LazyRead);
   vtkMRMLWriteXMLEndMacro();
 }
 
@@ -264,6 +986,7 @@ void vtkMRMLStreamingVolumeSequenceStorageNode::Copy(vtkMRMLNode *node)
   Superclass::Copy(node);
   vtkMRMLCopyBeginMacro(node);
   vtkMRMLCopyStdStringMacro(CodecFourCC);
+  vtkMRMLCopyBooleanMacro(LazyRead);
   vtkMRMLCopyEndMacro();
 }
 
@@ -273,5 +996,8 @@ void vtkMRMLStreamingVolumeSequenceStorageNode::PrintSelf(ostream& os, vtkIndent
   Superclass::PrintSelf(os, indent);
   vtkMRMLPrintBeginMacro(os, indent);
   vtkMRMLPrintStdStringMacro(CodecFourCC);
+  vtkMRMLPrintBooleanMacro(LazyRead);
+  vtkMRMLPrintBooleanMacro(IncrementalWriteActive);
+  vtkMRMLPrintIntMacro(NumberOfIncrementallyWrittenFrames);
   vtkMRMLPrintEndMacro();
 }
@@ -24,12 +24,22 @@ Care Ontario.
 #include "vtkSlicerVideoIOModuleMRMLExport.h"
 
 #include "vtkMRMLStorageNode.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 class vtkIGSIOTrackedFrameList;
 class vtkGenericVideoReader;
 class vtkGenericVideoWriter;
 class vtkMRMLSequenceNode;
+class vtkStreamingVolumeFrame;
 
 /// \ingroup Slicer_QtModules_Sequences
 class VTK_SLICER_VIDEOIO_MODULE_MRML_EXPORT vtkMRMLStreamingVolumeSequenceStorageNode : public vtkMRMLStorageNode
@@ -61,6 +71,61 @@ public:
   vtkSetMacro(CodecFourCC, std::string);
   vtkGetMacro(CodecFourCC, std::string);
 
+  /// If enabled, Matroska files are read by indexing the frames in the file instead of reading all of the encoded frames into memory.
+  /// The encoded payload of each frame is read from the file when the frame is first decoded.
+  /// The file must not be moved or modified while the sequence is loaded.
+  /// If the file cannot be read lazily, it is read fully instead.
+  vtkSetMacro(LazyRead, bool);
+  vtkGetMacro(LazyRead, bool);
+  vtkBooleanMacro(LazyRead, bool);
+
+  /// Start writing the frames of the sequence to the file incrementally.
+  /// Frames added to the sequence are appended to the open file when WriteIncrementalFrames() is called.
+  /// The frames are encoded and written on a background writer thread, and the encoded frames replace the uncompressed
+  /// items of the sequence once they have been written.
+  /// Saving the node while incremental writing is active only writes the frames that have not been written yet,
+  /// and finalizes the file. Frames that have already been written must not be modified.
+  /// The VideoIO logic finalizes the file when recording of the sequence stops, or when the scene is closed.
+  /// Only supported for Matroska files.
+  bool StartIncrementalWrite();
+
+  /// Queue the frames that have been added to the sequence since the last call for writing, and replace the items that
+  /// have been written since the last call by their encoded frames. Does not wait for the frames to be written.
+  /// If the queue of the writer thread is full, the frames are queued by a later call.
+  /// \param minimumNumberOfFrames Frames are only queued if at least this many frames are waiting to be written.
+  /// \return False if writing of previously queued frames failed
+  bool WriteIncrementalFrames(int minimumNumberOfFrames = 1);
+
+  /// Queue all of the frames that have not been written yet, and wait until they are written. The file is not finalized.
+  bool FlushIncrementalWrite();
+
+  /// Write the remaining frames and finalize the file
+  bool StopIncrementalWrite();
+
+  /// Discard the incrementally written file without finalizing it.
+  /// Incremental writing is cancelled when the node is deleted, so StopIncrementalWrite() must be called before.
+  void CancelIncrementalWrite();
+
+  /// Returns true if the frames of the sequence are being written incrementally
+  bool GetIncrementalWriteActive();
+
+  /// Number of frames that have been written to the file during incremental writing, and replaced by their encoded frames
+  int GetNumberOfIncrementallyWrittenFrames();
+
+  /// Mark all frames of the sequence as unmodified.
+  /// Called automatically after the sequence has been read or written. Should be called if the sequence is populated from the
+  /// file without using the storage node.
+  void ResetModifiedFrames(vtkMRMLSequenceNode* sequenceNode);
+
+  /// Get the ranges of items (first and last item number, inclusive) that have been modified since the sequence was last read
+  /// or written. Items are modified if their encoded frame was replaced or modified, or if they do not contain an encoded frame.
+  /// \return False if the modified frames are not known (ex. the sequence was never read or written), in which case
+  ///   all of the items are returned as a single range
+  bool GetModifiedFrameRanges(vtkMRMLSequenceNode* sequenceNode, std::vector<std::pair<int, int> >& modifiedFrameRanges);
+
+  /// Number of items that have been modified since the sequence was last read or written
+  int GetNumberOfModifiedFrames(vtkMRMLSequenceNode* sequenceNode);
+
   /// Read node attributes from XML file
   virtual void ReadXMLAttributes(const char** atts) VTK_OVERRIDE;
   /// Write this node's information to a MRML file in XML format.
@@ -84,6 +149,13 @@ protected:
   /// but it has an early exit if the file to be read is incompatible.
   virtual int ReadDataInternal(vtkMRMLNode* refNode);
 
+  /// Populate the sequence from the frame index of the file. Returns false if the file cannot be read lazily.
+  virtual bool ReadDataLazy(vtkMRMLSequenceNode* sequenceNode);
+
+  /// Read the payloads of all frames in the sequence that are still stored in the specified file into memory.
+  /// Must be called before the file is overwritten.
+  static void LoadFrameDataFromFile(vtkMRMLSequenceNode* sequenceNode, std::string fileName);
+
   /// Initialize all the supported write file types
   virtual void InitializeSupportedReadFileTypes();
 
@@ -93,7 +165,44 @@ protected:
   /// Update the supported compression presets
   virtual void UpdateCompressionPresets();
 
+  /// Take a snapshot of the frames between the last queued frame and endIndex, and queue them for the writer thread.
+  /// \param waitForQueue If the queue is full, wait until there is space in the queue instead of leaving the frames for a later call
+  bool QueueIncrementalFrames(vtkMRMLSequenceNode* sequenceNode, int endIndex, bool waitForQueue);
+
+  /// Replace the items that have been written by the writer thread by their encoded frames
+  /// \return False if the writer thread failed to write any of the frames
+  bool UpdateIncrementallyWrittenFrames(vtkMRMLSequenceNode* sequenceNode);
+
+  /// Parameters for encoding frames using the current compression settings
+  std::map<std::string, std::string> GetCodecParameters();
+
+  /// Extend the item ranges to the group of pictures boundaries, so that each range starts at a keyframe and ends before a keyframe.
+  /// Overlapping and adjacent ranges are merged.
+  static void ExpandFrameRangesToKeyFrames(vtkMRMLSequenceNode* sequenceNode, std::vector<std::pair<int, int> >& frameRanges);
+
   std::string CodecFourCC;
+  bool LazyRead;
+
+  bool IncrementalWriteActive;
+  std::string IncrementalWriteFileName;
+  int NumberOfIncrementallyWrittenFrames;
+
+  /// State of the encoded frame of an item when the sequence was last read or written
+  struct FrameSnapshot
+  {
+    vtkWeakPointer<vtkStreamingVolumeFrame> Frame;
+    vtkMTimeType FrameMTime;
+  };
+  /// Frame snapshots indexed by the index value of the item
+  std::map<std::string, FrameSnapshot> FrameSnapshots;
+  /// Sequence that the snapshots were taken from
+  vtkWeakPointer<vtkMRMLSequenceNode> FrameSnapshotSequenceNode;
+  /// Codec that the frames were encoded with when the snapshots were taken
+  std::string FrameSnapshotCodecFourCC;
+
+  /// Writer thread of the incrementally written file
+  class vtkInternal;
+  vtkInternal* Internal;
 };
 
 #endif
@@ -0,0 +1,210 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodecFactory.h>
+#include <vtkStreamingVolumeFrame.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOLosslessVolumeCodec.h>
+
+//----------------------------------------------------------------------------
+// Add an encoded video sequence to the scene, with keyframes every groupOfPicturesSize frames.
+// Uncompressed frames can be decoded independently, so groups of pictures are simulated by marking frames as predicted frames.
+vtkMRMLSequenceNode* AddVideoSequence(vtkMRMLScene* scene, int numFrames, double startTime, int groupOfPicturesSize, int firstKeyFrame, int width = 8)
+{
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  sequenceNode->SetIndexName("time");
+  scene->AddNode(sequenceNode);
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(width, 8, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, i);
+
+    vtkNew<vtkMRMLStreamingVolumeNode> streamingVolumeNode;
+    streamingVolumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+    std::stringstream indexValue;
+    indexValue << startTime + 0.5 * i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode.GetPointer(), indexValue.str());
+  }
+
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, "RV24"))
+  {
+    return NULL;
+  }
+
+  vtkStreamingVolumeFrame* previousFrame = NULL;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkStreamingVolumeFrame* frame = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i))->GetFrame();
+    if (i < firstKeyFrame || (i - firstKeyFrame) % groupOfPicturesSize != 0)
+    {
+      frame->SetFrameType(vtkStreamingVolumeFrame::PFrame);
+      frame->SetPreviousFrame(previousFrame);
+    }
+    previousFrame = frame;
+  }
+  return sequenceNode.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+int vtkConcatenateVideoSequencesTest(int argc, char* argv[])
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  // The second recording starts in the middle of a group of pictures (ex. trimmed), so its first 2 frames must be re-encoded
+  vtkNew<vtkCollection> inputSequenceNodes;
+  vtkMRMLSequenceNode* firstSequenceNode = AddVideoSequence(scene.GetPointer(), 10, 100.0, 5, 0);
+  vtkMRMLSequenceNode* secondSequenceNode = AddVideoSequence(scene.GetPointer(), 10, 0.0, 5, 2);
+  if (!firstSequenceNode || !secondSequenceNode)
+  {
+    std::cerr << "Could not encode input sequences" << std::endl;
+    return EXIT_FAILURE;
+  }
+  inputSequenceNodes->AddItem(firstSequenceNode);
+  inputSequenceNodes->AddItem(secondSequenceNode);
+
+  vtkNew<vtkMRMLSequenceNode> outputSequenceNode;
+  scene->AddNode(outputSequenceNode);
+  int numberOfReEncodedFrames = 0;
+  if (!vtkSlicerIGSIOCommon::ConcatenateVideoSequences(inputSequenceNodes.GetPointer(), outputSequenceNode.GetPointer(),
+    std::map<std::string, std::string>(), &numberOfReEncodedFrames))
+  {
+    std::cerr << "Could not concatenate sequences" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (numberOfReEncodedFrames != 2)
+  {
+    std::cerr << "Expected 2 re-encoded frames, got " << numberOfReEncodedFrames << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (outputSequenceNode->GetNumberOfDataNodes() != 20)
+  {
+    std::cerr << "Expected 20 frames, got " << outputSequenceNode->GetNumberOfDataNodes() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < outputSequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    // The second sequence continues one frame interval after the end of the first sequence
+    std::stringstream expectedIndexValue;
+    expectedIndexValue << 100.0 + 0.5 * i;
+    if (outputSequenceNode->GetNthIndexValue(i) != expectedIndexValue.str())
+    {
+      std::cerr << "Unexpected index value for frame " << i << ": " << outputSequenceNode->GetNthIndexValue(i) << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkMRMLSequenceNode* inputSequenceNode = i < 10 ? firstSequenceNode : secondSequenceNode;
+    vtkStreamingVolumeFrame* inputFrame = vtkMRMLStreamingVolumeNode::SafeDownCast(inputSequenceNode->GetNthDataNode(i % 10))->GetFrame();
+    vtkStreamingVolumeFrame* outputFrame = vtkMRMLStreamingVolumeNode::SafeDownCast(outputSequenceNode->GetNthDataNode(i))->GetFrame();
+    bool reEncoded = (i == 10 || i == 11);
+    if (reEncoded == (inputFrame == outputFrame))
+    {
+      std::cerr << "Frame " << i << (reEncoded ? " should be re-encoded" : " should be copied") << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (i == 10 && !outputFrame->IsKeyFrame())
+    {
+      std::cerr << "The first frame after the seam must be a keyframe" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The codec of the third recording changes after its first keyframe, so all of its frames must be re-encoded
+  vtkStreamingVolumeCodecFactory::GetInstance()->RegisterStreamingCodec(vtkSmartPointer<vtkSlicerIGSIOLosslessVolumeCodec>::New());
+  vtkMRMLSequenceNode* thirdSequenceNode = AddVideoSequence(scene.GetPointer(), 10, 10.0, 5, 0);
+  if (!thirdSequenceNode
+    || !vtkSlicerIGSIOCommon::ReEncodeVideoSequence(thirdSequenceNode, 6, 9, vtkSlicerIGSIOLosslessVolumeCodec::GetCodecFourCC()))
+  {
+    std::cerr << "Could not encode mixed codec input sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkCollection> mixedInputSequenceNodes;
+  mixedInputSequenceNodes->AddItem(firstSequenceNode);
+  mixedInputSequenceNodes->AddItem(thirdSequenceNode);
+  numberOfReEncodedFrames = 0;
+  if (!vtkSlicerIGSIOCommon::ConcatenateVideoSequences(mixedInputSequenceNodes.GetPointer(), outputSequenceNode.GetPointer(),
+    std::map<std::string, std::string>(), &numberOfReEncodedFrames))
+  {
+    std::cerr << "Could not concatenate mixed codec sequences" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (numberOfReEncodedFrames != 10)
+  {
+    std::cerr << "Expected 10 re-encoded frames for the mixed codec input, got " << numberOfReEncodedFrames << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < outputSequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkStreamingVolumeFrame* outputFrame = vtkMRMLStreamingVolumeNode::SafeDownCast(outputSequenceNode->GetNthDataNode(i))->GetFrame();
+    if (outputFrame->GetCodecFourCC() != "RV24")
+    {
+      std::cerr << "Frame " << i << " was not re-encoded using the codec of the output" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Frames are not resampled, so inputs with a different frame size are rejected and the output is not modified
+  vtkMRMLSequenceNode* largerSequenceNode = AddVideoSequence(scene.GetPointer(), 10, 20.0, 5, 0, 16);
+  if (!largerSequenceNode)
+  {
+    std::cerr << "Could not encode larger input sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkCollection> mixedSizeInputSequenceNodes;
+  mixedSizeInputSequenceNodes->AddItem(firstSequenceNode);
+  mixedSizeInputSequenceNodes->AddItem(largerSequenceNode);
+  int numberOfOutputFrames = outputSequenceNode->GetNumberOfDataNodes();
+  if (vtkSlicerIGSIOCommon::ConcatenateVideoSequences(mixedSizeInputSequenceNodes.GetPointer(), outputSequenceNode.GetPointer()))
+  {
+    std::cerr << "Sequences with different frame sizes were concatenated" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (outputSequenceNode->GetNumberOfDataNodes() != numberOfOutputFrames)
+  {
+    std::cerr << "The output sequence was modified by a failed concatenation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
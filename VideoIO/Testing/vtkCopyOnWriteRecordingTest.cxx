@@ -0,0 +1,134 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <cstring>
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// VideoIO includes
+#include <vtkSlicerVideoIOLogic.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkImageData> CreateImage(unsigned char value)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(16, 12, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    memset(imageData->GetScalarPointer(), value, 16 * 12 * 3);
+    return imageData;
+  }
+
+  //----------------------------------------------------------------------------
+  unsigned char GetFirstValue(vtkMRMLStreamingVolumeNode* node)
+  {
+    return ((unsigned char*)node->GetImageData()->GetScalarPointer())[0];
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkCopyOnWriteRecordingTest(int argc, char* argv[])
+{
+  vtkNew<vtkSlicerVideoIOLogic> logic;
+  logic->SetRecordingCopyMode(vtkSlicerVideoIOLogic::RecordingCopyOnWrite);
+
+  // Recorded items share the image of the source
+  vtkNew<vtkMRMLStreamingVolumeNode> sourceNode;
+  sourceNode->SetAndObserveImageData(CreateImage(1));
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode1;
+  if (!logic->ShareRecordedImage(sourceNode.GetPointer(), targetNode1.GetPointer())
+    || targetNode1->GetImageData()->GetScalarPointer() != sourceNode->GetImageData()->GetScalarPointer())
+  {
+    std::cerr << "Recorded image does not share the image of the source" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The shared items are copied before the source modifies its image in place
+  sourceNode->InvokeEvent(vtkSlicerVideoIOLogic::ImageDataAboutToBeModifiedEvent);
+  logic->MaterializeRecordedImages(sourceNode.GetPointer());
+  memset(sourceNode->GetImageData()->GetScalarPointer(), 2, 16 * 12 * 3);
+  sourceNode->GetImageData()->Modified();
+  if (GetFirstValue(targetNode1.GetPointer()) != 1 || logic->GetNumberOfMaterializedRecordedImages() != 1)
+  {
+    std::cerr << "Recorded image was not copied before the source image was modified" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Sources that set a new image for each frame are never copied
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode2;
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode3;
+  logic->ShareRecordedImage(sourceNode.GetPointer(), targetNode2.GetPointer());
+  sourceNode->SetAndObserveImageData(CreateImage(3));
+  logic->ShareRecordedImage(sourceNode.GetPointer(), targetNode3.GetPointer());
+  if (GetFirstValue(targetNode2.GetPointer()) != 2 || GetFirstValue(targetNode3.GetPointer()) != 3
+    || logic->GetNumberOfSharedRecordedImages() != 3 || logic->GetNumberOfMaterializedRecordedImages() != 1)
+  {
+    std::cerr << "Unexpected recorded images: " << logic->GetNumberOfSharedRecordedImages() << " shared, "
+      << logic->GetNumberOfMaterializedRecordedImages() << " copied" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Modifying the image in place without notification disables copy-on-write for the source
+  memset(sourceNode->GetImageData()->GetScalarPointer(), 4, 16 * 12 * 3);
+  sourceNode->GetImageData()->Modified();
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode4;
+  if (logic->ShareRecordedImage(sourceNode.GetPointer(), targetNode4.GetPointer()))
+  {
+    std::cerr << "Copy-on-write should be disabled after an unnotified modification" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The state of a source is discarded when it is removed from the scene
+  vtkNew<vtkMRMLScene> scene;
+  logic->SetMRMLScene(scene);
+  vtkNew<vtkMRMLStreamingVolumeNode> sceneSourceNode;
+  scene->AddNode(sceneSourceNode);
+  sceneSourceNode->SetAndObserveImageData(CreateImage(5));
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode5;
+  logic->ShareRecordedImage(sceneSourceNode.GetPointer(), targetNode5.GetPointer());
+  memset(sceneSourceNode->GetImageData()->GetScalarPointer(), 6, 16 * 12 * 3);
+  sceneSourceNode->GetImageData()->Modified();
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode6;
+  if (logic->ShareRecordedImage(sceneSourceNode.GetPointer(), targetNode6.GetPointer()))
+  {
+    std::cerr << "Copy-on-write should be disabled after an unnotified modification" << std::endl;
+    return EXIT_FAILURE;
+  }
+  scene->RemoveNode(sceneSourceNode);
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode7;
+  if (!logic->ShareRecordedImage(sceneSourceNode.GetPointer(), targetNode7.GetPointer()))
+  {
+    std::cerr << "Copy-on-write state was not discarded when the source was removed from the scene" << std::endl;
+    return EXIT_FAILURE;
+  }
+  logic->SetMRMLScene(NULL);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// VideoIO includes
+#include <vtkSlicerVideoIOLogic.h>
+
+//----------------------------------------------------------------------------
+int vtkDecodedFrameCacheTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 3;
+  unsigned long long frameSize = width * height * 3;
+
+  vtkNew<vtkSlicerVideoIOLogic> logic;
+  if (logic->GetDecodedFrameCacheSize() != 0)
+  {
+    std::cerr << "Cache should be disabled by default" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Only two frames fit in the cache
+  logic->SetDecodedFrameCacheSize(2 * frameSize);
+
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > frames;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    memset(imageData->GetScalarPointer(), i, frameSize);
+
+    vtkSmartPointer<vtkStreamingVolumeFrame> frame = vtkSmartPointer<vtkStreamingVolumeFrame>::New();
+    frames.push_back(frame);
+    logic->AddDecodedFrameToCache(frame, imageData);
+
+    if (i == 1)
+    {
+      // Mark the first frame as recently used, so that the second frame is evicted next
+      vtkNew<vtkImageData> outputImage;
+      if (!logic->GetDecodedFrameFromCache(frames[0], outputImage.GetPointer()))
+      {
+        std::cerr << "Frame 0 should be in the cache" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  if (logic->GetNumberOfDecodedFramesInCache() != 2 || logic->GetDecodedFrameCacheMemoryUsage() != 2 * frameSize)
+  {
+    std::cerr << "Unexpected cache usage: " << logic->GetNumberOfDecodedFramesInCache() << " frames, "
+              << logic->GetDecodedFrameCacheMemoryUsage() << " bytes" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int expectedInCache[3] = { 1, 0, 1 };
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkNew<vtkImageData> outputImage;
+    bool inCache = logic->GetDecodedFrameFromCache(frames[i], outputImage.GetPointer());
+    if (inCache != (expectedInCache[i] == 1))
+    {
+      std::cerr << "Frame " << i << (inCache ? " should not" : " should") << " be in the cache" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (inCache && ((unsigned char*)outputImage->GetScalarPointer())[0] != i)
+    {
+      std::cerr << "Cached image of frame " << i << " does not match the decoded image" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (logic->GetDecodedFrameCacheHits() != 3 || logic->GetDecodedFrameCacheMisses() != 1)
+  {
+    std::cerr << "Unexpected cache statistics: " << logic->GetDecodedFrameCacheHits() << " hits, "
+              << logic->GetDecodedFrameCacheMisses() << " misses" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Modifying the frame invalidates the cached image
+  frames[2]->Modified();
+  vtkNew<vtkImageData> outputImage;
+  if (logic->GetDecodedFrameFromCache(frames[2], outputImage.GetPointer()))
+  {
+    std::cerr << "Modified frame should not be in the cache" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  logic->ClearDecodedFrameCache();
+  if (logic->GetNumberOfDecodedFramesInCache() != 0 || logic->GetDecodedFrameCacheMemoryUsage() != 0)
+  {
+    std::cerr << "Cache was not cleared" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// MRML includes
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// VideoIO includes
+#include <vtkSlicerVideoIOLogic.h>
+
+//----------------------------------------------------------------------------
+int vtkEncodeOnRecordTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 10;
+  int frameSize = width * height * 3;
+
+  vtkNew<vtkSlicerVideoIOLogic> logic;
+  if (!logic->GetEncodeOnRecordCodecFourCC().empty())
+  {
+    std::cerr << "Encode on record should be disabled by default" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!logic->SetEncodeOnRecordCodecFourCC("RV24"))
+  {
+    std::cerr << "Could not enable encode on record" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Recording waits for the encoder, so that all images are encoded
+  logic->SetEncodeOnRecordQueueSize(2);
+  logic->SetEncodeOnRecordOverflowPolicy(vtkSlicerVideoIOLogic::EncodeOnRecordWait);
+
+  vtkNew<vtkMRMLStreamingVolumeNode> sourceNode;
+  std::vector<vtkSmartPointer<vtkMRMLStreamingVolumeNode> > targetNodes;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    unsigned char* imageDataScalars = (unsigned char*)imageData->GetScalarPointer();
+    for (int j = 0; j < frameSize; ++j)
+    {
+      imageDataScalars[j] = (unsigned char)(i * 5 + j);
+    }
+    sourceNode->SetAndObserveImageData(imageData);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> targetNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    if (!logic->EncodeOnRecord(sourceNode.GetPointer(), targetNode))
+    {
+      std::cerr << "Image " << i << " was not queued for encoding" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (logic->GetEncodeOnRecordQueueLength() > 2)
+    {
+      std::cerr << "Queue exceeds its size: " << logic->GetEncodeOnRecordQueueLength() << std::endl;
+      return EXIT_FAILURE;
+    }
+    targetNodes.push_back(targetNode);
+  }
+
+  logic->FlushEncodeOnRecord();
+  if (logic->GetEncodeOnRecordQueueLength() != 0 || logic->GetNumberOfFramesEncodedOnRecord() != numFrames
+    || logic->GetNumberOfFramesStoredUncompressedOnRecord() != 0)
+  {
+    std::cerr << "Unexpected statistics: " << logic->GetNumberOfFramesEncodedOnRecord() << " encoded, "
+      << logic->GetNumberOfFramesStoredUncompressedOnRecord() << " uncompressed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkStreamingVolumeFrame* frame = targetNodes[i]->GetFrame();
+    if (!frame || frame->GetCodecFourCC() != "RV24")
+    {
+      std::cerr << "Image " << i << " was not replaced by an encoded frame" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkImageData* decodedImage = targetNodes[i]->GetImageData();
+    unsigned char* decodedImageScalars = decodedImage ? (unsigned char*)decodedImage->GetScalarPointer() : NULL;
+    for (int j = 0; decodedImageScalars && j < frameSize; ++j)
+    {
+      if (decodedImageScalars[j] != (unsigned char)(i * 5 + j))
+      {
+        decodedImageScalars = NULL;
+      }
+    }
+    if (!decodedImageScalars)
+    {
+      std::cerr << "Decoded image " << i << " does not match the recorded image" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Disabling stops the encoder, recorded images are stored uncompressed
+  logic->SetEncodeOnRecordCodecFourCC("");
+  vtkNew<vtkMRMLStreamingVolumeNode> targetNode;
+  if (logic->EncodeOnRecord(sourceNode.GetPointer(), targetNode.GetPointer()) || !targetNode->GetImageData() || targetNode->GetFrame())
+  {
+    std::cerr << "Image should be stored uncompressed when encode on record is disabled" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
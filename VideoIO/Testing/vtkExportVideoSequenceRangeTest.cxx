@@ -0,0 +1,156 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+
+//----------------------------------------------------------------------------
+int vtkExportVideoSequenceRangeTest(int argc, char* argv[])
+{
+  int numFrames = 20;
+  int groupOfPicturesSize = 5;
+  std::string codecFourCC = "RV24";
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  sequenceNode->SetIndexName("time");
+  scene->AddNode(sequenceNode);
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(8, 8, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, i);
+
+    vtkNew<vtkMRMLStreamingVolumeNode> streamingVolumeNode;
+    streamingVolumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+    std::stringstream indexValue;
+    indexValue << i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode.GetPointer(), indexValue.str());
+  }
+
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC))
+  {
+    std::cerr << "Could not encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Uncompressed frames can be decoded independently, so groups of pictures are simulated by marking frames as predicted frames
+  vtkStreamingVolumeFrame* previousFrame = NULL;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkStreamingVolumeFrame* frame = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i))->GetFrame();
+    if (i % groupOfPicturesSize != 0)
+    {
+      frame->SetFrameType(vtkStreamingVolumeFrame::PFrame);
+      frame->SetPreviousFrame(previousFrame);
+    }
+    previousFrame = frame;
+  }
+
+  // The range starts in the middle of a group of pictures: only the frames before the next keyframe are re-encoded
+  int startIndex = 7;
+  int endIndex = 16;
+  vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+  int numberOfReEncodedFrames = 0;
+  if (!vtkSlicerIGSIOCommon::VideoSequenceRangeToTrackedFrameList(sequenceNode.GetPointer(), startIndex, endIndex,
+    trackedFrameList.GetPointer(), std::map<std::string, std::string>(), &numberOfReEncodedFrames))
+  {
+    std::cerr << "Could not convert frames " << startIndex << " to " << endIndex << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (numberOfReEncodedFrames != 3)
+  {
+    std::cerr << "Expected 3 re-encoded frames, got " << numberOfReEncodedFrames << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if ((int)trackedFrameList->GetNumberOfTrackedFrames() != endIndex - startIndex + 1)
+  {
+    std::cerr << "Expected " << endIndex - startIndex + 1 << " tracked frames, got " << trackedFrameList->GetNumberOfTrackedFrames() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < (int)trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+  {
+    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i);
+    vtkStreamingVolumeFrame* exportedFrame = trackedFrame->GetImageData()->GetEncodedFrame();
+    vtkStreamingVolumeFrame* originalFrame = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(startIndex + i))->GetFrame();
+    if (trackedFrame->GetTimestamp() != startIndex + i)
+    {
+      std::cerr << "Unexpected timestamp for frame " << i << ": " << trackedFrame->GetTimestamp() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (i == 0 && (!exportedFrame || !exportedFrame->IsKeyFrame()))
+    {
+      std::cerr << "The first exported frame must be a keyframe" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (startIndex + i >= 10 && exportedFrame != originalFrame)
+    {
+      std::cerr << "Frame " << startIndex + i << " should be copied without re-encoding" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // A range that starts on a keyframe is copied without re-encoding
+  if (!vtkSlicerIGSIOCommon::VideoSequenceRangeToTrackedFrameList(sequenceNode.GetPointer(), 10, -1,
+    trackedFrameList.GetPointer(), std::map<std::string, std::string>(), &numberOfReEncodedFrames)
+    || numberOfReEncodedFrames != 0
+    || (int)trackedFrameList->GetNumberOfTrackedFrames() != numFrames - 10)
+  {
+    std::cerr << "Frames starting on a keyframe should be copied without re-encoding" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The source sequence is not modified
+  vtkMRMLStreamingVolumeNode* startVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(startIndex));
+  if (startVolumeNode->GetFrame()->IsKeyFrame())
+  {
+    std::cerr << "The source sequence should not be modified" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodec.h>
+#include <vtkStreamingVolumeCodecFactory.h>
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOMkvFrameIndex.h>
+
+// VideoIO MRML includes
+#include <vtkMRMLStreamingVolumeSequenceStorageNode.h>
+
+//---------------------------------------------------------------------------
+void SetGrayscaleTestingImageDataForValue(vtkImageData* image, unsigned char value)
+{
+  int dimensions[3] = { 0,0,0 };
+  image->GetDimensions(dimensions);
+
+  unsigned char* imageDataScalars = (unsigned char*)image->GetScalarPointer();
+  for (int y = 0; y < dimensions[1]; ++y)
+  {
+    for (int x = 0; x < dimensions[0]; ++x)
+    {
+      *imageDataScalars = (unsigned char)(value + 255 * (x / (double)dimensions[0]));
+      ++imageDataScalars;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// Decode the frames of the sequence and compare them to the single-component input images
+bool CheckGrayscaleSequence(vtkMRMLSequenceNode* sequenceNode, std::vector<vtkSmartPointer<vtkImageData> >& images)
+{
+  if (sequenceNode->GetNumberOfDataNodes() != (int)images.size())
+  {
+    std::cerr << "Unexpected number of data nodes: " << sequenceNode->GetNumberOfDataNodes() << std::endl;
+    return false;
+  }
+
+  vtkSmartPointer<vtkStreamingVolumeCodec> codec;
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    vtkStreamingVolumeFrame* frame = streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL;
+    if (!frame || !vtkSlicerIGSIOCommon::IsLumaOnlyFrame(frame))
+    {
+      std::cerr << "Frame " << i << " is not a luma-only frame" << std::endl;
+      return false;
+    }
+
+    if (!codec)
+    {
+      codec = vtkSmartPointer<vtkStreamingVolumeCodec>::Take(
+        vtkStreamingVolumeCodecFactory::GetInstance()->CreateCodecByFourCC(frame->GetCodecFourCC()));
+    }
+    vtkSmartPointer<vtkImageData> outputImage = vtkSmartPointer<vtkImageData>::New();
+    if (!codec || !vtkSlicerIGSIOCommon::DecodeFrame(codec, frame, outputImage))
+    {
+      std::cerr << "Frame " << i << " could not be decoded" << std::endl;
+      return false;
+    }
+    if (outputImage->GetNumberOfScalarComponents() != 1)
+    {
+      std::cerr << "Frame " << i << " was decoded to " << outputImage->GetNumberOfScalarComponents() << " components" << std::endl;
+      return false;
+    }
+
+    vtkImageData* inputImage = images[i];
+    int numberOfPixels = inputImage->GetDimensions()[0] * inputImage->GetDimensions()[1];
+    unsigned char* inputImagePointer = (unsigned char*)inputImage->GetScalarPointer();
+    unsigned char* outputImagePointer = (unsigned char*)outputImage->GetScalarPointer();
+    for (int j = 0; j < numberOfPixels; ++j)
+    {
+      if (inputImagePointer[j] != outputImagePointer[j])
+      {
+        std::cerr << "Frame " << i << " does not match the input image" << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkGrayscaleVideoTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 10;
+  std::string fileName = "vtkGrayscaleVideoTest.mkv";
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  sequenceNode->SetIndexName("time");
+  scene->AddNode(sequenceNode);
+
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    SetGrayscaleTestingImageDataForValue(imageData, (unsigned char)i);
+    images.push_back(imageData);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i * 0.1;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  // The color codec encodes the single-component images as luma-only frames
+  std::string codecFourCC = "RV24";
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC))
+  {
+    std::cerr << "Could not encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckGrayscaleSequence(sequenceNode.GetPointer(), images))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Re-encoding decodes the luma-only frames to single-component images, so they stay single-component
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC,
+    std::map<std::string, std::string>(), true, false, 2))
+  {
+    std::cerr << "Could not force re-encoding of sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckGrayscaleSequence(sequenceNode.GetPointer(), images))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The grayscale flag is stored in the file, so the frames are read back as luma-only frames
+  vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+  if (!vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(sequenceNode.GetPointer(), trackedFrameList.GetPointer())
+    || !vtkMRMLStreamingVolumeSequenceStorageNode::WriteVideo(fileName, trackedFrameList.GetPointer()))
+  {
+    std::cerr << "Could not write video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkSlicerIGSIOMkvFrameIndex> frameIndex;
+  vtkNew<vtkMRMLSequenceNode> readSequenceNode;
+  scene->AddNode(readSequenceNode);
+  if (!frameIndex->ReadFile(fileName)
+    || !vtkSlicerIGSIOCommon::MkvFrameIndexToVolumeSequence(frameIndex.GetPointer(), readSequenceNode.GetPointer()))
+  {
+    std::cerr << "Could not read video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckGrayscaleSequence(readSequenceNode.GetPointer(), images))
+  {
+    return EXIT_FAILURE;
+  }
+
+  readSequenceNode->RemoveAllDataNodes();
+  vtksys::SystemTools::RemoveFile(fileName);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <cstring>
+#include <iostream>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOImagePool.h>
+
+//----------------------------------------------------------------------------
+int vtkImagePoolTest(int argc, char* argv[])
+{
+  int dimensions[3] = { 16, 12, 1 };
+  unsigned long long frameSize = dimensions[0] * dimensions[1] * dimensions[2] * 3;
+
+  vtkSlicerIGSIOImagePool* pool = vtkSlicerIGSIOImagePool::GetInstance();
+  pool->Clear();
+  pool->ResetStatistics();
+  pool->SetMaximumSize(2 * frameSize);
+
+  // Released buffers are reused by images of the same size
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  pool->AllocateImage(image, dimensions, VTK_UNSIGNED_CHAR, 3);
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if (!scalars || scalars->GetNumberOfTuples() != dimensions[0] * dimensions[1] || scalars->GetNumberOfComponents() != 3)
+  {
+    std::cerr << "Image was not allocated" << std::endl;
+    return EXIT_FAILURE;
+  }
+  void* scalarPointer = image->GetScalarPointer();
+  pool->ReleaseImage(image);
+  if (pool->GetNumberOfBuffers() != 1 || pool->GetResidentSize() != frameSize || image->GetPointData()->GetScalars())
+  {
+    std::cerr << "Buffer was not returned to the pool: " << pool->GetNumberOfBuffers() << " buffers, "
+      << pool->GetResidentSize() << " bytes" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkImageData> source = vtkSmartPointer<vtkImageData>::New();
+  source->SetDimensions(dimensions);
+  source->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+  memset(source->GetScalarPointer(), 7, frameSize);
+  vtkSmartPointer<vtkImageData> copy = vtkSmartPointer<vtkImageData>::New();
+  pool->CopyImage(source, copy);
+  if (copy->GetScalarPointer() != scalarPointer || ((unsigned char*)copy->GetScalarPointer())[frameSize - 1] != 7)
+  {
+    std::cerr << "Copy did not reuse the released buffer" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Images of a different size do not use the buffers of the pool
+  int otherDimensions[3] = { 8, 8, 1 };
+  vtkSmartPointer<vtkImageData> otherImage = vtkSmartPointer<vtkImageData>::New();
+  pool->AllocateImage(otherImage, otherDimensions, VTK_UNSIGNED_CHAR, 3);
+  if (pool->GetNumberOfHits() != 1 || pool->GetNumberOfMisses() != 2 || pool->GetResidentSize() != 0)
+  {
+    std::cerr << "Unexpected pool statistics: " << pool->GetNumberOfHits() << " hits, " << pool->GetNumberOfMisses() << " misses" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Images that are still referenced elsewhere are not recycled
+  vtkSmartPointer<vtkImageData> sharedImage = copy;
+  pool->ReleaseImage(copy);
+  sharedImage = NULL;
+  if (pool->GetNumberOfBuffers() != 0 || !copy->GetPointData()->GetScalars())
+  {
+    std::cerr << "Shared image should not be released" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Buffers that do not fit in the maximum size are freed
+  pool->SetMaximumSize(frameSize);
+  pool->ReleaseImage(copy);
+  pool->ReleaseImage(source);
+  if (pool->GetNumberOfBuffers() != 1 || pool->GetResidentSize() != frameSize)
+  {
+    std::cerr << "Pool exceeds its maximum size: " << pool->GetResidentSize() << " bytes" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  pool->Clear();
+  if (pool->GetNumberOfBuffers() != 0 || pool->GetResidentSize() != 0)
+  {
+    std::cerr << "Pool was not cleared" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtksys/SystemTools.hxx>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOMkvFrameIndex.h>
+
+// VideoIO MRML includes
+#include <vtkMRMLStreamingVolumeSequenceStorageNode.h>
+
+// VideoIO includes
+#include <vtkSlicerVideoIOLogic.h>
+
+//----------------------------------------------------------------------------
+void AddIncrementalWriteTestingFrames(vtkMRMLSequenceNode* sequenceNode, int numberOfFrames)
+{
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    int itemNumber = sequenceNode->GetNumberOfDataNodes();
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(8, 8, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, itemNumber);
+
+    vtkNew<vtkMRMLStreamingVolumeNode> streamingVolumeNode;
+    streamingVolumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+    std::stringstream indexValue;
+    indexValue << itemNumber * 0.1;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode.GetPointer(), indexValue.str());
+  }
+}
+
+//----------------------------------------------------------------------------
+bool CheckIncrementallyWrittenFrames(vtkMRMLStreamingVolumeSequenceStorageNode* storageNode, vtkMRMLSequenceNode* sequenceNode,
+  int expectedNumberOfFrames)
+{
+  if (storageNode->GetNumberOfIncrementallyWrittenFrames() != expectedNumberOfFrames)
+  {
+    std::cerr << "Unexpected number of written frames: " << storageNode->GetNumberOfIncrementallyWrittenFrames()
+              << ", expected " << expectedNumberOfFrames << std::endl;
+    return false;
+  }
+
+  // Written items are replaced by their encoded frames
+  for (int i = 0; i < expectedNumberOfFrames; ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    if (!streamingVolumeNode || !streamingVolumeNode->GetFrame())
+    {
+      std::cerr << "Written item " << i << " was not replaced by its encoded frame" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkIncrementalWriteTest(int argc, char* argv[])
+{
+  std::string fileName = "vtkIncrementalWriteTest.mkv";
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  sequenceNode->SetIndexName("time");
+  scene->AddNode(sequenceNode);
+
+  vtkNew<vtkMRMLStreamingVolumeSequenceStorageNode> storageNode;
+  scene->AddNode(storageNode);
+  storageNode->SetFileName(fileName.c_str());
+  storageNode->SetCodecFourCC("RV24");
+  sequenceNode->SetAndObserveStorageNodeID(storageNode->GetID());
+
+  if (!storageNode->StartIncrementalWrite())
+  {
+    std::cerr << "Could not start incremental writing" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Frames are written on the writer thread, so they are only known to be written after flushing
+  AddIncrementalWriteTestingFrames(sequenceNode, 10);
+  if (!storageNode->WriteIncrementalFrames(5))
+  {
+    std::cerr << "Could not queue frames for writing" << std::endl;
+    return EXIT_FAILURE;
+  }
+  AddIncrementalWriteTestingFrames(sequenceNode, 15);
+  if (!storageNode->WriteIncrementalFrames(5) || !storageNode->FlushIncrementalWrite())
+  {
+    std::cerr << "Could not write frames" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckIncrementallyWrittenFrames(storageNode, sequenceNode, 25))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The remaining frames are written when writing is stopped
+  AddIncrementalWriteTestingFrames(sequenceNode, 5);
+  if (!storageNode->StopIncrementalWrite() || storageNode->GetIncrementalWriteActive())
+  {
+    std::cerr << "Could not stop incremental writing" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckIncrementallyWrittenFrames(storageNode, sequenceNode, 30))
+  {
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkSlicerIGSIOMkvFrameIndex> frameIndex;
+  if (!frameIndex->ReadFile(fileName))
+  {
+    std::cerr << "Could not index video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  int trackNumber = frameIndex->GetFirstVideoTrackNumber();
+  if (frameIndex->GetNumberOfFrames(trackNumber) != 30)
+  {
+    std::cerr << "Unexpected number of frames in file: " << frameIndex->GetNumberOfFrames(trackNumber) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The logic finalizes the file when the scene is closed
+  vtkNew<vtkSlicerVideoIOLogic> logic;
+  logic->SetMRMLScene(scene);
+  if (!storageNode->StartIncrementalWrite())
+  {
+    std::cerr << "Could not restart incremental writing" << std::endl;
+    return EXIT_FAILURE;
+  }
+  AddIncrementalWriteTestingFrames(sequenceNode, 5);
+  int numberOfFrames = sequenceNode->GetNumberOfDataNodes();
+  scene->Clear(1);
+  logic->SetMRMLScene(NULL);
+  if (storageNode->GetIncrementalWriteActive())
+  {
+    std::cerr << "Incremental writing was not finalized when the scene was closed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkSlicerIGSIOMkvFrameIndex> closedSceneFrameIndex;
+  if (!closedSceneFrameIndex->ReadFile(fileName))
+  {
+    std::cerr << "Could not index video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  trackNumber = closedSceneFrameIndex->GetFirstVideoTrackNumber();
+  if (closedSceneFrameIndex->GetNumberOfFrames(trackNumber) != numberOfFrames)
+  {
+    std::cerr << "Unexpected number of frames in file after closing the scene: "
+      << closedSceneFrameIndex->GetNumberOfFrames(trackNumber) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtksys::SystemTools::RemoveFile(fileName);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <fstream>
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtksys/SystemTools.hxx>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOInstrumentation.h>
+
+//----------------------------------------------------------------------------
+int vtkInstrumentationTest(int argc, char* argv[])
+{
+  int numFrames = 10;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode);
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(8, 8, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, i);
+
+    vtkNew<vtkMRMLStreamingVolumeNode> streamingVolumeNode;
+    streamingVolumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+    std::stringstream indexValue;
+    indexValue << i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode.GetPointer(), indexValue.str());
+  }
+
+  vtkSlicerIGSIOInstrumentation* instrumentation = vtkSlicerIGSIOInstrumentation::GetInstance();
+  instrumentation->Reset();
+
+  // Nothing is recorded while instrumentation is disabled
+  instrumentation->SetEnabled(false);
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, "RV24", std::map<std::string, std::string>(), true))
+  {
+    std::cerr << "Could not encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (instrumentation->GetNumberOfStages() != 0)
+  {
+    std::cerr << "Stages should not be recorded while instrumentation is disabled" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  instrumentation->SetEnabled(true);
+  bool success = vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, "RV24", std::map<std::string, std::string>(), true);
+  instrumentation->SetEnabled(false);
+  if (!success)
+  {
+    std::cerr << "Could not re-encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << instrumentation->GetReport();
+
+  if (instrumentation->GetStageNumberOfCalls("ReEncode") != 1
+    || instrumentation->GetStageNumberOfItems("ReEncode") != numFrames
+    || instrumentation->GetStageNumberOfCalls("Decode") != numFrames
+    || instrumentation->GetStageNumberOfCalls("Encode") != numFrames)
+  {
+    std::cerr << "Unexpected number of recorded calls" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int histogramCount = 0;
+  for (int bin = 0; bin < instrumentation->GetNumberOfHistogramBins(); ++bin)
+  {
+    histogramCount += instrumentation->GetStageHistogramBinCount("Encode", bin);
+  }
+  if (histogramCount != numFrames
+    || instrumentation->GetStageMinimumTime("Encode") > instrumentation->GetStageMaximumTime("Encode")
+    || instrumentation->GetStageTotalTime("Encode") < instrumentation->GetStageMaximumTime("Encode"))
+  {
+    std::cerr << "Inconsistent statistics of the Encode stage" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  instrumentation->Reset();
+  if (instrumentation->GetNumberOfStages() != 0 || instrumentation->GetStageNumberOfCalls("Encode") != 0)
+  {
+    std::cerr << "Statistics should be removed by reset" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Spans are only recorded while tracing is enabled, independently of the statistics
+  if (instrumentation->GetNumberOfTraceEvents() != 0)
+  {
+    std::cerr << "Spans should not be recorded while tracing is disabled" << std::endl;
+    return EXIT_FAILURE;
+  }
+  instrumentation->SetTracingEnabled(true);
+  success = vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, "RV24", std::map<std::string, std::string>(), true);
+  instrumentation->SetTracingEnabled(false);
+  if (!success)
+  {
+    std::cerr << "Could not re-encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // ReEncode, ReEncodeBlock, and a Decode and Encode span for each frame
+  int expectedNumberOfTraceEvents = 2 + 2 * numFrames;
+  if (instrumentation->GetNumberOfStages() != 0 || instrumentation->GetNumberOfTraceEvents() != expectedNumberOfTraceEvents)
+  {
+    std::cerr << "Expected " << expectedNumberOfTraceEvents << " spans, got " << instrumentation->GetNumberOfTraceEvents() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string traceFileName = "vtkInstrumentationTest.json";
+  if (!instrumentation->WriteTrace(traceFileName) || vtksys::SystemTools::FileLength(traceFileName) == 0)
+  {
+    std::cerr << "Could not write trace file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::ifstream traceFile(traceFileName.c_str());
+  std::stringstream traceContent;
+  traceContent << traceFile.rdbuf();
+  traceFile.close();
+  vtksys::SystemTools::RemoveFile(traceFileName);
+  if (traceContent.str().find("\"name\": \"ReEncodeBlock\"") == std::string::npos)
+  {
+    std::cerr << "Trace file does not contain the re-encoded block" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  instrumentation->ClearTrace();
+  if (instrumentation->GetNumberOfTraceEvents() != 0)
+  {
+    std::cerr << "Spans should be removed by ClearTrace" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
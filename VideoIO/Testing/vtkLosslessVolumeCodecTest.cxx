@@ -0,0 +1,268 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkUnsignedCharArray.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodecFactory.h>
+#include <vtkStreamingVolumeFrame.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOLosslessVolumeCodec.h>
+
+//---------------------------------------------------------------------------
+// Smooth gradient that moves by one pixel per frame, with a small amount of noise
+template<typename T>
+void SetLosslessTestingImageDataForFrame(vtkImageData* image, int frameIndex)
+{
+  int dimensions[3] = { 0,0,0 };
+  image->GetDimensions(dimensions);
+  int numberOfComponents = image->GetNumberOfScalarComponents();
+
+  T* imageDataScalars = (T*)image->GetScalarPointer();
+  for (int y = 0; y < dimensions[1]; ++y)
+  {
+    for (int x = 0; x < dimensions[0]; ++x)
+    {
+      for (int c = 0; c < numberOfComponents; ++c)
+      {
+        *imageDataScalars = (T)(x + y + frameIndex + c + ((x * 7 + y * 13 + frameIndex) % 3));
+        ++imageDataScalars;
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// Encode the images using the lossless codec, check the keyframes and the size of the frames, and decode them using a new codec instance
+template<typename T>
+bool CheckLosslessRoundTrip(int scalarType, int numberOfComponents)
+{
+  int width = 64;
+  int height = 48;
+  int numFrames = 12;
+  int keyFrameInterval = 5;
+
+  vtkNew<vtkSlicerIGSIOLosslessVolumeCodec> encoder;
+  std::map<std::string, std::string> parameters;
+  parameters["keyFrameInterval"] = "5";
+  encoder->SetParameters(parameters);
+
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  std::vector<vtkSmartPointer<vtkStreamingVolumeFrame> > frames;
+  vtkIdType uncompressedSize = 0;
+  vtkIdType encodedSize = 0;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(scalarType, numberOfComponents);
+    SetLosslessTestingImageDataForFrame<T>(imageData, i);
+    images.push_back(imageData);
+
+    vtkSmartPointer<vtkStreamingVolumeFrame> frame = vtkSmartPointer<vtkStreamingVolumeFrame>::New();
+    if (!encoder->EncodeImageData(imageData, frame))
+    {
+      std::cerr << "Could not encode frame " << i << std::endl;
+      return false;
+    }
+    if (frame->IsKeyFrame() != (i % keyFrameInterval == 0))
+    {
+      std::cerr << "Unexpected frame type for frame " << i << std::endl;
+      return false;
+    }
+    if (!frame->IsKeyFrame())
+    {
+      frame->SetPreviousFrame(frames.back());
+    }
+    frames.push_back(frame);
+    uncompressedSize += width * height * numberOfComponents * (vtkIdType)sizeof(T);
+    encodedSize += frame->GetFrameData()->GetNumberOfValues();
+  }
+
+  std::cout << "Scalar type " << scalarType << ", " << numberOfComponents << " components: compression ratio "
+    << uncompressedSize / (double)encodedSize << std::endl;
+  if (encodedSize * 3 > uncompressedSize)
+  {
+    std::cerr << "Frames are not compressed: " << encodedSize << " bytes for " << uncompressedSize << " bytes of images" << std::endl;
+    return false;
+  }
+
+  // Decode in reverse order, so that each frame is decoded starting from its keyframe
+  vtkNew<vtkSlicerIGSIOLosslessVolumeCodec> decoder;
+  for (int i = numFrames - 1; i >= 0; --i)
+  {
+    vtkSmartPointer<vtkImageData> decodedImage = vtkSmartPointer<vtkImageData>::New();
+    if (!decoder->DecodeFrame(frames[i], decodedImage))
+    {
+      std::cerr << "Could not decode frame " << i << std::endl;
+      return false;
+    }
+    if (decodedImage->GetScalarType() != scalarType || decodedImage->GetNumberOfScalarComponents() != numberOfComponents)
+    {
+      std::cerr << "Frame " << i << " was decoded to a different format" << std::endl;
+      return false;
+    }
+
+    T* inputImagePointer = (T*)images[i]->GetScalarPointer();
+    T* outputImagePointer = (T*)decodedImage->GetScalarPointer();
+    for (int j = 0; j < width * height * numberOfComponents; ++j)
+    {
+      if (inputImagePointer[j] != outputImagePointer[j])
+      {
+        std::cerr << "Frame " << i << " does not match the input image" << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// Frames with an invalid header must be rejected without decoding, and the compression level must be in the documented range
+bool CheckLosslessInvalidFrames()
+{
+  vtkNew<vtkSlicerIGSIOLosslessVolumeCodec> codec;
+  if (codec->SetParameter("compressionLevel", "0") || codec->SetParameter("compressionLevel", "10"))
+  {
+    std::cerr << "Compression level outside of 1-9 was accepted" << std::endl;
+    return false;
+  }
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(16, 16, 1);
+  imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  SetLosslessTestingImageDataForFrame<unsigned char>(imageData, 0);
+  vtkNew<vtkStreamingVolumeFrame> frame;
+  if (!codec->EncodeImageData(imageData, frame, true))
+  {
+    std::cerr << "Could not encode frame" << std::endl;
+    return false;
+  }
+
+  // Header offsets: [2] scalar type, [4..7] number of components, [8..19] dimensions
+  const int numberOfCorruptions = 5;
+  int corruptedOffsets[numberOfCorruptions] = { 2, 4, 8, 8, 16 };
+  unsigned char corruptedValues[numberOfCorruptions][4] = {
+    { 255, 0, 0, 0 }, // invalid scalar type
+    { 0, 0, 0, 0 }, // no components
+    { 0, 0, 0, 0 }, // zero width
+    { 255, 255, 255, 255 }, // negative width
+    { 255, 255, 255, 127 }, // image much larger than the payload can contain
+  };
+  for (int i = 0; i < numberOfCorruptions; ++i)
+  {
+    vtkNew<vtkUnsignedCharArray> corruptedFrameData;
+    corruptedFrameData->DeepCopy(frame->GetFrameData());
+    int numberOfCorruptedBytes = corruptedOffsets[i] == 2 ? 1 : 4;
+    for (int j = 0; j < numberOfCorruptedBytes; ++j)
+    {
+      corruptedFrameData->SetValue(corruptedOffsets[i] + j, corruptedValues[i][j]);
+    }
+    vtkNew<vtkStreamingVolumeFrame> corruptedFrame;
+    corruptedFrame->SetFrameData(corruptedFrameData);
+    corruptedFrame->SetFrameType(frame->GetFrameType());
+    corruptedFrame->SetCodecFourCC(frame->GetCodecFourCC());
+    corruptedFrame->SetDimensions(frame->GetDimensions());
+    corruptedFrame->SetNumberOfComponents(frame->GetNumberOfComponents());
+
+    vtkNew<vtkSlicerIGSIOLosslessVolumeCodec> decoder;
+    vtkNew<vtkImageData> decodedImage;
+    if (decoder->DecodeFrame(corruptedFrame, decodedImage))
+    {
+      std::cerr << "Frame with corrupted header " << i << " was decoded" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkLosslessVolumeCodecTest(int argc, char* argv[])
+{
+  if (!CheckLosslessRoundTrip<unsigned char>(VTK_UNSIGNED_CHAR, 3)
+    || !CheckLosslessRoundTrip<unsigned char>(VTK_UNSIGNED_CHAR, 1)
+    || !CheckLosslessRoundTrip<unsigned short>(VTK_UNSIGNED_SHORT, 1)
+    || !CheckLosslessInvalidFrames())
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Single-component sequences are re-encoded without converting them to luma-only frames
+  vtkStreamingVolumeCodecFactory::GetInstance()->RegisterStreamingCodec(vtkSmartPointer<vtkSlicerIGSIOLosslessVolumeCodec>::New());
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode);
+  int numFrames = 10;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(32, 32, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    SetLosslessTestingImageDataForFrame<unsigned char>(imageData, i);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  std::string codecFourCC = vtkSlicerIGSIOLosslessVolumeCodec::GetCodecFourCC();
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC))
+  {
+    std::cerr << "Could not encode sequence using " << codecFourCC << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    vtkStreamingVolumeFrame* frame = streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL;
+    if (!frame || frame->GetNumberOfComponents() != 1 || vtkSlicerIGSIOCommon::IsLumaOnlyFrame(frame))
+    {
+      std::cerr << "Frame " << i << " was not encoded as a single-component frame" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkImageData* decodedImage = streamingVolumeNode->GetImageData();
+    if (!decodedImage || decodedImage->GetNumberOfScalarComponents() != 1)
+    {
+      std::cerr << "Frame " << i << " could not be decoded to a single-component image" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
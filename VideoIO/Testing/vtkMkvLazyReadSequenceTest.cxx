@@ -0,0 +1,237 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// Sequences includes
+#include <vtkMRMLSequenceBrowserNode.h>
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOMkvFrameIndex.h>
+#include <vtkSlicerIGSIOMkvStreamingVolumeFrame.h>
+
+// VideoIO MRML includes
+#include <vtkMRMLStreamingVolumeSequenceStorageNode.h>
+
+// VideoIO includes
+#include <vtkSlicerVideoIOLogic.h>
+
+//---------------------------------------------------------------------------
+void SetLazyReadTestingImageDataForValue(vtkImageData* image, unsigned char value)
+{
+  int dimensions[3] = { 0,0,0 };
+  image->GetDimensions(dimensions);
+
+  unsigned char* imageDataScalars = (unsigned char*)image->GetScalarPointer();
+  for (int y = 0; y < dimensions[1]; ++y)
+  {
+    for (int x = 0; x < dimensions[0]; ++x)
+    {
+      imageDataScalars[0] = value;
+      imageDataScalars[1] = 255 * (x / (double)dimensions[0]);
+      imageDataScalars[2] = 255 * (y / (double)dimensions[1]);
+      imageDataScalars += 3;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkMkvLazyReadSequenceTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 25;
+  std::string fileName = "vtkMkvLazyReadSequenceTest.mkv";
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  sequenceNode->SetIndexName("time");
+  scene->AddNode(sequenceNode);
+
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    SetLazyReadTestingImageDataForValue(imageData, (unsigned char)(255 * (i / (double)numFrames)));
+    images.push_back(imageData);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i * 0.1;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  std::string codecFourCC = "RV24";
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC))
+  {
+    std::cerr << "Could not encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+  if (!vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(sequenceNode.GetPointer(), trackedFrameList.GetPointer())
+    || !vtkMRMLStreamingVolumeSequenceStorageNode::WriteVideo(fileName, trackedFrameList.GetPointer()))
+  {
+    std::cerr << "Could not write video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkSlicerIGSIOMkvFrameIndex> frameIndex;
+  if (!frameIndex->ReadFile(fileName))
+  {
+    std::cerr << "Could not index video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int trackNumber = frameIndex->GetFirstVideoTrackNumber();
+  if (frameIndex->GetNumberOfFrames(trackNumber) != numFrames)
+  {
+    std::cerr << "Unexpected number of indexed frames: " << frameIndex->GetNumberOfFrames(trackNumber) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkMRMLSequenceNode> lazySequenceNode;
+  scene->AddNode(lazySequenceNode);
+  if (!vtkSlicerIGSIOCommon::MkvFrameIndexToVolumeSequence(frameIndex.GetPointer(), lazySequenceNode.GetPointer(), trackNumber)
+    || lazySequenceNode->GetNumberOfDataNodes() != numFrames)
+  {
+    std::cerr << "Could not create sequence from frame index" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < lazySequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* lazyStreamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(lazySequenceNode->GetNthDataNode(i));
+    vtkSlicerIGSIOMkvStreamingVolumeFrame* lazyFrame = lazyStreamingVolumeNode ?
+      vtkSlicerIGSIOMkvStreamingVolumeFrame::SafeDownCast(lazyStreamingVolumeNode->GetFrame()) : NULL;
+    if (!lazyFrame)
+    {
+      std::cerr << "Frame " << i << " is not a lazily loaded frame" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Payloads must only be read when the frame is decoded
+    if (lazyFrame->IsFrameDataLoaded())
+    {
+      std::cerr << "Frame " << i << " was loaded before it was decoded" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> outputStreamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    outputStreamingVolumeNode->SetAndObserveFrame(lazyFrame);
+
+    vtkImageData* inputImage = images[i];
+    vtkImageData* outputImage = outputStreamingVolumeNode->GetImageData();
+    if (!inputImage || !outputImage || !lazyFrame->IsFrameDataLoaded())
+    {
+      std::cerr << "Frame " << i << " could not be decoded" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    unsigned char* inputImagePointer = (unsigned char*)inputImage->GetScalarPointer();
+    unsigned char* outputImagePointer = (unsigned char*)outputImage->GetScalarPointer();
+    for (int j = 0; j < width * height * 3; ++j)
+    {
+      if (inputImagePointer[j] != outputImagePointer[j])
+      {
+        std::cerr << "Frame " << i << " does not match the input image" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Payloads are not released while frames are decoded
+  std::vector<vtkSlicerIGSIOMkvStreamingVolumeFrame*> lazyFrames;
+  for (int i = 0; i < lazySequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    lazyFrames.push_back(vtkSlicerIGSIOMkvStreamingVolumeFrame::SafeDownCast(
+      vtkMRMLStreamingVolumeNode::SafeDownCast(lazySequenceNode->GetNthDataNode(i))->GetFrame()));
+  }
+  {
+    vtkSlicerIGSIOMkvStreamingVolumeFrame::ScopedFrameDataAccess frameDataAccess;
+    if (vtkSlicerIGSIOMkvStreamingVolumeFrame::ReleaseFrameData(lazyFrames) || !lazyFrames[0]->IsFrameDataLoaded())
+    {
+      std::cerr << "Payloads were released while frames were decoded" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!vtkSlicerIGSIOMkvStreamingVolumeFrame::ReleaseFrameData(lazyFrames))
+  {
+    std::cerr << "Could not release payloads" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < numFrames; ++i)
+  {
+    if (lazyFrames[i]->IsFrameDataLoaded())
+    {
+      std::cerr << "Payload of frame " << i << " was not released" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The logic releases the payloads of the frames that leave the decode window of the browser
+  vtkNew<vtkSlicerVideoIOLogic> logic;
+  logic->SetMRMLScene(scene);
+  vtkNew<vtkMRMLSequenceBrowserNode> sequenceBrowserNode;
+  scene->AddNode(sequenceBrowserNode);
+  sequenceBrowserNode->SetAndObserveMasterSequenceNodeID(lazySequenceNode->GetID());
+  sequenceBrowserNode->SetSelectedItemNumber(0);
+  if (!lazyFrames[0]->GetFrameData() || !lazyFrames[0]->IsFrameDataLoaded())
+  {
+    std::cerr << "Could not load the payload of the selected frame" << std::endl;
+    return EXIT_FAILURE;
+  }
+  sequenceBrowserNode->SetSelectedItemNumber(1);
+  if (!lazyFrames[1]->GetFrameData() || !lazyFrames[1]->IsFrameDataLoaded())
+  {
+    std::cerr << "Could not load the payload of the selected frame" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (lazyFrames[0]->IsFrameDataLoaded())
+  {
+    std::cerr << "Payload of the previously selected frame was not released" << std::endl;
+    return EXIT_FAILURE;
+  }
+  logic->SetMRMLScene(NULL);
+
+  lazySequenceNode->RemoveAllDataNodes();
+  vtksys::SystemTools::RemoveFile(fileName);
+
+  return EXIT_SUCCESS;
+}
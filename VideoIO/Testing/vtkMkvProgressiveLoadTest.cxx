@@ -0,0 +1,178 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// Sequences includes
+#include <vtkMRMLSequenceBrowserNode.h>
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOMkvProgressiveLoader.h>
+
+// VideoIO MRML includes
+#include <vtkMRMLStreamingVolumeSequenceStorageNode.h>
+
+//----------------------------------------------------------------------------
+int vtkMkvProgressiveLoadTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 60;
+  std::string fileName = "vtkMkvProgressiveLoadTest.mkv";
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  sequenceNode->SetIndexName("time");
+  scene->AddNode(sequenceNode);
+
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    unsigned char* imageDataScalars = (unsigned char*)imageData->GetScalarPointer();
+    for (int j = 0; j < width * height * 3; ++j)
+    {
+      imageDataScalars[j] = (unsigned char)(i * 3 + j);
+    }
+    images.push_back(imageData);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i * 0.1;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  std::string codecFourCC = "RV24";
+  vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC)
+    || !vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(sequenceNode.GetPointer(), trackedFrameList.GetPointer())
+    || !vtkMRMLStreamingVolumeSequenceStorageNode::WriteVideo(fileName, trackedFrameList.GetPointer()))
+  {
+    std::cerr << "Could not write video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkMRMLSequenceBrowserNode> sequenceBrowserNode;
+  scene->AddNode(sequenceBrowserNode);
+
+  // Small batches, so that the sequence is populated by several updates
+  vtkNew<vtkSlicerIGSIOMkvProgressiveLoader> loader;
+  loader->SetFileName(fileName);
+  loader->SetSequenceBrowserNode(sequenceBrowserNode);
+  loader->SetNumberOfClustersPerScan(1);
+  loader->SetMaximumNumberOfFramesPerUpdate(7);
+  if (!loader->Start())
+  {
+    std::cerr << "Could not start loading video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkMRMLSequenceNode* loadedSequenceNode = loader->GetVideoSequenceNode();
+  if (!loadedSequenceNode || loadedSequenceNode->GetNumberOfDataNodes() < 1 || loadedSequenceNode->GetNumberOfDataNodes() > numFrames)
+  {
+    std::cerr << "First frame was not loaded" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Frames available after start: " << loadedSequenceNode->GetNumberOfDataNodes() << std::endl;
+
+  int previousNumberOfDataNodes = loadedSequenceNode->GetNumberOfDataNodes();
+  while (loader->Update() == vtkSlicerIGSIOMkvProgressiveLoader::StatusRunning)
+  {
+    int numberOfDataNodes = loadedSequenceNode->GetNumberOfDataNodes();
+    if (numberOfDataNodes < previousNumberOfDataNodes || numberOfDataNodes - previousNumberOfDataNodes > 7)
+    {
+      std::cerr << "Unexpected number of frames added by update: " << numberOfDataNodes - previousNumberOfDataNodes << std::endl;
+      return EXIT_FAILURE;
+    }
+    previousNumberOfDataNodes = numberOfDataNodes;
+  }
+  if (loader->GetStatus() != vtkSlicerIGSIOMkvProgressiveLoader::StatusCompleted
+    || loadedSequenceNode->GetNumberOfDataNodes() != numFrames || loader->GetNumberOfLoadedFrames() != numFrames)
+  {
+    std::cerr << "Loading did not complete: " << vtkSlicerIGSIOMkvProgressiveLoader::GetStatusAsString(loader->GetStatus())
+      << ", " << loadedSequenceNode->GetNumberOfDataNodes() << " frames" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < numFrames; ++i)
+  {
+    // Frames must be added in order, with the timestamps of the file
+    double loadedTimestamp = atof(loadedSequenceNode->GetNthIndexValue(i).c_str());
+    double timestamp = atof(sequenceNode->GetNthIndexValue(i).c_str());
+    if (fabs(loadedTimestamp - timestamp) > 1e-3)
+    {
+      std::cerr << "Frame " << i << " has index value " << loadedSequenceNode->GetNthIndexValue(i)
+        << " instead of " << sequenceNode->GetNthIndexValue(i) << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkMRMLStreamingVolumeNode* loadedStreamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(loadedSequenceNode->GetNthDataNode(i));
+    if (!loadedStreamingVolumeNode || !loadedStreamingVolumeNode->GetFrame())
+    {
+      std::cerr << "Frame " << i << " was not loaded" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> outputStreamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    outputStreamingVolumeNode->SetAndObserveFrame(loadedStreamingVolumeNode->GetFrame());
+    vtkImageData* outputImage = outputStreamingVolumeNode->GetImageData();
+    if (!outputImage)
+    {
+      std::cerr << "Frame " << i << " could not be decoded" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    unsigned char* inputImagePointer = (unsigned char*)images[i]->GetScalarPointer();
+    unsigned char* outputImagePointer = (unsigned char*)outputImage->GetScalarPointer();
+    for (int j = 0; j < width * height * 3; ++j)
+    {
+      if (inputImagePointer[j] != outputImagePointer[j])
+      {
+        std::cerr << "Frame " << i << " does not match the input image" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  loadedSequenceNode->RemoveAllDataNodes();
+  vtksys::SystemTools::RemoveFile(fileName);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+
+// VideoIO MRML includes
+#include <vtkMRMLStreamingVolumeSequenceStorageNode.h>
+
+//----------------------------------------------------------------------------
+int vtkModifiedFrameTrackingTest(int argc, char* argv[])
+{
+  int numFrames = 50;
+  std::string codecFourCC = "RV24";
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode);
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(8, 8, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, i);
+
+    vtkNew<vtkMRMLStreamingVolumeNode> streamingVolumeNode;
+    streamingVolumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+    std::stringstream indexValue;
+    indexValue << i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode.GetPointer(), indexValue.str());
+  }
+
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC))
+  {
+    std::cerr << "Could not encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkMRMLStreamingVolumeSequenceStorageNode> storageNode;
+  storageNode->SetCodecFourCC(codecFourCC);
+  std::vector<std::pair<int, int> > modifiedFrameRanges;
+
+  // Frames are not known to be unmodified until the sequence has been read or written
+  if (storageNode->GetModifiedFrameRanges(sequenceNode.GetPointer(), modifiedFrameRanges)
+    || storageNode->GetNumberOfModifiedFrames(sequenceNode.GetPointer()) != numFrames)
+  {
+    std::cerr << "All frames should be modified before the first save" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  storageNode->ResetModifiedFrames(sequenceNode.GetPointer());
+  if (storageNode->GetNumberOfModifiedFrames(sequenceNode.GetPointer()) != 0)
+  {
+    std::cerr << "No frames should be modified after reset" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Replace the frame of item 10 with an uncompressed image, and modify the frames of items 11 and 40
+  vtkMRMLStreamingVolumeNode* replacedVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(10));
+  vtkNew<vtkImageData> replacementImageData;
+  replacementImageData->SetDimensions(8, 8, 1);
+  replacementImageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+  replacedVolumeNode->SetAndObserveFrame(NULL);
+  replacedVolumeNode->SetAndObserveImageData(replacementImageData.GetPointer());
+  vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(11))->GetFrame()->Modified();
+  vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(40))->GetFrame()->Modified();
+
+  if (!storageNode->GetModifiedFrameRanges(sequenceNode.GetPointer(), modifiedFrameRanges)
+    || modifiedFrameRanges.size() != 2
+    || modifiedFrameRanges[0] != std::make_pair(10, 11)
+    || modifiedFrameRanges[1] != std::make_pair(40, 40))
+  {
+    std::cerr << "Unexpected modified frame ranges" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Changing the codec requires all of the frames to be re-encoded
+  storageNode->SetCodecFourCC("VP90");
+  if (storageNode->GetModifiedFrameRanges(sequenceNode.GetPointer(), modifiedFrameRanges)
+    || storageNode->GetNumberOfModifiedFrames(sequenceNode.GetPointer()) != numFrames)
+  {
+    std::cerr << "All frames should be modified after the codec is changed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // A failed save is reported, and the frames stay modified
+  storageNode->SetCodecFourCC(codecFourCC);
+  storageNode->SetFileName("vtkModifiedFrameTrackingTestMissingDirectory/vtkModifiedFrameTrackingTest.mkv");
+  if (storageNode->WriteData(sequenceNode.GetPointer())
+    || storageNode->GetNumberOfModifiedFrames(sequenceNode.GetPointer()) == 0)
+  {
+    std::cerr << "Writing to a missing directory should fail" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
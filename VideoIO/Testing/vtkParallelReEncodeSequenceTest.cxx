@@ -0,0 +1,200 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeCodecFactory.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+
+//---------------------------------------------------------------------------
+void SetParallelTestingImageDataForValue(vtkImageData* image, unsigned char value)
+{
+  int dimensions[3] = { 0,0,0 };
+  image->GetDimensions(dimensions);
+
+  unsigned char* imageDataScalars = (unsigned char*)image->GetScalarPointer();
+  for (int y = 0; y < dimensions[1]; ++y)
+  {
+    for (int x = 0; x < dimensions[0]; ++x)
+    {
+      imageDataScalars[0] = 255 * (x / (double)dimensions[0]);
+      imageDataScalars[1] = 255 * (y / (double)dimensions[1]);
+      imageDataScalars[2] = value;
+      imageDataScalars += 3;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkParallelReEncodeSequenceTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 97;
+  int numberOfThreads = 4;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode);
+
+  std::vector<vtkSmartPointer<vtkImageData> > images;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    SetParallelTestingImageDataForValue(imageData, (unsigned char)(255 * (i / (double)numFrames)));
+    images.push_back(imageData);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  // Encode the uncompressed frames, and then force re-encoding of the already encoded frames, using multiple threads
+  std::string codecFourCC = "RV24";
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC, numberOfThreads))
+  {
+    std::cerr << "Could not encode sequence using " << numberOfThreads << " threads" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSlicerIGSIOCommon::TranscodingStatistics statistics;
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC,
+    std::map<std::string, std::string>(), true, false, numberOfThreads, &statistics))
+  {
+    std::cerr << "Could not force re-encoding of sequence using " << numberOfThreads << " threads" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // All of the frames pass through the decode -> encode pipeline
+  if (statistics.NumberOfDecodedFrames != numFrames || statistics.NumberOfEncodedFrames != numFrames)
+  {
+    std::cerr << "Unexpected transcoding statistics: " << statistics.NumberOfDecodedFrames << " decoded, "
+      << statistics.NumberOfEncodedFrames << " encoded" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Decode time: " << statistics.DecodeTime << " s, stalled: " << statistics.DecodeStallTime << " s" << std::endl;
+  std::cout << "Encode time: " << statistics.EncodeTime << " s, stalled: " << statistics.EncodeStallTime << " s" << std::endl;
+  std::cout << "Decoded queue depth: " << statistics.DecodedQueueAverageDepth << " (max " << statistics.DecodedQueueMaximumDepth << ")" << std::endl;
+
+  if (sequenceNode->GetNumberOfDataNodes() != numFrames)
+  {
+    std::cerr << "Unexpected number of data nodes: " << sequenceNode->GetNumberOfDataNodes() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Frames must be spliced back in their original order
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* inputStreamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    if (!inputStreamingVolumeNode || !inputStreamingVolumeNode->GetFrame())
+    {
+      std::cerr << "Frame " << i << " was not encoded" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> outputStreamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    outputStreamingVolumeNode->SetAndObserveFrame(inputStreamingVolumeNode->GetFrame());
+
+    vtkImageData* inputImage = images[i];
+    vtkImageData* outputImage = outputStreamingVolumeNode->GetImageData();
+    if (!inputImage || !outputImage)
+    {
+      return EXIT_FAILURE;
+    }
+
+    unsigned char* inputImagePointer = (unsigned char*)inputImage->GetScalarPointer();
+    unsigned char* outputImagePointer = (unsigned char*)outputImage->GetScalarPointer();
+    for (int j = 0; j < width * height * 3; ++j)
+    {
+      if (inputImagePointer[j] != outputImagePointer[j])
+      {
+        std::cerr << "Frame " << i << " does not match the input image" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Consecutive items that share a frame are decoded into different frame buffers
+  int numRepeats = 3;
+  vtkNew<vtkMRMLSequenceNode> repeatedSequenceNode;
+  scene->AddNode(repeatedSequenceNode);
+  for (int i = 0; i < numFrames * numRepeats; ++i)
+  {
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveFrame(
+      vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i / numRepeats))->GetFrame());
+
+    std::stringstream indexValue;
+    indexValue << i;
+    repeatedSequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(repeatedSequenceNode.GetPointer(), 0, -1, codecFourCC,
+    std::map<std::string, std::string>(), true, false, 1))
+  {
+    std::cerr << "Could not force re-encoding of sequence with repeated frames" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < repeatedSequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* inputStreamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(repeatedSequenceNode->GetNthDataNode(i));
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> outputStreamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    outputStreamingVolumeNode->SetAndObserveFrame(inputStreamingVolumeNode->GetFrame());
+
+    vtkImageData* inputImage = images[i / numRepeats];
+    vtkImageData* outputImage = outputStreamingVolumeNode->GetImageData();
+    if (!outputImage)
+    {
+      std::cerr << "Repeated frame " << i << " was not encoded" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    unsigned char* inputImagePointer = (unsigned char*)inputImage->GetScalarPointer();
+    unsigned char* outputImagePointer = (unsigned char*)outputImage->GetScalarPointer();
+    for (int j = 0; j < width * height * 3; ++j)
+    {
+      if (inputImagePointer[j] != outputImagePointer[j])
+      {
+        std::cerr << "Repeated frame " << i << " does not match the input image" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <cstring>
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOReEncodeJob.h>
+
+//----------------------------------------------------------------------------
+std::vector<vtkStreamingVolumeFrame*> GetReEncodeJobTestFrames(vtkMRMLSequenceNode* sequenceNode)
+{
+  std::vector<vtkStreamingVolumeFrame*> frames;
+  for (int i = 0; i < sequenceNode->GetNumberOfDataNodes(); ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    frames.push_back(streamingVolumeNode ? streamingVolumeNode->GetFrame() : NULL);
+  }
+  return frames;
+}
+
+//----------------------------------------------------------------------------
+int vtkReEncodeJobTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 40;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode);
+
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    unsigned char* imageDataScalars = (unsigned char*)imageData->GetScalarPointer();
+    for (int j = 0; j < width * height * 3; ++j)
+    {
+      imageDataScalars[j] = (unsigned char)(i + j);
+    }
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  std::string codecFourCC = "RV24";
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC))
+  {
+    std::cerr << "Could not encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<vtkStreamingVolumeFrame*> originalFrames = GetReEncodeJobTestFrames(sequenceNode);
+
+  // The sequence must not be modified until the job is updated on the main thread
+  vtkNew<vtkSlicerIGSIOReEncodeJob> job;
+  job->SetSequenceNode(sequenceNode);
+  job->SetCodecFourCC(codecFourCC);
+  job->ForceReEncodingOn();
+  job->SetNumberOfThreads(2);
+  if (!job->Start() || job->GetNumberOfFrames() != numFrames)
+  {
+    std::cerr << "Could not start re-encoding" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (GetReEncodeJobTestFrames(sequenceNode) != originalFrames)
+  {
+    std::cerr << "Sequence was modified before the job was completed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (job->Wait() != vtkSlicerIGSIOReEncodeJob::StatusCompleted)
+  {
+    std::cerr << "Re-encoding did not complete: " << vtkSlicerIGSIOReEncodeJob::GetStatusAsString(job->GetStatus()) << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (job->GetNumberOfProcessedFrames() != numFrames || job->GetProgress() != 1.0)
+  {
+    std::cerr << "Unexpected number of processed frames: " << job->GetNumberOfProcessedFrames() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Re-encoded " << numFrames << " frames at " << job->GetFramesPerSecond() << " frames/s" << std::endl;
+
+  std::vector<vtkStreamingVolumeFrame*> reEncodedFrames = GetReEncodeJobTestFrames(sequenceNode);
+  for (int i = 0; i < numFrames; ++i)
+  {
+    if (!reEncodedFrames[i] || reEncodedFrames[i] == originalFrames[i])
+    {
+      std::cerr << "Frame " << i << " was not replaced" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!reEncodedFrames[0]->IsKeyFrame())
+  {
+    std::cerr << "First re-encoded frame is not a keyframe" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Cancelled jobs leave the sequence unchanged
+  if (!job->Start())
+  {
+    std::cerr << "Could not restart re-encoding" << std::endl;
+    return EXIT_FAILURE;
+  }
+  job->Cancel();
+  if (job->Wait() != vtkSlicerIGSIOReEncodeJob::StatusCancelled || GetReEncodeJobTestFrames(sequenceNode) != reEncodedFrames)
+  {
+    std::cerr << "Cancelled re-encoding modified the sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // If an item is changed while the job is running, none of the encoded frames are set
+  if (!job->Start())
+  {
+    std::cerr << "Could not restart re-encoding" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkMRMLStreamingVolumeNode* changedNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(numFrames / 2));
+  changedNode->SetAndObserveFrame(reEncodedFrames[0]);
+  reEncodedFrames[numFrames / 2] = reEncodedFrames[0];
+  if (job->Wait() != vtkSlicerIGSIOReEncodeJob::StatusFailed || GetReEncodeJobTestFrames(sequenceNode) != reEncodedFrames)
+  {
+    std::cerr << "Re-encoding overwrote a modified sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Uncompressed images are copied when the job is started, and editing one of them while the job is running
+  // prevents the encoded frames from being set
+  vtkNew<vtkMRMLSequenceNode> uncompressedSequenceNode;
+  scene->AddNode(uncompressedSequenceNode);
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    memset(imageData->GetScalarPointer(), i, width * height * 3);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i;
+    uncompressedSequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+  vtkNew<vtkSlicerIGSIOReEncodeJob> uncompressedJob;
+  uncompressedJob->SetSequenceNode(uncompressedSequenceNode);
+  uncompressedJob->SetCodecFourCC(codecFourCC);
+  if (!uncompressedJob->Start())
+  {
+    std::cerr << "Could not start re-encoding of uncompressed images" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkMRMLStreamingVolumeNode* editedNode = vtkMRMLStreamingVolumeNode::SafeDownCast(uncompressedSequenceNode->GetNthDataNode(numFrames / 2));
+  vtkImageData* editedImage = editedNode->GetImageData();
+  memset(editedImage->GetScalarPointer(), 255, width * height * 3);
+  editedImage->Modified();
+  if (uncompressedJob->Wait() != vtkSlicerIGSIOReEncodeJob::StatusFailed
+    || GetReEncodeJobTestFrames(uncompressedSequenceNode) != std::vector<vtkStreamingVolumeFrame*>(numFrames, (vtkStreamingVolumeFrame*)NULL)
+    || editedNode->GetImageData() != editedImage)
+  {
+    std::cerr << "Re-encoding overwrote an edited image" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOSequenceSeeker.h>
+
+//----------------------------------------------------------------------------
+bool CheckSeek(vtkSlicerIGSIOSequenceSeeker* seeker, int itemNumber, int expectedNumberOfDecodedFrames)
+{
+  if (!seeker->Seek(itemNumber))
+  {
+    std::cerr << "Could not seek to item " << itemNumber << std::endl;
+    return false;
+  }
+
+  if (seeker->GetLastSeekNumberOfDecodedFrames() != expectedNumberOfDecodedFrames)
+  {
+    std::cerr << "Seek to item " << itemNumber << " decoded " << seeker->GetLastSeekNumberOfDecodedFrames()
+              << " frames, expected " << expectedNumberOfDecodedFrames << std::endl;
+    return false;
+  }
+
+  unsigned char* imagePointer = (unsigned char*)seeker->GetImageData()->GetScalarPointer();
+  if (!imagePointer || imagePointer[0] != itemNumber)
+  {
+    std::cerr << "Decoded image does not match item " << itemNumber << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkSequenceSeekerTest(int argc, char* argv[])
+{
+  int width = 8;
+  int height = 6;
+  int numFrames = 30;
+  int groupOfPicturesSize = 10;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode);
+
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    memset(imageData->GetScalarPointer(), i, width * height * 3);
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, "RV24"))
+  {
+    std::cerr << "Could not encode sequence" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Link the uncompressed frames into groups of pictures, so that every frame depends on the previous one
+  vtkStreamingVolumeFrame* previousFrame = NULL;
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkMRMLStreamingVolumeNode* streamingVolumeNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(i));
+    vtkStreamingVolumeFrame* frame = streamingVolumeNode->GetFrame();
+    if (i % groupOfPicturesSize == 0)
+    {
+      frame->SetFrameType(vtkStreamingVolumeFrame::IFrame);
+    }
+    else
+    {
+      frame->SetFrameType(vtkStreamingVolumeFrame::PFrame);
+      frame->SetPreviousFrame(previousFrame);
+    }
+    previousFrame = frame;
+  }
+
+  vtkNew<vtkSlicerIGSIOSequenceSeeker> seeker;
+  seeker->SetSequenceNode(sequenceNode.GetPointer());
+  seeker->UpdateKeyFrameIndex();
+  if (seeker->GetNumberOfKeyFrames() != numFrames / groupOfPicturesSize)
+  {
+    std::cerr << "Unexpected number of keyframes: " << seeker->GetNumberOfKeyFrames() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (seeker->GetNearestKeyFrameItemNumber(15) != 10)
+  {
+    std::cerr << "Unexpected nearest keyframe: " << seeker->GetNearestKeyFrameItemNumber(15) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Decode from the keyframe
+  if (!CheckSeek(seeker, 5, 6))
+  {
+    return EXIT_FAILURE;
+  }
+  // Continue from the last decoded frame
+  if (!CheckSeek(seeker, 7, 2))
+  {
+    return EXIT_FAILURE;
+  }
+  // Seeking backwards requires decoding from the keyframe
+  if (!CheckSeek(seeker, 3, 4))
+  {
+    return EXIT_FAILURE;
+  }
+  // Seeking to a different group of pictures starts from its keyframe
+  if (!CheckSeek(seeker, 12, 3))
+  {
+    return EXIT_FAILURE;
+  }
+  // Same frame does not need to be decoded again
+  if (!CheckSeek(seeker, 12, 0))
+  {
+    return EXIT_FAILURE;
+  }
+  if (!CheckSeek(seeker, 20, 1))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (seeker->GetTotalNumberOfDecodedFrames() != 16)
+  {
+    std::cerr << "Unexpected total number of decoded frames: " << seeker->GetTotalNumberOfDecodedFrames() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkMRMLStreamingVolumeNode* keyFrameNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(0));
+  vtkMRMLStreamingVolumeNode* middleNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(13));
+  if (seeker->GetItemNumberOfFrame(middleNode->GetFrame()) != 13)
+  {
+    std::cerr << "Unexpected item number of frame: " << seeker->GetItemNumberOfFrame(middleNode->GetFrame()) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The frame of an item can be replaced without modifying the sequence, which must be detected when the item is accessed
+  vtkMRMLStreamingVolumeNode* replacedNode = vtkMRMLStreamingVolumeNode::SafeDownCast(sequenceNode->GetNthDataNode(27));
+  replacedNode->SetAndObserveFrame(keyFrameNode->GetFrame());
+  if (!seeker->Seek(27))
+  {
+    std::cerr << "Could not seek to replaced item" << std::endl;
+    return EXIT_FAILURE;
+  }
+  unsigned char* imagePointer = (unsigned char*)seeker->GetImageData()->GetScalarPointer();
+  if (seeker->GetLastSeekNumberOfDecodedFrames() != 1 || !imagePointer || imagePointer[0] != 0)
+  {
+    std::cerr << "Replaced frame was not decoded: decoded " << seeker->GetLastSeekNumberOfDecodedFrames() << " frames" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (seeker->GetNearestKeyFrameItemNumber(28) != 27)
+  {
+    std::cerr << "Keyframe table was not updated: " << seeker->GetNearestKeyFrameItemNumber(28) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkVariant.h>
+
+// vtkAddon includes
+#include <vtkStreamingVolumeFrame.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceBrowserNode.h>
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+
+//----------------------------------------------------------------------------
+// Fill the tracked frame list with small uncompressed frames and a probe transform.
+// The frames are added in reverse chronological order, so the import must sort them.
+void CreateImportTestingTrackedFrameList(vtkIGSIOTrackedFrameList* trackedFrameList, int numFrames)
+{
+  vtkNew<vtkMatrix4x4> probeToTrackerTransform;
+  igsioTransformName probeToTrackerName("Probe", "Tracker");
+
+  for (int i = numFrames - 1; i >= 0; --i)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(4, 4, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+    igsioTrackedFrame trackedFrame;
+    trackedFrame.GetImageData()->DeepCopyFrom(imageData.GetPointer());
+    trackedFrame.SetTimestamp(i * 0.01);
+    probeToTrackerTransform->SetElement(0, 3, i);
+    trackedFrame.SetFrameTransform(probeToTrackerName, probeToTrackerTransform.GetPointer());
+    trackedFrameList->AddTrackedFrame(&trackedFrame);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Encoded tracked frames that are not in chronological order, as with reordered (bidirectionally predicted) frames.
+// Uncompressed frames can be decoded independently, so prediction is simulated by marking frames as predicted frames.
+void CreateEncodedImportTestingTrackedFrameList(vtkIGSIOTrackedFrameList* trackedFrameList)
+{
+  const int numFrames = 3;
+  double timestamps[numFrames] = { 0.0, 0.02, 0.01 };
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkNew<vtkUnsignedCharArray> frameData;
+    frameData->SetNumberOfValues(4 * 4 * 3);
+    frameData->FillComponent(0, i);
+
+    vtkNew<vtkStreamingVolumeFrame> frame;
+    frame->SetFrameData(frameData);
+    frame->SetDimensions(4, 4, 1);
+    frame->SetNumberOfComponents(3);
+    frame->SetCodecFourCC("RV24");
+    frame->SetFrameType(i == 0 ? vtkStreamingVolumeFrame::IFrame : vtkStreamingVolumeFrame::PFrame);
+
+    igsioTrackedFrame trackedFrame;
+    trackedFrame.GetImageData()->SetEncodedFrame(frame);
+    trackedFrame.SetTimestamp(timestamps[i]);
+    trackedFrameList->AddTrackedFrame(&trackedFrame);
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTrackedFrameListImportTest(int argc, char* argv[])
+{
+  const int numFrames = 100;
+
+  // Uncompressed frames are imported in chronological order, without reordering the tracked frame list
+  {
+    vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+    CreateImportTestingTrackedFrameList(trackedFrameList.GetPointer(), numFrames);
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkMRMLSequenceNode> videoSequenceNode;
+    scene->AddNode(videoSequenceNode);
+    if (!vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(trackedFrameList.GetPointer(), videoSequenceNode.GetPointer()))
+    {
+      std::cerr << "Could not import frames to a volume sequence" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (videoSequenceNode->GetNumberOfDataNodes() != numFrames || (int)trackedFrameList->GetNumberOfTrackedFrames() != numFrames)
+    {
+      std::cerr << "Unexpected number of frames after importing to a volume sequence" << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int i = 0; i < numFrames; ++i)
+    {
+      if (trackedFrameList->GetTrackedFrame(i)->GetTimestamp() != (numFrames - 1 - i) * 0.01)
+      {
+        std::cerr << "The tracked frame list was reordered by the import at item " << i << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // With transfer of ownership, the tracked frames are released after the import
+  {
+    vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+    CreateImportTestingTrackedFrameList(trackedFrameList.GetPointer(), numFrames);
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkMRMLSequenceBrowserNode> sequenceBrowserNode;
+    scene->AddNode(sequenceBrowserNode);
+    if (!vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(trackedFrameList.GetPointer(), sequenceBrowserNode.GetPointer(), true))
+    {
+      std::cerr << "Could not import frames to a sequence browser" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (trackedFrameList->GetNumberOfTrackedFrames() != 0)
+    {
+      std::cerr << "Tracked frames were not released after import" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkMRMLSequenceNode* videoSequenceNode = sequenceBrowserNode->GetMasterSequenceNode();
+    std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+    sequenceBrowserNode->GetSynchronizedSequenceNodes(sequenceNodes);
+    if (!videoSequenceNode || videoSequenceNode->GetNumberOfDataNodes() != numFrames
+      || sequenceNodes.size() != 1 || sequenceNodes[0]->GetNumberOfDataNodes() != numFrames)
+    {
+      std::cerr << "Unexpected video or transform sequence after import" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkNew<vtkMatrix4x4> probeToTrackerTransform;
+    for (int i = 0; i < numFrames; ++i)
+    {
+      if (i > 0 && vtkVariant(videoSequenceNode->GetNthIndexValue(i - 1)).ToDouble() >= vtkVariant(videoSequenceNode->GetNthIndexValue(i)).ToDouble())
+      {
+        std::cerr << "Frames are not in chronological order at item " << i << std::endl;
+        return EXIT_FAILURE;
+      }
+      // Each transform must be stored at the timestamp of its own tracked frame
+      vtkMRMLLinearTransformNode* transformNode = vtkMRMLLinearTransformNode::SafeDownCast(sequenceNodes[0]->GetNthDataNode(i));
+      if (!transformNode || sequenceNodes[0]->GetNthIndexValue(i) != videoSequenceNode->GetNthIndexValue(i))
+      {
+        std::cerr << "Missing transform at item " << i << std::endl;
+        return EXIT_FAILURE;
+      }
+      transformNode->GetMatrixTransformToParent(probeToTrackerTransform);
+      if (probeToTrackerTransform->GetElement(0, 3) != i)
+      {
+        std::cerr << "Unexpected transform at item " << i << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Encoded frames are imported in decoding order, so each frame still references the frame that precedes it in the list
+  {
+    vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+    CreateEncodedImportTestingTrackedFrameList(trackedFrameList.GetPointer());
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkMRMLSequenceNode> videoSequenceNode;
+    scene->AddNode(videoSequenceNode);
+    if (!vtkSlicerIGSIOCommon::TrackedFrameListToVolumeSequence(trackedFrameList.GetPointer(), videoSequenceNode.GetPointer()))
+    {
+      std::cerr << "Could not import encoded frames" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (videoSequenceNode->GetNumberOfDataNodes() != 3 || trackedFrameList->GetTrackedFrame(1)->GetTimestamp() != 0.02)
+    {
+      std::cerr << "The encoded tracked frame list was reordered by the import" << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int i = 1; i < 3; ++i)
+    {
+      vtkStreamingVolumeFrame* frame = trackedFrameList->GetTrackedFrame(i)->GetImageData()->GetEncodedFrame();
+      vtkStreamingVolumeFrame* expectedPreviousFrame = trackedFrameList->GetTrackedFrame(i - 1)->GetImageData()->GetEncodedFrame();
+      if (frame->GetPreviousFrame() != expectedPreviousFrame)
+      {
+        std::cerr << "Encoded frame " << i << " does not reference the preceding frame in decoding order" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <iostream>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// Sequences includes
+#include <vtkMRMLSequenceBrowserNode.h>
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOTransformTrack.h>
+
+//----------------------------------------------------------------------------
+int vtkTransformTrackTest(int argc, char* argv[])
+{
+  int numFrames = 10;
+
+  // Transforms that are added out of order must be sorted by timestamp
+  vtkNew<vtkSlicerIGSIOTransformTrack> transformTrack;
+  vtkNew<vtkMatrix4x4> matrix;
+  for (int i = numFrames - 1; i >= 0; --i)
+  {
+    matrix->SetElement(0, 3, i);
+    transformTrack->AddTransform(i * 0.1, matrix.GetPointer());
+  }
+  // Replaces the existing transform
+  matrix->SetElement(0, 3, 100);
+  transformTrack->AddTransform(0.5, matrix.GetPointer());
+
+  if (transformTrack->GetNumberOfTransforms() != numFrames)
+  {
+    std::cerr << "Unexpected number of transforms: " << transformTrack->GetNumberOfTransforms() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < numFrames; ++i)
+  {
+    transformTrack->GetNthTransform(i, matrix.GetPointer());
+    double expectedTranslation = (i == 5 ? 100 : i);
+    if (matrix->GetElement(0, 3) != expectedTranslation)
+    {
+      std::cerr << "Unexpected transform " << i << ": " << matrix->GetElement(0, 3) << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (transformTrack->GetClosestTransformIndex(-1.0) != 0
+    || transformTrack->GetClosestTransformIndex(0.22) != 2
+    || transformTrack->GetClosestTransformIndex(0.28) != 3
+    || transformTrack->GetClosestTransformIndex(100.0) != numFrames - 1)
+  {
+    std::cerr << "Closest transform lookup failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Import a tracked frame list with the transforms stored in transform tracks
+  vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+  igsioTransformName probeToTrackerName("Probe", "Tracker");
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(4, 4, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+    igsioTrackedFrame trackedFrame;
+    trackedFrame.GetImageData()->DeepCopyFrom(imageData.GetPointer());
+    trackedFrame.SetTimestamp(i * 0.1);
+    matrix->SetElement(0, 3, i);
+    trackedFrame.SetFrameTransform(probeToTrackerName, matrix.GetPointer());
+    trackedFrameList->AddTrackedFrame(&trackedFrame);
+  }
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceBrowserNode> sequenceBrowserNode;
+  scene->AddNode(sequenceBrowserNode);
+  vtkNew<vtkCollection> transformTracks;
+  if (!vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(trackedFrameList.GetPointer(), sequenceBrowserNode.GetPointer(),
+    false, transformTracks.GetPointer()))
+  {
+    std::cerr << "Could not import tracked frame list" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+  sequenceBrowserNode->GetSynchronizedSequenceNodes(sequenceNodes);
+  if (!sequenceNodes.empty())
+  {
+    std::cerr << "Transform sequences should not be created when importing into transform tracks" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSlicerIGSIOTransformTrack* importedTransformTrack = vtkSlicerIGSIOTransformTrack::SafeDownCast(transformTracks->GetItemAsObject(0));
+  if (transformTracks->GetNumberOfItems() != 1 || !importedTransformTrack
+    || importedTransformTrack->GetNumberOfTransforms() != numFrames)
+  {
+    std::cerr << "Unexpected transform tracks after import" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  importedTransformTrack->GetTransformAtTimestamp(0.3, matrix.GetPointer());
+  if (matrix->GetElement(0, 3) != 3)
+  {
+    std::cerr << "Unexpected imported transform: " << matrix->GetElement(0, 3) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
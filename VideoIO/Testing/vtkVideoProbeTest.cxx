@@ -0,0 +1,147 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This file was originally developed by Kyle Sunderland, PerkLab, Queen's University
+and was supported through CANARIE's Research Software Program, and Cancer
+Care Ontario.
+
+==============================================================================*/
+
+// std includes
+#include <cstdlib>
+#include <iostream>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// Sequences includes
+#include <vtkMRMLSequenceNode.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStreamingVolumeNode.h>
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOCommon.h>
+#include <vtkSlicerIGSIOVideoProbe.h>
+
+// VideoIO MRML includes
+#include <vtkMRMLStreamingVolumeSequenceStorageNode.h>
+
+//----------------------------------------------------------------------------
+int vtkVideoProbeTest(int argc, char* argv[])
+{
+  int width = 16;
+  int height = 12;
+  int numFrames = 40;
+  std::string fileName = "vtkVideoProbeTest.mkv";
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  sequenceNode->SetIndexName("time");
+  scene->AddNode(sequenceNode);
+
+  for (int i = 0; i < numFrames; ++i)
+  {
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions(width, height, 1);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    unsigned char* imageDataScalars = (unsigned char*)imageData->GetScalarPointer();
+    for (int j = 0; j < width * height * 3; ++j)
+    {
+      imageDataScalars[j] = (unsigned char)(i + j);
+    }
+
+    vtkSmartPointer<vtkMRMLStreamingVolumeNode> streamingVolumeNode = vtkSmartPointer<vtkMRMLStreamingVolumeNode>::New();
+    streamingVolumeNode->SetAndObserveImageData(imageData);
+
+    std::stringstream indexValue;
+    indexValue << i * 0.1;
+    sequenceNode->SetDataNodeAtValue(streamingVolumeNode, indexValue.str());
+  }
+
+  std::string codecFourCC = "RV24";
+  vtkNew<vtkIGSIOTrackedFrameList> trackedFrameList;
+  if (!vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode.GetPointer(), 0, -1, codecFourCC)
+    || !vtkSlicerIGSIOCommon::VolumeSequenceToTrackedFrameList(sequenceNode.GetPointer(), trackedFrameList.GetPointer())
+    || !vtkMRMLStreamingVolumeSequenceStorageNode::WriteVideo(fileName, trackedFrameList.GetPointer()))
+  {
+    std::cerr << "Could not write video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Default bounded scan, the number of frames is exact because the short video fits in a few clusters
+  vtkNew<vtkSlicerIGSIOVideoProbe> probe;
+  if (!probe->Probe(fileName) || probe->GetNumberOfFrames() < 1 || probe->GetNumberOfFrames() > numFrames + 1
+    || (probe->IsNumberOfFramesExact() && probe->GetNumberOfFrames() != numFrames))
+  {
+    std::cerr << "Unexpected number of frames from default scan: " << probe->GetNumberOfFrames() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Full scan of the block headers
+  probe->SetMaximumNumberOfScannedClusters(-1);
+  if (!probe->Probe(fileName))
+  {
+    std::cerr << "Could not probe video: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!probe->IsNumberOfFramesExact() || probe->GetNumberOfFrames() != numFrames)
+  {
+    std::cerr << "Unexpected number of frames: " << probe->GetNumberOfFrames() << " instead of " << numFrames << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (probe->GetCodecFourCC() != codecFourCC)
+  {
+    std::cerr << "Unexpected codec: " << probe->GetCodecFourCC() << " instead of " << codecFourCC << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (probe->GetWidth() != width || probe->GetHeight() != height || probe->GetNumberOfComponents() != 3)
+  {
+    std::cerr << "Unexpected dimensions: " << probe->GetWidth() << " x " << probe->GetHeight()
+      << " x " << probe->GetNumberOfComponents() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (probe->GetNumberOfTracks() < 1 || probe->GetNumberOfTransforms() != 0)
+  {
+    std::cerr << "Unexpected tracks: " << probe->GetNumberOfTracks() << " tracks, " << probe->GetNumberOfTransforms() << " transforms" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Header and cues only, the number of components is derived from the codec without scanning
+  probe->SetMaximumNumberOfScannedClusters(0);
+  if (!probe->Probe(fileName) || probe->GetCodecFourCC() != codecFourCC || probe->GetWidth() != width
+    || probe->GetNumberOfComponents() != 3 || probe->GetNumberOfFrames() > numFrames)
+  {
+    std::cerr << "Could not probe video header: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Bounded scan, the number of frames is estimated from the duration if the scan is incomplete
+  probe->SetMaximumNumberOfScannedClusters(1);
+  if (!probe->Probe(fileName) || probe->GetNumberOfFrames() < 1 || probe->GetNumberOfFrames() > numFrames + 1)
+  {
+    std::cerr << "Unexpected number of frames from bounded scan: " << probe->GetNumberOfFrames() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtksys::SystemTools::RemoveFile(fileName);
+
+  return EXIT_SUCCESS;
+}
@@ -36,6 +36,9 @@ Care Ontario.
 
 #include "vtkVP9VolumeCodec.h"
 
+// SlicerIGSIOCommon includes
+#include <vtkSlicerIGSIOLosslessVolumeCodec.h>
+
 //
 #include <vtkStreamingVolumeCodecFactory.h>
 
@@ -133,6 +136,7 @@ void qSlicerVideoIOModule::setup()
   // Register the codecs
   vtkStreamingVolumeCodecFactory* codecFactory = vtkStreamingVolumeCodecFactory::GetInstance();
   codecFactory->RegisterStreamingCodec(vtkSmartPointer<vtkVP9VolumeCodec>::New());
+  codecFactory->RegisterStreamingCodec(vtkSmartPointer<vtkSlicerIGSIOLosslessVolumeCodec>::New());
 }
 
 //-----------------------------------------------------------------------------
@@ -21,6 +21,7 @@ Care Ontario.
 // Qt includes
 #include <QDebug>
 #include <QStandardItemModel>
+#include <QTimer>
 #include <QTreeView>
 #include <QTextEdit>
 
@@ -36,6 +37,7 @@ Care Ontario.
 
 // SlicerIGSIOCommon includes
 #include "vtkSlicerIGSIOCommon.h"
+#include "vtkSlicerIGSIOReEncodeJob.h"
 
 // qMRMLWidgets includes
 #include <qMRMLNodeFactory.h>
@@ -57,6 +59,9 @@ public:
   qSlicerVideoIOModuleWidgetPrivate(qSlicerVideoIOModuleWidget& object);
   ~qSlicerVideoIOModuleWidgetPrivate();
 
+  /// Encoding that runs in the background. NULL if no video has been encoded yet.
+  vtkSmartPointer<vtkSlicerIGSIOReEncodeJob> EncodeJob;
+  QTimer EncodeProgressTimer;
 };
 
 //-----------------------------------------------------------------------------
@@ -96,6 +101,9 @@ void qSlicerVideoIOModuleWidget::setup()
   this->Superclass::setup();
 
   connect(d->EncodeButton, SIGNAL(clicked()), this, SLOT(encodeVideo()));
+  connect(d->CancelEncodeButton, SIGNAL(clicked()), this, SLOT(cancelEncoding()));
+  connect(&d->EncodeProgressTimer, SIGNAL(timeout()), this, SLOT(updateEncodingProgress()));
+  d->EncodeProgressTimer.setInterval(100);
   connect(d->CodecSelector, SIGNAL(currentIndexChanged(const QString &)), this, SLOT(onCodecChanged(QString)));
 
   std::vector<std::string> codecFourCCs = vtkStreamingVolumeCodecFactory::GetInstance()->GetStreamingCodecFourCCs();
@@ -171,9 +179,84 @@ void qSlicerVideoIOModuleWidget::encodeVideo()
     parameters[parameterName] = parameterValue;
   }
 
-  std::string encoding = d->CodecSelector->currentText().toStdString();
-  vtkSlicerIGSIOCommon::ReEncodeVideoSequence(sequenceNode, 0, -1, encoding, parameters, true);
+  if (d->EncodeJob && d->EncodeJob->IsRunning())
+  {
+    return;
+  }
+
+  // Frames are encoded on a background thread, and are set in the sequence once all of them have been encoded
+  d->EncodeJob = vtkSmartPointer<vtkSlicerIGSIOReEncodeJob>::New();
+  d->EncodeJob->SetSequenceNode(sequenceNode);
+  d->EncodeJob->SetCodecFourCC(d->CodecSelector->currentText().toStdString());
+  d->EncodeJob->SetCodecParameters(parameters);
+  d->EncodeJob->ForceReEncodingOn();
+  d->EncodeJob->SetNumberOfThreads(0);
+  if (!d->EncodeJob->Start())
+  {
+    d->EncodeStatusLabel->setText(tr("Encoding failed"));
+    return;
+  }
+
+  d->EncodeButton->setEnabled(false);
+  d->CancelEncodeButton->setEnabled(true);
+  d->EncodeProgressBar->setValue(0);
+  d->EncodeStatusLabel->setText(tr("Encoding..."));
+  d->EncodeProgressTimer.start();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoIOModuleWidget::cancelEncoding()
+{
+  Q_D(qSlicerVideoIOModuleWidget);
+  if (!d->EncodeJob)
+  {
+    return;
+  }
+  d->EncodeJob->Cancel();
+  d->CancelEncodeButton->setEnabled(false);
+  d->EncodeStatusLabel->setText(tr("Cancelling..."));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoIOModuleWidget::updateEncodingProgress()
+{
+  Q_D(qSlicerVideoIOModuleWidget);
+  if (!d->EncodeJob)
+  {
+    d->EncodeProgressTimer.stop();
+    return;
+  }
+
+  int status = d->EncodeJob->Update();
+  d->EncodeProgressBar->setValue(qRound(d->EncodeJob->GetProgress() * 100.0));
+  QString throughput = tr("%1 of %2 frames, %3 frames/s")
+    .arg(d->EncodeJob->GetNumberOfProcessedFrames())
+    .arg(d->EncodeJob->GetNumberOfFrames())
+    .arg(d->EncodeJob->GetFramesPerSecond(), 0, 'f', 1);
+  if (status == vtkSlicerIGSIOReEncodeJob::StatusRunning)
+  {
+    if (d->CancelEncodeButton->isEnabled())
+    {
+      d->EncodeStatusLabel->setText(tr("Encoding: %1").arg(throughput));
+    }
+    return;
+  }
 
+  d->EncodeProgressTimer.stop();
+  d->EncodeButton->setEnabled(true);
+  d->CancelEncodeButton->setEnabled(false);
+  if (status == vtkSlicerIGSIOReEncodeJob::StatusCompleted)
+  {
+    d->EncodeStatusLabel->setText(tr("Encoding completed in %1 s: %2").arg(d->EncodeJob->GetElapsedTime(), 0, 'f', 1).arg(throughput));
+  }
+  else if (status == vtkSlicerIGSIOReEncodeJob::StatusCancelled)
+  {
+    d->EncodeStatusLabel->setText(tr("Encoding cancelled"));
+  }
+  else
+  {
+    d->EncodeStatusLabel->setText(tr("Encoding failed"));
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -48,6 +48,11 @@ public slots:
 
   void onCodecChanged(const QString& fourCC);
   void encodeVideo();
+  void cancelEncoding();
+
+protected slots:
+  /// Poll the background encoding job, and update the progress of the encoding
+  void updateEncodingProgress();
 
 protected:
   QScopedPointer<qSlicerVideoIOModuleWidgetPrivate> d_ptr;
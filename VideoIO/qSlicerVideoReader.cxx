@@ -20,6 +20,7 @@ Care Ontario.
 
 // Qt includes
 #include <QDebug>
+#include <QTimer>
 
 // SlicerIGSIO include
 #include <vtkSlicerVideoIOLogic.h>
@@ -33,6 +34,9 @@ Care Ontario.
 #include "qSlicerVideoReader.h"
 
 #include "vtkSlicerIGSIOCommon.h"
+#include "vtkSlicerIGSIOInstrumentation.h"
+#include "vtkSlicerIGSIOMkvFrameIndex.h"
+#include "vtkSlicerIGSIOMkvProgressiveLoader.h"
 
 // MRML includes
 #include <vtkMRMLScene.h>
@@ -47,26 +51,55 @@ Care Ontario.
 
 //
 #include "vtkMRMLStreamingVolumeNode.h"
+#include <vtkStreamingVolumeFrame.h>
 
 #include "vtkMRMLStreamingVolumeSequenceStorageNode.h"
 
 // VTK includes
+#include <vtkCollection.h>
 #include <vtkSmartPointer.h>
 
+// STD includes
+#include <vector>
 
 //-----------------------------------------------------------------------------
 class qSlicerVideoReaderPrivate
 {
 public:
   vtkSlicerVideoIOLogic* VideoIOLogic;
+
+  /// Files that are still being read in the background
+  std::vector<vtkSmartPointer<vtkSlicerIGSIOMkvProgressiveLoader> > ProgressiveLoaders;
+  QTimer ProgressiveLoadTimer;
 };
 
+//-----------------------------------------------------------------------------
+// Mark the frames of the video sequences of the browser as unmodified, so they are not re-encoded when the sequences are saved
+static void ResetModifiedVideoFrames(vtkMRMLSequenceBrowserNode* sequenceBrowserNode)
+{
+  std::vector<vtkMRMLSequenceNode*> sequenceNodes;
+  sequenceBrowserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+  for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+  {
+    vtkMRMLSequenceNode* sequenceNode = *sequenceNodeIt;
+    vtkMRMLStreamingVolumeSequenceStorageNode* storageNode = sequenceNode ?
+      vtkMRMLStreamingVolumeSequenceStorageNode::SafeDownCast(sequenceNode->GetStorageNode()) : NULL;
+    if (storageNode)
+    {
+      storageNode->ResetModifiedFrames(sequenceNode);
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 qSlicerVideoReader::qSlicerVideoReader(vtkSlicerVideoIOLogic* newVideoIOLogic, QObject* _parent)
   : Superclass(_parent)
   , d_ptr(new qSlicerVideoReaderPrivate)
 {
+  Q_D(qSlicerVideoReader);
   this->setVideoIOLogic(newVideoIOLogic);
+  d->ProgressiveLoadTimer.setInterval(50);
+  connect(&d->ProgressiveLoadTimer, SIGNAL(timeout()), this, SLOT(updateProgressiveLoads()));
 }
 
 //-----------------------------------------------------------------------------
@@ -119,24 +152,107 @@ bool qSlicerVideoReader::load(const IOProperties& properties)
     qCritical() << Q_FUNC_INFO << " did not receive fileName property";
   }
   QString fileName = properties["fileName"].toString();
+  vtkSlicerIGSIOInstrumentation::ScopedTimer timer("Load");
+
+  // Frames are only read from the file when they are decoded
+  bool lazyRead = properties.contains("lazyRead") && properties["lazyRead"].toBool();
 
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  if (!vtkMRMLStreamingVolumeSequenceStorageNode::ReadVideo(fileName.toStdString(), trackedFrameList))
+  // The browser is created as soon as the first frame has been read, and the remaining frames are added while the file is read
+  // in the background. The frames are read lazily.
+  bool progressiveLoad = properties.contains("progressiveLoad") && properties["progressiveLoad"].toBool();
+
+  // Transforms are stored in compact transform tracks instead of transform sequences
+  bool compactTransforms = properties.contains("compactTransforms") && properties["compactTransforms"].toBool();
+  vtkSmartPointer<vtkCollection> transformTracks;
+  if (compactTransforms)
   {
-    qCritical() << Q_FUNC_INFO << " error reading video: " << fileName;
-    return false;
+    transformTracks = vtkSmartPointer<vtkCollection>::New();
   }
 
   std::string sequenceBrowserName = vtksys::SystemTools::GetFilenameWithoutExtension(fileName.toStdString());
   vtkSmartPointer<vtkMRMLSequenceBrowserNode> sequenceBrowserNode = vtkSmartPointer<vtkMRMLSequenceBrowserNode>::New();
   sequenceBrowserNode->SetName(this->mrmlScene()->GetUniqueNameByString(sequenceBrowserName.c_str()));
-  this->mrmlScene()->AddNode(sequenceBrowserNode);
 
-  if (!vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(trackedFrameList, sequenceBrowserNode))
+  std::string encodingFourCC;
+  vtkSmartPointer<vtkSlicerIGSIOMkvProgressiveLoader> progressiveLoader;
+  if (progressiveLoad)
+  {
+    progressiveLoader = vtkSmartPointer<vtkSlicerIGSIOMkvProgressiveLoader>::New();
+    progressiveLoader->SetFileName(fileName.toStdString());
+    progressiveLoader->SetSequenceBrowserNode(sequenceBrowserNode);
+    progressiveLoader->SetTransformTracks(transformTracks);
+    this->mrmlScene()->AddNode(sequenceBrowserNode);
+    if (progressiveLoader->Start())
+    {
+      vtkMRMLSequenceNode* videoSequenceNode = progressiveLoader->GetVideoSequenceNode();
+      vtkMRMLStreamingVolumeNode* firstFrameNode = videoSequenceNode ?
+        vtkMRMLStreamingVolumeNode::SafeDownCast(videoSequenceNode->GetNthDataNode(0)) : NULL;
+      if (firstFrameNode && firstFrameNode->GetFrame())
+      {
+        encodingFourCC = firstFrameNode->GetFrame()->GetCodecFourCC();
+      }
+      lazyRead = true;
+    }
+    else
+    {
+      qWarning() << Q_FUNC_INFO << " could not read video progressively, reading all frames: " << fileName;
+      progressiveLoader = NULL;
+      this->mrmlScene()->RemoveNode(sequenceBrowserNode);
+      sequenceBrowserNode = vtkSmartPointer<vtkMRMLSequenceBrowserNode>::New();
+      sequenceBrowserNode->SetName(this->mrmlScene()->GetUniqueNameByString(sequenceBrowserName.c_str()));
+      if (transformTracks)
+      {
+        transformTracks->RemoveAllItems();
+      }
+      progressiveLoad = false;
+      lazyRead = false;
+    }
+  }
+  else if (lazyRead)
+  {
+    vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex> frameIndex = vtkSmartPointer<vtkSlicerIGSIOMkvFrameIndex>::New();
+    this->mrmlScene()->AddNode(sequenceBrowserNode);
+    if (frameIndex->ReadFile(fileName.toStdString())
+      && vtkSlicerIGSIOCommon::MkvFrameIndexToSequenceBrowser(frameIndex, sequenceBrowserNode, transformTracks))
+    {
+      encodingFourCC = frameIndex->GetTrackFourCC(frameIndex->GetFirstVideoTrackNumber());
+    }
+    else
+    {
+      qWarning() << Q_FUNC_INFO << " could not read video lazily, reading all frames: " << fileName;
+      this->mrmlScene()->RemoveNode(sequenceBrowserNode);
+      sequenceBrowserNode = vtkSmartPointer<vtkMRMLSequenceBrowserNode>::New();
+      sequenceBrowserNode->SetName(this->mrmlScene()->GetUniqueNameByString(sequenceBrowserName.c_str()));
+      if (transformTracks)
+      {
+        transformTracks->RemoveAllItems();
+      }
+      lazyRead = false;
+    }
+  }
+
+  if (!lazyRead && !progressiveLoad)
   {
-    this->mrmlScene()->RemoveNode(sequenceBrowserNode);
-    qCritical() << Q_FUNC_INFO << " could not convert tracked frame list to sequence browser node";
-    return false;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (!vtkMRMLStreamingVolumeSequenceStorageNode::ReadVideo(fileName.toStdString(), trackedFrameList))
+    {
+      qCritical() << Q_FUNC_INFO << " error reading video: " << fileName;
+      return false;
+    }
+
+    trackedFrameList->GetEncodingFourCC(encodingFourCC);
+    this->mrmlScene()->AddNode(sequenceBrowserNode);
+    if (!vtkSlicerIGSIOCommon::TrackedFrameListToSequenceBrowser(trackedFrameList, sequenceBrowserNode, true, transformTracks))
+    {
+      this->mrmlScene()->RemoveNode(sequenceBrowserNode);
+      qCritical() << Q_FUNC_INFO << " could not convert tracked frame list to sequence browser node";
+      return false;
+    }
+  }
+
+  if (transformTracks)
+  {
+    this->VideoIOLogic()->AddTransformTracks(sequenceBrowserNode, transformTracks);
   }
 
   std::vector<vtkMRMLSequenceNode*> sequenceNodes;
@@ -158,11 +274,13 @@ bool qSlicerVideoReader::load(const IOProperties& properties)
     vtkSmartPointer<vtkMRMLStreamingVolumeSequenceStorageNode> storageNode = vtkSmartPointer<vtkMRMLStreamingVolumeSequenceStorageNode>::New();
     this->mrmlScene()->AddNode(storageNode.GetPointer());
     sequenceNode->SetAndObserveStorageNodeID(storageNode->GetID());
-    std::string encodingFourCC;
-    if (trackedFrameList->GetEncodingFourCC(encodingFourCC))
+    storageNode->SetLazyRead(lazyRead);
+    if (!encodingFourCC.empty())
     {
       storageNode->SetCodecFourCC(encodingFourCC);
     }
+    // The frames have just been read from the file, so they do not need to be re-encoded when the sequence is saved
+    storageNode->ResetModifiedFrames(sequenceNode);
   }
 
   vtkSlicerApplicationLogic* appLogic = this->VideoIOLogic()->GetApplicationLogic();
@@ -178,5 +296,43 @@ bool qSlicerVideoReader::load(const IOProperties& properties)
     }
   }
 
+  if (progressiveLoader && progressiveLoader->IsRunning())
+  {
+    d->ProgressiveLoaders.push_back(progressiveLoader);
+    d->ProgressiveLoadTimer.start();
+  }
+
   return true;
 }
+
+//-----------------------------------------------------------------------------
+void qSlicerVideoReader::updateProgressiveLoads()
+{
+  Q_D(qSlicerVideoReader);
+  std::vector<vtkSmartPointer<vtkSlicerIGSIOMkvProgressiveLoader> >::iterator loaderIt = d->ProgressiveLoaders.begin();
+  while (loaderIt != d->ProgressiveLoaders.end())
+  {
+    vtkSlicerIGSIOMkvProgressiveLoader* progressiveLoader = *loaderIt;
+    int status = progressiveLoader->Update();
+    if (status == vtkSlicerIGSIOMkvProgressiveLoader::StatusRunning)
+    {
+      ++loaderIt;
+      continue;
+    }
+
+    if (status == vtkSlicerIGSIOMkvProgressiveLoader::StatusFailed)
+    {
+      qCritical() << Q_FUNC_INFO << " error reading video: " << QString::fromStdString(progressiveLoader->GetFileName());
+    }
+    if (progressiveLoader->GetSequenceBrowserNode())
+    {
+      ResetModifiedVideoFrames(progressiveLoader->GetSequenceBrowserNode());
+    }
+    loaderIt = d->ProgressiveLoaders.erase(loaderIt);
+  }
+
+  if (d->ProgressiveLoaders.empty())
+  {
+    d->ProgressiveLoadTimer.stop();
+  }
+}
@@ -47,6 +47,10 @@ public:
   void setVideoIOLogic(vtkSlicerVideoIOLogic* newVideoIOLogic);
   vtkSlicerVideoIOLogic* VideoIOLogic() const;
 
+protected slots:
+  /// Add the frames that have been read by the progressive loads to the sequences
+  void updateProgressiveLoads();
+
 protected:
   QScopedPointer< qSlicerVideoReaderPrivate > d_ptr;
 